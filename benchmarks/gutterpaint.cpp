@@ -0,0 +1,170 @@
+// Gutter paint time while scrolling a 1M-line document: the cached digit
+// renderer the editor uses against drawing QString::number per row, as the
+// gutter did before. Both modes scroll through the same positions; only the
+// time spent painting the gutter is counted.
+//
+// Headless machines: QT_QPA_PLATFORM=offscreen ./bin/GutterPaintBenchmark
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextStream>
+
+#include "editor/codeeditor.h"
+
+namespace {
+
+const int kLineCount = 1000000;
+const int kWheelSteps = 5000;
+const int kPageSteps = 1000;
+
+// Exposes what the old gutter code needed from QPlainTextEdit
+class BenchmarkEditor : public CodeEditor
+{
+public:
+    void paintLegacyGutter(QWidget *gutter, QPaintEvent *event)
+    {
+        QPainter painter(gutter);
+        painter.fillRect(event->rect(), QColor(40, 40, 40));
+
+        QTextBlock block = firstVisibleBlock();
+        int blockNumber = block.blockNumber();
+        int top = (int) blockBoundingGeometry(block).translated(contentOffset()).top();
+        int bottom = top + (int) blockBoundingRect(block).height();
+
+        while (block.isValid() && top <= event->rect().bottom()) {
+            if (block.isVisible() && bottom >= event->rect().top()) {
+                QString number = QString::number(blockNumber + 1);
+                painter.setPen(QColor(120, 120, 120));
+                painter.drawText(0, top, gutter->width(), fontMetrics().height(), Qt::AlignRight, number);
+            }
+
+            block = block.next();
+            top = bottom;
+            bottom = top + (int) blockBoundingRect(block).height();
+            ++blockNumber;
+        }
+    }
+};
+
+// Paints the gutter itself, so each paint can be timed on its own
+class GutterTimer : public QObject
+{
+public:
+    GutterTimer(BenchmarkEditor *editor, QWidget *gutter)
+        : m_editor(editor), m_gutter(gutter), m_legacy(false), m_paints(0), m_nanoseconds(0) {}
+
+    void reset(bool legacy)
+    {
+        m_legacy = legacy;
+        m_paints = 0;
+        m_nanoseconds = 0;
+    }
+
+    int paints() const { return m_paints; }
+    qint64 nanoseconds() const { return m_nanoseconds; }
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event) override
+    {
+        if (object != m_gutter || event->type() != QEvent::Paint) {
+            return false;
+        }
+
+        QPaintEvent *paintEvent = static_cast<QPaintEvent *>(event);
+        QElapsedTimer timer;
+        timer.start();
+        if (m_legacy) {
+            m_editor->paintLegacyGutter(m_gutter, paintEvent);
+        } else {
+            m_editor->lineNumberAreaPaintEvent(paintEvent);
+        }
+        m_nanoseconds += timer.nsecsElapsed();
+        ++m_paints;
+        return true;
+    }
+
+private:
+    BenchmarkEditor *m_editor;
+    QWidget *m_gutter;
+    bool m_legacy;
+    int m_paints;
+    qint64 m_nanoseconds;
+};
+
+void scrollThrough(QApplication &app, QScrollBar *scrollBar, int steps, int stepSize)
+{
+    scrollBar->setValue(0);
+    app.processEvents();
+    for (int i = 0; i < steps; ++i) {
+        scrollBar->setValue((scrollBar->value() + stepSize) % qMax(1, scrollBar->maximum()));
+        app.processEvents();
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    BenchmarkEditor editor;
+    editor.resize(1000, 1000);
+
+    QString text;
+    text.reserve(kLineCount * 24);
+    for (int line = 0; line < kLineCount; ++line) {
+        text += QString("int value%1 = %1;\n").arg(line);
+    }
+    editor.setPlainText(text);
+    editor.show();
+    app.processEvents();
+
+    QWidget *gutter = nullptr;
+    for (QObject *child : editor.children()) {
+        if (LineNumberArea *area = dynamic_cast<LineNumberArea *>(child)) {
+            gutter = area;
+        }
+    }
+    if (!gutter) {
+        out << "No line number area found\n";
+        return 1;
+    }
+
+    GutterTimer timer(&editor, gutter);
+    gutter->installEventFilter(&timer);
+
+    QScrollBar *scrollBar = editor.verticalScrollBar();
+    const int pageStep = scrollBar->pageStep();
+    out << QString("%1 lines, %2 rows per page\n\n").arg(editor.blockCount()).arg(pageStep);
+    out << QString("%1 %2 %3 %4\n").arg("", -22).arg("paints", 8).arg("total ms", 10).arg("us/paint", 10);
+
+    struct Scenario {
+        const char *name;
+        int steps;
+        int stepSize;
+    };
+    const Scenario scenarios[] = {
+        { "wheel (3 lines)", kWheelSteps, 3 },
+        { "page", kPageSteps, pageStep },
+    };
+
+    for (const Scenario &scenario : scenarios) {
+        for (int legacy = 1; legacy >= 0; --legacy) {
+            timer.reset(legacy);
+            scrollThrough(app, scrollBar, scenario.steps, scenario.stepSize);
+            const QString name = QString("%1, %2").arg(scenario.name, legacy ? "string" : "cached");
+            out << QString("%1 %2 %3 %4\n")
+                       .arg(name, -22)
+                       .arg(timer.paints(), 8)
+                       .arg(timer.nanoseconds() / 1e6, 10, 'f', 1)
+                       .arg(timer.nanoseconds() / 1e3 / qMax(1, timer.paints()), 10, 'f', 1);
+        }
+    }
+
+    return 0;
+}
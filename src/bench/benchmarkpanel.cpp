@@ -0,0 +1,158 @@
+#include "benchmarkpanel.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QHeaderView>
+#include <QColor>
+#include <QFileInfo>
+#include <QSettings>
+#include <QtMath>
+
+namespace {
+
+enum Column {
+    NameColumn,
+    TimeColumn,
+    CpuColumn,
+    NoiseColumn,
+    PreviousColumn,
+    ChangeColumn
+};
+
+const int kDefaultRepetitions = 5;
+
+// Smaller changes are not reported however quiet the measurements were
+const double kMinSignificantChange = 0.03;
+
+QString formatTime(double ns)
+{
+    if (ns <= 0.0) {
+        return QString();
+    }
+    if (ns < 1e3) {
+        return QString("%1 ns").arg(ns, 0, 'f', 1);
+    }
+    if (ns < 1e6) {
+        return QString("%1 us").arg(ns / 1e3, 0, 'f', 2);
+    }
+    if (ns < 1e9) {
+        return QString("%1 ms").arg(ns / 1e6, 0, 'f', 2);
+    }
+    return QString("%1 s").arg(ns / 1e9, 0, 'f', 2);
+}
+
+} // namespace
+
+BenchmarkPanel::BenchmarkPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    m_statusLabel = new QLabel("No benchmark run yet");
+
+    m_repetitionsSpin = new QSpinBox();
+    m_repetitionsSpin->setRange(1, 100);
+    m_repetitionsSpin->setValue(QSettings().value("benchmark/repetitions", kDefaultRepetitions).toInt());
+    m_repetitionsSpin->setToolTip("Repetitions per benchmark (Google Benchmark) or samples per benchmark (Catch2)");
+
+    m_runButton = new QPushButton("Run");
+
+    QHBoxLayout *topLayout = new QHBoxLayout();
+    topLayout->addWidget(m_statusLabel, 1);
+    topLayout->addWidget(new QLabel("Repetitions:"));
+    topLayout->addWidget(m_repetitionsSpin);
+    topLayout->addWidget(m_runButton);
+
+    m_resultsTree = new QTreeWidget();
+    m_resultsTree->setRootIsDecorated(false);
+    m_resultsTree->setUniformRowHeights(true);
+    m_resultsTree->setHeaderLabels({"Benchmark", "Time", "CPU", "Noise", "Previous", "Change"});
+    m_resultsTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->setSpacing(4);
+    layout->addLayout(topLayout);
+    layout->addWidget(m_resultsTree, 1);
+
+    connect(m_runButton, &QPushButton::clicked, this, &BenchmarkPanel::runRequested);
+    connect(m_repetitionsSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int value) {
+        QSettings().setValue("benchmark/repetitions", value);
+    });
+}
+
+int BenchmarkPanel::repetitions() const
+{
+    return m_repetitionsSpin->value();
+}
+
+void BenchmarkPanel::setRunning(bool running, const QString &status)
+{
+    m_runButton->setText(running ? "Stop" : "Run");
+    m_statusLabel->setText(status);
+}
+
+void BenchmarkPanel::showError(const QString &message)
+{
+    setRunning(false, message);
+}
+
+void BenchmarkPanel::showRun(const BenchmarkRun &run, const BenchmarkBaseline &baseline)
+{
+    QString status = QString("%1 (%2), %3 benchmarks at %4")
+                         .arg(QFileInfo(run.executable).fileName(), run.framework)
+                         .arg(run.results.size())
+                         .arg(run.time.toString("HH:mm:ss"));
+    if (run.cpu >= 0) {
+        status += QString(", pinned to CPU %1").arg(run.cpu);
+    }
+    setRunning(false, status);
+
+    int regressions = 0;
+    m_resultsTree->setUpdatesEnabled(false);
+    m_resultsTree->clear();
+    for (const BenchmarkResult &result : run.results) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_resultsTree);
+        item->setText(NameColumn, result.name);
+        item->setToolTip(NameColumn, result.name);
+        item->setText(TimeColumn, formatTime(result.timeNs));
+        item->setText(CpuColumn, formatTime(result.cpuTimeNs));
+        if (result.stddevNs > 0.0) {
+            item->setText(NoiseColumn, QString("%1%").arg(100.0 * result.stddevNs / result.timeNs, 0, 'f', 1));
+        }
+        for (int column = TimeColumn; column <= ChangeColumn; ++column) {
+            item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+        }
+
+        const auto previous = baseline.constFind(result.name);
+        if (previous == baseline.constEnd() || previous.value().timeNs <= 0.0) {
+            item->setText(ChangeColumn, "new");
+            continue;
+        }
+        item->setText(PreviousColumn, formatTime(previous.value().timeNs));
+
+        // A change counts once it is clear of both runs' spread
+        const double change = result.timeNs / previous.value().timeNs - 1.0;
+        const double noise = qSqrt(qPow(result.stddevNs / result.timeNs, 2)
+                                   + qPow(previous.value().stddevNs / previous.value().timeNs, 2));
+        const double threshold = qMax(kMinSignificantChange, 2.0 * noise);
+        item->setText(ChangeColumn, QString("%1%2%").arg(change >= 0.0 ? "+" : "").arg(100.0 * change, 0, 'f', 1));
+        item->setToolTip(ChangeColumn, QString("Changes under %1% are within the noise").arg(100.0 * threshold, 0, 'f', 1));
+        if (qAbs(change) > threshold) {
+            const QColor color = change > 0.0 ? QColor(241, 76, 76) : QColor(35, 209, 139);
+            item->setForeground(ChangeColumn, color);
+            item->setForeground(NameColumn, color);
+            if (change > 0.0) {
+                ++regressions;
+            }
+        }
+    }
+    m_resultsTree->setUpdatesEnabled(true);
+
+    if (regressions > 0) {
+        m_statusLabel->setText(m_statusLabel->text() + QString(", %1 slower").arg(regressions));
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef BENCHMARKPANEL_H
+#define BENCHMARKPANEL_H
+
+#include <QWidget>
+
+#include "benchmarkrunner.h"
+
+class QLabel;
+class QSpinBox;
+class QPushButton;
+class QTreeWidget;
+
+// Results of the last benchmark run next to the previous result of each
+// benchmark. Changes beyond the measured noise are coloured: red for
+// slower, green for faster.
+class BenchmarkPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit BenchmarkPanel(QWidget *parent = nullptr);
+
+    int repetitions() const;
+
+    void setRunning(bool running, const QString &status);
+    void showRun(const BenchmarkRun &run, const BenchmarkBaseline &baseline);
+    void showError(const QString &message);
+
+signals:
+    // Run, or stop while running
+    void runRequested();
+
+private:
+    QLabel *m_statusLabel;
+    QSpinBox *m_repetitionsSpin;
+    QPushButton *m_runButton;
+    QTreeWidget *m_resultsTree;
+};
+
+#endif // BENCHMARKPANEL_H
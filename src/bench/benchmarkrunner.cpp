@@ -0,0 +1,577 @@
+#include "benchmarkrunner.h"
+#include "util/processgroup.h"
+#include "util/projectpaths.h"
+
+#include <QProcess>
+#include <QTimer>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QXmlStreamReader>
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+namespace {
+
+// Build trees can hold thousands of executables; each one is read in full
+const int kMaxCandidates = 2000;
+const qint64 kMaxExecutableSize = 512LL * 1024 * 1024;
+const int kScanChunkSize = 1024 * 1024;
+
+// Strings every build of the framework carries in its command line parser
+const char kGoogleBenchmarkMarker[] = "benchmark_min_time";
+const char kCatch2Marker[] = "benchmark-samples";
+
+// Every Catch2 test binary carries the marker; only those with test cases
+// tagged like this are benchmarks, and only those test cases are run
+const char kCatch2BenchmarkTag[] = "[!benchmark]";
+const int kListTestsTimeout = 5000;
+
+// Results are on stdout; anything bigger is not a benchmark report
+const int kMaxReportSize = 64 * 1024 * 1024;
+
+// Past this the oldest half of the history is dropped
+const qint64 kMaxHistorySize = 16 * 1024 * 1024;
+
+const int kCancelGracePeriod = 3000;
+
+#ifdef Q_OS_LINUX
+// The last core the IDE may use; the UI thread is least likely to be there
+int pinningCpu()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return -1;
+    }
+    for (int cpu = CPU_SETSIZE - 1; cpu >= 0; --cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+#else
+int pinningCpu()
+{
+    return -1;
+}
+#endif
+
+// Runs in its own process group, pinned to one core so the scheduler
+// does not move it mid-measurement
+class BenchmarkProcess : public ProcessGroupProcess
+{
+public:
+    BenchmarkProcess(int cpu, QObject *parent)
+        : ProcessGroupProcess(parent)
+#ifdef Q_OS_LINUX
+        , m_cpu(cpu)
+#endif
+    {
+        // Pinning is only implemented on Linux
+        Q_UNUSED(cpu)
+    }
+
+protected:
+    void setupChildProcess() override
+    {
+        ProcessGroupProcess::setupChildProcess();
+#ifdef Q_OS_LINUX
+        if (m_cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(m_cpu, &set);
+            ::sched_setaffinity(0, sizeof(set), &set);
+        }
+#endif
+    }
+
+#ifdef Q_OS_LINUX
+private:
+    int m_cpu;
+#endif
+};
+
+// Asks a Catch2 executable whether it has benchmark test cases. Both v2
+// and v3 end their listing with "N matching test cases" or "N test cases".
+bool hasCatch2Benchmarks(const QString &executable)
+{
+    QProcess process;
+    process.setWorkingDirectory(QFileInfo(executable).absolutePath());
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(executable, QStringList() << "--list-tests" << kCatch2BenchmarkTag);
+    if (!process.waitForFinished(kListTestsTimeout)) {
+        process.kill();
+        process.waitForFinished(1000);
+        return false;
+    }
+
+    static const QRegularExpression count("^\\s*(\\d+) (?:matching )?test cases?\\s*$",
+                                          QRegularExpression::MultilineOption);
+    const QRegularExpressionMatch match = count.match(QString::fromLocal8Bit(process.readAll()));
+    return match.hasMatch() && match.captured(1).toInt() > 0;
+}
+
+double nanoseconds(double value, const QString &unit)
+{
+    if (unit == QLatin1String("us")) {
+        return value * 1e3;
+    }
+    if (unit == QLatin1String("ms")) {
+        return value * 1e6;
+    }
+    if (unit == QLatin1String("s")) {
+        return value * 1e9;
+    }
+    return value;
+}
+
+QJsonObject resultToJson(const BenchmarkResult &result)
+{
+    QJsonObject object;
+    object.insert("name", result.name);
+    object.insert("time", result.timeNs);
+    object.insert("cpuTime", result.cpuTimeNs);
+    object.insert("stddev", result.stddevNs);
+    object.insert("samples", result.samples);
+    return object;
+}
+
+BenchmarkResult resultFromJson(const QJsonObject &object)
+{
+    BenchmarkResult result;
+    result.name = object.value("name").toString();
+    result.timeNs = object.value("time").toDouble();
+    result.cpuTimeNs = object.value("cpuTime").toDouble();
+    result.stddevNs = object.value("stddev").toDouble();
+    result.samples = object.value("samples").toInt();
+    return result;
+}
+
+} // namespace
+
+BenchmarkRunner::BenchmarkRunner(QObject *parent)
+    : QObject(parent)
+    , m_process(nullptr)
+    , m_killTimer(new QTimer(this))
+    , m_cancelled(false)
+    , m_framework(NoFramework)
+    , m_targetsWatcher(new QFutureWatcher<QVector<BenchmarkTarget>>(this))
+    , m_recordWatcher(new QFutureWatcher<BenchmarkBaseline>(this))
+{
+    m_killTimer->setSingleShot(true);
+    m_killTimer->setInterval(kCancelGracePeriod);
+    connect(m_killTimer, &QTimer::timeout, this, [this]() {
+        if (m_process) {
+            signalProcessGroup(m_process, true);
+        }
+    });
+
+    connect(m_targetsWatcher, &QFutureWatcher<QVector<BenchmarkTarget>>::finished,
+            this, &BenchmarkRunner::onTargetsFound);
+    connect(m_recordWatcher, &QFutureWatcher<BenchmarkBaseline>::finished, this, &BenchmarkRunner::onRunRecorded);
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+    if (m_process) {
+        m_process->disconnect(this);
+        signalProcessGroup(m_process, true);
+        m_process->waitForFinished(1000);
+    }
+    m_targetsWatcher->waitForFinished();
+    m_recordWatcher->waitForFinished();
+}
+
+QString BenchmarkRunner::frameworkName(Framework framework)
+{
+    switch (framework) {
+    case GoogleBenchmark:
+        return "Google Benchmark";
+    case Catch2:
+        return "Catch2";
+    default:
+        return QString();
+    }
+}
+
+BenchmarkRunner::Framework BenchmarkRunner::detectFramework(const QString &executable)
+{
+    QFile file(executable);
+    if (file.size() > kMaxExecutableSize || !file.open(QIODevice::ReadOnly)) {
+        return NoFramework;
+    }
+
+    // Scripts are not benchmarks, even when they mention the flags
+    if (file.peek(2) == "#!") {
+        return NoFramework;
+    }
+
+    // Chunks overlap by a marker's length so none is missed at a boundary
+    const int overlap = int(qMax(sizeof(kGoogleBenchmarkMarker), sizeof(kCatch2Marker)));
+    QByteArray tail;
+    while (!file.atEnd()) {
+        const QByteArray chunk = tail + file.read(kScanChunkSize);
+        if (chunk.contains(kGoogleBenchmarkMarker)) {
+            return GoogleBenchmark;
+        }
+        if (chunk.contains(kCatch2Marker)) {
+            return Catch2;
+        }
+        tail = chunk.right(overlap);
+    }
+    return NoFramework;
+}
+
+QVector<BenchmarkTarget> BenchmarkRunner::scanTargets(const QString &projectPath, const QStringList &extraExecutables)
+{
+    QStringList candidates = extraExecutables;
+
+    // Executables at the top of the project (in-tree make builds) and
+    // anywhere in its build directories
+    const QDir root(projectPath);
+    for (const QFileInfo &info : root.entryInfoList(QDir::Files | QDir::Executable)) {
+        candidates.append(info.absoluteFilePath());
+    }
+    const QStringList buildDirectories = root.entryList(QStringList() << "*build*" << "out" << "bin",
+                                                        QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString &directory : buildDirectories) {
+        QDirIterator it(root.filePath(directory), QDir::Files | QDir::Executable, QDirIterator::Subdirectories);
+        while (it.hasNext() && candidates.size() < kMaxCandidates) {
+            const QString path = it.next();
+            // CMake's compiler checks leave small test programs behind, and
+            // fetched dependencies bring their own tests and libraries
+            if (path.contains(QLatin1String("/CMakeFiles/")) || path.contains(QLatin1String("/_deps/"))) {
+                continue;
+            }
+            const QString fileName = it.fileName();
+            if (fileName.contains(QLatin1String(".so")) || fileName.endsWith(QLatin1String(".dylib"))
+                || fileName.endsWith(QLatin1String(".dll"))) {
+                continue;
+            }
+            candidates.append(path);
+        }
+    }
+
+    QVector<BenchmarkTarget> targets;
+    QSet<QString> seen;
+    for (const QString &candidate : candidates) {
+        const QString path = QFileInfo(candidate).canonicalFilePath();
+        if (path.isEmpty() || seen.contains(path)) {
+            continue;
+        }
+        seen.insert(path);
+        const Framework framework = detectFramework(path);
+        if (framework == Catch2 && !hasCatch2Benchmarks(path)) {
+            continue;
+        }
+        if (framework != NoFramework) {
+            BenchmarkTarget target;
+            target.executable = path;
+            target.framework = framework;
+            targets.append(target);
+        }
+    }
+    return targets;
+}
+
+void BenchmarkRunner::findTargets(const QString &projectPath, const QStringList &extraExecutables)
+{
+    if (m_targetsWatcher->isRunning()) {
+        return;
+    }
+    m_targetsWatcher->setFuture(QtConcurrent::run(scanTargets, projectPath, extraExecutables));
+}
+
+void BenchmarkRunner::onTargetsFound()
+{
+    emit targetsFound(m_targetsWatcher->result());
+}
+
+void BenchmarkRunner::start(const QString &projectPath, const BenchmarkTarget &target, int repetitions)
+{
+    if (isRunning()) {
+        return;
+    }
+
+    QStringList arguments;
+    if (target.framework == GoogleBenchmark) {
+        // Only the aggregates are reported, so the median is there to compare
+        arguments << "--benchmark_format=json"
+                  << QString("--benchmark_repetitions=%1").arg(qMax(1, repetitions))
+                  << "--benchmark_report_aggregates_only=true";
+    } else if (target.framework == Catch2) {
+        // Catch2's JSON reporter has no benchmark statistics; its XML one
+        // does. Its samples stand in for repetitions.
+        arguments << kCatch2BenchmarkTag << "--reporter" << "xml"
+                  << "--benchmark-samples" << QString::number(qMax(1, repetitions));
+    } else {
+        emit failed(QString("%1 is not a Google Benchmark or Catch2 executable").arg(target.executable));
+        return;
+    }
+
+    m_projectPath = projectPath;
+    m_framework = target.framework;
+    m_cancelled = false;
+    m_output.clear();
+    m_run = BenchmarkRun();
+    m_run.time = QDateTime::currentDateTime();
+    m_run.executable = target.executable;
+    m_run.framework = frameworkName(Framework(target.framework));
+    m_run.cpu = pinningCpu();
+
+    m_process = new BenchmarkProcess(m_run.cpu, this);
+    m_process->setWorkingDirectory(QFileInfo(target.executable).absolutePath());
+    connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
+        m_output += m_process->readAllStandardOutput();
+        if (m_output.size() > kMaxReportSize) {
+            m_output.clear();
+            emit outputReady("The benchmark report is over 64 MB; stopping the benchmark\n");
+            cancel();
+        }
+    });
+    connect(m_process, &QProcess::readyReadStandardError, this, &BenchmarkRunner::readError);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus exitStatus) {
+        onProcessFinished(exitCode, exitStatus == QProcess::CrashExit);
+    });
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            const QString reason = m_process->errorString();
+            m_process->deleteLater();
+            m_process = nullptr;
+            emit failed(QString("Could not start %1: %2").arg(m_run.executable, reason));
+        }
+    });
+
+    emit started(target.executable + ' ' + arguments.join(' '), m_run.cpu);
+    m_process->start(target.executable, arguments);
+}
+
+void BenchmarkRunner::cancel()
+{
+    if (!m_process || m_cancelled) {
+        return;
+    }
+    m_cancelled = true;
+    signalProcessGroup(m_process, false);
+    m_killTimer->start();
+}
+
+void BenchmarkRunner::readError()
+{
+    const QByteArray data = m_process->readAllStandardError();
+    if (!data.isEmpty()) {
+        emit outputReady(QString::fromLocal8Bit(data));
+    }
+}
+
+void BenchmarkRunner::onProcessFinished(int exitCode, bool crashed)
+{
+    m_output += m_process->readAllStandardOutput();
+    readError();
+    m_killTimer->stop();
+    m_process->deleteLater();
+    m_process = nullptr;
+
+    if (m_cancelled) {
+        emit failed("Benchmark cancelled");
+        return;
+    }
+    if (crashed) {
+        emit failed(QString("%1 crashed").arg(QFileInfo(m_run.executable).fileName()));
+        return;
+    }
+
+    QString error;
+    m_run.results = m_framework == GoogleBenchmark ? parseGoogleBenchmark(m_output, &error)
+                                                   : parseCatch2(m_output, &error);
+    m_output.clear();
+    if (m_run.results.isEmpty()) {
+        if (error.isEmpty()) {
+            error = exitCode != 0 ? QString("exited with code %1").arg(exitCode) : "no benchmarks were run";
+        }
+        emit failed(QString("%1: %2").arg(QFileInfo(m_run.executable).fileName(), error));
+        return;
+    }
+
+    // The history file is read and appended to off the UI thread
+    m_recordWatcher->setFuture(QtConcurrent::run(recordRun, historyPath(m_projectPath), m_run));
+}
+
+void BenchmarkRunner::onRunRecorded()
+{
+    emit finished(m_run, m_recordWatcher->result());
+}
+
+QVector<BenchmarkResult> BenchmarkRunner::parseGoogleBenchmark(const QByteArray &json, QString *error)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (!document.isObject()) {
+        *error = QString("unreadable JSON report: %1").arg(parseError.errorString());
+        return QVector<BenchmarkResult>();
+    }
+
+    // Without repetitions there are only iteration entries; with them the
+    // median aggregate is the figure to compare, the stddev its noise
+    QVector<BenchmarkResult> results;
+    QHash<QString, int> indexes;
+    QSet<QString> haveMedian;
+    for (const QJsonValue &value : document.object().value("benchmarks").toArray()) {
+        const QJsonObject benchmark = value.toObject();
+        if (benchmark.value("error_occurred").toBool()) {
+            continue;
+        }
+        const QString name = benchmark.value("run_name").toString(benchmark.value("name").toString());
+        const QString unit = benchmark.value("time_unit").toString("ns");
+        const double time = nanoseconds(benchmark.value("real_time").toDouble(), unit);
+        const double cpuTime = nanoseconds(benchmark.value("cpu_time").toDouble(), unit);
+
+        int index = indexes.value(name, -1);
+        if (index < 0) {
+            index = results.size();
+            indexes.insert(name, index);
+            BenchmarkResult result;
+            result.name = name;
+            results.append(result);
+        }
+        BenchmarkResult &result = results[index];
+
+        if (benchmark.value("run_type").toString() == QLatin1String("aggregate")) {
+            const QString aggregate = benchmark.value("aggregate_name").toString();
+            result.samples = benchmark.value("repetitions").toInt(result.samples);
+            if (aggregate == QLatin1String("median")) {
+                result.timeNs = time;
+                result.cpuTimeNs = cpuTime;
+                haveMedian.insert(name);
+            } else if (aggregate == QLatin1String("mean") && !haveMedian.contains(name)) {
+                result.timeNs = time;
+                result.cpuTimeNs = cpuTime;
+            } else if (aggregate == QLatin1String("stddev")) {
+                result.stddevNs = time;
+            }
+        } else if (result.samples <= 1) {
+            result.timeNs = time;
+            result.cpuTimeNs = cpuTime;
+            result.samples = 1;
+        }
+    }
+
+    // Complexity fits (_BigO, _RMS) come as aggregates without a time
+    QVector<BenchmarkResult> timed;
+    for (const BenchmarkResult &result : qAsConst(results)) {
+        if (result.timeNs > 0.0) {
+            timed.append(result);
+        }
+    }
+    return timed;
+}
+
+QVector<BenchmarkResult> BenchmarkRunner::parseCatch2(const QByteArray &xml, QString *error)
+{
+    // <TestCase name="..."> ... <BenchmarkResults name="..." samples="...">
+    //     <mean value="..."/> <standardDeviation value="..."/>
+    QVector<BenchmarkResult> results;
+    QXmlStreamReader reader(xml);
+    QString testCase;
+    BenchmarkResult current;
+    bool inBenchmark = false;
+
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            const QStringRef element = reader.name();
+            if (element == QLatin1String("TestCase")) {
+                testCase = reader.attributes().value("name").toString();
+            } else if (element == QLatin1String("BenchmarkResults")) {
+                current = BenchmarkResult();
+                const QString name = reader.attributes().value("name").toString();
+                current.name = testCase.isEmpty() ? name : testCase + '/' + name;
+                current.samples = reader.attributes().value("samples").toInt();
+                inBenchmark = true;
+            } else if (inBenchmark && element == QLatin1String("mean")) {
+                current.timeNs = reader.attributes().value("value").toDouble();
+            } else if (inBenchmark && element == QLatin1String("standardDeviation")) {
+                current.stddevNs = reader.attributes().value("value").toDouble();
+            }
+        } else if (reader.isEndElement() && reader.name() == QLatin1String("BenchmarkResults")) {
+            results.append(current);
+            inBenchmark = false;
+        }
+    }
+
+    if (reader.hasError() && results.isEmpty()) {
+        *error = QString("unreadable XML report: %1").arg(reader.errorString());
+    }
+    return results;
+}
+
+QString BenchmarkRunner::historyPath(const QString &projectPath)
+{
+    return projectCachePath(projectPath, "benchmarks", ".jsonl", QStandardPaths::AppDataLocation);
+}
+
+BenchmarkBaseline BenchmarkRunner::recordRun(const QString &historyPath, const BenchmarkRun &run)
+{
+    // One run per line, oldest first; the last line that has a benchmark
+    // holds its previous result
+    BenchmarkBaseline baseline;
+    QList<QByteArray> lines;
+    QFile file(historyPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine().trimmed();
+            if (line.isEmpty()) {
+                continue;
+            }
+            lines.append(line);
+            const QJsonObject object = QJsonDocument::fromJson(line).object();
+            if (object.value("executable").toString() != run.executable) {
+                continue;
+            }
+            for (const QJsonValue &value : object.value("results").toArray()) {
+                const BenchmarkResult result = resultFromJson(value.toObject());
+                baseline.insert(result.name, result);
+            }
+        }
+        file.close();
+    }
+
+    QJsonArray results;
+    for (const BenchmarkResult &result : run.results) {
+        results.append(resultToJson(result));
+    }
+    QJsonObject object;
+    object.insert("time", run.time.toString(Qt::ISODate));
+    object.insert("executable", run.executable);
+    object.insert("framework", run.framework);
+    object.insert("cpu", run.cpu);
+    object.insert("results", results);
+    const QByteArray entry = QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+
+    QDir().mkpath(QFileInfo(historyPath).absolutePath());
+    if (file.size() + entry.size() > kMaxHistorySize && lines.size() > 1) {
+        // Rewritten with the newer half of the runs
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            for (int i = lines.size() / 2; i < lines.size(); ++i) {
+                file.write(lines.at(i) + '\n');
+            }
+            file.write(entry);
+        }
+    } else if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write(entry);
+    }
+    return baseline;
+}
@@ -0,0 +1,110 @@
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+#include <QDateTime>
+#include <QFutureWatcher>
+
+class QProcess;
+class QTimer;
+
+// One benchmark of a run. Times are in nanoseconds per iteration: the
+// median over the repetitions for Google Benchmark, the mean over the
+// samples for Catch2, which has no CPU time of its own.
+struct BenchmarkResult
+{
+    QString name;
+    double timeNs = 0.0;
+    double cpuTimeNs = 0.0;
+    double stddevNs = 0.0;
+    int samples = 0;
+};
+
+struct BenchmarkRun
+{
+    QDateTime time;
+    QString executable;
+    QString framework;
+    int cpu = -1;   // the core it was pinned to, or -1
+    QVector<BenchmarkResult> results;
+};
+
+struct BenchmarkTarget
+{
+    QString executable;
+    int framework = 0;   // BenchmarkRunner::Framework
+};
+
+// Previous result of each benchmark of an executable, by name
+typedef QHash<QString, BenchmarkResult> BenchmarkBaseline;
+
+// Finds Google Benchmark and Catch2 executables in a project's build
+// directories and runs one of them pinned to a single core, with machine
+// readable output. Every run is appended to the project's history (a JSON
+// lines file in the application data directory) and handed out with the
+// latest earlier result of each benchmark, so changes show up per run.
+class BenchmarkRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Framework {
+        NoFramework,
+        GoogleBenchmark,
+        Catch2
+    };
+
+    explicit BenchmarkRunner(QObject *parent = nullptr);
+    ~BenchmarkRunner();
+
+    static QString frameworkName(Framework framework);
+    static Framework detectFramework(const QString &executable);
+
+    bool isRunning() const { return m_process != nullptr || m_recordWatcher->isRunning(); }
+    bool isSearching() const { return m_targetsWatcher->isRunning(); }
+
+    // extraExecutables (e.g. from run configurations) are checked as well
+    void findTargets(const QString &projectPath, const QStringList &extraExecutables);
+    void start(const QString &projectPath, const BenchmarkTarget &target, int repetitions);
+    void cancel();
+
+signals:
+    void targetsFound(const QVector<BenchmarkTarget> &targets);
+    void started(const QString &commandLine, int cpu);
+    // Progress and diagnostics the benchmark prints besides its results
+    void outputReady(const QString &text);
+    void finished(const BenchmarkRun &run, const BenchmarkBaseline &baseline);
+    void failed(const QString &message);
+
+private slots:
+    void readError();
+    void onTargetsFound();
+    void onRunRecorded();
+
+private:
+    void onProcessFinished(int exitCode, bool crashed);
+
+    static QString historyPath(const QString &projectPath);
+    static QVector<BenchmarkTarget> scanTargets(const QString &projectPath, const QStringList &extraExecutables);
+    static BenchmarkBaseline recordRun(const QString &historyPath, const BenchmarkRun &run);
+    static QVector<BenchmarkResult> parseGoogleBenchmark(const QByteArray &json, QString *error);
+    static QVector<BenchmarkResult> parseCatch2(const QByteArray &xml, QString *error);
+
+    QProcess *m_process;
+    QTimer *m_killTimer;
+    QByteArray m_output;
+    bool m_cancelled;
+    QString m_projectPath;
+    BenchmarkRun m_run;
+    int m_framework;
+
+    QFutureWatcher<QVector<BenchmarkTarget>> *m_targetsWatcher;
+    QFutureWatcher<BenchmarkBaseline> *m_recordWatcher;
+};
+
+#endif // BENCHMARKRUNNER_H
@@ -0,0 +1,458 @@
+#include "buildmanager.h"
+#include "util/processgroup.h"
+
+#include <QProcess>
+#include <QTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtConcurrent>
+
+namespace {
+
+// Output is handed out at most this often, or sooner once this much is
+// waiting
+const int kOutputFlushInterval = 50;
+const int kMaxPendingOutput = 256 * 1024;
+
+// Time a cancelled build gets to exit before it is killed
+const int kCancelGracePeriod = 3000;
+
+// Length of data without a trailing, incomplete UTF-8 sequence
+int completeUtf8Length(const QByteArray &data)
+{
+    int start = data.size();
+    while (start > 0 && start > data.size() - 4 && (uchar(data.at(start - 1)) & 0xC0) == 0x80) {
+        --start;
+    }
+    if (start == 0) {
+        return data.size();
+    }
+
+    const uchar lead = uchar(data.at(start - 1));
+    int length = 1;
+    if ((lead & 0xE0) == 0xC0) {
+        length = 2;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4;
+    }
+    return data.size() - (start - 1) < length ? start - 1 : data.size();
+}
+
+QString commandLine(const BuildStep &step)
+{
+    if (step.arguments.size() == 2 && step.arguments.first() == QLatin1String("-c")) {
+        return step.arguments.last();
+    }
+    QStringList parts(step.program);
+    for (const QString &argument : step.arguments) {
+        parts.append(argument.contains(' ') ? '"' + argument + '"' : argument);
+    }
+    return parts.join(' ');
+}
+
+} // namespace
+
+BuildManager::BuildManager(QObject *parent)
+    : QObject(parent)
+    , m_jobCount(qMax(1, QThread::idealThreadCount()))
+    , m_process(nullptr)
+    , m_flushTimer(new QTimer(this))
+    , m_killTimer(new QTimer(this))
+    , m_running(false)
+    , m_cancelled(false)
+    , m_compileCommandsWatcher(new QFutureWatcher<CompileCommands>(this))
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kOutputFlushInterval);
+    connect(m_flushTimer, &QTimer::timeout, this, &BuildManager::flushOutput);
+
+    m_killTimer->setSingleShot(true);
+    m_killTimer->setInterval(kCancelGracePeriod);
+    connect(m_killTimer, &QTimer::timeout, this, [this]() {
+        if (m_process) {
+            signalProcessGroup(m_process, true);
+        }
+    });
+
+    connect(m_compileCommandsWatcher, &QFutureWatcher<CompileCommands>::finished,
+            this, &BuildManager::onCompileCommandsLoaded);
+}
+
+BuildManager::~BuildManager()
+{
+    if (m_process) {
+        m_process->disconnect(this);
+        signalProcessGroup(m_process, true);
+        m_process->waitForFinished(1000);
+    }
+    m_compileCommandsWatcher->waitForFinished();
+}
+
+BuildManager::System BuildManager::detectSystem(const QString &projectPath)
+{
+    const QDir dir(projectPath);
+    if (dir.exists("CMakeLists.txt")) {
+        return CMake;
+    }
+    if (dir.exists("build.ninja")) {
+        return Ninja;
+    }
+    if (dir.exists("Makefile") || dir.exists("makefile") || dir.exists("GNUmakefile")) {
+        return Make;
+    }
+    return NoSystem;
+}
+
+QString BuildManager::systemName(System system)
+{
+    switch (system) {
+    case CMake:
+        return "CMake";
+    case Ninja:
+        return "Ninja";
+    case Make:
+        return "Make";
+    case NoSystem:
+        break;
+    }
+    return QString();
+}
+
+QString BuildManager::cmakeBuildDirectory(const QString &projectPath)
+{
+    // An existing configured tree wins: build/ first, then build-*,
+    // cmake-build-* and the like
+    const QDir dir(projectPath);
+    if (dir.exists("build/CMakeCache.txt")) {
+        return dir.filePath("build");
+    }
+    const QStringList candidates = dir.entryList(QStringList() << "*build*", QDir::Dirs | QDir::NoDotAndDotDot,
+                                                 QDir::Name);
+    for (const QString &candidate : candidates) {
+        if (dir.exists(candidate + "/CMakeCache.txt")) {
+            return dir.filePath(candidate);
+        }
+    }
+    return dir.filePath("build");
+}
+
+QString BuildManager::compileCommandsPath(const QString &projectPath, System system)
+{
+    if (system == CMake) {
+        return cmakeBuildDirectory(projectPath) + "/compile_commands.json";
+    }
+    const QDir dir(projectPath);
+    if (!dir.exists("compile_commands.json") && dir.exists("build/compile_commands.json")) {
+        return dir.filePath("build/compile_commands.json");
+    }
+    return dir.filePath("compile_commands.json");
+}
+
+BuildStep BuildManager::configureStep(const QString &projectPath, const QString &buildDirectory)
+{
+    // The compilation database makes single-file builds possible and helps
+    // clangd as well
+    BuildStep step{"cmake", QStringList() << "-S" << projectPath << "-B" << buildDirectory
+                                           << "-DCMAKE_EXPORT_COMPILE_COMMANDS=ON", projectPath};
+    if (!QFileInfo::exists(buildDirectory + "/CMakeCache.txt")
+            && !QStandardPaths::findExecutable("ninja").isEmpty()) {
+        step.arguments << "-G" << "Ninja";
+    }
+    return step;
+}
+
+void BuildManager::buildProject(const QString &projectPath)
+{
+    if (m_running) {
+        return;
+    }
+
+    const System system = detectSystem(projectPath);
+    const QString jobs = QString::number(m_jobCount);
+    QVector<BuildStep> steps;
+    switch (system) {
+    case CMake: {
+        const QString buildDirectory = cmakeBuildDirectory(projectPath);
+        if (!QFileInfo::exists(buildDirectory + "/CMakeCache.txt")) {
+            steps.append(configureStep(projectPath, buildDirectory));
+        }
+        steps.append(BuildStep{"cmake", QStringList() << "--build" << buildDirectory << "--parallel" << jobs,
+                               projectPath});
+        break;
+    }
+    case Ninja:
+        steps.append(BuildStep{"ninja", QStringList() << "-j" << jobs, projectPath});
+        break;
+    case Make:
+        steps.append(BuildStep{"make", QStringList() << "-j" + jobs, projectPath});
+        break;
+    case NoSystem:
+        break;
+    }
+
+    start(QString("Building %1 with %2, %3 jobs").arg(QDir::toNativeSeparators(projectPath), systemName(system), jobs),
+          steps);
+    if (system == NoSystem) {
+        fail(QString("No CMakeLists.txt, build.ninja or Makefile in %1").arg(QDir::toNativeSeparators(projectPath)));
+    }
+}
+
+void BuildManager::buildFile(const QString &projectPath, const QString &filePath)
+{
+    if (m_running) {
+        return;
+    }
+
+    const System system = detectSystem(projectPath);
+    m_fileToBuild = QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+    m_compileCommandsPath = compileCommandsPath(projectPath, system);
+    const QString relativePath = QDir(projectPath).relativeFilePath(m_fileToBuild);
+
+    BuildStep lookup;
+    lookup.compileCommandLookup = true;
+
+    // The compilation database has the exact command the build would run.
+    // Without one, CMake writes it; Ninja and Make are asked for the
+    // object file by their own conventions.
+    QVector<BuildStep> steps;
+    if (QFileInfo::exists(m_compileCommandsPath)) {
+        steps.append(lookup);
+    } else if (system == CMake) {
+        steps.append(configureStep(projectPath, cmakeBuildDirectory(projectPath)));
+        steps.append(lookup);
+    } else if (system == Ninja) {
+        steps.append(BuildStep{"ninja", QStringList() << relativePath + '^', projectPath});
+    } else if (system == Make) {
+        const QFileInfo source(relativePath);
+        const QString object = source.path() == QLatin1String(".")
+            ? source.completeBaseName() + ".o"
+            : source.path() + '/' + source.completeBaseName() + ".o";
+        steps.append(BuildStep{"make", QStringList() << object, projectPath});
+    }
+
+    start(QString("Compiling %1").arg(QDir::toNativeSeparators(relativePath)), steps);
+    if (steps.isEmpty()) {
+        fail(QString("No CMakeLists.txt, build.ninja or Makefile in %1").arg(QDir::toNativeSeparators(projectPath)));
+    }
+}
+
+void BuildManager::cancel()
+{
+    if (!m_running || m_cancelled) {
+        return;
+    }
+    m_cancelled = true;
+    m_steps.clear();
+    if (m_process) {
+        signalProcessGroup(m_process, false);
+        m_killTimer->start();
+    }
+    // A compile command lookup finishes on its own and sees the flag
+}
+
+void BuildManager::start(const QString &description, const QVector<BuildStep> &steps)
+{
+    m_running = true;
+    m_cancelled = false;
+    m_steps = steps;
+    m_pendingOutput.clear();
+    m_buildTimer.start();
+    emit buildStarted(description);
+
+    if (!m_steps.isEmpty()) {
+        runNextStep();
+    }
+}
+
+void BuildManager::runNextStep()
+{
+    if (m_cancelled) {
+        finish(false);
+        return;
+    }
+    if (m_steps.isEmpty()) {
+        finish(true);
+        return;
+    }
+
+    const BuildStep step = m_steps.takeFirst();
+    if (step.compileCommandLookup) {
+        resolveCompileCommand();
+        return;
+    }
+
+    // Its own process group, so make and ninja are stopped together with
+    // the compilers they started
+    m_process = new ProcessGroupProcess(this);
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    m_process->setWorkingDirectory(step.workingDirectory);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &BuildManager::readOutput);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus exitStatus) {
+        onStepFinished(exitCode, exitStatus == QProcess::CrashExit);
+    });
+    connect(m_process, &QProcess::errorOccurred, this, [this, step](QProcess::ProcessError error) {
+        // Nothing else is reported for a program that never ran
+        if (error == QProcess::FailedToStart) {
+            const QString reason = m_process->errorString();
+            m_process->deleteLater();
+            m_process = nullptr;
+            fail(QString("Could not start %1: %2").arg(step.program, reason));
+        }
+    });
+
+    emit stepStarted(commandLine(step), step.workingDirectory);
+    m_process->start(step.program, step.arguments);
+}
+
+void BuildManager::readOutput()
+{
+    m_pendingOutput += m_process->readAllStandardOutput();
+    if (m_pendingOutput.size() >= kMaxPendingOutput) {
+        flushOutput();
+    } else if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void BuildManager::flushOutput()
+{
+    // Only whole lines go out, so a UTF-8 sequence or a diagnostic is never
+    // split between two batches. A line longer than the cap is the
+    // exception; it goes out in pieces rather than piling up.
+    int end = m_pendingOutput.lastIndexOf('\n') + 1;
+    if (end <= 0) {
+        if (m_pendingOutput.size() < kMaxPendingOutput) {
+            return;
+        }
+        end = completeUtf8Length(m_pendingOutput);
+    }
+    const QString text = QString::fromUtf8(m_pendingOutput.constData(), end);
+    m_pendingOutput.remove(0, end);
+    emit outputReady(text);
+}
+
+void BuildManager::onStepFinished(int exitCode, bool crashed)
+{
+    readOutput();
+    if (!m_pendingOutput.isEmpty() && !m_pendingOutput.endsWith('\n')) {
+        m_pendingOutput += '\n';
+    }
+    m_flushTimer->stop();
+    flushOutput();
+
+    m_killTimer->stop();
+    m_process->deleteLater();
+    m_process = nullptr;
+
+    if (m_cancelled) {
+        finish(false);
+    } else if (crashed) {
+        fail("The build process crashed");
+    } else if (exitCode != 0) {
+        fail(QString("The build process exited with code %1").arg(exitCode));
+    } else {
+        runNextStep();
+    }
+}
+
+void BuildManager::resolveCompileCommand()
+{
+    const QDateTime modified = QFileInfo(m_compileCommandsPath).lastModified();
+    if (m_compileCommandsPath == m_loadedCompileCommandsPath && modified == m_compileCommandsModified) {
+        runCompileCommand();
+        return;
+    }
+
+    // Databases of big projects run to megabytes of JSON
+    m_loadedCompileCommandsPath = m_compileCommandsPath;
+    m_compileCommandsModified = modified;
+    m_compileCommandsWatcher->setFuture(QtConcurrent::run(&BuildManager::readCompileCommands, m_compileCommandsPath));
+}
+
+void BuildManager::onCompileCommandsLoaded()
+{
+    m_compileCommands = m_compileCommandsWatcher->result();
+    runCompileCommand();
+}
+
+void BuildManager::runCompileCommand()
+{
+    if (m_cancelled) {
+        finish(false);
+        return;
+    }
+
+    auto it = m_compileCommands.constFind(m_fileToBuild);
+    if (it == m_compileCommands.constEnd()) {
+        it = m_compileCommands.constFind(QFileInfo(m_fileToBuild).canonicalFilePath());
+    }
+    if (it == m_compileCommands.constEnd()) {
+        fail(QString("%1 has no entry in %2; only sources the build compiles can be built on their own")
+                 .arg(QDir::toNativeSeparators(m_fileToBuild), QDir::toNativeSeparators(m_compileCommandsPath)));
+        return;
+    }
+
+    m_steps.prepend(it.value());
+    runNextStep();
+}
+
+CompileCommands BuildManager::readCompileCommands(const QString &path)
+{
+    CompileCommands commands;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return commands;
+    }
+
+    const QJsonArray entries = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue &value : entries) {
+        const QJsonObject entry = value.toObject();
+        const QString directory = entry.value("directory").toString();
+
+        BuildStep step;
+        step.workingDirectory = directory;
+        if (entry.contains("arguments")) {
+            for (const QJsonValue &argument : entry.value("arguments").toArray()) {
+                step.arguments.append(argument.toString());
+            }
+            if (step.arguments.isEmpty()) {
+                continue;
+            }
+            step.program = step.arguments.takeFirst();
+        } else {
+            // "command" is a shell command line
+#ifdef Q_OS_WIN
+            step.program = "cmd";
+            step.arguments << "/c" << entry.value("command").toString();
+#else
+            step.program = "/bin/sh";
+            step.arguments << "-c" << entry.value("command").toString();
+#endif
+        }
+        commands.insert(QDir::cleanPath(QDir(directory).absoluteFilePath(entry.value("file").toString())), step);
+    }
+    return commands;
+}
+
+void BuildManager::fail(const QString &message)
+{
+    emit outputReady(message + '\n');
+    finish(false);
+}
+
+void BuildManager::finish(bool success)
+{
+    m_running = false;
+    m_steps.clear();
+    m_killTimer->stop();
+    emit buildFinished(success, m_cancelled, m_buildTimer.elapsed());
+}
@@ -0,0 +1,108 @@
+#ifndef BUILDMANAGER_H
+#define BUILDMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+
+class QProcess;
+class QTimer;
+
+// One command of a build
+struct BuildStep
+{
+    QString program;
+    QStringList arguments;
+    QString workingDirectory;
+    bool compileCommandLookup = false;   // resolves the next step from the compilation database
+};
+
+// compile_commands.json entries by absolute source path
+typedef QHash<QString, BuildStep> CompileCommands;
+
+// Runs the project's own build system (CMake, Ninja or Make) in a QProcess
+// with one job per core. Output is merged and handed out in batches of
+// whole lines instead of line by line. A build runs in its own process
+// group, so cancelling stops the compilers as well as the driver.
+// buildFile() compiles a single source with its command from the
+// compilation database, for quick edit-compile loops.
+class BuildManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum System {
+        NoSystem,
+        CMake,
+        Ninja,
+        Make
+    };
+
+    explicit BuildManager(QObject *parent = nullptr);
+    ~BuildManager();
+
+    static System detectSystem(const QString &projectPath);
+    static QString systemName(System system);
+
+    bool isRunning() const { return m_running; }
+    int jobCount() const { return m_jobCount; }
+
+    void buildProject(const QString &projectPath);
+    void buildFile(const QString &projectPath, const QString &filePath);
+    void cancel();
+
+signals:
+    void buildStarted(const QString &description);
+    // Relative paths in the step's output are relative to workingDirectory
+    void stepStarted(const QString &commandLine, const QString &workingDirectory);
+    // Whole lines of compiler output, several per call
+    void outputReady(const QString &text);
+    void buildFinished(bool success, bool cancelled, qint64 elapsedMs);
+
+private slots:
+    void readOutput();
+    void flushOutput();
+    void onCompileCommandsLoaded();
+
+private:
+    void start(const QString &description, const QVector<BuildStep> &steps);
+    void runNextStep();
+    void onStepFinished(int exitCode, bool crashed);
+    void finish(bool success);
+    void fail(const QString &message);
+    void resolveCompileCommand();
+    void runCompileCommand();
+
+    static QString cmakeBuildDirectory(const QString &projectPath);
+    static QString compileCommandsPath(const QString &projectPath, System system);
+    static BuildStep configureStep(const QString &projectPath, const QString &buildDirectory);
+    static CompileCommands readCompileCommands(const QString &path);
+
+    int m_jobCount;
+    QVector<BuildStep> m_steps;
+    QProcess *m_process;
+    QTimer *m_flushTimer;
+    QTimer *m_killTimer;
+    QByteArray m_pendingOutput;
+    QElapsedTimer m_buildTimer;
+    bool m_running;
+    bool m_cancelled;
+
+    // Single-file builds: the target and the database it is looked up in
+    QString m_fileToBuild;
+    QString m_compileCommandsPath;
+
+    // The last database read, reused while the file is unchanged
+    CompileCommands m_compileCommands;
+    QString m_loadedCompileCommandsPath;
+    QDateTime m_compileCommandsModified;
+    QFutureWatcher<CompileCommands> *m_compileCommandsWatcher;
+};
+
+#endif // BUILDMANAGER_H
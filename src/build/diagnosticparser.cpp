@@ -0,0 +1,287 @@
+#include "diagnosticparser.h"
+
+#include <QDir>
+
+namespace {
+
+const int kMaxPathLength = 1024;
+const int kMaxSeverityLength = 40;
+const int kMaxMessageLength = 4000;
+const int kMaxLineNumber = 100000000;
+const int kMaxCachedPaths = 10000;
+
+inline bool isDigit(ushort c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Characters that end a run copied or skipped in bulk
+inline bool endsRun(ushort c)
+{
+    return c == '\n' || c == '\r' || c == 0x1b;
+}
+
+} // namespace
+
+DiagnosticParser::DiagnosticParser()
+    : m_escape(0)
+{
+    startLine();
+}
+
+void DiagnosticParser::setBaseDirectory(const QString &directory)
+{
+    if (directory != m_baseDirectory) {
+        m_baseDirectory = directory;
+        m_resolvedPaths.clear();
+    }
+}
+
+void DiagnosticParser::reset()
+{
+    m_escape = 0;
+    startLine();
+}
+
+void DiagnosticParser::startLine()
+{
+    m_state = LineStart;
+    m_path.clear();
+    m_line = 0;
+    m_column = -1;
+    m_severityWord.clear();
+    m_severity = BuildDiagnostic::Error;
+    m_message.clear();
+}
+
+void DiagnosticParser::parse(const QString &text, QVector<BuildDiagnostic> *diagnostics)
+{
+    const QChar *data = text.constData();
+    const int length = text.length();
+    int pos = 0;
+
+    while (pos < length) {
+        const ushort c = data[pos].unicode();
+
+        // Colour sequences may sit anywhere, even inside a path
+        if (m_escape == 1) {
+            m_escape = c == '[' ? 2 : 0;
+            ++pos;
+            continue;
+        }
+        if (m_escape == 2) {
+            if (c >= 0x40 && c <= 0x7e) {
+                m_escape = 0;
+            }
+            ++pos;
+            continue;
+        }
+        if (c == 0x1b) {
+            m_escape = 1;
+            ++pos;
+            continue;
+        }
+        if (c == '\r') {
+            ++pos;
+            continue;
+        }
+        if (c == '\n') {
+            if ((m_state == Message || m_state == MessageStart) && !m_path.isEmpty()) {
+                BuildDiagnostic diagnostic;
+                diagnostic.filePath = resolvePath(m_path);
+                diagnostic.line = qMax(0, m_line - 1);
+                diagnostic.column = qMax(0, m_column - 1);
+                diagnostic.severity = m_severity;
+                diagnostic.message = m_message;
+                diagnostics->append(diagnostic);
+            }
+            startLine();
+            ++pos;
+            continue;
+        }
+
+        // Most of the output is paths, messages and lines being skipped;
+        // those are taken a run at a time
+        if (m_state == Skip || m_state == Message || m_state == Path) {
+            int end = pos;
+            if (m_state == Path) {
+                while (end < length && !endsRun(data[end].unicode()) && data[end] != QLatin1Char(':')
+                       && data[end] != QLatin1Char('(')) {
+                    ++end;
+                }
+                m_path.append(data + pos, end - pos);
+                if (m_path.size() > kMaxPathLength) {
+                    m_state = Skip;
+                }
+                if (end < length && !endsRun(data[end].unicode()) && m_state == Path) {
+                    m_state = data[end] == QLatin1Char(':') ? PathColon : PathParen;
+                    ++end;
+                }
+            } else {
+                while (end < length && !endsRun(data[end].unicode())) {
+                    ++end;
+                }
+                if (m_state == Message) {
+                    m_message.append(data + pos, qBound(0, kMaxMessageLength - m_message.size(), end - pos));
+                }
+            }
+            pos = end;
+            continue;
+        }
+
+        bool consumed = true;
+        switch (m_state) {
+        case LineStart:
+            // Source excerpts, carets and "from file:line" continuations are
+            // indented; nothing indented is a diagnostic of its own
+            if (c == ' ' || c == '\t') {
+                m_state = Skip;
+            } else {
+                m_state = Path;
+                consumed = false;
+            }
+            break;
+        case PathColon:
+            if (isDigit(c)) {
+                m_line = c - '0';
+                m_state = LineNumber;
+            } else if (c == ' ') {
+                // "file: In function ...", "make: ***", "ld: error: ..."
+                m_state = Skip;
+            } else {
+                // A drive letter or any other colon in the path
+                m_path += QLatin1Char(':');
+                m_state = Path;
+                consumed = false;
+            }
+            break;
+        case PathParen:
+            if (isDigit(c)) {
+                m_line = c - '0';
+                m_state = MsvcLine;
+            } else {
+                m_path += QLatin1Char('(');
+                m_state = Path;
+                consumed = false;
+            }
+            break;
+        case LineNumber:
+        case MsvcLine:
+            if (isDigit(c) && m_line < kMaxLineNumber) {
+                m_line = m_line * 10 + (c - '0');
+            } else if (c == ':' && m_state == LineNumber) {
+                m_state = LineColon;
+            } else if (c == ',' && m_state == MsvcLine) {
+                m_column = 0;
+                m_state = MsvcColumn;
+            } else if (c == ')' && m_state == MsvcLine) {
+                m_state = MsvcClose;
+            } else {
+                m_state = Skip;
+            }
+            break;
+        case LineColon:
+            if (isDigit(c)) {
+                m_column = c - '0';
+                m_state = ColumnNumber;
+            } else if (c == ' ') {
+                // No column: "file:12: warning: ..."
+                m_state = SeverityWord;
+            } else {
+                m_state = Skip;
+            }
+            break;
+        case ColumnNumber:
+        case MsvcColumn:
+            if (isDigit(c) && m_column < kMaxLineNumber) {
+                m_column = m_column * 10 + (c - '0');
+            } else if (c == ':' && m_state == ColumnNumber) {
+                m_state = SeverityWord;
+            } else if (c == ')' && m_state == MsvcColumn) {
+                m_state = MsvcClose;
+            } else {
+                m_state = Skip;
+            }
+            break;
+        case MsvcClose:
+            if (c == ':') {
+                m_state = SeverityWord;
+            } else if (c != ' ') {
+                m_state = Skip;
+            }
+            break;
+        case SeverityWord:
+            if (c == ':') {
+                m_state = takeSeverity() ? MessageStart : Skip;
+            } else if (c != ' ' || !m_severityWord.isEmpty()) {
+                m_severityWord += QChar(c);
+                if (m_severityWord.size() > kMaxSeverityLength) {
+                    m_state = Skip;
+                }
+            }
+            break;
+        case MessageStart:
+            if (c != ' ') {
+                m_state = Message;
+                consumed = false;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (consumed) {
+            ++pos;
+        }
+    }
+}
+
+bool DiagnosticParser::takeSeverity()
+{
+    static const struct {
+        const char *word;
+        BuildDiagnostic::Severity severity;
+    } severities[] = {
+        {"error", BuildDiagnostic::Error},
+        {"fatal error", BuildDiagnostic::Error},
+        {"warning", BuildDiagnostic::Warning},
+        {"note", BuildDiagnostic::Note}
+    };
+
+    for (const auto &entry : severities) {
+        const QLatin1String word(entry.word);
+        if (!m_severityWord.startsWith(word)) {
+            continue;
+        }
+        // MSVC follows the word with its code: "error C2065"
+        const QStringRef rest = m_severityWord.midRef(word.size());
+        if (!rest.isEmpty() && rest.at(0) != QLatin1Char(' ')) {
+            continue;
+        }
+        const QStringRef code = rest.trimmed();
+        if (!code.isEmpty()) {
+            if (code.contains(QLatin1Char(' '))) {
+                continue;
+            }
+            m_message = code.toString() + QLatin1String(": ");
+        }
+        m_severity = entry.severity;
+        return true;
+    }
+    return false;
+}
+
+QString DiagnosticParser::resolvePath(const QString &path)
+{
+    const auto it = m_resolvedPaths.constFind(path);
+    if (it != m_resolvedPaths.constEnd()) {
+        return it.value();
+    }
+
+    const QString resolved = QDir::cleanPath(QDir(m_baseDirectory).absoluteFilePath(path));
+    if (m_resolvedPaths.size() >= kMaxCachedPaths) {
+        m_resolvedPaths.clear();
+    }
+    m_resolvedPaths.insert(path, resolved);
+    return resolved;
+}
@@ -0,0 +1,81 @@
+#ifndef DIAGNOSTICPARSER_H
+#define DIAGNOSTICPARSER_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+// One compiler message. line and column are zero-based.
+struct BuildDiagnostic
+{
+    enum Severity {
+        Error,
+        Warning,
+        Note
+    };
+
+    QString filePath;
+    int line = 0;
+    int column = 0;
+    Severity severity = Error;
+    QString message;
+};
+
+// Picks compiler diagnostics out of build output as it arrives:
+//     file:line:column: error: message        (GCC, Clang)
+//     file:line: warning: message
+//     file(line,column): error C2065: message (MSVC)
+// A single pass over the characters drives a small state machine, so each
+// byte is looked at once and lines that cannot be diagnostics (source
+// excerpts, carets, progress lines) are dropped at their first character
+// that does not fit. ANSI colour sequences are skipped. A line split
+// between two calls is continued where it stopped.
+class DiagnosticParser
+{
+public:
+    DiagnosticParser();
+
+    // Relative paths are resolved against the current build step's directory
+    void setBaseDirectory(const QString &directory);
+    QString baseDirectory() const { return m_baseDirectory; }
+    void reset();
+
+    void parse(const QString &text, QVector<BuildDiagnostic> *diagnostics);
+
+private:
+    enum State {
+        LineStart,
+        Path,
+        PathColon,
+        PathParen,
+        LineNumber,
+        LineColon,
+        ColumnNumber,
+        MsvcLine,
+        MsvcColumn,
+        MsvcClose,
+        SeverityWord,
+        MessageStart,
+        Message,
+        Skip
+    };
+
+    void startLine();
+    bool takeSeverity();
+    QString resolvePath(const QString &path);
+
+    State m_state;
+    int m_escape;   // 1 after ESC, 2 inside ESC [ ... until its final byte
+    QString m_path;
+    int m_line;
+    int m_column;
+    QString m_severityWord;
+    BuildDiagnostic::Severity m_severity;
+    QString m_message;
+
+    QString m_baseDirectory;
+    // Raw paths repeat for every warning in a header, so each is resolved once
+    QHash<QString, QString> m_resolvedPaths;
+};
+
+#endif // DIAGNOSTICPARSER_H
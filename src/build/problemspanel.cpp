@@ -0,0 +1,250 @@
+#include "problemspanel.h"
+
+#include <QVBoxLayout>
+#include <QLabel>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QFileInfo>
+#include <QApplication>
+#include <QStyle>
+
+namespace {
+
+enum ProblemRole {
+    FilePathRole = Qt::UserRole,
+    LineRole,
+    ColumnRole
+};
+
+// A -j64 build can report tens of thousands of warnings; past this many
+// the tree only counts them, while editors still get every one
+const int kMaxShownProblems = 20000;
+
+// Squiggles are handed to the editors at most this often
+const int kPublishInterval = 100;
+
+const int kMaxMessagePreview = 300;
+
+QString problemKey(const BuildDiagnostic &diagnostic)
+{
+    return diagnostic.filePath + '\n' + QString::number(diagnostic.line) + ':'
+           + QString::number(diagnostic.column) + '\n' + diagnostic.message;
+}
+
+void setupItem(QTreeWidgetItem *item, const BuildDiagnostic &diagnostic, const QString &location)
+{
+    QStyle::StandardPixmap icon = QStyle::SP_MessageBoxInformation;
+    if (diagnostic.severity == BuildDiagnostic::Error) {
+        icon = QStyle::SP_MessageBoxCritical;
+    } else if (diagnostic.severity == BuildDiagnostic::Warning) {
+        icon = QStyle::SP_MessageBoxWarning;
+    }
+    item->setIcon(0, QApplication::style()->standardIcon(icon));
+    item->setText(0, QString("%1  %2").arg(location, diagnostic.message.left(kMaxMessagePreview)));
+    item->setToolTip(0, diagnostic.message.left(2000));
+    item->setData(0, FilePathRole, diagnostic.filePath);
+    item->setData(0, LineRole, diagnostic.line);
+    item->setData(0, ColumnRole, diagnostic.column);
+}
+
+} // namespace
+
+ProblemsPanel::ProblemsPanel(QWidget *parent)
+    : QWidget(parent)
+    , m_lastProblemItem(nullptr)
+    , m_errorCount(0)
+    , m_warningCount(0)
+    , m_shownCount(0)
+{
+    m_statusLabel = new QLabel("No problems");
+
+    m_problemsTree = new QTreeWidget();
+    m_problemsTree->setHeaderHidden(true);
+    m_problemsTree->setUniformRowHeights(true);
+    m_problemsTree->setColumnCount(1);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->setSpacing(4);
+    layout->addWidget(m_statusLabel);
+    layout->addWidget(m_problemsTree, 1);
+
+    m_publishTimer = new QTimer(this);
+    m_publishTimer->setSingleShot(true);
+    m_publishTimer->setInterval(kPublishInterval);
+    connect(m_publishTimer, &QTimer::timeout, this, &ProblemsPanel::publishChanges);
+
+    connect(m_problemsTree, &QTreeWidget::itemActivated, this, &ProblemsPanel::onItemActivated);
+}
+
+void ProblemsPanel::clear()
+{
+    // Files that had problems get their squiggles taken away
+    for (auto it = m_diagnostics.constBegin(); it != m_diagnostics.constEnd(); ++it) {
+        m_changedFiles.insert(it.key());
+    }
+
+    m_parser.reset();
+    m_problemsTree->clear();
+    m_fileItems.clear();
+    m_diagnostics.clear();
+    m_seen.clear();
+    m_lastProblemItem = nullptr;
+    m_errorCount = 0;
+    m_warningCount = 0;
+    m_shownCount = 0;
+    updateStatus();
+
+    if (!m_changedFiles.isEmpty() && !m_publishTimer->isActive()) {
+        m_publishTimer->start();
+    }
+}
+
+void ProblemsPanel::setBaseDirectory(const QString &directory)
+{
+    m_parser.setBaseDirectory(directory);
+}
+
+void ProblemsPanel::addOutput(const QString &text)
+{
+    m_parsed.clear();
+    m_parser.parse(text, &m_parsed);
+    if (!m_parsed.isEmpty()) {
+        addDiagnostics(m_parsed);
+    }
+}
+
+bool ProblemsPanel::activateOutputLine(const QString &line)
+{
+    // A parser of its own, so a build still streaming in is not disturbed
+    DiagnosticParser parser;
+    parser.setBaseDirectory(m_parser.baseDirectory());
+    QVector<BuildDiagnostic> diagnostics;
+    parser.parse(line + '\n', &diagnostics);
+    if (diagnostics.isEmpty()) {
+        return false;
+    }
+    const BuildDiagnostic &diagnostic = diagnostics.first();
+    emit problemActivated(diagnostic.filePath, diagnostic.line, diagnostic.column, 0);
+    return true;
+}
+
+QTreeWidgetItem *ProblemsPanel::fileItem(const QString &filePath)
+{
+    QTreeWidgetItem *item = m_fileItems.value(filePath);
+    if (!item) {
+        item = new QTreeWidgetItem(m_problemsTree);
+        item->setText(0, QFileInfo(filePath).fileName());
+        item->setToolTip(0, filePath);
+        item->setData(0, FilePathRole, filePath);
+        item->setData(0, LineRole, -1);
+        item->setExpanded(true);
+        m_fileItems.insert(filePath, item);
+    }
+    return item;
+}
+
+void ProblemsPanel::addDiagnostics(const QVector<BuildDiagnostic> &diagnostics)
+{
+    m_problemsTree->setUpdatesEnabled(false);
+
+    for (const BuildDiagnostic &diagnostic : diagnostics) {
+        if (diagnostic.severity == BuildDiagnostic::Note) {
+            // Notes are shown with the problem they explain, or not at all
+            if (m_lastProblemItem) {
+                QTreeWidgetItem *item = new QTreeWidgetItem(m_lastProblemItem);
+                setupItem(item, diagnostic, QString("%1:%2").arg(QFileInfo(diagnostic.filePath).fileName())
+                                                            .arg(diagnostic.line + 1));
+            }
+            continue;
+        }
+
+        m_lastProblemItem = nullptr;
+        const QString key = problemKey(diagnostic);
+        if (m_seen.contains(key)) {
+            continue;
+        }
+        m_seen.insert(key);
+
+        if (diagnostic.severity == BuildDiagnostic::Error) {
+            ++m_errorCount;
+        } else {
+            ++m_warningCount;
+        }
+        m_diagnostics[diagnostic.filePath].append(diagnostic);
+        m_changedFiles.insert(diagnostic.filePath);
+
+        if (m_shownCount >= kMaxShownProblems) {
+            continue;
+        }
+        ++m_shownCount;
+
+        // Kept in line order; a compiler reports a file top to bottom, so
+        // the end is nearly always the right place
+        QTreeWidgetItem *parent = fileItem(diagnostic.filePath);
+        int index = parent->childCount();
+        if (index > 0 && parent->child(index - 1)->data(0, LineRole).toInt() > diagnostic.line) {
+            int low = 0;
+            int high = index - 1;
+            while (low < high) {
+                const int middle = (low + high) / 2;
+                if (parent->child(middle)->data(0, LineRole).toInt() > diagnostic.line) {
+                    high = middle;
+                } else {
+                    low = middle + 1;
+                }
+            }
+            index = low;
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem();
+        setupItem(item, diagnostic, QString("%1:%2").arg(diagnostic.line + 1).arg(diagnostic.column + 1));
+        parent->insertChild(index, item);
+        m_lastProblemItem = item;
+    }
+
+    m_problemsTree->setUpdatesEnabled(true);
+    updateStatus();
+
+    if (!m_changedFiles.isEmpty() && !m_publishTimer->isActive()) {
+        m_publishTimer->start();
+    }
+}
+
+void ProblemsPanel::publishChanges()
+{
+    // File labels carry their problem count
+    for (const QString &filePath : qAsConst(m_changedFiles)) {
+        if (QTreeWidgetItem *item = m_fileItems.value(filePath)) {
+            item->setText(0, QString("%1 (%2)").arg(QFileInfo(filePath).fileName())
+                                               .arg(m_diagnostics.value(filePath).size()));
+        }
+    }
+
+    const QStringList filePaths = m_changedFiles.values();
+    m_changedFiles.clear();
+    emit diagnosticsChanged(filePaths);
+}
+
+void ProblemsPanel::updateStatus()
+{
+    if (m_errorCount == 0 && m_warningCount == 0) {
+        m_statusLabel->setText("No problems");
+        return;
+    }
+    QString status = QString("%1 errors, %2 warnings").arg(m_errorCount).arg(m_warningCount);
+    if (m_errorCount + m_warningCount > m_shownCount) {
+        status += QString(", showing the first %1").arg(m_shownCount);
+    }
+    m_statusLabel->setText(status);
+}
+
+void ProblemsPanel::onItemActivated(QTreeWidgetItem *item)
+{
+    const int line = item->data(0, LineRole).toInt();
+    if (line < 0) {
+        return;
+    }
+    emit problemActivated(item->data(0, FilePathRole).toString(), line, item->data(0, ColumnRole).toInt(), 0);
+}
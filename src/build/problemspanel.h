@@ -0,0 +1,75 @@
+#ifndef PROBLEMSPANEL_H
+#define PROBLEMSPANEL_H
+
+#include <QWidget>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QStringList>
+
+#include "diagnosticparser.h"
+
+class QLabel;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Problems of the last build, parsed from its output as it streams in and
+// listed under their file in line order. Notes hang under the problem
+// they explain, and a warning repeated by every file that includes a
+// header is listed once. Editor squiggles for changed files are handed
+// out in batches, not per diagnostic.
+class ProblemsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ProblemsPanel(QWidget *parent = nullptr);
+
+    void clear();
+    void setBaseDirectory(const QString &directory);
+    void addOutput(const QString &text);
+
+    // Jumps to the diagnostic on a line of output, if there is one
+    bool activateOutputLine(const QString &line);
+
+    // Errors and warnings only; notes are not marked in the editor
+    QVector<BuildDiagnostic> diagnosticsFor(const QString &filePath) const { return m_diagnostics.value(filePath); }
+    int errorCount() const { return m_errorCount; }
+    int warningCount() const { return m_warningCount; }
+
+signals:
+    // line is zero-based
+    void problemActivated(const QString &filePath, int line, int column, int length);
+    void diagnosticsChanged(const QStringList &filePaths);
+
+private slots:
+    void onItemActivated(QTreeWidgetItem *item);
+    void publishChanges();
+
+private:
+    void addDiagnostics(const QVector<BuildDiagnostic> &diagnostics);
+    QTreeWidgetItem *fileItem(const QString &filePath);
+    void updateStatus();
+
+    DiagnosticParser m_parser;
+    QVector<BuildDiagnostic> m_parsed;
+
+    QLabel *m_statusLabel;
+    QTreeWidget *m_problemsTree;
+    QTimer *m_publishTimer;
+
+    QHash<QString, QTreeWidgetItem*> m_fileItems;
+    QHash<QString, QVector<BuildDiagnostic>> m_diagnostics;
+    QSet<QString> m_seen;
+    QSet<QString> m_changedFiles;
+
+    // Notes that follow a problem are put under it
+    QTreeWidgetItem *m_lastProblemItem;
+
+    int m_errorCount;
+    int m_warningCount;
+    int m_shownCount;
+};
+
+#endif // PROBLEMSPANEL_H
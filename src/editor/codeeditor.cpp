@@ -1,5 +1,7 @@
 #include "codeeditor.h"
 #include "syntaxhighlighter.h"
+#include "fileloader.h"
+#include "symbols/symbolindex.h"
 
 #include <QPainter>
 #include <QTextBlock>
@@ -8,11 +10,43 @@
 #include <QAbstractItemView>
 #include <QScrollBar>
 #include <QFileInfo>
+#include <QStringListModel>
+#include <QToolTip>
+#include <QHelpEvent>
+#include <QSet>
+
+namespace {
+
+// Squiggles beyond this many are not drawn; the problems are still listed
+const int kMaxDiagnosticSelections = 1000;
+
+// Typing offers completions from this many characters on; each source
+// contributes at most the given number, which bounds the work per keystroke
+const int kMinCompletionPrefix = 2;
+const int kMaxLocalCompletions = 100;
+const int kMaxProjectCompletions = 100;
+
+inline bool isIdentifierChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+} // namespace
 
 CodeEditor::CodeEditor(QWidget *parent)
     : QPlainTextEdit(parent)
     , m_lineNumberArea(nullptr)
     , m_syntaxHighlighter(nullptr)
+    , m_fileLoader(nullptr)
+    , m_gutterFirstBlock(-1)
+    , m_gutterOffset(0)
+    , m_gutterBlockCount(-1)
+    , m_completer(nullptr)
+    , m_completionModel(nullptr)
+    , m_completionStart(-1)
+    , m_externalCompletionStart(-1)
+    , m_hoverLine(-1)
+    , m_hoverColumn(-1)
 {
     setupEditor();
 }
@@ -24,11 +58,14 @@ void CodeEditor::setupEditor()
     
     // Set up syntax highlighter
     m_syntaxHighlighter = new SyntaxHighlighter(document());
+    m_syntaxHighlighter->setLazyHighlighting(true);
+    m_syntaxHighlighter->setBackgroundLexing(true);
     
     // Connect signals
     connect(this, &CodeEditor::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
     connect(this, &CodeEditor::updateRequest, this, &CodeEditor::updateLineNumberArea);
     connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
+    connect(document(), &QTextDocument::contentsChange, this, &CodeEditor::onContentsChange);
     
     updateLineNumberAreaWidth(0);
     highlightCurrentLine();
@@ -59,6 +96,116 @@ void CodeEditor::setCurrentFile(const QString &fileName)
     m_syntaxHighlighter->setLanguage(extension);
 }
 
+void CodeEditor::loadFile(const QString &fileName)
+{
+    delete m_fileLoader;
+    
+    clear();
+    setReadOnly(true);
+    document()->setUndoRedoEnabled(false);
+    
+    m_fileLoader = new FileLoader(fileName, this);
+    connect(m_fileLoader, &FileLoader::textLoaded, this, &CodeEditor::appendLoadedText);
+    connect(m_fileLoader, &FileLoader::progress, this, &CodeEditor::onLoadProgress);
+    connect(m_fileLoader, &FileLoader::finished, this, &CodeEditor::onLoadFinished);
+    connect(m_fileLoader, &FileLoader::failed, this, &CodeEditor::onLoadFailed);
+    m_fileLoader->start();
+}
+
+void CodeEditor::appendLoadedText(const QString &text)
+{
+    // Append through a private cursor so the user's cursor and scroll
+    // position are left alone while the rest of the file arrives.
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+}
+
+void CodeEditor::onLoadProgress(qint64 bytesRead, qint64 totalBytes)
+{
+    if (totalBytes > 0) {
+        emit loadProgress(int(qMin<qint64>(100, bytesRead * 100 / totalBytes)));
+    }
+}
+
+void CodeEditor::onLoadFinished()
+{
+    m_fileLoader->deleteLater();
+    m_fileLoader = nullptr;
+    
+    document()->setUndoRedoEnabled(true);
+    document()->setModified(false);
+    setReadOnly(false);
+    highlightCurrentLine();
+    
+    emit loadFinished();
+}
+
+void CodeEditor::onLoadFailed(const QString &error)
+{
+    m_fileLoader->deleteLater();
+    m_fileLoader = nullptr;
+    
+    document()->setUndoRedoEnabled(true);
+    setReadOnly(false);
+    
+    emit loadFailed(error);
+}
+
+void CodeEditor::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    // Mirror the edit into the piece table. QTextDocument counts the final
+    // paragraph separator in some change notifications, so clamp to the real
+    // text length and fall back to a full resync if the lengths disagree.
+    const int documentLength = document()->characterCount() - 1;
+    const int removed = qMin(charsRemoved, m_textBuffer.length() - position);
+    const int added = qMin(charsAdded, documentLength - position);
+    
+    QString text;
+    if (added > 0) {
+        QTextCursor cursor(document());
+        cursor.setPosition(position);
+        cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+        
+        // selectedText() uses Unicode separators where toPlainText() has '\n'
+        text = cursor.selectedText();
+        text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+        text.replace(QChar::LineSeparator, QLatin1Char('\n'));
+    }
+    
+    // Highlighting reports untouched text as changed; nothing to mirror
+    const TextSnapshot before = m_textBuffer.snapshot();
+    if (removed == added && m_textBuffer.length() == documentLength
+        && (removed <= 0 || before.text(position, removed) == text)) {
+        return;
+    }
+    
+    // The range is taken from the text as it was before the edit
+    EditorChange change;
+    change.startLine = before.lineOfPosition(position);
+    change.startColumn = position - before.positionOfLine(change.startLine);
+    change.endLine = before.lineOfPosition(position + qMax(0, removed));
+    change.endColumn = position + qMax(0, removed) - before.positionOfLine(change.endLine);
+    change.text = text;
+    
+    m_textBuffer.remove(position, removed);
+    if (added > 0) {
+        m_textBuffer.insert(position, text);
+    }
+    
+    if (m_textBuffer.length() != documentLength) {
+        m_textBuffer.setText(document()->toPlainText());
+        change = EditorChange();
+        change.fullText = true;
+        change.text = m_textBuffer.snapshot().text();
+    }
+    
+    // Appends while streaming a file in are not edits
+    if (!m_fileLoader) {
+        emit contentsEdited(change);
+    }
+}
+
 int CodeEditor::lineNumberAreaWidth()
 {
     int digits = 1;
@@ -79,13 +226,44 @@ void CodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
 
 void CodeEditor::updateLineNumberArea(const QRect &rect, int dy)
 {
+    // Scrolling blits the rows already painted and exposes only the new
+    // ones. Partial update requests (cursor blink, typing within a line)
+    // leave the numbering as it is, so the gutter is not touched.
+    const bool numberingChanged = gutterNumberingChanged();
+    const bool fullUpdate = rect.contains(viewport()->rect());
     if (dy)
         m_lineNumberArea->scroll(0, dy);
-    else
-        m_lineNumberArea->update(0, rect.y(), m_lineNumberArea->width(), rect.height());
+    else if (numberingChanged || fullUpdate)
+        m_lineNumberArea->update();
 
-    if (rect.contains(viewport()->rect()))
+    if (fullUpdate)
         updateLineNumberAreaWidth(0);
+
+    updateVisibleBlockRange();
+}
+
+bool CodeEditor::gutterNumberingChanged()
+{
+    const int firstBlock = firstVisibleBlock().blockNumber();
+    const int offset = (int) contentOffset().y();
+    const int count = blockCount();
+    if (firstBlock == m_gutterFirstBlock && offset == m_gutterOffset && count == m_gutterBlockCount)
+        return false;
+
+    m_gutterFirstBlock = firstBlock;
+    m_gutterOffset = offset;
+    m_gutterBlockCount = count;
+    return true;
+}
+
+void CodeEditor::updateVisibleBlockRange()
+{
+    // Lines have a fixed height with NoWrap, so the last visible block can be
+    // derived without walking the layout.
+    const int firstBlock = firstVisibleBlock().blockNumber();
+    const int lineHeight = qMax(1, fontMetrics().lineSpacing());
+    const int lastBlock = firstBlock + viewport()->height() / lineHeight + 1;
+    m_syntaxHighlighter->setVisibleBlockRange(firstBlock, lastBlock);
 }
 
 void CodeEditor::resizeEvent(QResizeEvent *e)
@@ -112,36 +290,310 @@ void CodeEditor::highlightCurrentLine()
         extraSelections.append(selection);
     }
 
+    // Squiggles go on top of the line highlight
+    extraSelections.append(m_diagnosticSelections);
     setExtraSelections(extraSelections);
 }
 
+void CodeEditor::setDiagnostics(const QString &source, const QVector<EditorDiagnostic> &diagnostics)
+{
+    if (diagnostics.isEmpty()) {
+        m_diagnostics.remove(source);
+    } else {
+        m_diagnostics.insert(source, diagnostics);
+    }
+    updateDiagnosticSelections();
+    highlightCurrentLine();
+}
+
+void CodeEditor::updateDiagnosticSelections()
+{
+    // The selections' cursors follow later edits on their own
+    m_diagnosticSelections.clear();
+    for (auto it = m_diagnostics.constBegin(); it != m_diagnostics.constEnd(); ++it) {
+        for (const EditorDiagnostic &diagnostic : it.value()) {
+            if (m_diagnosticSelections.size() >= kMaxDiagnosticSelections) {
+                return;
+            }
+            const QTextBlock startBlock = document()->findBlockByNumber(diagnostic.line);
+            if (!startBlock.isValid()) {
+                continue;
+            }
+            QTextBlock endBlock = document()->findBlockByNumber(diagnostic.endLine);
+            if (!endBlock.isValid()) {
+                endBlock = startBlock;
+            }
+            
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(document());
+            int start = startBlock.position() + qBound(0, diagnostic.column, startBlock.length() - 1);
+            int end = endBlock.position() + qBound(0, diagnostic.endColumn, endBlock.length() - 1);
+            if (end <= start) {
+                // Point diagnostics underline the word or character they sit on
+                QTextCursor word(document());
+                word.setPosition(start);
+                word.select(QTextCursor::WordUnderCursor);
+                start = word.hasSelection() ? word.selectionStart() : start;
+                end = word.hasSelection() ? word.selectionEnd() : qMin(start + 1, document()->characterCount() - 1);
+            }
+            selection.cursor.setPosition(start);
+            selection.cursor.setPosition(end, QTextCursor::KeepAnchor);
+            
+            QColor color(230, 60, 60);
+            if (diagnostic.severity == EditorDiagnostic::Warning) {
+                color = QColor(230, 180, 40);
+            } else if (diagnostic.severity > EditorDiagnostic::Warning) {
+                color = QColor(90, 150, 230);
+            }
+            selection.format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+            selection.format.setUnderlineColor(color);
+            m_diagnosticSelections.append(selection);
+        }
+    }
+}
+
+QStringList CodeEditor::diagnosticsAt(int line, int column) const
+{
+    QStringList messages;
+    for (auto it = m_diagnostics.constBegin(); it != m_diagnostics.constEnd(); ++it) {
+        for (const EditorDiagnostic &diagnostic : it.value()) {
+            const bool afterStart = line > diagnostic.line || (line == diagnostic.line && column >= diagnostic.column);
+            const bool beforeEnd = line < diagnostic.endLine
+                                   || (line == diagnostic.endLine && column <= qMax(diagnostic.endColumn, diagnostic.column + 1));
+            if (afterStart && beforeEnd) {
+                messages.append(diagnostic.message);
+            }
+        }
+    }
+    return messages;
+}
+
+bool CodeEditor::viewportEvent(QEvent *event)
+{
+    if (event->type() != QEvent::ToolTip) {
+        return QPlainTextEdit::viewportEvent(event);
+    }
+    
+    // Problems under the mouse show at once; hover text follows from the
+    // language server, if any
+    QHelpEvent *helpEvent = static_cast<QHelpEvent*>(event);
+    const QTextCursor cursor = cursorForPosition(helpEvent->pos());
+    m_hoverLine = cursor.blockNumber();
+    m_hoverColumn = cursor.positionInBlock();
+    
+    const QStringList messages = diagnosticsAt(m_hoverLine, m_hoverColumn);
+    if (messages.isEmpty()) {
+        QToolTip::hideText();
+    } else {
+        QToolTip::showText(helpEvent->globalPos(), messages.join('\n'), viewport());
+    }
+    emit hoverRequested(m_hoverLine, m_hoverColumn, helpEvent->globalPos());
+    return true;
+}
+
+void CodeEditor::showHover(int line, int column, const QString &text, const QPoint &globalPos)
+{
+    if (line != m_hoverLine || column != m_hoverColumn || text.isEmpty() || !underMouse()) {
+        return;
+    }
+    QStringList parts = diagnosticsAt(line, column);
+    parts.append(text);
+    QToolTip::showText(globalPos, parts.join(QStringLiteral("\n\n")), viewport());
+}
+
+void CodeEditor::ensureCompleter()
+{
+    if (m_completer) {
+        return;
+    }
+    m_completionModel = new QStringListModel(this);
+    m_completer = new QCompleter(m_completionModel, this);
+    m_completer->setWidget(this);
+    m_completer->setCompletionMode(QCompleter::PopupCompletion);
+    m_completer->setCaseSensitivity(Qt::CaseInsensitive);
+    m_completer->setMaxVisibleItems(12);
+    connect(m_completer, QOverload<const QString &>::of(&QCompleter::activated),
+            this, &CodeEditor::insertCompletion);
+    connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::updateCompletionPopup);
+}
+
+void CodeEditor::showCompletions(const QStringList &items, int startPosition)
+{
+    ensureCompleter();
+    m_completionStart = startPosition;
+    m_externalCompletions = items;
+    m_externalCompletionStart = startPosition;
+    
+    const QString prefix = completionPrefix();
+    if (!prefix.isNull()) {
+        refreshCompletions(prefix);
+    }
+    updateCompletionPopup();
+}
+
+void CodeEditor::completeWord(bool explicitRequest)
+{
+    const QTextCursor cursor = textCursor();
+    const QTextBlock block = cursor.block();
+    const QString text = block.text();
+    const int column = cursor.positionInBlock();
+    int start = column;
+    while (start > 0 && isIdentifierChar(text.at(start - 1))) {
+        --start;
+    }
+    
+    const QString prefix = text.mid(start, column - start);
+    if (cursor.hasSelection() || (!explicitRequest && prefix.size() < kMinCompletionPrefix)
+            || (!prefix.isEmpty() && prefix.at(0).isDigit())) {
+        if (m_completer) {
+            m_completionStart = -1;
+            m_completer->popup()->hide();
+        }
+        return;
+    }
+    
+    ensureCompleter();
+    m_completionStart = block.position() + start;
+    refreshCompletions(prefix);
+    updateCompletionPopup();
+}
+
+QString CodeEditor::completionPrefix() const
+{
+    // Null unless the cursor is still inside the word being completed
+    const QTextCursor cursor = textCursor();
+    const QTextBlock block = cursor.block();
+    const int position = cursor.position();
+    if (m_completionStart < block.position() || position < m_completionStart || cursor.hasSelection()) {
+        return QString();
+    }
+    
+    const QString prefix = block.text().mid(m_completionStart - block.position(), position - m_completionStart);
+    for (const QChar c : prefix) {
+        if (!isIdentifierChar(c)) {
+            return QString();
+        }
+    }
+    return prefix.isNull() ? QStringLiteral("") : prefix;
+}
+
+void CodeEditor::refreshCompletions(const QString &prefix)
+{
+    // Language server items first, then the document's identifiers, then
+    // the project's symbols. The trie lookups cost well under a millisecond
+    // even with 100k identifiers, so this runs on every keystroke.
+    QStringList items;
+    QSet<QString> seen;
+    auto add = [&](const QStringList &words) {
+        for (const QString &word : words) {
+            // The word being typed is itself in the document
+            if (word != prefix && !seen.contains(word)) {
+                seen.insert(word);
+                items.append(word);
+            }
+        }
+    };
+    if (m_externalCompletionStart == m_completionStart) {
+        add(m_externalCompletions);
+    }
+    add(m_syntaxHighlighter->identifiers().complete(prefix, kMaxLocalCompletions));
+    if (m_symbolIndex) {
+        add(m_symbolIndex->completions(prefix, kMaxProjectCompletions));
+    }
+    m_completionModel->setStringList(items);
+}
+
+void CodeEditor::updateCompletionPopup()
+{
+    if (!m_completer || m_completionStart < 0) {
+        return;
+    }
+    
+    // The popup follows the word being typed and closes when it ends
+    const QString prefix = completionPrefix();
+    bool valid = !prefix.isNull();
+    if (valid) {
+        m_completer->setCompletionPrefix(prefix);
+        valid = m_completer->completionCount() > 0;
+    }
+    if (!valid) {
+        m_completionStart = -1;
+        m_completer->popup()->hide();
+        return;
+    }
+    
+    QRect rect = cursorRect();
+    rect.setWidth(m_completer->popup()->sizeHintForColumn(0)
+                  + m_completer->popup()->verticalScrollBar()->sizeHint().width());
+    m_completer->complete(rect);
+}
+
+void CodeEditor::insertCompletion(const QString &completion)
+{
+    if (m_completionStart < 0) {
+        return;
+    }
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(m_completionStart, QTextCursor::KeepAnchor);
+    m_completionStart = -1;
+    cursor.insertText(completion);
+    setTextCursor(cursor);
+}
+
 void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
 {
     QPainter painter(m_lineNumberArea);
     painter.fillRect(event->rect(), QColor(40, 40, 40));
 
+    m_gutterRenderer.setStyle(font(), QColor(120, 120, 120), m_lineNumberArea->devicePixelRatioF());
+
+    const int right = m_lineNumberArea->width();
+    const int paintTop = event->rect().top();
+    const int paintBottom = event->rect().bottom();
+
     QTextBlock block = firstVisibleBlock();
     int blockNumber = block.blockNumber();
     int top = (int) blockBoundingGeometry(block).translated(contentOffset()).top();
-    int bottom = top + (int) blockBoundingRect(block).height();
-
-    while (block.isValid() && top <= event->rect().bottom()) {
-        if (block.isVisible() && bottom >= event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
-            painter.setPen(QColor(120, 120, 120));
-            painter.drawText(0, top, m_lineNumberArea->width(), fontMetrics().height(),
-                           Qt::AlignRight, number);
+
+    while (block.isValid() && top <= paintBottom) {
+        const int height = (int) blockBoundingRect(block).height();
+        if (block.isVisible() && top + height >= paintTop) {
+            m_gutterRenderer.drawNumber(&painter, right, top, blockNumber + 1);
         }
 
         block = block.next();
-        top = bottom;
-        bottom = top + (int) blockBoundingRect(block).height();
+        top += height;
         ++blockNumber;
     }
 }
 
 void CodeEditor::keyPressEvent(QKeyEvent *event)
 {
+    // While completions are shown, these keys belong to the popup
+    if (m_completer && m_completer->popup()->isVisible()) {
+        switch (event->key()) {
+        case Qt::Key_Escape:
+            // Dismissed until completions are offered again
+            m_completionStart = -1;
+            event->ignore();
+            return;
+        case Qt::Key_Enter:
+        case Qt::Key_Return:
+        case Qt::Key_Tab:
+        case Qt::Key_Backtab:
+            event->ignore();
+            return;
+        default:
+            break;
+        }
+    }
+    
+    if (event->key() == Qt::Key_Space && (event->modifiers() & Qt::ControlModifier)) {
+        completeWord(true);
+        emit completionRequested();
+        return;
+    }
+    
     // Handle auto-indentation
     if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
         QPlainTextEdit::keyPressEvent(event);
@@ -190,6 +642,14 @@ void CodeEditor::keyPressEvent(QKeyEvent *event)
     }
     
     QPlainTextEdit::keyPressEvent(event);
+    
+    // Typing a word offers completions; deleting within it refreshes them
+    const QString typed = event->text();
+    const bool plainKey = !(event->modifiers() & (Qt::ControlModifier | Qt::AltModifier));
+    if ((plainKey && typed.size() == 1 && isIdentifierChar(typed.at(0)))
+            || (event->key() == Qt::Key_Backspace && m_completionStart >= 0)) {
+        completeWord(false);
+    }
 }
 
 void CodeEditor::autoIndent()
@@ -7,9 +7,50 @@
 #include <QResizeEvent>
 #include <QSize>
 #include <QRect>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QPointer>
+
+#include "piecetable.h"
+#include "gutterrenderer.h"
 
 class LineNumberArea;
 class SyntaxHighlighter;
+class FileLoader;
+class QCompleter;
+class QStringListModel;
+class SymbolIndex;
+
+// One edit in language-server terms: the replaced range, in lines and UTF-16
+// columns of the text before the edit, and the text that replaced it
+struct EditorChange
+{
+    int startLine = 0;
+    int startColumn = 0;
+    int endLine = 0;
+    int endColumn = 0;
+    QString text;
+    bool fullText = false;   // the range is void; text is the whole document
+};
+
+// A problem reported for a range of the text. Severities match LSP.
+struct EditorDiagnostic
+{
+    enum Severity {
+        Error = 1,
+        Warning,
+        Information,
+        Hint
+    };
+
+    int line = 0;
+    int column = 0;
+    int endLine = 0;
+    int endColumn = 0;
+    Severity severity = Error;
+    QString message;
+};
 
 class CodeEditor : public QPlainTextEdit
 {
@@ -23,24 +64,97 @@ public:
     
     QString currentFile() const { return m_currentFile; }
     void setCurrentFile(const QString &fileName);
+    
+    SyntaxHighlighter *syntaxHighlighter() const { return m_syntaxHighlighter; }
+    
+    // O(1) immutable copy of the current text for background consumers
+    // (saving, indexing, AI context); never copies on the GUI thread.
+    TextSnapshot textSnapshot() const { return m_textBuffer.snapshot(); }
+    
+    // Streams the file into the document on a worker; the editor stays
+    // read-only until loadFinished or loadFailed.
+    void loadFile(const QString &fileName);
+    bool isLoading() const { return m_fileLoader != nullptr; }
+    
+    // Underlines the ranges; each source (language server, build) replaces
+    // only its own set
+    void setDiagnostics(const QString &source, const QVector<EditorDiagnostic> &diagnostics);
+    
+    // Typing a word offers the document's own identifiers and, if set, the
+    // project's symbols
+    void setSymbolIndex(SymbolIndex *index) { m_symbolIndex = index; }
+    
+    // Offers items for the word that starts at startPosition, ahead of the
+    // local ones; the popup filters them as typing goes on and closes when
+    // the word ends
+    void showCompletions(const QStringList &items, int startPosition);
+    // Answer to hoverRequested; dropped if the mouse has moved on since
+    void showHover(int line, int column, const QString &text, const QPoint &globalPos);
+
+signals:
+    void loadProgress(int percent);
+    void loadFinished();
+    void loadFailed(const QString &error);
+    // User edits after loading, as deltas
+    void contentsEdited(const EditorChange &change);
+    void completionRequested();
+    void hoverRequested(int line, int column, const QPoint &globalPos);
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
 
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
     void highlightCurrentLine();
     void updateLineNumberArea(const QRect &rect, int dy);
+    void appendLoadedText(const QString &text);
+    void onLoadProgress(qint64 bytesRead, qint64 totalBytes);
+    void onLoadFinished();
+    void onLoadFailed(const QString &error);
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void updateCompletionPopup();
+    void insertCompletion(const QString &completion);
 
 private:
     void setupEditor();
+    void updateVisibleBlockRange();
+    bool gutterNumberingChanged();
     void autoIndent();
-    void autoComplete();
+    void ensureCompleter();
+    void completeWord(bool explicitRequest);
+    QString completionPrefix() const;
+    void refreshCompletions(const QString &prefix);
+    void updateDiagnosticSelections();
+    QStringList diagnosticsAt(int line, int column) const;
     
     QWidget *m_lineNumberArea;
     SyntaxHighlighter *m_syntaxHighlighter;
+    FileLoader *m_fileLoader;
+    PieceTable m_textBuffer;
     QString m_currentFile;
+    
+    // Gutter cache and the numbering it last showed
+    GutterRenderer m_gutterRenderer;
+    int m_gutterFirstBlock;
+    int m_gutterOffset;
+    int m_gutterBlockCount;
+    
+    // Completion popup and the position of the word it completes, or -1
+    QCompleter *m_completer;
+    QStringListModel *m_completionModel;
+    int m_completionStart;
+    QPointer<SymbolIndex> m_symbolIndex;
+    
+    // Items from showCompletions and the word they were computed for
+    QStringList m_externalCompletions;
+    int m_externalCompletionStart;
+    
+    QHash<QString, QVector<EditorDiagnostic>> m_diagnostics;
+    QList<QTextEdit::ExtraSelection> m_diagnosticSelections;
+    int m_hoverLine;
+    int m_hoverColumn;
 };
 
 class LineNumberArea : public QWidget
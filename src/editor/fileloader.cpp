@@ -0,0 +1,97 @@
+#include "fileloader.h"
+
+#include <QFile>
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace {
+
+// Size of one read; also the granularity of document appends on the GUI side.
+const qint64 kChunkBytes = 512 * 1024;
+
+// Decoded chunks posted but not yet appended. Qt delivers every posted
+// event in one pass, so without a bound the whole file would be appended
+// before the next repaint.
+const int kMaxChunksInFlight = 2;
+
+// How often a reader waiting for a free slot checks for cancellation
+const int kSlotWaitMsec = 50;
+
+} // namespace
+
+FileLoader::FileLoader(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , m_fileName(fileName)
+    , m_cancelled(0)
+    , m_chunkSlots(kMaxChunksInFlight)
+{
+}
+
+FileLoader::~FileLoader()
+{
+    cancel();
+    m_future.waitForFinished();
+}
+
+void FileLoader::start()
+{
+    m_cancelled.storeRelease(0);
+    m_future = QtConcurrent::run([this] { run(); });
+}
+
+void FileLoader::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void FileLoader::run()
+{
+    // Everything below runs on a pool thread. Results are posted with this
+    // object as context, so nothing is delivered once it has been deleted.
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QString error = file.errorString();
+        QMetaObject::invokeMethod(this, [this, error] { emit failed(error); }, Qt::QueuedConnection);
+        return;
+    }
+
+    const qint64 totalBytes = file.size();
+    QScopedPointer<QTextDecoder> decoder(QTextCodec::codecForName("UTF-8")->makeDecoder());
+
+    while (!file.atEnd()) {
+        if (m_cancelled.loadAcquire()) {
+            return;
+        }
+
+        const QByteArray chunk = file.read(kChunkBytes);
+        if (chunk.isEmpty() && file.error() != QFileDevice::NoError) {
+            const QString error = file.errorString();
+            QMetaObject::invokeMethod(this, [this, error] { emit failed(error); }, Qt::QueuedConnection);
+            return;
+        }
+
+        // The decoder keeps partial multi-byte sequences between chunks.
+        const QString text = decoder->toUnicode(chunk);
+        const qint64 bytesRead = file.pos();
+
+        while (!m_chunkSlots.tryAcquire(1, kSlotWaitMsec)) {
+            if (m_cancelled.loadAcquire()) {
+                return;
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, text, bytesRead, totalBytes] {
+            if (!text.isEmpty()) {
+                emit textLoaded(text);
+            }
+            emit progress(bytesRead, totalBytes);
+            // Freed from a timer, which runs after the posted events of
+            // this pass, so the next chunk waits for the next loop slice
+            QTimer::singleShot(0, this, [this] { m_chunkSlots.release(); });
+        }, Qt::QueuedConnection);
+    }
+
+    QMetaObject::invokeMethod(this, [this] { emit finished(); }, Qt::QueuedConnection);
+}
@@ -0,0 +1,42 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QFuture>
+
+// Reads a file on the thread pool in fixed-size chunks, decodes UTF-8
+// incrementally and hands each decoded batch back to the owning thread.
+// Only a few batches are in flight at a time, so the owning thread gets
+// to paint between them. Deleting the loader cancels the read.
+class FileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLoader(const QString &fileName, QObject *parent = nullptr);
+    ~FileLoader();
+
+    void start();
+    void cancel();
+
+    QString fileName() const { return m_fileName; }
+
+signals:
+    void textLoaded(const QString &text);
+    void progress(qint64 bytesRead, qint64 totalBytes);
+    void finished();
+    void failed(const QString &error);
+
+private:
+    void run();
+
+    QString m_fileName;
+    QAtomicInt m_cancelled;
+    QSemaphore m_chunkSlots;
+    QFuture<void> m_future;
+};
+
+#endif // FILELOADER_H
@@ -0,0 +1,54 @@
+#include "gutterrenderer.h"
+
+#include <QPainter>
+#include <QFontMetrics>
+
+GutterRenderer::GutterRenderer()
+    : m_devicePixelRatio(0)
+    , m_digitWidth(0)
+    , m_lineHeight(0)
+{
+}
+
+void GutterRenderer::setStyle(const QFont &font, const QColor &color, qreal devicePixelRatio)
+{
+    if (m_devicePixelRatio == devicePixelRatio && m_color == color && m_font == font) {
+        return;
+    }
+
+    m_font = font;
+    m_color = color;
+    m_devicePixelRatio = devicePixelRatio;
+    rebuild();
+}
+
+void GutterRenderer::rebuild()
+{
+    const QFontMetrics metrics(m_font);
+    m_digitWidth = metrics.width(QLatin1Char('9'));
+    m_lineHeight = metrics.height();
+
+    for (int digit = 0; digit < 10; ++digit) {
+        QPixmap pixmap(QSize(m_digitWidth, m_lineHeight) * m_devicePixelRatio);
+        pixmap.setDevicePixelRatio(m_devicePixelRatio);
+        pixmap.fill(Qt::transparent);
+
+        QPainter painter(&pixmap);
+        painter.setFont(m_font);
+        painter.setPen(m_color);
+        painter.drawText(QRect(0, 0, m_digitWidth, m_lineHeight), Qt::AlignRight, QString(QChar('0' + digit)));
+        painter.end();
+
+        m_digits[digit] = pixmap;
+    }
+}
+
+void GutterRenderer::drawNumber(QPainter *painter, int right, int top, int number) const
+{
+    int x = right;
+    do {
+        x -= m_digitWidth;
+        painter->drawPixmap(x, top, m_digits[number % 10]);
+        number /= 10;
+    } while (number > 0);
+}
@@ -0,0 +1,37 @@
+#ifndef GUTTERRENDERER_H
+#define GUTTERRENDERER_H
+
+#include <QFont>
+#include <QColor>
+#include <QPixmap>
+
+class QPainter;
+
+// Draws line numbers from ten pre-rendered digit pixmaps, so painting a
+// gutter row is a few blits with no string allocation or text shaping.
+// The cache is rebuilt only when the font, color or pixel ratio changes.
+class GutterRenderer
+{
+public:
+    GutterRenderer();
+
+    void setStyle(const QFont &font, const QColor &color, qreal devicePixelRatio);
+
+    int digitWidth() const { return m_digitWidth; }
+    int lineHeight() const { return m_lineHeight; }
+
+    // Draws number right-aligned so its last digit ends at right.
+    void drawNumber(QPainter *painter, int right, int top, int number) const;
+
+private:
+    void rebuild();
+
+    QFont m_font;
+    QColor m_color;
+    qreal m_devicePixelRatio;
+    int m_digitWidth;
+    int m_lineHeight;
+    QPixmap m_digits[10];
+};
+
+#endif // GUTTERRENDERER_H
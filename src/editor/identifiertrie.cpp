@@ -0,0 +1,175 @@
+#include "identifiertrie.h"
+
+#include <QVarLengthArray>
+
+namespace {
+
+inline ushort foldedKey(QChar c)
+{
+    return c.toLower().unicode();
+}
+
+} // namespace
+
+IdentifierTrie::IdentifierTrie()
+{
+    clear();
+}
+
+void IdentifierTrie::clear()
+{
+    m_nodes.clear();
+    m_nodes.append(Node());
+    m_entries.clear();
+    m_freeEntries.clear();
+}
+
+int IdentifierTrie::findChild(int node, ushort key) const
+{
+    // Siblings are sorted; identifiers rarely give a node more than a few
+    // dozen children, so a linear scan beats anything fancier
+    for (int child = m_nodes.at(node).firstChild; child >= 0; child = m_nodes.at(child).nextSibling) {
+        const ushort childKey = m_nodes.at(child).key;
+        if (childKey == key) {
+            return child;
+        }
+        if (childKey > key) {
+            break;
+        }
+    }
+    return -1;
+}
+
+int IdentifierTrie::findOrAddChild(int node, ushort key)
+{
+    int previous = -1;
+    int child = m_nodes.at(node).firstChild;
+    while (child >= 0 && m_nodes.at(child).key < key) {
+        previous = child;
+        child = m_nodes.at(child).nextSibling;
+    }
+    if (child >= 0 && m_nodes.at(child).key == key) {
+        return child;
+    }
+
+    Node added;
+    added.key = key;
+    added.nextSibling = child;
+    const int index = m_nodes.size();
+    m_nodes.append(added);
+    if (previous >= 0) {
+        m_nodes[previous].nextSibling = index;
+    } else {
+        m_nodes[node].firstChild = index;
+    }
+    return index;
+}
+
+void IdentifierTrie::insert(const QString &word)
+{
+    if (word.isEmpty()) {
+        return;
+    }
+
+    QVarLengthArray<int, 64> path;
+    int node = 0;
+    path.append(node);
+    for (const QChar c : word) {
+        node = findOrAddChild(node, foldedKey(c));
+        path.append(node);
+    }
+
+    for (int entry = m_nodes.at(node).entry; entry >= 0; entry = m_entries.at(entry).next) {
+        if (m_entries.at(entry).word == word) {
+            ++m_entries[entry].count;
+            return;
+        }
+    }
+
+    int entry;
+    if (!m_freeEntries.isEmpty()) {
+        entry = m_freeEntries.takeLast();
+    } else {
+        entry = m_entries.size();
+        m_entries.append(Entry());
+    }
+    m_entries[entry].word = word;
+    m_entries[entry].count = 1;
+    m_entries[entry].next = m_nodes.at(node).entry;
+    m_nodes[node].entry = entry;
+
+    for (const int pathNode : path) {
+        ++m_nodes[pathNode].words;
+    }
+}
+
+void IdentifierTrie::remove(const QString &word)
+{
+    if (word.isEmpty()) {
+        return;
+    }
+
+    QVarLengthArray<int, 64> path;
+    int node = 0;
+    path.append(node);
+    for (const QChar c : word) {
+        node = findChild(node, foldedKey(c));
+        if (node < 0) {
+            return;
+        }
+        path.append(node);
+    }
+
+    int previous = -1;
+    int entry = m_nodes.at(node).entry;
+    while (entry >= 0 && m_entries.at(entry).word != word) {
+        previous = entry;
+        entry = m_entries.at(entry).next;
+    }
+    if (entry < 0 || --m_entries[entry].count > 0) {
+        return;
+    }
+
+    // Last occurrence: unlink the spelling and free its slot
+    if (previous >= 0) {
+        m_entries[previous].next = m_entries.at(entry).next;
+    } else {
+        m_nodes[node].entry = m_entries.at(entry).next;
+    }
+    m_entries[entry] = Entry();
+    m_freeEntries.append(entry);
+
+    for (const int pathNode : path) {
+        --m_nodes[pathNode].words;
+    }
+}
+
+QStringList IdentifierTrie::complete(const QString &prefix, int maxResults) const
+{
+    QStringList result;
+    int node = 0;
+    for (const QChar c : prefix) {
+        node = findChild(node, foldedKey(c));
+        if (node < 0) {
+            return result;
+        }
+    }
+    collect(node, maxResults, &result);
+    return result;
+}
+
+void IdentifierTrie::collect(int node, int maxResults, QStringList *result) const
+{
+    // Subtrees without live words are skipped, so the walk costs about as
+    // much as the words it returns
+    for (int entry = m_nodes.at(node).entry; entry >= 0 && result->size() < maxResults;
+         entry = m_entries.at(entry).next) {
+        result->append(m_entries.at(entry).word);
+    }
+    for (int child = m_nodes.at(node).firstChild; child >= 0 && result->size() < maxResults;
+         child = m_nodes.at(child).nextSibling) {
+        if (m_nodes.at(child).words > 0) {
+            collect(child, maxResults, result);
+        }
+    }
+}
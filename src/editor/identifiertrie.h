@@ -0,0 +1,55 @@
+#ifndef IDENTIFIERTRIE_H
+#define IDENTIFIERTRIE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Reference-counted set of identifiers for prefix completion. Keys are
+// case-folded, so "sv" finds both "setValue" and "SV_MAX"; each node keeps
+// the number of live words below it, so a lookup only walks the prefix and
+// the subtrees that still hold words, however many identifiers there are.
+// Nodes of removed words are kept for reuse until clear().
+class IdentifierTrie
+{
+public:
+    IdentifierTrie();
+
+    // insert() and remove() must be balanced per occurrence
+    void insert(const QString &word);
+    void remove(const QString &word);
+    void clear();
+
+    int size() const { return m_nodes.at(0).words; }
+
+    // Words starting with prefix in case-folded order, at most maxResults
+    QStringList complete(const QString &prefix, int maxResults) const;
+
+private:
+    struct Node
+    {
+        ushort key = 0;
+        int firstChild = -1;
+        int nextSibling = -1;
+        int words = 0;       // live words ending in this subtree
+        int entry = -1;      // first word ending here
+    };
+
+    // Spellings that fold to the same key share a node
+    struct Entry
+    {
+        QString word;
+        int count = 0;
+        int next = -1;
+    };
+
+    int findChild(int node, ushort key) const;
+    int findOrAddChild(int node, ushort key);
+    void collect(int node, int maxResults, QStringList *result) const;
+
+    QVector<Node> m_nodes;
+    QVector<Entry> m_entries;
+    QVector<int> m_freeEntries;
+};
+
+#endif // IDENTIFIERTRIE_H
@@ -0,0 +1,524 @@
+#include "largefileviewer.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QByteArrayMatcher>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+const int kLinesPerCheckpoint = 64;
+
+// Bytes scanned by the indexing job between progress updates.
+const qint64 kIndexBatchBytes = 16 * 1024 * 1024;
+
+// Bytes searched per step, so cancellation is noticed quickly.
+const qint64 kSearchChunkBytes = 64 * 1024 * 1024;
+
+// Only this much of a line is decoded and drawn.
+const int kMaxDisplayedLineBytes = 4096;
+
+// Editors and loggers write in bursts; the file is mapped again once they
+// are done.
+const int kReloadDelayMs = 200;
+
+// The jobs check this between batches; it narrows the window in which a
+// truncation can fault them, but cannot close it
+bool fileShrank(const QString &fileName, qint64 mappedSize)
+{
+    return QFileInfo(fileName).size() < mappedSize;
+}
+
+QString displayText(const uchar *data, qint64 length)
+{
+    QString text = QString::fromUtf8(reinterpret_cast<const char *>(data), int(length));
+    text.replace(QLatin1Char('\t'), QLatin1String("    "));
+    return text;
+}
+
+} // namespace
+
+LargeFileViewer::LargeFileViewer(QWidget *parent)
+    : QAbstractScrollArea(parent)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_lineCount(0)
+    , m_cancelled(0)
+    , m_indexed(false)
+    , m_generation(0)
+    , m_windowFirstLine(-1)
+    , m_fileWatcher(new QFileSystemWatcher(this))
+    , m_reloadTimer(new QTimer(this))
+    , m_restoreTopLine(-1)
+    , m_searchGeneration(-1)
+    , m_searchWatcher(new QFutureWatcher<LargeFileSearchResult>(this))
+    , m_lineHeight(1)
+    , m_charWidth(1)
+    , m_longestLine(0)
+{
+    QFont font("Consolas", 10);
+    font.setFixedPitch(true);
+    setFont(font);
+
+    m_lineHeight = qMax(1, fontMetrics().lineSpacing());
+    m_charWidth = qMax(1, fontMetrics().width(QLatin1Char('9')));
+
+    connect(m_searchWatcher, &QFutureWatcher<LargeFileSearchResult>::finished,
+            this, &LargeFileViewer::onSearchFinished);
+
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(kReloadDelayMs);
+    connect(m_reloadTimer, &QTimer::timeout, this, &LargeFileViewer::reloadFile);
+    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged, m_reloadTimer, [this] {
+        m_reloadTimer->start();
+    });
+}
+
+LargeFileViewer::~LargeFileViewer()
+{
+    closeFile();
+}
+
+bool LargeFileViewer::openFile(const QString &fileName)
+{
+    closeFile();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size > 0) {
+        m_data = m_file.map(0, m_size);
+        if (!m_data) {
+            m_file.close();
+            return false;
+        }
+    }
+
+    if (!m_fileWatcher->files().contains(fileName)) {
+        m_fileWatcher->addPath(fileName);
+    }
+
+    m_checkpoints.clear();
+    m_checkpoints.append(0);
+    m_lineCount = 1;
+    m_indexed = false;
+    updateScrollBars();
+
+    m_cancelled.storeRelease(0);
+    const int generation = ++m_generation;
+    m_indexFuture = QtConcurrent::run([this, fileName, generation] { buildLineIndex(fileName, generation); });
+    return true;
+}
+
+void LargeFileViewer::closeFile()
+{
+    // Both jobs read the mapping, so they have to be gone before it is.
+    m_cancelled.storeRelease(1);
+    m_indexFuture.waitForFinished();
+    m_searchWatcher->waitForFinished();
+
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_size = 0;
+    m_match = LargeFileSearchResult();
+    m_windowStarts.clear();
+    m_windowFirstLine = -1;
+    m_restoreTopLine = -1;
+}
+
+void LargeFileViewer::reloadFile()
+{
+    // A deleted file keeps its pages until it is unmapped, so the old
+    // contents stay on screen; a replaced or rewritten one is mapped anew.
+    const QString fileName = m_file.fileName();
+    if (!QFileInfo::exists(fileName)) {
+        return;
+    }
+
+    const int top = verticalScrollBar()->value();
+    if (openFile(fileName)) {
+        m_restoreTopLine = top;
+    }
+    viewport()->update();
+}
+
+bool LargeFileViewer::isMappingIntact() const
+{
+    // QFile::size() asks the open handle, so this sees a truncation before
+    // the watcher reports it
+    return m_data && m_file.size() >= m_size;
+}
+
+void LargeFileViewer::buildLineIndex(const QString &fileName, int generation)
+{
+    // Runs on a pool thread; it only reads the mapping and hands batches of
+    // checkpoints back to the GUI thread.
+    QVector<qint64> batch;
+    qint64 lines = 1;
+    qint64 pos = 0;
+
+    do {
+        if (m_cancelled.loadAcquire() || fileShrank(fileName, m_size)) {
+            return;
+        }
+
+        const qint64 batchEnd = qMin(m_size, pos + kIndexBatchBytes);
+        while (pos < batchEnd) {
+            const void *newline = std::memchr(m_data + pos, '\n', size_t(batchEnd - pos));
+            if (!newline) {
+                pos = batchEnd;
+                break;
+            }
+            pos = static_cast<const uchar *>(newline) - m_data + 1;
+            if (lines % kLinesPerCheckpoint == 0) {
+                batch.append(pos);
+            }
+            ++lines;
+        }
+
+        const bool done = pos >= m_size;
+        QMetaObject::invokeMethod(this, [this, batch, lines, pos, done, generation] {
+            appendCheckpoints(batch, lines, pos, done, generation);
+        }, Qt::QueuedConnection);
+        batch.clear();
+    } while (pos < m_size);
+}
+
+void LargeFileViewer::appendCheckpoints(const QVector<qint64> &checkpoints, qint64 lineCount,
+                                        qint64 bytesIndexed, bool done, int generation)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    m_checkpoints += checkpoints;
+    m_lineCount = lineCount;
+    updateScrollBars();
+    if (m_restoreTopLine >= 0 && (m_restoreTopLine < m_lineCount || done)) {
+        verticalScrollBar()->setValue(int(m_restoreTopLine));
+        m_restoreTopLine = -1;
+    }
+    viewport()->update();
+
+    emit indexingProgress(bytesIndexed, m_size);
+    if (done) {
+        m_indexed = true;
+        emit indexingFinished(m_lineCount);
+    }
+}
+
+void LargeFileViewer::updateScrollBars()
+{
+    const int visibleLines = qMax(1, viewport()->height() / m_lineHeight);
+    const qint64 maxTop = qMax<qint64>(0, m_lineCount - visibleLines + 1);
+    verticalScrollBar()->setRange(0, int(qMin<qint64>(maxTop, INT_MAX)));
+    verticalScrollBar()->setPageStep(visibleLines);
+    verticalScrollBar()->setSingleStep(1);
+
+    const int textWidth = viewport()->width() - gutterWidth();
+    horizontalScrollBar()->setRange(0, qMax(0, m_longestLine * m_charWidth - textWidth));
+    horizontalScrollBar()->setPageStep(qMax(1, textWidth));
+    horizontalScrollBar()->setSingleStep(m_charWidth);
+}
+
+qint64 LargeFileViewer::lineStart(qint64 line) const
+{
+    if (!m_data || line < 0 || line >= m_lineCount) {
+        return -1;
+    }
+
+    const int checkpoint = int(qMin<qint64>(line / kLinesPerCheckpoint, m_checkpoints.size() - 1));
+    qint64 pos = m_checkpoints.at(checkpoint);
+    for (qint64 remaining = line - qint64(checkpoint) * kLinesPerCheckpoint; remaining > 0; --remaining) {
+        const void *newline = std::memchr(m_data + pos, '\n', size_t(m_size - pos));
+        if (!newline) {
+            return -1;
+        }
+        pos = static_cast<const uchar *>(newline) - m_data + 1;
+    }
+    return pos;
+}
+
+void LargeFileViewer::updateLineWindow(qint64 firstLine, int lineCount)
+{
+    // Scrolling keeps the lines still on screen; only the new ones are
+    // searched for, and only once however often the view repaints
+    if (m_windowFirstLine >= 0 && firstLine >= m_windowFirstLine
+            && firstLine < m_windowFirstLine + m_windowStarts.size()) {
+        m_windowStarts.remove(0, int(firstLine - m_windowFirstLine));
+    } else {
+        m_windowStarts.clear();
+        const qint64 start = lineStart(firstLine);
+        if (start < 0) {
+            m_windowFirstLine = -1;
+            return;
+        }
+        m_windowStarts.append(start);
+    }
+    m_windowFirstLine = firstLine;
+
+    while (m_windowStarts.size() <= lineCount && m_windowStarts.last() >= 0) {
+        const qint64 start = m_windowStarts.last();
+        const qint64 nextLine = firstLine + m_windowStarts.size();
+        if (m_indexed && nextLine >= m_lineCount) {
+            m_windowStarts.append(-1);
+            continue;
+        }
+
+        // The next line starts before the checkpoint after it, so a long line
+        // is only searched up to there
+        const qint64 checkpoint = nextLine / kLinesPerCheckpoint;
+        if (nextLine % kLinesPerCheckpoint == 0 && checkpoint < m_checkpoints.size()) {
+            m_windowStarts.append(m_checkpoints.at(int(checkpoint)));
+            continue;
+        }
+        const qint64 end = checkpoint + 1 < m_checkpoints.size() ? m_checkpoints.at(int(checkpoint) + 1) : m_size;
+        const void *newline = std::memchr(m_data + start, '\n', size_t(end - start));
+        m_windowStarts.append(newline ? static_cast<const uchar *>(newline) - m_data + 1 : -1);
+    }
+}
+
+int LargeFileViewer::gutterWidth() const
+{
+    int digits = 1;
+    for (qint64 max = qMax<qint64>(1, m_lineCount); max >= 10; max /= 10) {
+        ++digits;
+    }
+    return 8 + m_charWidth * digits;
+}
+
+void LargeFileViewer::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), QColor(30, 30, 30));
+
+    const int gutter = gutterWidth();
+    painter.fillRect(0, 0, gutter, viewport()->height(), QColor(40, 40, 40));
+
+    if (!isMappingIntact()) {
+        if (m_data && !m_reloadTimer->isActive()) {
+            m_reloadTimer->start();
+        }
+        return;
+    }
+
+    const qint64 firstLine = verticalScrollBar()->value();
+    const int visibleLines = viewport()->height() / m_lineHeight + 1;
+    const int xOffset = horizontalScrollBar()->value();
+    const int ascent = fontMetrics().ascent();
+    const int previousLongest = m_longestLine;
+
+    updateLineWindow(firstLine, visibleLines);
+    for (int i = 0; i < visibleLines && i < m_windowStarts.size() && firstLine + i < m_lineCount; ++i) {
+        const qint64 start = m_windowStarts.at(i);
+        if (start < 0) {
+            break;
+        }
+        const qint64 line = firstLine + i;
+        const int y = i * m_lineHeight;
+        const uchar *lineData = m_data + start;
+
+        const qint64 next = m_windowStarts.value(i + 1, -1);
+        qint64 length = next >= 0 ? next - 1 - start : m_size - start;
+        if (length > 0 && lineData[length - 1] == '\r') {
+            --length;
+        }
+
+        const QString text = displayText(lineData, qMin<qint64>(length, kMaxDisplayedLineBytes));
+        m_longestLine = qMax(m_longestLine, text.length());
+
+        painter.setClipping(false);
+        painter.setPen(QColor(120, 120, 120));
+        painter.drawText(0, y, gutter - 4, m_lineHeight, Qt::AlignRight, QString::number(line + 1));
+
+        painter.setClipRect(gutter, 0, viewport()->width() - gutter, viewport()->height());
+        if (line == m_match.line && m_match.offset >= start) {
+            const int column = displayText(lineData, qMin<qint64>(m_match.offset - start, kMaxDisplayedLineBytes)).length();
+            const int width = QString::fromUtf8(m_searchNeedle).length();
+            painter.fillRect(gutter + 4 + column * m_charWidth - xOffset, y,
+                             width * m_charWidth, m_lineHeight, QColor(0, 120, 212));
+        }
+        painter.setPen(QColor(220, 220, 220));
+        painter.drawText(gutter + 4 - xOffset, y + ascent, text);
+    }
+
+    if (m_longestLine != previousLongest) {
+        updateScrollBars();
+    }
+}
+
+void LargeFileViewer::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LargeFileViewer::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::MoveToStartOfDocument)) {
+        verticalScrollBar()->setValue(0);
+        return;
+    }
+
+    if (event->matches(QKeySequence::MoveToEndOfDocument)) {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+        return;
+    }
+
+    if (event->matches(QKeySequence::FindNext)) {
+        findNext();
+        return;
+    }
+
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LargeFileViewer::goToLine(qint64 line)
+{
+    // Keep a few lines of context above the target.
+    const qint64 target = qBound<qint64>(0, line, m_lineCount - 1);
+    verticalScrollBar()->setValue(int(qMin<qint64>(qMax<qint64>(0, target - 3), INT_MAX)));
+    viewport()->update();
+}
+
+void LargeFileViewer::promptGoToLine()
+{
+    bool ok = false;
+    const int maxLine = int(qMin<qint64>(m_lineCount, INT_MAX));
+    const int line = QInputDialog::getInt(this, "Go to Line", "Line:",
+                                          verticalScrollBar()->value() + 1, 1, maxLine, 1, &ok);
+    if (ok) {
+        goToLine(line - 1);
+    }
+}
+
+void LargeFileViewer::promptFind()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, "Find", "Find:", QLineEdit::Normal,
+                                               QString::fromUtf8(m_searchNeedle), &ok);
+    if (ok && !text.isEmpty()) {
+        find(text);
+    }
+}
+
+void LargeFileViewer::find(const QString &text)
+{
+    m_searchNeedle = text.toUtf8();
+    m_match = LargeFileSearchResult();
+    startSearch(qMax<qint64>(0, lineStart(verticalScrollBar()->value())));
+}
+
+void LargeFileViewer::findNext()
+{
+    if (m_searchNeedle.isEmpty()) {
+        promptFind();
+        return;
+    }
+
+    const qint64 from = m_match.offset >= 0 ? m_match.offset + 1
+                                             : lineStart(verticalScrollBar()->value());
+    startSearch(qMax<qint64>(0, from));
+}
+
+void LargeFileViewer::startSearch(qint64 fromOffset)
+{
+    if (m_searchNeedle.isEmpty() || !isMappingIntact() || m_searchWatcher->isRunning()) {
+        return;
+    }
+
+    const uchar *data = m_data;
+    const qint64 size = m_size;
+    const QByteArray needle = m_searchNeedle;
+    const QVector<qint64> checkpoints = m_checkpoints;
+    const QString fileName = m_file.fileName();
+    const QAtomicInt *cancelled = &m_cancelled;
+    m_searchGeneration = m_generation;
+    m_searchWatcher->setFuture(QtConcurrent::run([=] {
+        return searchMapped(data, size, needle, fromOffset, checkpoints, fileName, cancelled);
+    }));
+}
+
+void LargeFileViewer::onSearchFinished()
+{
+    // A search over a mapping that has been replaced since
+    if (m_searchGeneration != m_generation) {
+        return;
+    }
+
+    m_match = m_searchWatcher->result();
+    const bool found = m_match.offset >= 0;
+    if (found) {
+        goToLine(m_match.line);
+    }
+    viewport()->update();
+    emit searchFinished(found);
+}
+
+LargeFileSearchResult LargeFileViewer::searchMapped(const uchar *data, qint64 size, const QByteArray &needle,
+                                                    qint64 from, const QVector<qint64> &checkpoints,
+                                                    const QString &fileName, const QAtomicInt *cancelled)
+{
+    LargeFileSearchResult result;
+    const QByteArrayMatcher matcher(needle);
+    const qint64 overlap = needle.size() - 1;
+
+    // Search [begin, end) in chunks that overlap by the needle length.
+    auto searchRange = [&](qint64 begin, qint64 end) -> qint64 {
+        for (qint64 pos = begin; pos < end; pos += kSearchChunkBytes) {
+            if (cancelled->loadAcquire() || fileShrank(fileName, size)) {
+                return -1;
+            }
+            const qint64 chunkEnd = qMin(size, qMin(end, pos + kSearchChunkBytes) + overlap);
+            const int index = matcher.indexIn(reinterpret_cast<const char *>(data + pos), int(chunkEnd - pos));
+            if (index >= 0) {
+                return pos + index;
+            }
+        }
+        return -1;
+    };
+
+    // From the cursor to the end, then wrap around.
+    result.offset = searchRange(from, size);
+    if (result.offset < 0 && from > 0) {
+        result.offset = searchRange(0, from);
+    }
+    if (result.offset < 0) {
+        return result;
+    }
+
+    // Nearest checkpoint at or before the match, then count the remaining
+    // newlines; this also works past the part indexed so far.
+    const auto it = std::upper_bound(checkpoints.constBegin(), checkpoints.constEnd(), result.offset);
+    const int checkpoint = int(it - checkpoints.constBegin()) - 1;
+    qint64 line = qint64(checkpoint) * kLinesPerCheckpoint;
+    qint64 pos = checkpoints.at(checkpoint);
+    while (pos < result.offset) {
+        const void *newline = std::memchr(data + pos, '\n', size_t(result.offset - pos));
+        if (!newline) {
+            break;
+        }
+        pos = static_cast<const uchar *>(newline) - data + 1;
+        ++line;
+    }
+    result.line = line;
+    return result;
+}
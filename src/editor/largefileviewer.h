@@ -0,0 +1,109 @@
+#ifndef LARGEFILEVIEWER_H
+#define LARGEFILEVIEWER_H
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QVector>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QByteArray>
+
+class QPaintEvent;
+class QKeyEvent;
+class QTimer;
+class QFileSystemWatcher;
+
+struct LargeFileSearchResult
+{
+    qint64 offset = -1;
+    qint64 line = -1;
+};
+
+// Read-only view over a memory-mapped file. A background job builds a sparse
+// line index (one offset every 64 lines) and only the visible line window is
+// ever decoded, so memory use does not grow with the file size. The file is
+// mapped again when it changes on disk; reading a mapping past the end of a
+// truncated file would fault.
+class LargeFileViewer : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeFileViewer(QWidget *parent = nullptr);
+    ~LargeFileViewer();
+
+    bool openFile(const QString &fileName);
+    QString fileName() const { return m_file.fileName(); }
+
+    qint64 lineCount() const { return m_lineCount; }
+    bool isIndexing() const { return m_indexFuture.isRunning(); }
+
+public slots:
+    void goToLine(qint64 line);
+    void find(const QString &text);
+    void findNext();
+    void promptGoToLine();
+    void promptFind();
+
+signals:
+    void indexingProgress(qint64 bytesIndexed, qint64 totalBytes);
+    void indexingFinished(qint64 lineCount);
+    void searchFinished(bool found);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+    void onSearchFinished();
+    void reloadFile();
+
+private:
+    void closeFile();
+    bool isMappingIntact() const;
+    void buildLineIndex(const QString &fileName, int generation);
+    void appendCheckpoints(const QVector<qint64> &checkpoints, qint64 lineCount, qint64 bytesIndexed, bool done,
+                           int generation);
+    void updateScrollBars();
+    qint64 lineStart(qint64 line) const;
+    void updateLineWindow(qint64 firstLine, int lineCount);
+    int gutterWidth() const;
+    void startSearch(qint64 fromOffset);
+
+    static LargeFileSearchResult searchMapped(const uchar *data, qint64 size, const QByteArray &needle,
+                                              qint64 from, const QVector<qint64> &checkpoints,
+                                              const QString &fileName, const QAtomicInt *cancelled);
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+
+    QVector<qint64> m_checkpoints;
+    qint64 m_lineCount;
+    QAtomicInt m_cancelled;
+    QFuture<void> m_indexFuture;
+    bool m_indexed;
+    int m_generation;   // bumped on every (re)open; stale job results are ignored
+
+    // Starts of the lines on screen and of the line after them (-1 past the
+    // last line), so repaints do not search for newlines again
+    QVector<qint64> m_windowStarts;
+    qint64 m_windowFirstLine;
+
+    QFileSystemWatcher *m_fileWatcher;
+    QTimer *m_reloadTimer;
+    qint64 m_restoreTopLine;   // scroll position to return to once indexed that far
+
+    QByteArray m_searchNeedle;
+    LargeFileSearchResult m_match;
+    int m_searchGeneration;
+    QFutureWatcher<LargeFileSearchResult> *m_searchWatcher;
+
+    int m_lineHeight;
+    int m_charWidth;
+    int m_longestLine;
+};
+
+#endif // LARGEFILEVIEWER_H
@@ -0,0 +1,301 @@
+#include "lexer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+inline bool isAsciiLetter(ushort c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool isAsciiDigit(ushort c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isIdentifierStart(QChar ch)
+{
+    const ushort c = ch.unicode();
+    if (c < 128) {
+        return isAsciiLetter(c) || c == '_';
+    }
+    return ch.isLetter();
+}
+
+inline bool isIdentifierPart(QChar ch)
+{
+    const ushort c = ch.unicode();
+    if (c < 128) {
+        return isAsciiLetter(c) || isAsciiDigit(c) || c == '_';
+    }
+    return ch.isLetterOrNumber();
+}
+
+inline void appendRun(QVector<FormatRun> *runs, int start, int length, TokenKind kind)
+{
+    if (length > 0) {
+        runs->append({start, length, kind});
+    }
+}
+
+// Returns the index just past the closing "*/", or -1 if the comment does not
+// end on this line.
+int findBlockCommentEnd(const QChar *data, int length, int from)
+{
+    for (int i = from; i + 1 < length; ++i) {
+        if (data[i].unicode() == '*' && data[i + 1].unicode() == '/') {
+            return i + 2;
+        }
+    }
+    return -1;
+}
+
+bool matchesAt(const QChar *data, int length, int pos, const QString &token)
+{
+    const int tokenLength = token.length();
+    if (tokenLength == 0 || pos + tokenLength > length) {
+        return false;
+    }
+    return std::memcmp(data + pos, token.constData(), tokenLength * sizeof(QChar)) == 0;
+}
+
+} // namespace
+
+KeywordSet::KeywordSet(const QStringList &keywords)
+{
+    QStringList unique = keywords;
+    unique.removeDuplicates();
+    if (unique.isEmpty()) {
+        return;
+    }
+
+    for (const QString &keyword : unique) {
+        m_lengthMask |= quint64(1) << qMin(keyword.length(), 63);
+    }
+
+    const int bucketCount = qMax(1, unique.size() / 2);
+    QVector<QVector<int>> buckets(bucketCount);
+    for (int i = 0; i < unique.size(); ++i) {
+        const QString &keyword = unique.at(i);
+        buckets[hash(keyword.constData(), keyword.length(), 0) % bucketCount].append(i);
+    }
+
+    // Place the largest buckets first; they are the hardest to fit.
+    QVector<int> order(bucketCount);
+    for (int i = 0; i < bucketCount; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&buckets](int a, int b) {
+        return buckets.at(a).size() > buckets.at(b).size();
+    });
+
+    int slotCount = 1;
+    while (slotCount < unique.size() * 2) {
+        slotCount <<= 1;
+    }
+
+    // Search a displacement per bucket that maps all of its keywords to free
+    // slots. If a bucket cannot be placed, retry with a larger table.
+    for (;;) {
+        m_slots.fill(QString(), slotCount);
+        m_displacements.fill(0, bucketCount);
+        m_slotMask = quint32(slotCount - 1);
+
+        QVector<bool> used(slotCount, false);
+        bool placedAll = true;
+
+        for (int bucket : order) {
+            const QVector<int> &members = buckets.at(bucket);
+            if (members.isEmpty()) {
+                continue;
+            }
+
+            bool placed = false;
+            QVector<int> slots;
+            for (quint32 displacement = 1; displacement < 4096 && !placed; ++displacement) {
+                slots.clear();
+                placed = true;
+                for (int index : members) {
+                    const QString &keyword = unique.at(index);
+                    const int slot = int(hash(keyword.constData(), keyword.length(), displacement) & m_slotMask);
+                    if (used.at(slot) || slots.contains(slot)) {
+                        placed = false;
+                        break;
+                    }
+                    slots.append(slot);
+                }
+                if (placed) {
+                    m_displacements[bucket] = displacement;
+                }
+            }
+
+            if (!placed) {
+                placedAll = false;
+                break;
+            }
+
+            for (int i = 0; i < members.size(); ++i) {
+                used[slots.at(i)] = true;
+                m_slots[slots.at(i)] = unique.at(members.at(i));
+            }
+        }
+
+        if (placedAll) {
+            return;
+        }
+        slotCount <<= 1;
+    }
+}
+
+bool KeywordSet::contains(const QChar *text, int length) const
+{
+    if (m_slots.isEmpty() || !(m_lengthMask & (quint64(1) << qMin(length, 63)))) {
+        return false;
+    }
+
+    const int bucket = int(hash(text, length, 0) % quint32(m_displacements.size()));
+    const int slot = int(hash(text, length, m_displacements.at(bucket)) & m_slotMask);
+    const QString &candidate = m_slots.at(slot);
+    return candidate.length() == length
+        && std::memcmp(candidate.constData(), text, length * sizeof(QChar)) == 0;
+}
+
+quint32 KeywordSet::hash(const QChar *text, int length, quint32 seed)
+{
+    // FNV-1a with a seeded basis and a final avalanche step.
+    quint32 h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (int i = 0; i < length; ++i) {
+        h ^= text[i].unicode();
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+int Lexer::lex(const QString &text, int previousState, QVector<FormatRun> *runs) const
+{
+    if (!m_config) {
+        return NormalState;
+    }
+
+    const LexerConfig &config = *m_config;
+    const QChar *data = text.constData();
+    const int length = text.length();
+    int pos = 0;
+
+    if (config.blockComments && previousState == BlockCommentState) {
+        const int end = findBlockCommentEnd(data, length, 0);
+        if (end < 0) {
+            appendRun(runs, 0, length, TokenKind::MultiLineComment);
+            return BlockCommentState;
+        }
+        appendRun(runs, 0, end, TokenKind::MultiLineComment);
+        pos = end;
+    }
+
+    while (pos < length) {
+        const QChar ch = data[pos];
+        const ushort c = ch.unicode();
+
+        // Comments
+        if (config.blockComments && c == '/' && pos + 1 < length && data[pos + 1].unicode() == '*') {
+            const int end = findBlockCommentEnd(data, length, pos + 2);
+            if (end < 0) {
+                appendRun(runs, pos, length - pos, TokenKind::MultiLineComment);
+                return BlockCommentState;
+            }
+            appendRun(runs, pos, end - pos, TokenKind::MultiLineComment);
+            pos = end;
+            continue;
+        }
+
+        if (matchesAt(data, length, pos, config.lineComment)) {
+            appendRun(runs, pos, length - pos, TokenKind::Comment);
+            break;
+        }
+
+        // Strings, with backslash escapes; an unterminated string runs to the
+        // end of the line.
+        if (c < 128 && config.stringDelimiters.contains(ch)) {
+            int end = pos + 1;
+            while (end < length) {
+                const ushort e = data[end].unicode();
+                if (e == '\\') {
+                    end += 2;
+                } else if (e == c) {
+                    ++end;
+                    break;
+                } else {
+                    ++end;
+                }
+            }
+            end = qMin(end, length);
+            appendRun(runs, pos, end - pos, TokenKind::String);
+            pos = end;
+            continue;
+        }
+
+        // Numbers, including hex, suffixes and exponents
+        if (isAsciiDigit(c)) {
+            int end = pos + 1;
+            while (end < length) {
+                const QChar e = data[end];
+                const ushort u = e.unicode();
+                if (isIdentifierPart(e) || u == '.') {
+                    ++end;
+                } else if (u == '\'' && end + 1 < length && isIdentifierPart(data[end + 1])) {
+                    // Digit separator (1'000'000), not a character literal
+                    ++end;
+                } else if ((u == '+' || u == '-')
+                           && (data[end - 1].unicode() | 0x20) == 'e') {
+                    ++end;
+                } else {
+                    break;
+                }
+            }
+            if (config.numbers) {
+                appendRun(runs, pos, end - pos, TokenKind::Number);
+            }
+            pos = end;
+            continue;
+        }
+
+        // Identifiers, keywords, functions and class names
+        if (isIdentifierStart(ch)) {
+            int end = pos + 1;
+            while (end < length && isIdentifierPart(data[end])) {
+                ++end;
+            }
+
+            const int wordLength = end - pos;
+            if (config.keywords.contains(data + pos, wordLength)) {
+                appendRun(runs, pos, wordLength, TokenKind::Keyword);
+            } else if (config.functions && end < length && data[end].unicode() == '(') {
+                appendRun(runs, pos, wordLength, TokenKind::Function);
+            } else if (config.classNames && c >= 'A' && c <= 'Z') {
+                appendRun(runs, pos, wordLength, TokenKind::ClassName);
+            }
+            pos = end;
+            continue;
+        }
+
+        // Preprocessor directives
+        if (config.preprocessor && c == '#' && pos + 1 < length && isIdentifierPart(data[pos + 1])) {
+            int end = pos + 2;
+            while (end < length && isIdentifierPart(data[end])) {
+                ++end;
+            }
+            appendRun(runs, pos, end - pos, TokenKind::Preprocessor);
+            pos = end;
+            continue;
+        }
+
+        ++pos;
+    }
+
+    return NormalState;
+}
@@ -0,0 +1,88 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSharedPointer>
+
+// Token categories produced by the lexer. The highlighter maps each kind to
+// a QTextCharFormat, so the lexer itself never touches formats.
+enum class TokenKind : quint8
+{
+    Keyword,
+    ClassName,
+    Comment,
+    MultiLineComment,
+    String,
+    Function,
+    Number,
+    Preprocessor,
+    Count
+};
+
+struct FormatRun
+{
+    int start;
+    int length;
+    TokenKind kind;
+};
+
+// Keyword lookup built with hash-and-displace: every keyword lands in its own
+// slot, so a lookup is two hashes and at most one string compare.
+class KeywordSet
+{
+public:
+    KeywordSet() = default;
+    explicit KeywordSet(const QStringList &keywords);
+
+    bool contains(const QChar *text, int length) const;
+    bool isEmpty() const { return m_slots.isEmpty(); }
+
+private:
+    static quint32 hash(const QChar *text, int length, quint32 seed);
+
+    QVector<QString> m_slots;
+    QVector<quint32> m_displacements;
+    quint32 m_slotMask = 0;
+    quint64 m_lengthMask = 0;
+};
+
+// Per-language lexer configuration; this is what the old regex rule sets in
+// SyntaxHighlighter turned into.
+struct LexerConfig
+{
+    KeywordSet keywords;
+    QString lineComment;          // "//" or "#", empty for none
+    bool blockComments = false;   // C-style /* ... */
+    QString stringDelimiters;     // e.g. "\"'"
+    bool classNames = false;      // identifiers starting with an upper-case letter
+    bool functions = false;       // identifiers directly followed by '('
+    bool numbers = true;
+    bool preprocessor = false;    // #directive
+};
+
+// Single-pass, table-driven lexer. It is stateless apart from its immutable
+// configuration, so one instance can be shared between threads.
+class Lexer
+{
+public:
+    enum State {
+        NormalState = 0,
+        BlockCommentState = 1
+    };
+
+    Lexer() = default;
+    explicit Lexer(QSharedPointer<const LexerConfig> config) : m_config(config) {}
+
+    // Lexes one line starting in previousState, appends the format runs to
+    // runs and returns the state at the end of the line.
+    int lex(const QString &text, int previousState, QVector<FormatRun> *runs) const;
+
+    QSharedPointer<const LexerConfig> config() const { return m_config; }
+
+private:
+    QSharedPointer<const LexerConfig> m_config;
+};
+
+#endif // LEXER_H
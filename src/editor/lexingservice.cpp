@@ -0,0 +1,56 @@
+#include "lexingservice.h"
+
+#include <QtConcurrent>
+
+LexingService::LexingService(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<LexResult>(this))
+{
+    connect(m_watcher, &QFutureWatcher<LexResult>::finished, this, &LexingService::onJobFinished);
+}
+
+bool LexingService::isBusy() const
+{
+    return m_watcher->isRunning();
+}
+
+void LexingService::submit(const Lexer &lexer, const LexSnapshot &snapshot)
+{
+    // The job owns copies of the lexer and the snapshot, so it can outlive
+    // the service if the editor is closed mid-job.
+    m_watcher->setFuture(QtConcurrent::run(&LexingService::lexSnapshot, lexer, snapshot));
+}
+
+void LexingService::onJobFinished()
+{
+    emit lexed(m_watcher->result());
+}
+
+LexResult LexingService::lexSnapshot(const Lexer &lexer, const LexSnapshot &snapshot)
+{
+    LexResult result;
+    result.documentRevision = snapshot.documentRevision;
+    result.generation = snapshot.generation;
+    result.firstBlock = snapshot.firstBlock;
+    result.blocks.reserve(snapshot.lines.size());
+
+    int state = snapshot.startState;
+    for (int i = 0; i < snapshot.lines.size(); ++i) {
+        LexedBlock block;
+        block.text = snapshot.lines.at(i);
+        block.revision = snapshot.revisions.at(i);
+        block.startState = state;
+        block.endState = lexer.lex(snapshot.lines.at(i), state, &block.runs);
+        result.blocks.append(block);
+
+        state = block.endState;
+
+        // Past the edited range, stop as soon as the state matches what the
+        // document already has; later blocks would lex the same as before.
+        if (i + 1 >= snapshot.minimumBlocks && state == snapshot.knownEndStates.at(i)) {
+            break;
+        }
+    }
+
+    return result;
+}
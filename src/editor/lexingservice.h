@@ -0,0 +1,66 @@
+#ifndef LEXINGSERVICE_H
+#define LEXINGSERVICE_H
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <QFutureWatcher>
+
+#include "lexer.h"
+
+// Immutable copy of a block range, taken on the GUI thread and handed to a
+// pool thread. Nothing in here refers back to the QTextDocument.
+struct LexSnapshot
+{
+    int documentRevision = 0;
+    quint32 generation = 0;
+    int firstBlock = 0;
+    int startState = -1;
+    int minimumBlocks = 0;         // blocks that must be lexed before convergence counts
+    QVector<QString> lines;
+    QVector<int> revisions;        // QTextBlock::revision() per line
+    QVector<int> knownEndStates;   // block state before this request
+};
+
+struct LexedBlock
+{
+    QString text;   // the line as lexed, to match it against the document later
+    int revision;
+    int startState;
+    int endState;
+    QVector<FormatRun> runs;
+};
+
+struct LexResult
+{
+    int documentRevision = 0;
+    quint32 generation = 0;
+    int firstBlock = 0;
+    QVector<LexedBlock> blocks;
+};
+
+// Runs the lexer on the global thread pool, one job at a time per service.
+// Results are delivered on the thread that owns the service.
+class LexingService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LexingService(QObject *parent = nullptr);
+
+    bool isBusy() const;
+    void submit(const Lexer &lexer, const LexSnapshot &snapshot);
+
+signals:
+    void lexed(const LexResult &result);
+
+private slots:
+    void onJobFinished();
+
+private:
+    static LexResult lexSnapshot(const Lexer &lexer, const LexSnapshot &snapshot);
+
+    QFutureWatcher<LexResult> *m_watcher;
+};
+
+#endif // LEXINGSERVICE_H
@@ -0,0 +1,290 @@
+#include "piecetable.h"
+
+#include <algorithm>
+
+namespace {
+
+typedef QSharedPointer<const PieceNode> NodePtr;
+
+inline int subtreeLength(const NodePtr &node)
+{
+    return node ? node->subtreeLength : 0;
+}
+
+inline int subtreeNewlines(const NodePtr &node)
+{
+    return node ? node->subtreeNewlines : 0;
+}
+
+// Number of line breaks in buffer[start, start + length).
+int countNewlines(const PieceBuffer &buffer, int start, int length)
+{
+    const auto first = std::lower_bound(buffer.lineBreaks.constBegin(), buffer.lineBreaks.constEnd(), start);
+    const auto last = std::lower_bound(first, buffer.lineBreaks.constEnd(), start + length);
+    return int(last - first);
+}
+
+QSharedPointer<const PieceBuffer> makeBuffer(const QString &text)
+{
+    QSharedPointer<PieceBuffer> buffer(new PieceBuffer);
+    buffer->text = text;
+    const QChar *data = text.constData();
+    for (int i = 0; i < text.length(); ++i) {
+        if (data[i].unicode() == '\n') {
+            buffer->lineBreaks.append(i);
+        }
+    }
+    return buffer;
+}
+
+NodePtr makeNode(const QSharedPointer<const PieceBuffer> &buffer, int start, int length, int newlines,
+                 quint32 priority, const NodePtr &left, const NodePtr &right)
+{
+    PieceNode *node = new PieceNode;
+    node->buffer = buffer;
+    node->start = start;
+    node->length = length;
+    node->newlines = newlines;
+    node->priority = priority;
+    node->subtreeLength = subtreeLength(left) + length + subtreeLength(right);
+    node->subtreeNewlines = subtreeNewlines(left) + newlines + subtreeNewlines(right);
+    node->left = left;
+    node->right = right;
+    return NodePtr(node);
+}
+
+inline NodePtr withChildren(const NodePtr &node, const NodePtr &left, const NodePtr &right)
+{
+    return makeNode(node->buffer, node->start, node->length, node->newlines, node->priority, left, right);
+}
+
+// Splits the tree so that *left holds the first position characters. A piece
+// straddling the split point is cut in two; only the path is copied.
+void split(const NodePtr &node, int position, NodePtr *left, NodePtr *right)
+{
+    if (!node) {
+        *left = NodePtr();
+        *right = NodePtr();
+        return;
+    }
+
+    const int leftLength = subtreeLength(node->left);
+    if (position <= leftLength) {
+        NodePtr innerRight;
+        split(node->left, position, left, &innerRight);
+        *right = withChildren(node, innerRight, node->right);
+    } else if (position >= leftLength + node->length) {
+        NodePtr innerLeft;
+        split(node->right, position - leftLength - node->length, &innerLeft, right);
+        *left = withChildren(node, node->left, innerLeft);
+    } else {
+        const int offset = position - leftLength;
+        const int headNewlines = countNewlines(*node->buffer, node->start, offset);
+        *left = makeNode(node->buffer, node->start, offset, headNewlines,
+                         node->priority, node->left, NodePtr());
+        *right = makeNode(node->buffer, node->start + offset, node->length - offset,
+                          node->newlines - headNewlines, node->priority, NodePtr(), node->right);
+    }
+}
+
+NodePtr merge(const NodePtr &left, const NodePtr &right)
+{
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+
+    if (left->priority > right->priority) {
+        return withChildren(left, left->left, merge(left->right, right));
+    }
+    return withChildren(right, merge(left, right->left), right->right);
+}
+
+void appendRange(const NodePtr &node, int offset, int from, int to, QString *out)
+{
+    if (!node || to <= offset || from >= offset + node->subtreeLength) {
+        return;
+    }
+
+    appendRange(node->left, offset, from, to, out);
+
+    const int pieceStart = offset + subtreeLength(node->left);
+    const int pieceEnd = pieceStart + node->length;
+    const int begin = qMax(from, pieceStart);
+    const int end = qMin(to, pieceEnd);
+    if (begin < end) {
+        out->append(node->buffer->text.constData() + node->start + (begin - pieceStart), end - begin);
+    }
+
+    appendRange(node->right, pieceEnd, from, to, out);
+}
+
+int newlinesBefore(const NodePtr &node, int position)
+{
+    int count = 0;
+    NodePtr current = node;
+    while (current) {
+        const int leftLength = subtreeLength(current->left);
+        if (position <= leftLength) {
+            current = current->left;
+            continue;
+        }
+
+        count += subtreeNewlines(current->left);
+        position -= leftLength;
+        if (position <= current->length) {
+            return count + countNewlines(*current->buffer, current->start, position);
+        }
+
+        count += current->newlines;
+        position -= current->length;
+        current = current->right;
+    }
+    return count;
+}
+
+// Position just past the n-th (1-based) line break.
+int positionAfterNewline(const NodePtr &node, int n)
+{
+    int offset = 0;
+    NodePtr current = node;
+    while (current) {
+        const int leftNewlines = subtreeNewlines(current->left);
+        if (n <= leftNewlines) {
+            current = current->left;
+            continue;
+        }
+
+        n -= leftNewlines;
+        offset += subtreeLength(current->left);
+        if (n <= current->newlines) {
+            const QVector<int> &breaks = current->buffer->lineBreaks;
+            const auto first = std::lower_bound(breaks.constBegin(), breaks.constEnd(), current->start);
+            return offset + (*(first + (n - 1)) - current->start) + 1;
+        }
+
+        n -= current->newlines;
+        offset += current->length;
+        current = current->right;
+    }
+    return offset;
+}
+
+} // namespace
+
+int TextSnapshot::length() const
+{
+    return subtreeLength(m_root);
+}
+
+int TextSnapshot::lineCount() const
+{
+    return subtreeNewlines(m_root) + 1;
+}
+
+QString TextSnapshot::text() const
+{
+    return text(0, length());
+}
+
+QString TextSnapshot::text(int position, int length) const
+{
+    QString result;
+    const int from = qBound(0, position, this->length());
+    const int to = qBound(from, position + length, this->length());
+    result.reserve(to - from);
+    appendRange(m_root, 0, from, to, &result);
+    return result;
+}
+
+int TextSnapshot::lineOfPosition(int position) const
+{
+    return newlinesBefore(m_root, qBound(0, position, length()));
+}
+
+int TextSnapshot::positionOfLine(int line) const
+{
+    if (line <= 0) {
+        return 0;
+    }
+    if (line > subtreeNewlines(m_root)) {
+        return length();
+    }
+    return positionAfterNewline(m_root, line);
+}
+
+PieceTable::PieceTable()
+    : m_seed(0x9E3779B9u)
+{
+}
+
+PieceTable::PieceTable(const QString &text)
+    : PieceTable()
+{
+    if (!text.isEmpty()) {
+        m_root = makePiece(text);
+    }
+}
+
+int PieceTable::length() const
+{
+    return subtreeLength(m_root);
+}
+
+int PieceTable::lineCount() const
+{
+    return subtreeNewlines(m_root) + 1;
+}
+
+void PieceTable::insert(int position, const QString &text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    // Every insertion gets its own immutable buffer, so snapshots held by
+    // other threads never see a buffer change underneath them.
+    const NodePtr piece = makePiece(text);
+
+    NodePtr left;
+    NodePtr right;
+    split(m_root, qBound(0, position, length()), &left, &right);
+    m_root = merge(merge(left, piece), right);
+}
+
+void PieceTable::remove(int position, int length)
+{
+    if (length <= 0) {
+        return;
+    }
+
+    NodePtr left;
+    NodePtr rest;
+    NodePtr middle;
+    NodePtr right;
+    split(m_root, qBound(0, position, this->length()), &left, &rest);
+    split(rest, length, &middle, &right);
+    m_root = merge(left, right);
+}
+
+void PieceTable::setText(const QString &text)
+{
+    m_root = text.isEmpty() ? NodePtr() : makePiece(text);
+}
+
+PieceTable::NodePtr PieceTable::makePiece(const QString &text)
+{
+    const QSharedPointer<const PieceBuffer> buffer = makeBuffer(text);
+    return makeNode(buffer, 0, text.length(), buffer->lineBreaks.size(), nextPriority(), NodePtr(), NodePtr());
+}
+
+quint32 PieceTable::nextPriority()
+{
+    // xorshift32; treap priorities only need to be well spread.
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
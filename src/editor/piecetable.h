@@ -0,0 +1,85 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QString>
+#include <QVector>
+#include <QSharedPointer>
+
+// Immutable text buffer a piece points into, together with the offsets of
+// its line breaks so newline counts of any slice are a binary search.
+struct PieceBuffer
+{
+    QString text;
+    QVector<int> lineBreaks;
+};
+
+// Node of a persistent treap ordered by text position. Nodes are never
+// modified after construction; edits copy the path from the root, so every
+// older root stays a valid, complete version of the text.
+struct PieceNode
+{
+    QSharedPointer<const PieceBuffer> buffer;
+    int start;
+    int length;
+    int newlines;
+    quint32 priority;
+    int subtreeLength;
+    int subtreeNewlines;
+    QSharedPointer<const PieceNode> left;
+    QSharedPointer<const PieceNode> right;
+};
+
+// O(1) copyable, read-only view of one version of a PieceTable. Safe to hand
+// to other threads.
+class TextSnapshot
+{
+public:
+    TextSnapshot() = default;
+
+    int length() const;
+    int lineCount() const;
+    bool isEmpty() const { return length() == 0; }
+
+    QString text() const;
+    QString text(int position, int length) const;
+
+    // Line/position conversions; lines and positions are zero-based.
+    int lineOfPosition(int position) const;
+    int positionOfLine(int line) const;
+
+private:
+    friend class PieceTable;
+    explicit TextSnapshot(QSharedPointer<const PieceNode> root) : m_root(root) {}
+
+    QSharedPointer<const PieceNode> m_root;
+};
+
+// Piece table over a persistent treap: O(log n) expected inserts and
+// removes and O(1) snapshots. Undo stays with QTextDocument; a snapshot
+// shares structure with the current version for as long as it is held.
+class PieceTable
+{
+public:
+    PieceTable();
+    explicit PieceTable(const QString &text);
+
+    int length() const;
+    int lineCount() const;
+
+    void insert(int position, const QString &text);
+    void remove(int position, int length);
+    void setText(const QString &text);
+
+    TextSnapshot snapshot() const { return TextSnapshot(m_root); }
+
+private:
+    typedef QSharedPointer<const PieceNode> NodePtr;
+
+    NodePtr makePiece(const QString &text);
+    quint32 nextPriority();
+
+    NodePtr m_root;
+    quint32 m_seed;
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,264 @@
+#include "saveservice.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTemporaryFile>
+#include <QSharedPointer>
+#include <QtConcurrent>
+
+#ifdef Q_OS_UNIX
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Characters converted and written per step, so a large document is never
+// held as one UTF-8 copy.
+const int kWriteChunkChars = 1024 * 1024;
+
+bool writeSnapshot(QFile *file, const TextSnapshot &content, QString *error)
+{
+    const int length = content.length();
+    for (int position = 0; position < length;) {
+        int end = qMin(length, position + kWriteChunkChars);
+        QString chunk = content.text(position, end - position);
+
+        // Never split a surrogate pair across two chunks.
+        if (end < length && chunk.at(chunk.length() - 1).isHighSurrogate()) {
+            chunk.chop(1);
+            --end;
+        }
+
+        const QByteArray bytes = chunk.toUtf8();
+        if (file->write(bytes) != bytes.size()) {
+            *error = file->errorString();
+            return false;
+        }
+        position = end;
+    }
+
+    if (!file->flush()) {
+        *error = file->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool syncToDisk(QFile *file)
+{
+#ifdef Q_OS_UNIX
+    return ::fsync(file->handle()) == 0;
+#else
+    return file->flush();
+#endif
+}
+
+void syncDirectory(const QString &path)
+{
+    // Makes the renames themselves durable.
+#ifdef Q_OS_UNIX
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    Q_UNUSED(path)
+#endif
+}
+
+#ifdef Q_OS_UNIX
+// umask() can only be read by setting it, which races with every thread
+// creating files; it is read once, from the GUI thread, at startup.
+mode_t processUmask()
+{
+    static const mode_t mask = [] {
+        const mode_t current = ::umask(022);
+        ::umask(current);
+        return current;
+    }();
+    return mask;
+}
+#endif
+
+// Saving through a symlink replaces the file it points to, not the link.
+QString resolveTarget(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    if (!info.isSymLink()) {
+        return fileName;
+    }
+    const QString canonical = info.canonicalFilePath();
+    return canonical.isEmpty() ? info.symLinkTarget() : canonical;
+}
+
+bool replaceFile(const QString &source, const QString &target)
+{
+#ifdef Q_OS_UNIX
+    return ::rename(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0;
+#else
+    QFile::remove(target);
+    return QFile::rename(source, target);
+#endif
+}
+
+} // namespace
+
+SaveService::SaveService(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<QVector<SaveOutcome>>(this))
+{
+    connect(m_watcher, &QFutureWatcher<QVector<SaveOutcome>>::finished, this, &SaveService::onBatchFinished);
+#ifdef Q_OS_UNIX
+    processUmask();
+#endif
+}
+
+SaveService::~SaveService()
+{
+    // Never abandon a save halfway, even on shutdown.
+    m_watcher->waitForFinished();
+    if (!m_queue.isEmpty()) {
+        writeBatch(m_queue);
+    }
+}
+
+bool SaveService::isBusy() const
+{
+    return m_watcher->isRunning() || !m_queue.isEmpty();
+}
+
+void SaveService::save(const QString &fileName, const TextSnapshot &content)
+{
+    saveAll(QVector<SaveRequest>() << SaveRequest{fileName, content});
+}
+
+void SaveService::saveAll(const QVector<SaveRequest> &requests)
+{
+    // A newer snapshot of a queued file replaces the older one.
+    for (const SaveRequest &request : requests) {
+        bool replaced = false;
+        for (SaveRequest &queued : m_queue) {
+            if (queued.fileName == request.fileName) {
+                queued.content = request.content;
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) {
+            m_queue.append(request);
+        }
+    }
+
+    if (!m_watcher->isRunning()) {
+        startNextBatch();
+    }
+}
+
+void SaveService::startNextBatch()
+{
+    if (m_queue.isEmpty()) {
+        return;
+    }
+
+    const QVector<SaveRequest> batch = m_queue;
+    m_queue.clear();
+    m_watcher->setFuture(QtConcurrent::run(&SaveService::writeBatch, batch));
+}
+
+void SaveService::onBatchFinished()
+{
+    int savedCount = 0;
+    int failedCount = 0;
+    for (const SaveOutcome &outcome : m_watcher->result()) {
+        if (outcome.error.isEmpty()) {
+            ++savedCount;
+            emit fileSaved(outcome.fileName);
+        } else {
+            ++failedCount;
+            emit saveFailed(outcome.fileName, outcome.error);
+        }
+    }
+    emit batchFinished(savedCount, failedCount);
+
+    startNextBatch();
+}
+
+QVector<SaveOutcome> SaveService::writeBatch(const QVector<SaveRequest> &requests)
+{
+    QVector<SaveOutcome> outcomes(requests.size());
+    QVector<QSharedPointer<QTemporaryFile>> tempFiles(requests.size());
+    QVector<QString> targets(requests.size());
+
+    // 1. Write every file to a temp file in its target directory, so the
+    //    final rename never crosses a filesystem.
+    for (int i = 0; i < requests.size(); ++i) {
+        const SaveRequest &request = requests.at(i);
+        outcomes[i].fileName = request.fileName;
+
+        targets[i] = resolveTarget(request.fileName);
+        const QFileInfo targetInfo(targets.at(i));
+        QSharedPointer<QTemporaryFile> tempFile(new QTemporaryFile(
+            targetInfo.absolutePath() + "/." + targetInfo.fileName() + ".XXXXXX"));
+        tempFile->setAutoRemove(false);
+        if (!tempFile->open()) {
+            outcomes[i].error = tempFile->errorString();
+            continue;
+        }
+
+        // Temp files are created 0600; a new file gets what a plain open
+        // would have given it
+        if (targetInfo.exists()) {
+            tempFile->setPermissions(QFile::permissions(targets.at(i)));
+        } else {
+#ifdef Q_OS_UNIX
+            ::fchmod(tempFile->handle(), 0666 & ~processUmask());
+#endif
+        }
+
+        if (!writeSnapshot(tempFile.data(), request.content, &outcomes[i].error)) {
+            tempFile->close();
+            tempFile->remove();
+            continue;
+        }
+        tempFiles[i] = tempFile;
+    }
+
+    // 2. Sync all temp files back to back, so the filesystem can coalesce
+    //    the journal commits of the whole batch.
+    for (int i = 0; i < requests.size(); ++i) {
+        if (tempFiles.at(i) && !syncToDisk(tempFiles.at(i).data())) {
+            outcomes[i].error = QString("Could not sync %1 to disk").arg(tempFiles.at(i)->fileName());
+            tempFiles.at(i)->close();
+            tempFiles.at(i)->remove();
+            tempFiles[i].reset();
+        }
+    }
+
+    // 3. Atomically replace the targets, then sync each directory once.
+    QSet<QString> directories;
+    for (int i = 0; i < requests.size(); ++i) {
+        if (!tempFiles.at(i)) {
+            continue;
+        }
+
+        const QString tempName = tempFiles.at(i)->fileName();
+        tempFiles.at(i)->close();
+        if (!replaceFile(tempName, targets.at(i))) {
+            outcomes[i].error = QString("Could not replace %1").arg(targets.at(i));
+            QFile::remove(tempName);
+            continue;
+        }
+        directories.insert(QFileInfo(targets.at(i)).absolutePath());
+    }
+
+    for (const QString &directory : directories) {
+        syncDirectory(directory);
+    }
+
+    return outcomes;
+}
@@ -0,0 +1,55 @@
+#ifndef SAVESERVICE_H
+#define SAVESERVICE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QFutureWatcher>
+
+#include "piecetable.h"
+
+struct SaveRequest
+{
+    QString fileName;
+    TextSnapshot content;
+};
+
+struct SaveOutcome
+{
+    QString fileName;
+    QString error;   // empty on success
+};
+
+// Writes document snapshots off the GUI thread. Each file goes to a temp
+// file next to it, all temp files of a batch are fsynced together, then
+// renamed over their targets, so a crash never leaves a truncated file.
+class SaveService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SaveService(QObject *parent = nullptr);
+    ~SaveService();
+
+    void save(const QString &fileName, const TextSnapshot &content);
+    void saveAll(const QVector<SaveRequest> &requests);
+
+    bool isBusy() const;
+
+signals:
+    void fileSaved(const QString &fileName);
+    void saveFailed(const QString &fileName, const QString &error);
+    void batchFinished(int savedCount, int failedCount);
+
+private slots:
+    void onBatchFinished();
+
+private:
+    void startNextBatch();
+    static QVector<SaveOutcome> writeBatch(const QVector<SaveRequest> &requests);
+
+    QVector<SaveRequest> m_queue;
+    QFutureWatcher<QVector<SaveOutcome>> *m_watcher;
+};
+
+#endif // SAVESERVICE_H
@@ -1,8 +1,104 @@
 #include "syntaxhighlighter.h"
 
+#include <QTimer>
+#include <QTextBlock>
+#include <QElapsedTimer>
+
+namespace {
+
+// Upper bound for one continuation slice, so input and paint events keep
+// flowing while a large document is highlighted in the background.
+const int kContinuationSliceMs = 8;
+
+// Below this size lexing inline is cheaper than the thread handoff and
+// avoids a frame of stale colours while typing.
+const int kBackgroundLexingMinBlocks = 2000;
+
+// Blocks lexed past an edit before giving up on convergence, and the size of
+// one background continuation window.
+const int kBackgroundLookaheadBlocks = 256;
+const int kBackgroundWindowBlocks = 4096;
+
+// Shorter words are not worth completing
+const int kMinIdentifierLength = 3;
+
+inline bool isIdentifierStart(QChar c)
+{
+    return c.isLetter() || c == QLatin1Char('_');
+}
+
+inline bool isIdentifierPart(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+// Identifiers in text between lexer runs; a word that starts inside a run
+// belongs to the run
+void appendIdentifiers(const QString &text, int start, int end, QVector<QString> *identifiers)
+{
+    const QChar *data = text.constData();
+    int pos = start;
+    while (pos < end) {
+        if (!isIdentifierPart(data[pos])) {
+            ++pos;
+            continue;
+        }
+        const int wordStart = pos;
+        while (pos < end && isIdentifierPart(data[pos])) {
+            ++pos;
+        }
+        if (isIdentifierStart(data[wordStart]) && pos - wordStart >= kMinIdentifierLength
+                && (wordStart == 0 || !isIdentifierPart(data[wordStart - 1]))) {
+            identifiers->append(text.mid(wordStart, pos - wordStart));
+        }
+    }
+}
+
+} // namespace
+
+HighlightBlockData::~HighlightBlockData()
+{
+    if (identifierTrie) {
+        for (const QString &identifier : qAsConst(identifiers)) {
+            identifierTrie->remove(identifier);
+        }
+    }
+}
+
 SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent)
     : QSyntaxHighlighter(parent)
+    , m_lazyHighlighting(false)
+    , m_highlightedUpTo(-1)
+    , m_blockCount(parent ? parent->blockCount() : 0)
+    , m_firstVisibleBlock(0)
+    , m_lastVisibleBlock(100)
+    , m_continuationTimer(new QTimer(this))
+    , m_editBaseline(0)
+    , m_generation(0)
+    , m_lexingService(new LexingService(this))
+    , m_lexRequestTimer(new QTimer(this))
+    , m_backgroundLexing(false)
+    , m_dirtyFirst(-1)
+    , m_dirtyLast(-1)
+    , m_inFlightFirst(-1)
+    , m_inFlightLast(-1)
+    , m_inFlightContinuation(false)
+    , m_identifiers(new IdentifierTrie)
 {
+    m_continuationTimer->setInterval(0);
+    connect(m_continuationTimer, &QTimer::timeout, this, &SyntaxHighlighter::continueHighlighting);
+    
+    m_lexRequestTimer->setSingleShot(true);
+    m_lexRequestTimer->setInterval(0);
+    connect(m_lexRequestTimer, &QTimer::timeout, this, &SyntaxHighlighter::submitLexRequest);
+    connect(m_lexingService, &LexingService::lexed, this, &SyntaxHighlighter::onLexed);
+    
+    // QSyntaxHighlighter connected to contentsChange first, so this slot runs
+    // after the edit has been rehighlighted.
+    if (parent) {
+        connect(parent, &QTextDocument::contentsChange, this, &SyntaxHighlighter::onContentsChange);
+    }
+    
     // Set up formats
     m_keywordFormat.setForeground(QColor(86, 156, 214)); // Blue
     m_keywordFormat.setFontWeight(QFont::Bold);
@@ -25,6 +121,15 @@ SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent)
     
     m_preprocessorFormat.setForeground(QColor(155, 155, 155)); // Gray
     
+    m_tokenFormats[int(TokenKind::Keyword)] = m_keywordFormat;
+    m_tokenFormats[int(TokenKind::ClassName)] = m_classFormat;
+    m_tokenFormats[int(TokenKind::Comment)] = m_singleLineCommentFormat;
+    m_tokenFormats[int(TokenKind::MultiLineComment)] = m_multiLineCommentFormat;
+    m_tokenFormats[int(TokenKind::String)] = m_quotationFormat;
+    m_tokenFormats[int(TokenKind::Function)] = m_functionFormat;
+    m_tokenFormats[int(TokenKind::Number)] = m_numberFormat;
+    m_tokenFormats[int(TokenKind::Preprocessor)] = m_preprocessorFormat;
+    
     // Default to C++ highlighting
     setupCppHighlighting();
 }
@@ -36,7 +141,6 @@ void SyntaxHighlighter::setLanguage(const QString &language)
     }
     
     m_currentLanguage = language;
-    m_highlightingRules.clear();
     
     if (language == "cpp" || language == "h" || language == "c" || language == "hpp") {
         setupCppHighlighting();
@@ -48,207 +152,513 @@ void SyntaxHighlighter::setLanguage(const QString &language)
         setupGenericHighlighting();
     }
     
-    rehighlight();
+    // Invalidates every cached block without touching the blocks themselves.
+    ++m_generation;
+    restartHighlighting();
 }
 
-void SyntaxHighlighter::setupCppHighlighting()
+void SyntaxHighlighter::setLazyHighlighting(bool enabled)
 {
-    HighlightingRule rule;
-
-    // C++ keywords
-    QStringList keywordPatterns;
-    keywordPatterns << "\\bauto\\b" << "\\bbool\\b" << "\\bbreak\\b" << "\\bcase\\b"
-                    << "\\bcatch\\b" << "\\bchar\\b" << "\\bclass\\b" << "\\bconst\\b"
-                    << "\\bconstexpr\\b" << "\\bcontinue\\b" << "\\bdefault\\b" << "\\bdelete\\b"
-                    << "\\bdo\\b" << "\\bdouble\\b" << "\\belse\\b" << "\\benum\\b"
-                    << "\\bexplicit\\b" << "\\bextern\\b" << "\\bfalse\\b" << "\\bfloat\\b"
-                    << "\\bfor\\b" << "\\bfriend\\b" << "\\bif\\b" << "\\binline\\b"
-                    << "\\bint\\b" << "\\blong\\b" << "\\bnamespace\\b" << "\\bnew\\b"
-                    << "\\bnoexcept\\b" << "\\bnullptr\\b" << "\\boperator\\b" << "\\bprivate\\b"
-                    << "\\bprotected\\b" << "\\bpublic\\b" << "\\breturn\\b" << "\\bshort\\b"
-                    << "\\bsigned\\b" << "\\bsizeof\\b" << "\\bstatic\\b" << "\\bstruct\\b"
-                    << "\\bswitch\\b" << "\\btemplate\\b" << "\\bthis\\b" << "\\bthrow\\b"
-                    << "\\btrue\\b" << "\\btry\\b" << "\\btypedef\\b" << "\\btypename\\b"
-                    << "\\bunion\\b" << "\\bunsigned\\b" << "\\busing\\b" << "\\bvirtual\\b"
-                    << "\\bvoid\\b" << "\\bvolatile\\b" << "\\bwhile\\b";
-
-    foreach (const QString &pattern, keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = m_keywordFormat;
-        m_highlightingRules.append(rule);
-    }
-
-    // Class names
-    rule.pattern = QRegularExpression("\\b[A-Z][A-Za-z0-9_]*\\b");
-    rule.format = m_classFormat;
-    m_highlightingRules.append(rule);
-
-    // Single line comments
-    rule.pattern = QRegularExpression("//[^\n]*");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
-
-    // Multi-line comments
-    m_commentStartExpression = QRegularExpression("/\\*");
-    m_commentEndExpression = QRegularExpression("\\*/");
-
-    // Quotations
-    rule.pattern = QRegularExpression("\".*\"");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
-
-    // Functions
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
-    
-    // Numbers
-    rule.pattern = QRegularExpression("\\b[0-9]+\\.?[0-9]*\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
-    
-    // Preprocessor directives
-    rule.pattern = QRegularExpression("#[A-Za-z0-9_]+");
-    rule.format = m_preprocessorFormat;
-    m_highlightingRules.append(rule);
+    if (m_lazyHighlighting == enabled) {
+        return;
+    }
+    
+    m_lazyHighlighting = enabled;
+    restartHighlighting();
 }
 
-void SyntaxHighlighter::setupPythonHighlighting()
+void SyntaxHighlighter::setVisibleBlockRange(int firstBlock, int lastBlock)
+{
+    if (firstBlock == m_firstVisibleBlock && lastBlock == m_lastVisibleBlock) {
+        return;
+    }
+    
+    const int previousFirst = m_firstVisibleBlock;
+    const int previousLast = m_lastVisibleBlock;
+    m_firstVisibleBlock = firstBlock;
+    m_lastVisibleBlock = lastBlock;
+    
+    if (!m_lazyHighlighting || !document()) {
+        return;
+    }
+    
+    // Blocks that just scrolled into view and have not been reached by the
+    // continuation yet are highlighted right away.
+    QTextBlock block = document()->findBlockByNumber(qMax(firstBlock, m_highlightedUpTo + 1));
+    while (block.isValid() && block.blockNumber() <= lastBlock) {
+        const int blockNumber = block.blockNumber();
+        if (blockNumber < previousFirst || blockNumber > previousLast) {
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+    m_editBaseline = m_stats.blocksLexed;
+}
+
+void SyntaxHighlighter::setBackgroundLexing(bool enabled)
 {
-    HighlightingRule rule;
+    m_backgroundLexing = enabled;
+}
+
+bool SyntaxHighlighter::useBackgroundLexing() const
+{
+    return m_backgroundLexing && document() && document()->blockCount() >= kBackgroundLexingMinBlocks;
+}
+
+bool SyntaxHighlighter::hasContinuationWork() const
+{
+    return m_lazyHighlighting && document() && m_highlightedUpTo + 1 < document()->blockCount();
+}
 
-    // Python keywords
-    QStringList keywordPatterns;
-    keywordPatterns << "\\band\\b" << "\\bas\\b" << "\\bassert\\b" << "\\bbreak\\b"
-                    << "\\bclass\\b" << "\\bcontinue\\b" << "\\bdef\\b" << "\\bdel\\b"
-                    << "\\belif\\b" << "\\belse\\b" << "\\bexcept\\b" << "\\bexec\\b"
-                    << "\\bfinally\\b" << "\\bfor\\b" << "\\bfrom\\b" << "\\bglobal\\b"
-                    << "\\bif\\b" << "\\bimport\\b" << "\\bin\\b" << "\\bis\\b"
-                    << "\\blambda\\b" << "\\bnot\\b" << "\\bor\\b" << "\\bpass\\b"
-                    << "\\bprint\\b" << "\\braise\\b" << "\\breturn\\b" << "\\btry\\b"
-                    << "\\bwhile\\b" << "\\bwith\\b" << "\\byield\\b" << "\\bTrue\\b"
-                    << "\\bFalse\\b" << "\\bNone\\b";
+void SyntaxHighlighter::markDirty(int firstBlock, int lastBlock)
+{
+    m_dirtyFirst = m_dirtyFirst < 0 ? firstBlock : qMin(m_dirtyFirst, firstBlock);
+    m_dirtyLast = qMax(m_dirtyLast, lastBlock);
+    scheduleLexRequest();
+}
 
-    foreach (const QString &pattern, keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = m_keywordFormat;
-        m_highlightingRules.append(rule);
+void SyntaxHighlighter::scheduleLexRequest()
+{
+    if (!m_lexRequestTimer->isActive()) {
+        m_lexRequestTimer->start();
     }
+}
 
-    // Single line comments
-    rule.pattern = QRegularExpression("#[^\n]*");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::submitLexRequest()
+{
+    QTextDocument *doc = document();
+    if (!doc || m_lexingService->isBusy()) {
+        // A busy service reschedules from onLexed.
+        return;
+    }
+    
+    // Edited blocks go first; the lazy continuation only runs when there is
+    // nothing dirty left.
+    int first = -1;
+    int last = -1;
+    bool continuation = false;
+    if (m_dirtyFirst >= 0) {
+        first = m_dirtyFirst;
+        last = m_dirtyLast;
+        m_dirtyFirst = -1;
+        m_dirtyLast = -1;
+    } else if (hasContinuationWork()) {
+        first = m_highlightedUpTo + 1;
+        last = first + kBackgroundWindowBlocks - 1;
+        continuation = true;
+    } else {
+        return;
+    }
+    
+    QTextBlock block = doc->findBlockByNumber(first);
+    if (!block.isValid()) {
+        return;
+    }
+    
+    LexSnapshot snapshot;
+    snapshot.documentRevision = doc->revision();
+    snapshot.generation = m_generation;
+    snapshot.firstBlock = first;
+    snapshot.startState = block.previous().isValid() ? block.previous().userState() : -1;
+    snapshot.minimumBlocks = last - first + 1;
+    
+    const int limit = continuation ? last : last + kBackgroundLookaheadBlocks;
+    for (int blockNumber = first; block.isValid() && blockNumber <= limit; ++blockNumber) {
+        snapshot.lines.append(block.text());
+        snapshot.revisions.append(block.revision());
+        snapshot.knownEndStates.append(block.userState());
+        block = block.next();
+    }
+    
+    m_inFlightFirst = first;
+    m_inFlightLast = last;
+    m_inFlightContinuation = continuation;
+    m_lexingService->submit(m_lexer, snapshot);
+}
 
-    // Quotations
-    rule.pattern = QRegularExpression("\".*\"|'.*'");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::onLexed(const LexResult &result)
+{
+    QTextDocument *doc = document();
+    if (!doc) {
+        return;
+    }
+    
+    const int firstBlock = m_inFlightFirst;
+    const int lastBlock = m_inFlightLast;
+    if (result.generation != m_generation) {
+        // The language changed while the job ran. Drop the result and queue
+        // its range again; the continuation simply resumes.
+        if (!m_inFlightContinuation) {
+            markDirty(firstBlock, lastBlock);
+        } else {
+            scheduleLexRequest();
+        }
+        return;
+    }
+    
+    // Store every block first, so the rehighlight cascade below finds the
+    // following blocks already cached. If the text changed while the job
+    // ran, the blocks up to the first edited one are still good; the rest
+    // is dropped, so typing does not starve the continuation.
+    const bool documentChanged = result.documentRevision != doc->revision();
+    QVector<QTextBlock> blocks;
+    blocks.reserve(result.blocks.size());
+    QTextBlock block = doc->findBlockByNumber(firstBlock);
+    for (const LexedBlock &lexed : result.blocks) {
+        if (!block.isValid()) {
+            break;
+        }
+        if (documentChanged && (block.revision() != lexed.revision || block.text() != lexed.text)) {
+            break;
+        }
+        
+        HighlightBlockData *data = static_cast<HighlightBlockData *>(block.userData());
+        if (!data) {
+            data = new HighlightBlockData;
+            block.setUserData(data);
+        }
+        data->revision = lexed.revision;
+        data->startState = lexed.startState;
+        data->endState = lexed.endState;
+        data->generation = result.generation;
+        data->runs = lexed.runs;
+        updateIdentifiers(data, block.text());
+        
+        blocks.append(block);
+        block = block.next();
+    }
+    const bool complete = blocks.size() == result.blocks.size();
+    
+    if (blocks.isEmpty()) {
+        if (!m_inFlightContinuation) {
+            markDirty(firstBlock, lastBlock);
+        } else {
+            scheduleLexRequest();
+        }
+        return;
+    }
+    
+    m_stats.blocksLexed += blocks.size();
+    if (m_inFlightContinuation) {
+        // Only a window that starts at the watermark may move it
+        if (firstBlock <= m_highlightedUpTo + 1) {
+            m_highlightedUpTo = qMax(m_highlightedUpTo, firstBlock + blocks.size() - 1);
+        }
+    } else {
+        m_stats.lastEditBlocksLexed = blocks.size();
+    }
+    m_editBaseline = m_stats.blocksLexed;
+    
+    const int lastStateBefore = blocks.last().userState();
+    for (const QTextBlock &lexedBlock : blocks) {
+        rehighlightBlock(lexedBlock);
+    }
+    
+    if (!complete) {
+        // The edited part of the range goes around again
+        if (!m_inFlightContinuation && firstBlock + blocks.size() <= lastBlock) {
+            markDirty(firstBlock + blocks.size(), lastBlock);
+        }
+    } else if (!m_inFlightContinuation && block.isValid()
+               && blocks.last().userState() != lastStateBefore) {
+        // The worker hit its lookahead limit before the state converged.
+        markDirty(block.blockNumber(), block.blockNumber());
+    }
+    
+    if (m_dirtyFirst >= 0 || (useBackgroundLexing() && hasContinuationWork())) {
+        scheduleLexRequest();
+    }
+}
 
-    // Functions
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::updateIdentifiers(HighlightBlockData *data, const QString &text)
+{
+    // Keywords, numbers, strings and comments are not identifiers; function
+    // and class name runs are, and so is plain text between runs
+    QVector<QString> identifiers;
+    int pos = 0;
+    for (const FormatRun &run : qAsConst(data->runs)) {
+        appendIdentifiers(text, pos, qMin(run.start, text.length()), &identifiers);
+        if ((run.kind == TokenKind::Function || run.kind == TokenKind::ClassName)
+                && run.length >= kMinIdentifierLength) {
+            identifiers.append(text.mid(run.start, run.length));
+        }
+        pos = qMax(pos, run.start + run.length);
+    }
+    appendIdentifiers(text, qMin(pos, text.length()), text.length(), &identifiers);
     
-    // Numbers
-    rule.pattern = QRegularExpression("\\b[0-9]+\\.?[0-9]*\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
+    if (identifiers == data->identifiers && data->identifierTrie == m_identifiers) {
+        return;
+    }
+    
+    // Insert before removing, so words that stay never drop out of the trie
+    for (const QString &identifier : qAsConst(identifiers)) {
+        m_identifiers->insert(identifier);
+    }
+    if (data->identifierTrie) {
+        for (const QString &identifier : qAsConst(data->identifiers)) {
+            data->identifierTrie->remove(identifier);
+        }
+    }
+    data->identifiers = identifiers;
+    data->identifierTrie = m_identifiers;
 }
 
-void SyntaxHighlighter::setupJavaScriptHighlighting()
+void SyntaxHighlighter::resetStats()
 {
-    HighlightingRule rule;
+    m_stats = HighlightStats();
+    m_editBaseline = 0;
+}
 
-    // JavaScript keywords
-    QStringList keywordPatterns;
-    keywordPatterns << "\\bbreak\\b" << "\\bcase\\b" << "\\bcatch\\b" << "\\bclass\\b"
-                    << "\\bconst\\b" << "\\bcontinue\\b" << "\\bdefault\\b" << "\\bdelete\\b"
-                    << "\\bdo\\b" << "\\belse\\b" << "\\bexport\\b" << "\\bextends\\b"
-                    << "\\bfalse\\b" << "\\bfinally\\b" << "\\bfor\\b" << "\\bfunction\\b"
-                    << "\\bif\\b" << "\\bimport\\b" << "\\bin\\b" << "\\binstanceof\\b"
-                    << "\\blet\\b" << "\\bnew\\b" << "\\bnull\\b" << "\\breturn\\b"
-                    << "\\bsuper\\b" << "\\bswitch\\b" << "\\bthis\\b" << "\\bthrow\\b"
-                    << "\\btrue\\b" << "\\btry\\b" << "\\btypeof\\b" << "\\bundefined\\b"
-                    << "\\bvar\\b" << "\\bvoid\\b" << "\\bwhile\\b" << "\\bwith\\b"
-                    << "\\byield\\b";
+void SyntaxHighlighter::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    
+    QTextDocument *doc = document();
+    const int blockDelta = doc->blockCount() - m_blockCount;
+    m_blockCount = doc->blockCount();
+    
+    // Inserted or removed lines move every later block, so the watermark
+    // moves with the blocks it covers. The edited blocks themselves were
+    // rehighlighted against the old watermark just before this.
+    if (blockDelta != 0) {
+        const int firstBlock = doc->findBlock(position).blockNumber();
+        const int lastBlock = doc->findBlock(position + charsAdded).blockNumber();
+        const int oldLastBlock = lastBlock - blockDelta;
+        
+        // Queued and in-flight ranges after the edit refer to the same blocks
+        // under their new numbers
+        if (m_dirtyFirst > oldLastBlock) {
+            m_dirtyFirst += blockDelta;
+            m_dirtyLast += blockDelta;
+        }
+        if (m_inFlightFirst > oldLastBlock) {
+            m_inFlightFirst += blockDelta;
+            m_inFlightLast += blockDelta;
+        }
+        
+        if (m_highlightedUpTo < 0) {
+            // Nothing reached yet
+        } else if (m_highlightedUpTo >= oldLastBlock) {
+            // The edit is entirely below the watermark. Edited blocks past the
+            // old watermark were skipped as pending and are done now.
+            const int skippedFrom = qMax(firstBlock, m_highlightedUpTo + 1);
+            m_highlightedUpTo += blockDelta;
+            QTextBlock block = doc->findBlockByNumber(skippedFrom);
+            while (block.isValid() && block.blockNumber() <= lastBlock) {
+                rehighlightBlock(block);
+                block = block.next();
+            }
+        } else {
+            // The edit straddles the watermark; blocks after the edit were not
+            // reached yet, whatever their new numbers
+            m_highlightedUpTo = qMin(m_highlightedUpTo, lastBlock);
+        }
+    }
+    
+    // Lexing outside of edits re-baselines the counter, so the difference
+    // is exactly what this edit cost.
+    m_stats.lastEditBlocksLexed = int(m_stats.blocksLexed - m_editBaseline);
+    m_editBaseline = m_stats.blocksLexed;
+}
 
-    foreach (const QString &pattern, keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = m_keywordFormat;
-        m_highlightingRules.append(rule);
+void SyntaxHighlighter::restartHighlighting()
+{
+    if (!m_lazyHighlighting || !document()) {
+        m_continuationTimer->stop();
+        m_highlightedUpTo = -1;
+        rehighlight();
+        m_editBaseline = m_stats.blocksLexed;
+        return;
     }
+    
+    // Visible blocks first; everything else is picked up by the continuation
+    // starting from the top so block states are correct by the time it is done.
+    m_highlightedUpTo = -1;
+    QTextBlock block = document()->findBlockByNumber(m_firstVisibleBlock);
+    while (block.isValid() && block.blockNumber() <= m_lastVisibleBlock) {
+        rehighlightBlock(block);
+        block = block.next();
+    }
+    m_editBaseline = m_stats.blocksLexed;
+    m_continuationTimer->start();
+}
 
-    // Single line comments
-    rule.pattern = QRegularExpression("//[^\n]*");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::continueHighlighting()
+{
+    if (!document()) {
+        m_continuationTimer->stop();
+        return;
+    }
+    
+    if (useBackgroundLexing()) {
+        // The worker takes over in windows; onLexed schedules the next one.
+        m_continuationTimer->stop();
+        scheduleLexRequest();
+        return;
+    }
+    
+    QElapsedTimer elapsed;
+    elapsed.start();
+    
+    // Each rehighlightBlock lexes one block with the state its predecessor
+    // left behind; the cascade stops at the next pending block because
+    // highlightBlock leaves pending block states untouched.
+    QTextBlock block = document()->findBlockByNumber(m_highlightedUpTo + 1);
+    while (block.isValid()) {
+        m_highlightedUpTo = block.blockNumber();
+        rehighlightBlock(block);
+        block = block.next();
+        
+        if (elapsed.elapsed() >= kContinuationSliceMs) {
+            break;
+        }
+    }
+    
+    m_editBaseline = m_stats.blocksLexed;
+    
+    if (!block.isValid()) {
+        m_continuationTimer->stop();
+    }
+}
 
-    // Multi-line comments
-    m_commentStartExpression = QRegularExpression("/\\*");
-    m_commentEndExpression = QRegularExpression("\\*/");
+bool SyntaxHighlighter::isPendingBlock(int blockNumber) const
+{
+    return blockNumber > m_highlightedUpTo
+        && (blockNumber < m_firstVisibleBlock || blockNumber > m_lastVisibleBlock);
+}
 
-    // Quotations
-    rule.pattern = QRegularExpression("\".*\"|'.*'|`.*`");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::setupCppHighlighting()
+{
+    // Lexer configurations are immutable, so every highlighter shares one
+    // instance per language.
+    static const QSharedPointer<const LexerConfig> config = [] {
+        QSharedPointer<LexerConfig> cpp(new LexerConfig);
+        cpp->keywords = KeywordSet(QStringList()
+            << "auto" << "bool" << "break" << "case" << "catch" << "char" << "class" << "const"
+            << "constexpr" << "continue" << "default" << "delete" << "do" << "double" << "else" << "enum"
+            << "explicit" << "extern" << "false" << "float" << "for" << "friend" << "if" << "inline"
+            << "int" << "long" << "namespace" << "new" << "noexcept" << "nullptr" << "operator" << "private"
+            << "protected" << "public" << "return" << "short" << "signed" << "sizeof" << "static" << "struct"
+            << "switch" << "template" << "this" << "throw" << "true" << "try" << "typedef" << "typename"
+            << "union" << "unsigned" << "using" << "virtual" << "void" << "volatile" << "while");
+        cpp->lineComment = "//";
+        cpp->blockComments = true;
+        cpp->stringDelimiters = "\"'";
+        cpp->classNames = true;
+        cpp->functions = true;
+        cpp->preprocessor = true;
+        return QSharedPointer<const LexerConfig>(cpp);
+    }();
+
+    m_lexer = Lexer(config);
+}
 
-    // Functions
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
-    
-    // Numbers
-    rule.pattern = QRegularExpression("\\b[0-9]+\\.?[0-9]*\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::setupPythonHighlighting()
+{
+    static const QSharedPointer<const LexerConfig> config = [] {
+        QSharedPointer<LexerConfig> python(new LexerConfig);
+        python->keywords = KeywordSet(QStringList()
+            << "and" << "as" << "assert" << "break" << "class" << "continue" << "def" << "del"
+            << "elif" << "else" << "except" << "exec" << "finally" << "for" << "from" << "global"
+            << "if" << "import" << "in" << "is" << "lambda" << "not" << "or" << "pass"
+            << "print" << "raise" << "return" << "try" << "while" << "with" << "yield" << "True"
+            << "False" << "None");
+        python->lineComment = "#";
+        python->stringDelimiters = "\"'";
+        python->functions = true;
+        return QSharedPointer<const LexerConfig>(python);
+    }();
+
+    m_lexer = Lexer(config);
 }
 
-void SyntaxHighlighter::setupGenericHighlighting()
+void SyntaxHighlighter::setupJavaScriptHighlighting()
 {
-    HighlightingRule rule;
+    static const QSharedPointer<const LexerConfig> config = [] {
+        QSharedPointer<LexerConfig> javaScript(new LexerConfig);
+        javaScript->keywords = KeywordSet(QStringList()
+            << "break" << "case" << "catch" << "class" << "const" << "continue" << "default" << "delete"
+            << "do" << "else" << "export" << "extends" << "false" << "finally" << "for" << "function"
+            << "if" << "import" << "in" << "instanceof" << "let" << "new" << "null" << "return"
+            << "super" << "switch" << "this" << "throw" << "true" << "try" << "typeof" << "undefined"
+            << "var" << "void" << "while" << "with" << "yield");
+        javaScript->lineComment = "//";
+        javaScript->blockComments = true;
+        javaScript->stringDelimiters = "\"'`";
+        javaScript->functions = true;
+        return QSharedPointer<const LexerConfig>(javaScript);
+    }();
+
+    m_lexer = Lexer(config);
+}
 
-    // Numbers
-    rule.pattern = QRegularExpression("\\b[0-9]+\\.?[0-9]*\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
+void SyntaxHighlighter::setupGenericHighlighting()
+{
+    static const QSharedPointer<const LexerConfig> config = [] {
+        QSharedPointer<LexerConfig> generic(new LexerConfig);
+        generic->stringDelimiters = "\"'";
+        return QSharedPointer<const LexerConfig>(generic);
+    }();
 
-    // Quotations
-    rule.pattern = QRegularExpression("\".*\"|'.*'");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
+    m_lexer = Lexer(config);
 }
 
 void SyntaxHighlighter::highlightBlock(const QString &text)
 {
-    foreach (const HighlightingRule &rule, m_highlightingRules) {
-        QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+    if (m_lazyHighlighting && isPendingBlock(currentBlock().blockNumber())) {
+        // Not reached yet: leave the block state untouched so the reformat
+        // cascade ends here, and make sure the continuation comes back.
+        if (!m_continuationTimer->isActive()) {
+            m_continuationTimer->start();
         }
+        return;
     }
-
-    // Handle multi-line comments
-    setCurrentBlockState(0);
-
-    QRegularExpressionMatch startMatch = m_commentStartExpression.match(text);
-    int startIndex = 0;
-    if (previousBlockState() != 1)
-        startIndex = startMatch.capturedStart();
-
-    while (startIndex >= 0) {
-        QRegularExpressionMatch endMatch = m_commentEndExpression.match(text, startIndex);
-        int endIndex = endMatch.capturedStart();
-        int commentLength = 0;
-        if (endIndex == -1) {
-            setCurrentBlockState(1);
-            commentLength = text.length() - startIndex;
-        } else {
-            commentLength = endIndex - startIndex + endMatch.capturedLength();
+    
+    const QTextBlock block = currentBlock();
+    const int startState = previousBlockState();
+    
+    HighlightBlockData *data = static_cast<HighlightBlockData *>(currentBlockUserData());
+    if (data && data->revision == block.revision() && data->startState == startState
+            && data->generation == m_generation) {
+        ++m_stats.blocksReused;
+    } else if (useBackgroundLexing()) {
+        // Keep showing the last known runs and end state until the worker
+        // catches up; keeping the old state also stops the cascade here.
+        markDirty(block.blockNumber(), block.blockNumber());
+        if (!data) {
+            return;
+        }
+        
+        const int length = text.length();
+        for (const FormatRun &run : data->runs) {
+            if (run.start < length) {
+                setFormat(run.start, qMin(run.length, length - run.start), m_tokenFormats[int(run.kind)]);
+            }
+        }
+        setCurrentBlockState(data->endState);
+        return;
+    } else {
+        if (!data) {
+            data = new HighlightBlockData;
+            setCurrentBlockUserData(data);
         }
-        setFormat(startIndex, commentLength, m_multiLineCommentFormat);
-        startMatch = m_commentStartExpression.match(text, startIndex + commentLength);
-        startIndex = startMatch.capturedStart();
+        
+        // One pass over the line; the lexer emits non-overlapping runs.
+        data->runs.clear();
+        data->endState = m_lexer.lex(text, startState, &data->runs);
+        data->revision = block.revision();
+        data->startState = startState;
+        data->generation = m_generation;
+        updateIdentifiers(data, text);
+        ++m_stats.blocksLexed;
+    }
+    
+    for (const FormatRun &run : data->runs) {
+        setFormat(run.start, run.length, m_tokenFormats[int(run.kind)]);
     }
-}
\ No newline at end of file
+    
+    // QSyntaxHighlighter only moves on to the next block when this state
+    // differs from the one stored before, so an edit stops propagating as
+    // soon as the end state converges.
+    setCurrentBlockState(data->endState);
+}
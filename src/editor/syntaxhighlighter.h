@@ -3,8 +3,41 @@
 
 #include <QSyntaxHighlighter>
 #include <QTextDocument>
-#include <QRegularExpression>
 #include <QTextCharFormat>
+#include <QTextBlockUserData>
+#include <QSharedPointer>
+
+#include "lexer.h"
+#include "lexingservice.h"
+#include "identifiertrie.h"
+
+class QTimer;
+
+// Lexer output cached on a block. It stays valid while the block text
+// (revision), the state it starts in and the language are unchanged.
+class HighlightBlockData : public QTextBlockUserData
+{
+public:
+    ~HighlightBlockData() override;
+
+    int revision = -1;
+    int startState = -1;
+    int endState = Lexer::NormalState;
+    quint32 generation = 0;
+    QVector<FormatRun> runs;
+
+    // Identifiers of the block as counted in the document's trie; taken
+    // out again when the block goes away
+    QVector<QString> identifiers;
+    QSharedPointer<IdentifierTrie> identifierTrie;
+};
+
+struct HighlightStats
+{
+    quint64 blocksLexed = 0;
+    quint64 blocksReused = 0;
+    int lastEditBlocksLexed = 0;
+};
 
 class SyntaxHighlighter : public QSyntaxHighlighter
 {
@@ -14,17 +47,68 @@ public:
     explicit SyntaxHighlighter(QTextDocument *parent = nullptr);
     
     void setLanguage(const QString &language);
+    
+    // In lazy mode only the visible blocks are highlighted synchronously; the
+    // rest of the document is finished in time slices on the event loop.
+    void setLazyHighlighting(bool enabled);
+    bool isLazyHighlighting() const { return m_lazyHighlighting; }
+    void setVisibleBlockRange(int firstBlock, int lastBlock);
+    
+    // On large documents, lex on the thread pool instead of the GUI thread;
+    // highlightBlock then only applies results that are already cached.
+    void setBackgroundLexing(bool enabled);
+    bool isBackgroundLexing() const { return m_backgroundLexing; }
+    
+    // Lexing counters; lastEditBlocksLexed covers the most recent document
+    // edit only, so typing should keep it proportional to the edited lines.
+    const HighlightStats &stats() const { return m_stats; }
+    void resetStats();
+    
+    // Every identifier in the lexed blocks, kept in step with the lexer
+    // output block by block
+    const IdentifierTrie &identifiers() const { return *m_identifiers; }
 
 protected:
     void highlightBlock(const QString &text) override;
 
+private slots:
+    void continueHighlighting();
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void submitLexRequest();
+    void onLexed(const LexResult &result);
+
 private:
-    struct HighlightingRule
-    {
-        QRegularExpression pattern;
-        QTextCharFormat format;
-    };
-    QVector<HighlightingRule> m_highlightingRules;
+    void restartHighlighting();
+    bool isPendingBlock(int blockNumber) const;
+    bool useBackgroundLexing() const;
+    bool hasContinuationWork() const;
+    void markDirty(int firstBlock, int lastBlock);
+    void scheduleLexRequest();
+    void updateIdentifiers(HighlightBlockData *data, const QString &text);
+    
+    bool m_lazyHighlighting;
+    int m_highlightedUpTo;
+    int m_blockCount;
+    int m_firstVisibleBlock;
+    int m_lastVisibleBlock;
+    QTimer *m_continuationTimer;
+    
+    HighlightStats m_stats;
+    quint64 m_editBaseline;
+    quint32 m_generation;
+    
+    LexingService *m_lexingService;
+    QTimer *m_lexRequestTimer;
+    bool m_backgroundLexing;
+    int m_dirtyFirst;
+    int m_dirtyLast;
+    int m_inFlightFirst;
+    int m_inFlightLast;
+    bool m_inFlightContinuation;
+    
+    Lexer m_lexer;
+    QSharedPointer<IdentifierTrie> m_identifiers;
+    QTextCharFormat m_tokenFormats[int(TokenKind::Count)];
 
     QTextCharFormat m_keywordFormat;
     QTextCharFormat m_classFormat;
@@ -35,9 +119,6 @@ private:
     QTextCharFormat m_numberFormat;
     QTextCharFormat m_preprocessorFormat;
     
-    QRegularExpression m_commentStartExpression;
-    QRegularExpression m_commentEndExpression;
-    
     QString m_currentLanguage;
     
     void setupCppHighlighting();
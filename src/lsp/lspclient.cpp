@@ -0,0 +1,660 @@
+#include "lspclient.h"
+#include "lspconnection.h"
+#include "editor/codeeditor.h"
+
+#include <QTimer>
+#include <QUrl>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QCoreApplication>
+#include <QTextBlock>
+#include <QJsonValue>
+#include <QSet>
+
+#include <algorithm>
+
+namespace {
+
+// Edits are collected for this long before a didChange goes out
+const int kChangeFlushDelay = 50;
+
+// Typing pauses this long before completions are requested
+const int kCompletionDelay = 120;
+
+// Past this many coalesced deltas the whole text is cheaper
+const int kMaxPendingChanges = 200;
+
+const int kMaxCompletionItems = 500;
+
+// Latency samples kept per method
+const int kSampleCount = 256;
+
+// JSON-RPC error code of a request the client cancelled
+const int kRequestCancelled = -32800;
+
+inline bool isIdentifierChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+QJsonObject position(int line, int character)
+{
+    return QJsonObject{{"line", line}, {"character", character}};
+}
+
+// Hover contents come as MarkupContent, MarkedString or a list of either
+QString hoverText(const QJsonValue &contents)
+{
+    QString text;
+    if (contents.isString()) {
+        text = contents.toString();
+    } else if (contents.isObject()) {
+        text = contents.toObject().value("value").toString();
+    } else if (contents.isArray()) {
+        QStringList parts;
+        for (const QJsonValue &part : contents.toArray()) {
+            parts.append(hoverText(part));
+        }
+        return parts.join("\n");
+    }
+
+    // Markdown code fences are noise in a plain tooltip
+    QStringList lines = text.split('\n');
+    lines.erase(std::remove_if(lines.begin(), lines.end(), [](const QString &line) {
+        return line.startsWith(QLatin1String("```"));
+    }), lines.end());
+    return lines.join('\n').trimmed();
+}
+
+} // namespace
+
+LspClient::LspClient(const QString &program, const QStringList &arguments, const QString &rootPath, QObject *parent)
+    : QObject(parent)
+    , m_serverName(QFileInfo(program).fileName())
+    , m_rootPath(rootPath)
+    , m_connection(new LspConnection)
+    , m_state(Starting)
+    , m_nextId(1)
+    , m_flushTimer(new QTimer(this))
+    , m_completionTimer(new QTimer(this))
+    , m_syncKind(0)
+    , m_completionProvider(false)
+    , m_hoverProvider(false)
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kChangeFlushDelay);
+    connect(m_flushTimer, &QTimer::timeout, this, &LspClient::flushChanges);
+
+    m_completionTimer->setSingleShot(true);
+    m_completionTimer->setInterval(kCompletionDelay);
+    connect(m_completionTimer, &QTimer::timeout, this, [this]() {
+        requestCompletion(m_completionUri);
+    });
+
+    // Everything the connection emits arrives here queued
+    m_connection->moveToThread(&m_ioThread);
+    connect(&m_ioThread, &QThread::finished, m_connection, &QObject::deleteLater);
+    connect(m_connection, &LspConnection::started, this, &LspClient::onConnectionStarted);
+    connect(m_connection, &LspConnection::messageReceived, this, &LspClient::onMessage);
+    connect(m_connection, &LspConnection::errorOccurred, this, [this](const QString &error) {
+        if (m_state == Starting) {
+            onServerStopped(error);
+        } else {
+            emit statusMessage(QString("%1: %2").arg(m_serverName, error));
+        }
+    });
+    connect(m_connection, &LspConnection::finished, this, [this](int exitCode) {
+        onServerStopped(QString("exited with code %1").arg(exitCode));
+    });
+
+    m_ioThread.setObjectName("LspIo");
+    m_ioThread.start();
+
+    LspConnection *connection = m_connection;
+    QMetaObject::invokeMethod(connection, [connection, program, arguments, rootPath]() {
+        connection->start(program, arguments, rootPath);
+    }, Qt::QueuedConnection);
+}
+
+LspClient::~LspClient()
+{
+    if (m_state == Running) {
+        flushChanges();
+        sendRequest("shutdown", QJsonObject(), nullptr);
+        sendNotification("exit", QJsonObject());
+    }
+
+    // Blocks until the messages above are written and the server is gone;
+    // a plain queued call could be dropped when the thread quits
+    LspConnection *connection = m_connection;
+    QMetaObject::invokeMethod(connection, [connection]() {
+        connection->stop();
+    }, Qt::BlockingQueuedConnection);
+    m_ioThread.quit();
+    m_ioThread.wait();
+}
+
+bool LspClient::serverForFile(const QString &filePath, QString *program, QStringList *arguments, QString *languageId)
+{
+    static const QSet<QString> cSuffixes = {"c"};
+    static const QSet<QString> cppSuffixes = {"cc", "cpp", "cxx", "c++", "h", "hh", "hpp", "hxx", "inl", "ipp"};
+
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    QString name;
+    if (cSuffixes.contains(suffix) || cppSuffixes.contains(suffix)) {
+        name = "clangd";
+        *arguments = QStringList{"--log=error"};
+        *languageId = cSuffixes.contains(suffix) ? "c" : "cpp";
+    } else if (suffix == "py") {
+        name = "pylsp";
+        *arguments = QStringList();
+        *languageId = "python";
+    } else {
+        return false;
+    }
+
+    *program = QStandardPaths::findExecutable(name);
+    return !program->isEmpty();
+}
+
+QString LspClient::uriForPath(const QString &filePath)
+{
+    return QUrl::fromLocalFile(filePath).toString(QUrl::FullyEncoded);
+}
+
+void LspClient::onConnectionStarted()
+{
+    m_state = Initializing;
+
+    const QString rootUri = uriForPath(m_rootPath);
+    QJsonObject textDocument{
+        {"synchronization", QJsonObject{{"didSave", true}}},
+        {"completion", QJsonObject{{"completionItem", QJsonObject{{"snippetSupport", false}}}}},
+        {"hover", QJsonObject{{"contentFormat", QJsonArray{"plaintext", "markdown"}}}},
+        {"publishDiagnostics", QJsonObject{{"versionSupport", true}}}
+    };
+    QJsonObject params{
+        {"processId", qint64(QCoreApplication::applicationPid())},
+        {"clientInfo", QJsonObject{{"name", QCoreApplication::applicationName()}, {"version", QCoreApplication::applicationVersion()}}},
+        {"rootUri", rootUri},
+        {"rootPath", m_rootPath},
+        {"workspaceFolders", QJsonArray{QJsonObject{{"uri", rootUri}, {"name", QFileInfo(m_rootPath).fileName()}}}},
+        {"capabilities", QJsonObject{{"textDocument", textDocument}}}
+    };
+
+    sendRequest("initialize", params, [this](const QJsonValue &result) {
+        const QJsonObject capabilities = result.toObject().value("capabilities").toObject();
+        const QJsonValue sync = capabilities.value("textDocumentSync");
+        m_syncKind = sync.isObject() ? sync.toObject().value("change").toInt() : sync.toInt();
+        m_completionProvider = capabilities.contains("completionProvider");
+        m_hoverProvider = capabilities.value("hoverProvider").toBool()
+                          || capabilities.value("hoverProvider").isObject();
+        m_triggerCharacters.clear();
+        for (const QJsonValue &trigger : capabilities.value("completionProvider").toObject()
+                                             .value("triggerCharacters").toArray()) {
+            m_triggerCharacters.append(trigger.toString());
+        }
+
+        m_state = Running;
+        sendNotification("initialized", QJsonObject());
+        const QVector<QJsonObject> outbox = m_outbox;
+        m_outbox.clear();
+        for (const QJsonObject &message : outbox) {
+            sendMessage(message);
+        }
+        emit statusMessage(QString("%1 ready").arg(m_serverName));
+    });
+}
+
+void LspClient::onServerStopped(const QString &reason)
+{
+    if (m_state == Stopped) {
+        return;
+    }
+    m_state = Stopped;
+    m_pending.clear();
+    m_outbox.clear();
+    m_flushTimer->stop();
+    m_completionTimer->stop();
+
+    for (const Document &document : m_documents) {
+        if (document.editor) {
+            document.editor->setDiagnostics(m_serverName, QVector<EditorDiagnostic>());
+        }
+    }
+    emit statusMessage(QString("%1 stopped: %2").arg(m_serverName, reason));
+    emit statisticsChanged();
+}
+
+int LspClient::sendRequest(const QString &method, const QJsonObject &params, const ResponseHandler &handler)
+{
+    const int id = m_nextId++;
+    PendingRequest request;
+    request.method = method;
+    request.handler = handler;
+    request.timer.start();
+    m_pending.insert(id, request);
+    ++m_stats[method].sent;
+
+    sendMessage(QJsonObject{{"jsonrpc", "2.0"}, {"id", id}, {"method", method}, {"params", params}});
+    return id;
+}
+
+void LspClient::sendNotification(const QString &method, const QJsonObject &params)
+{
+    sendMessage(QJsonObject{{"jsonrpc", "2.0"}, {"method", method}, {"params", params}});
+}
+
+void LspClient::sendMessage(const QJsonObject &message)
+{
+    if (m_state == Stopped) {
+        return;
+    }
+    // Only the handshake may go out before the server is initialized
+    if (m_state != Running && message.value("method").toString() != QLatin1String("initialize")) {
+        m_outbox.append(message);
+        return;
+    }
+
+    // Encoding and writing happen on the I/O thread
+    LspConnection *connection = m_connection;
+    QMetaObject::invokeMethod(connection, [connection, message]() {
+        connection->send(message);
+    }, Qt::QueuedConnection);
+}
+
+void LspClient::cancelRequest(int id)
+{
+    const auto it = m_pending.find(id);
+    if (it == m_pending.end() || it->cancelled) {
+        return;
+    }
+    // The server still answers; the answer is dropped
+    it->cancelled = true;
+    ++m_stats[it->method].cancelled;
+    sendNotification("$/cancelRequest", QJsonObject{{"id", id}});
+}
+
+void LspClient::onMessage(const QJsonObject &message)
+{
+    const bool hasMethod = message.contains("method");
+    if (!hasMethod && message.contains("id")) {
+        const int id = message.value("id").toInt();
+        const auto it = m_pending.find(id);
+        if (it == m_pending.end()) {
+            return;
+        }
+        const PendingRequest request = it.value();
+        m_pending.erase(it);
+        if (request.cancelled) {
+            return;
+        }
+
+        MethodSamples &stats = m_stats[request.method];
+        if (message.contains("error")) {
+            if (message.value("error").toObject().value("code").toInt() == kRequestCancelled) {
+                ++stats.cancelled;
+            } else {
+                ++stats.failed;
+            }
+            emit statisticsChanged();
+            return;
+        }
+
+        stats.last = request.timer.nsecsElapsed() / 1000;
+        ++stats.completed;
+        if (stats.samples.size() < kSampleCount) {
+            stats.samples.append(stats.last);
+        } else {
+            stats.samples[stats.nextSample] = stats.last;
+            stats.nextSample = (stats.nextSample + 1) % kSampleCount;
+        }
+        if (request.handler) {
+            request.handler(message.value("result"));
+        }
+        emit statisticsChanged();
+        return;
+    }
+
+    if (hasMethod && message.contains("id")) {
+        handleServerRequest(message);
+    } else if (hasMethod) {
+        handleNotification(message.value("method").toString(), message.value("params").toObject());
+    }
+}
+
+void LspClient::handleServerRequest(const QJsonObject &message)
+{
+    // Servers wait for answers to their own requests; none of them needs
+    // more than an empty one from this client
+    const QString method = message.value("method").toString();
+    QJsonValue result;
+    if (method == QLatin1String("workspace/configuration")) {
+        const int count = message.value("params").toObject().value("items").toArray().size();
+        QJsonArray configurations;
+        for (int i = 0; i < count; ++i) {
+            configurations.append(QJsonValue());
+        }
+        result = configurations;
+    }
+    sendMessage(QJsonObject{{"jsonrpc", "2.0"}, {"id", message.value("id")}, {"result", result}});
+}
+
+void LspClient::handleNotification(const QString &method, const QJsonObject &params)
+{
+    if (method == QLatin1String("textDocument/publishDiagnostics")) {
+        const auto it = m_documents.constFind(params.value("uri").toString());
+        if (it == m_documents.constEnd() || !it->editor) {
+            return;
+        }
+        // Ranges of an older version would land in the wrong place; a
+        // fresh set follows
+        if (params.contains("version") && params.value("version").toInt() < it->version) {
+            return;
+        }
+
+        QVector<EditorDiagnostic> diagnostics;
+        for (const QJsonValue &value : params.value("diagnostics").toArray()) {
+            const QJsonObject object = value.toObject();
+            const QJsonObject range = object.value("range").toObject();
+            const QJsonObject start = range.value("start").toObject();
+            const QJsonObject end = range.value("end").toObject();
+
+            EditorDiagnostic diagnostic;
+            diagnostic.line = start.value("line").toInt();
+            diagnostic.column = start.value("character").toInt();
+            diagnostic.endLine = end.value("line").toInt();
+            diagnostic.endColumn = end.value("character").toInt();
+            diagnostic.severity = EditorDiagnostic::Severity(qBound(1, object.value("severity").toInt(1), 4));
+            diagnostic.message = object.value("message").toString();
+            diagnostics.append(diagnostic);
+        }
+        it->editor->setDiagnostics(m_serverName, diagnostics);
+    } else if (method == QLatin1String("window/showMessage")) {
+        emit statusMessage(QString("%1: %2").arg(m_serverName, params.value("message").toString()));
+    }
+}
+
+void LspClient::openDocument(CodeEditor *editor, const QString &filePath, const QString &languageId)
+{
+    const QString uri = uriForPath(filePath);
+    if (m_documents.contains(uri) || m_state == Stopped) {
+        return;
+    }
+
+    Document document;
+    document.editor = editor;
+    document.filePath = filePath;
+    document.languageId = languageId;
+    document.version = 1;
+    m_documents.insert(uri, document);
+
+    sendNotification("textDocument/didOpen", QJsonObject{{"textDocument", QJsonObject{
+        {"uri", uri}, {"languageId", languageId}, {"version", document.version},
+        {"text", editor->textSnapshot().text()}
+    }}});
+
+    connect(editor, &CodeEditor::contentsEdited, this, [this, uri](const EditorChange &change) {
+        onEdited(uri, change);
+    });
+    connect(editor, &CodeEditor::completionRequested, this, [this, uri]() {
+        requestCompletion(uri);
+    });
+    connect(editor, &CodeEditor::hoverRequested, this, [this, uri](int line, int column, const QPoint &globalPos) {
+        requestHover(uri, line, column, globalPos);
+    });
+    connect(editor, &QObject::destroyed, this, [this, uri]() {
+        closeDocument(uri);
+    });
+}
+
+bool LspClient::hasDocument(const QString &filePath) const
+{
+    return m_documents.contains(uriForPath(filePath));
+}
+
+void LspClient::closeDocument(const QString &uri)
+{
+    if (!m_documents.remove(uri)) {
+        return;
+    }
+    sendNotification("textDocument/didClose", QJsonObject{{"textDocument", QJsonObject{{"uri", uri}}}});
+}
+
+void LspClient::documentSaved(const QString &filePath)
+{
+    const QString uri = uriForPath(filePath);
+    if (!m_documents.contains(uri)) {
+        return;
+    }
+    flushDocument(uri);
+    sendNotification("textDocument/didSave", QJsonObject{{"textDocument", QJsonObject{{"uri", uri}}}});
+}
+
+void LspClient::onEdited(const QString &uri, const EditorChange &change)
+{
+    const auto it = m_documents.find(uri);
+    if (it == m_documents.end() || (m_state == Running && m_syncKind == 0)) {
+        return;
+    }
+    Document &document = it.value();
+
+    if (change.fullText || m_syncKind == 1 || document.changes.size() >= kMaxPendingChanges) {
+        document.fullSyncPending = true;
+        document.changes = QJsonArray();
+    } else if (!document.fullSyncPending) {
+        // Typing and backspacing extend the last delta instead of adding one
+        bool merged = false;
+        if (!document.changes.isEmpty()) {
+            QJsonObject last = document.changes.last().toObject();
+            const QJsonObject start = last.value("range").toObject().value("start").toObject();
+            const QJsonObject end = last.value("range").toObject().value("end").toObject();
+            QString text = last.value("text").toString();
+            const int line = start.value("line").toInt();
+            const int tail = start.value("character").toInt() + text.size();
+            const bool sameLine = !text.contains('\n') && change.startLine == line && change.endLine == line;
+
+            if (sameLine && change.startColumn == tail && change.endColumn == tail) {
+                text += change.text;
+                merged = true;
+            } else if (sameLine && change.text.isEmpty() && !text.isEmpty()
+                       && change.startColumn == tail - 1 && change.endColumn == tail) {
+                text.chop(1);
+                merged = true;
+            }
+            if (merged) {
+                last.insert("text", text);
+                last.insert("range", QJsonObject{{"start", start}, {"end", end}});
+                document.changes[document.changes.size() - 1] = last;
+            }
+        }
+        if (!merged) {
+            document.changes.append(QJsonObject{
+                {"range", QJsonObject{{"start", position(change.startLine, change.startColumn)},
+                                      {"end", position(change.endLine, change.endColumn)}}},
+                {"text", change.text}
+            });
+        }
+    }
+
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+
+    // Completion follows typing in a word or a trigger character
+    if (change.text.size() == 1 && m_completionProvider) {
+        const QChar typed = change.text.at(0);
+        bool trigger = isIdentifierChar(typed);
+        for (const QString &characters : m_triggerCharacters) {
+            trigger = trigger || characters.endsWith(typed);
+        }
+        if (trigger) {
+            m_completionUri = uri;
+            m_completionTimer->start();
+            return;
+        }
+    }
+    m_completionTimer->stop();
+}
+
+void LspClient::flushChanges()
+{
+    for (auto it = m_documents.constBegin(); it != m_documents.constEnd(); ++it) {
+        if (it->fullSyncPending || !it->changes.isEmpty()) {
+            flushDocument(it.key());
+        }
+    }
+}
+
+void LspClient::flushDocument(const QString &uri)
+{
+    const auto it = m_documents.find(uri);
+    if (it == m_documents.end()) {
+        return;
+    }
+    Document &document = it.value();
+
+    QJsonArray changes = document.changes;
+    if (document.fullSyncPending) {
+        if (!document.editor) {
+            return;
+        }
+        changes = QJsonArray{QJsonObject{{"text", document.editor->textSnapshot().text()}}};
+    }
+    if (changes.isEmpty()) {
+        return;
+    }
+    document.changes = QJsonArray();
+    document.fullSyncPending = false;
+    ++document.version;
+
+    sendNotification("textDocument/didChange", QJsonObject{
+        {"textDocument", QJsonObject{{"uri", uri}, {"version", document.version}}},
+        {"contentChanges", changes}
+    });
+}
+
+void LspClient::requestCompletion(const QString &uri)
+{
+    const auto it = m_documents.find(uri);
+    if (m_state != Running || !m_completionProvider || it == m_documents.end() || !it->editor) {
+        return;
+    }
+
+    // The server must see every edit before the position makes sense
+    flushDocument(uri);
+    cancelRequest(it->completionRequest);
+
+    CodeEditor *editor = it->editor;
+    const QTextCursor cursor = editor->textCursor();
+    const QTextBlock block = cursor.block();
+    const QString text = block.text();
+    const int line = cursor.blockNumber();
+    const int column = cursor.positionInBlock();
+    int wordStart = column;
+    while (wordStart > 0 && isIdentifierChar(text.at(wordStart - 1))) {
+        --wordStart;
+    }
+    const int startPosition = block.position() + wordStart;
+
+    const QJsonObject params{
+        {"textDocument", QJsonObject{{"uri", uri}}},
+        {"position", position(line, column)}
+    };
+    it->completionRequest = sendRequest("textDocument/completion", params,
+                                        [this, uri, line, startPosition](const QJsonValue &result) {
+        const auto document = m_documents.constFind(uri);
+        if (document == m_documents.constEnd() || !document->editor) {
+            return;
+        }
+        // The cursor left the word while the server was busy
+        CodeEditor *editor = document->editor;
+        if (editor->textCursor().blockNumber() != line || editor->textCursor().position() < startPosition) {
+            return;
+        }
+
+        const QJsonArray items = result.isArray() ? result.toArray() : result.toObject().value("items").toArray();
+        QStringList completions;
+        QSet<QString> seen;
+        for (const QJsonValue &value : items) {
+            const QJsonObject item = value.toObject();
+            QString completion = item.value("textEdit").toObject().value("newText").toString();
+            if (completion.isEmpty()) {
+                completion = item.value("insertText").toString();
+            }
+            if (completion.isEmpty()) {
+                completion = item.value("label").toString();
+            }
+            completion = completion.trimmed();
+            if (!completion.isEmpty() && !seen.contains(completion)) {
+                seen.insert(completion);
+                completions.append(completion);
+                if (completions.size() >= kMaxCompletionItems) {
+                    break;
+                }
+            }
+        }
+        if (!completions.isEmpty()) {
+            editor->showCompletions(completions, startPosition);
+        }
+    });
+}
+
+void LspClient::requestHover(const QString &uri, int line, int column, const QPoint &globalPos)
+{
+    const auto it = m_documents.find(uri);
+    if (m_state != Running || !m_hoverProvider || it == m_documents.end() || !it->editor) {
+        return;
+    }
+
+    flushDocument(uri);
+    cancelRequest(it->hoverRequest);
+
+    const QJsonObject params{
+        {"textDocument", QJsonObject{{"uri", uri}}},
+        {"position", position(line, column)}
+    };
+    it->hoverRequest = sendRequest("textDocument/hover", params,
+                                   [this, uri, line, column, globalPos](const QJsonValue &result) {
+        const auto document = m_documents.constFind(uri);
+        if (document == m_documents.constEnd() || !document->editor || !result.isObject()) {
+            return;
+        }
+        document->editor->showHover(line, column, hoverText(result.toObject().value("contents")), globalPos);
+    });
+}
+
+QVector<LspMethodStats> LspClient::statistics() const
+{
+    QVector<LspMethodStats> result;
+    for (auto it = m_stats.constBegin(); it != m_stats.constEnd(); ++it) {
+        const MethodSamples &samples = it.value();
+        LspMethodStats stats;
+        stats.method = it.key();
+        stats.sent = samples.sent;
+        stats.completed = samples.completed;
+        stats.cancelled = samples.cancelled;
+        stats.failed = samples.failed;
+        stats.last = samples.last;
+
+        if (!samples.samples.isEmpty()) {
+            QVector<qint64> sorted = samples.samples;
+            std::sort(sorted.begin(), sorted.end());
+            qint64 total = 0;
+            for (const qint64 sample : sorted) {
+                total += sample;
+            }
+            stats.mean = total / sorted.size();
+            stats.median = sorted.at(sorted.size() / 2);
+            stats.p95 = sorted.at(qMin(sorted.size() - 1, sorted.size() * 95 / 100));
+            stats.max = sorted.last();
+        }
+        result.append(stats);
+    }
+
+    std::sort(result.begin(), result.end(), [](const LspMethodStats &a, const LspMethodStats &b) {
+        return a.method < b.method;
+    });
+    return result;
+}
@@ -0,0 +1,161 @@
+#ifndef LSPCLIENT_H
+#define LSPCLIENT_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QPoint>
+#include <QPointer>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+
+#include <functional>
+
+class QTimer;
+class CodeEditor;
+class LspConnection;
+struct EditorChange;
+
+// Latency of one request method, in microseconds from sending to handling
+// the response on the GUI thread
+struct LspMethodStats
+{
+    QString method;
+    int sent = 0;
+    int completed = 0;
+    int cancelled = 0;
+    int failed = 0;
+    qint64 last = 0;
+    qint64 mean = 0;
+    qint64 median = 0;
+    qint64 p95 = 0;
+    qint64 max = 0;
+};
+
+// Client for one language server (clangd, pylsp) driven over stdio. The
+// process and all message encoding live on a dedicated I/O thread; the GUI
+// thread only queues messages and handles parsed responses. Requests are
+// pipelined: any number may be in flight. Edits are sent as incremental
+// didChange deltas, coalesced over a short delay; completion requests are
+// debounced, and a newer completion or hover cancels the stale one with
+// $/cancelRequest. Results are applied to the editors when they arrive.
+class LspClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    LspClient(const QString &program, const QStringList &arguments, const QString &rootPath,
+              QObject *parent = nullptr);
+    ~LspClient();
+
+    QString serverName() const { return m_serverName; }
+    bool isRunning() const { return m_state == Running; }
+
+    // Starts tracking an editor whose content is fully loaded
+    void openDocument(CodeEditor *editor, const QString &filePath, const QString &languageId);
+    void documentSaved(const QString &filePath);
+    bool hasDocument(const QString &filePath) const;
+
+    QVector<LspMethodStats> statistics() const;
+    int pendingRequestCount() const { return m_pending.size(); }
+
+    // The server for a file type, if it is installed
+    static bool serverForFile(const QString &filePath, QString *program, QStringList *arguments,
+                              QString *languageId);
+
+signals:
+    void statusMessage(const QString &message);
+    void statisticsChanged();
+
+private:
+    enum State {
+        Starting,
+        Initializing,
+        Running,
+        Stopped
+    };
+
+    typedef std::function<void(const QJsonValue &result)> ResponseHandler;
+
+    struct PendingRequest
+    {
+        QString method;
+        QElapsedTimer timer;
+        ResponseHandler handler;
+        bool cancelled = false;
+    };
+
+    struct Document
+    {
+        QPointer<CodeEditor> editor;
+        QString filePath;
+        QString languageId;
+        int version = 0;
+        QJsonArray changes;      // not sent yet
+        bool fullSyncPending = false;
+        int completionRequest = 0;
+        int hoverRequest = 0;
+    };
+
+    struct MethodSamples
+    {
+        int sent = 0;
+        int completed = 0;
+        int cancelled = 0;
+        int failed = 0;
+        qint64 last = 0;
+        QVector<qint64> samples;   // ring of recent latencies
+        int nextSample = 0;
+    };
+
+    void onConnectionStarted();
+    void onMessage(const QJsonObject &message);
+    void onServerStopped(const QString &reason);
+    void handleServerRequest(const QJsonObject &message);
+    void handleNotification(const QString &method, const QJsonObject &params);
+
+    int sendRequest(const QString &method, const QJsonObject &params, const ResponseHandler &handler);
+    void sendNotification(const QString &method, const QJsonObject &params);
+    void sendMessage(const QJsonObject &message);
+    void cancelRequest(int id);
+
+    void onEdited(const QString &uri, const EditorChange &change);
+    void flushChanges();
+    void flushDocument(const QString &uri);
+    void requestCompletion(const QString &uri);
+    void requestHover(const QString &uri, int line, int column, const QPoint &globalPos);
+    void closeDocument(const QString &uri);
+
+    static QString uriForPath(const QString &filePath);
+
+    QString m_serverName;
+    QString m_rootPath;
+    QThread m_ioThread;
+    LspConnection *m_connection;
+    State m_state;
+
+    // Messages queued until the initialize handshake is done
+    QVector<QJsonObject> m_outbox;
+
+    int m_nextId;
+    QHash<int, PendingRequest> m_pending;
+    QHash<QString, MethodSamples> m_stats;
+
+    QHash<QString, Document> m_documents;   // by URI
+    QTimer *m_flushTimer;
+    QTimer *m_completionTimer;
+    QString m_completionUri;
+
+    // Server capabilities
+    int m_syncKind;   // 0 none, 1 full, 2 incremental
+    bool m_completionProvider;
+    bool m_hoverProvider;
+    QStringList m_triggerCharacters;
+};
+
+#endif // LSPCLIENT_H
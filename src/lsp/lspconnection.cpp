@@ -0,0 +1,122 @@
+#include "lspconnection.h"
+
+#include <QProcess>
+#include <QJsonDocument>
+#include <QJsonParseError>
+
+namespace {
+
+// Consumed input is dropped from the buffer once it is this large
+const int kCompactThreshold = 64 * 1024;
+
+// A frame claiming more than this is taken for a broken stream
+const int kMaxContentLength = 256 * 1024 * 1024;
+
+} // namespace
+
+LspConnection::LspConnection(QObject *parent)
+    : QObject(parent)
+    , m_process(nullptr)
+    , m_readPosition(0)
+    , m_contentLength(-1)
+{
+}
+
+LspConnection::~LspConnection()
+{
+    stop();
+}
+
+void LspConnection::start(const QString &program, const QStringList &arguments, const QString &workingDirectory)
+{
+    // Created here so the process belongs to the I/O thread
+    m_process = new QProcess(this);
+    m_process->setWorkingDirectory(workingDirectory);
+    m_process->setStandardErrorFile(QProcess::nullDevice());
+
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &LspConnection::readOutput);
+    connect(m_process, &QProcess::started, this, &LspConnection::started);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            emit errorOccurred(m_process->errorString());
+        }
+    });
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus) {
+        emit finished(exitCode);
+    });
+
+    m_process->start(program, arguments);
+}
+
+void LspConnection::send(const QJsonObject &message)
+{
+    if (!m_process || m_process->state() == QProcess::NotRunning) {
+        return;
+    }
+    const QByteArray body = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    QByteArray frame = "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+    frame += body;
+    m_process->write(frame);
+}
+
+void LspConnection::stop()
+{
+    if (!m_process || m_process->state() == QProcess::NotRunning) {
+        return;
+    }
+    m_process->closeWriteChannel();
+    if (!m_process->waitForFinished(500)) {
+        m_process->kill();
+        m_process->waitForFinished(200);
+    }
+}
+
+void LspConnection::readOutput()
+{
+    m_buffer += m_process->readAllStandardOutput();
+
+    for (;;) {
+        if (m_contentLength < 0) {
+            const int headerEnd = m_buffer.indexOf("\r\n\r\n", m_readPosition);
+            if (headerEnd < 0) {
+                break;
+            }
+
+            // Content-Type is optional and always UTF-8 JSON in practice
+            const QList<QByteArray> headers = m_buffer.mid(m_readPosition, headerEnd - m_readPosition).split('\n');
+            for (const QByteArray &header : headers) {
+                const int colon = header.indexOf(':');
+                if (colon > 0 && header.left(colon).trimmed().toLower() == "content-length") {
+                    bool ok = false;
+                    const int length = header.mid(colon + 1).trimmed().toInt(&ok);
+                    if (ok && length >= 0 && length <= kMaxContentLength) {
+                        m_contentLength = length;
+                    }
+                }
+            }
+            m_readPosition = headerEnd + 4;
+            if (m_contentLength < 0) {
+                emit errorOccurred(QStringLiteral("Malformed message header from the language server"));
+                continue;
+            }
+        }
+
+        if (m_buffer.size() - m_readPosition < m_contentLength) {
+            break;
+        }
+
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(m_buffer.mid(m_readPosition, m_contentLength), &error);
+        m_readPosition += m_contentLength;
+        m_contentLength = -1;
+        if (error.error == QJsonParseError::NoError && document.isObject()) {
+            emit messageReceived(document.object());
+        }
+    }
+
+    if (m_readPosition >= kCompactThreshold || m_readPosition == m_buffer.size()) {
+        m_buffer.remove(0, m_readPosition);
+        m_readPosition = 0;
+    }
+}
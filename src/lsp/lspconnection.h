@@ -0,0 +1,45 @@
+#ifndef LSPCONNECTION_H
+#define LSPCONNECTION_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QJsonObject>
+
+class QProcess;
+
+// Language server process and its stdio framing. Lives on the client's I/O
+// thread: JSON is encoded, framed and written there, and incoming frames
+// are split and parsed there, so the GUI thread only sees whole messages.
+class LspConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LspConnection(QObject *parent = nullptr);
+    ~LspConnection();
+
+public slots:
+    void start(const QString &program, const QStringList &arguments, const QString &workingDirectory);
+    void send(const QJsonObject &message);
+    // Waits briefly for the server to exit after "exit", then kills it
+    void stop();
+
+signals:
+    void started();
+    void messageReceived(const QJsonObject &message);
+    void errorOccurred(const QString &error);
+    void finished(int exitCode);
+
+private slots:
+    void readOutput();
+
+private:
+    QProcess *m_process;
+    QByteArray m_buffer;
+    int m_readPosition;
+    int m_contentLength;   // of the frame being read, or -1 while in headers
+};
+
+#endif // LSPCONNECTION_H
@@ -0,0 +1,103 @@
+#include "lspstatspanel.h"
+#include "lspclient.h"
+
+#include <QVBoxLayout>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTimer>
+
+namespace {
+
+const int kRefreshInterval = 1000;
+
+// Latencies are kept in microseconds and shown in milliseconds
+QString milliseconds(qint64 microseconds)
+{
+    return QString::number(double(microseconds) / 1000.0, 'f', 1);
+}
+
+} // namespace
+
+LspStatsPanel::LspStatsPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    m_statsTree = new QTreeWidget();
+    m_statsTree->setRootIsDecorated(true);
+    m_statsTree->setUniformRowHeights(true);
+    m_statsTree->setHeaderLabels({"Request", "Sent", "Done", "Cancelled", "Failed",
+                                  "Last ms", "Mean ms", "p50 ms", "p95 ms", "Max ms"});
+    m_statsTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    m_statusLabel = new QLabel("No language server running");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->setSpacing(4);
+    layout->addWidget(m_statsTree, 1);
+    layout->addWidget(m_statusLabel);
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(kRefreshInterval);
+    connect(m_refreshTimer, &QTimer::timeout, this, &LspStatsPanel::refresh);
+}
+
+void LspStatsPanel::addClient(LspClient *client)
+{
+    m_clients.append(client);
+    if (isVisible()) {
+        refresh();
+    }
+}
+
+void LspStatsPanel::showEvent(QShowEvent *event)
+{
+    refresh();
+    m_refreshTimer->start();
+    QWidget::showEvent(event);
+}
+
+void LspStatsPanel::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer->stop();
+    QWidget::hideEvent(event);
+}
+
+void LspStatsPanel::refresh()
+{
+    m_clients.removeAll(QPointer<LspClient>());
+
+    m_statsTree->setUpdatesEnabled(false);
+    m_statsTree->clear();
+    int pending = 0;
+    for (const QPointer<LspClient> &client : qAsConst(m_clients)) {
+        QTreeWidgetItem *serverItem = new QTreeWidgetItem(m_statsTree);
+        serverItem->setText(0, client->isRunning() ? client->serverName()
+                                                   : client->serverName() + " (not running)");
+        pending += client->pendingRequestCount();
+
+        for (const LspMethodStats &stats : client->statistics()) {
+            QTreeWidgetItem *item = new QTreeWidgetItem(serverItem);
+            item->setText(0, stats.method);
+            item->setText(1, QString::number(stats.sent));
+            item->setText(2, QString::number(stats.completed));
+            item->setText(3, QString::number(stats.cancelled));
+            item->setText(4, QString::number(stats.failed));
+            item->setText(5, milliseconds(stats.last));
+            item->setText(6, milliseconds(stats.mean));
+            item->setText(7, milliseconds(stats.median));
+            item->setText(8, milliseconds(stats.p95));
+            item->setText(9, milliseconds(stats.max));
+            for (int column = 1; column < m_statsTree->columnCount(); ++column) {
+                item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+            }
+        }
+    }
+    m_statsTree->expandAll();
+    m_statsTree->setUpdatesEnabled(true);
+
+    m_statusLabel->setText(m_clients.isEmpty()
+                               ? QString("No language server running")
+                               : QString("%1 servers, %2 requests in flight").arg(m_clients.size()).arg(pending));
+}
@@ -0,0 +1,38 @@
+#ifndef LSPSTATSPANEL_H
+#define LSPSTATSPANEL_H
+
+#include <QWidget>
+#include <QList>
+#include <QPointer>
+
+class QTreeWidget;
+class QLabel;
+class QTimer;
+class LspClient;
+
+// Per-method request counts and latency percentiles of the running
+// language servers. Refreshes on a timer while it is visible.
+class LspStatsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LspStatsPanel(QWidget *parent = nullptr);
+
+    void addClient(LspClient *client);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+
+private:
+    QList<QPointer<LspClient>> m_clients;
+    QTreeWidget *m_statsTree;
+    QLabel *m_statusLabel;
+    QTimer *m_refreshTimer;
+};
+
+#endif // LSPSTATSPANEL_H
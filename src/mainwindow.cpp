@@ -1,38 +1,102 @@
 #include "mainwindow.h"
 #include "editor/codeeditor.h"
+#include "editor/largefileviewer.h"
+#include "editor/saveservice.h"
 #include "bagel/bagelclient.h"
 #include "bagel/bagelchatwidget.h"
 #include "project/projectmanager.h"
+#include "project/projecttreemodel.h"
+#include "search/searchengine.h"
+#include "search/searchpanel.h"
+#include "search/filegrep.h"
+#include "search/searchinfilesdialog.h"
+#include "search/quickopendialog.h"
+#include "symbols/symbolindex.h"
+#include "symbols/symbolsearchdialog.h"
+#include "lsp/lspclient.h"
+#include "lsp/lspstatspanel.h"
+#include "build/buildmanager.h"
+#include "build/problemspanel.h"
+#include "run/processrunner.h"
+#include "run/runconfigurationdialog.h"
+#include "bench/benchmarkrunner.h"
+#include "bench/benchmarkpanel.h"
+#include "ui/outputconsole.h"
 
 #include <QApplication>
 #include <QMenuBar>
 #include <QToolBar>
 #include <QStatusBar>
+#include <QLabel>
 #include <QDockWidget>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTabWidget>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QTextEdit>
 #include <QSplitter>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QAction>
 #include <QKeySequence>
-#include <QFile>
-#include <QTextStream>
 #include <QFileInfo>
-#include <QTreeWidgetItem>
+#include <QDir>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QTextBlock>
+#include <QSettings>
+#include <QSharedPointer>
+
+namespace {
+
+// Files at least this large open in the read-only, memory-mapped viewer.
+const qint64 kLargeFileThreshold = 64 * 1024 * 1024;
+
+QString formatBytes(qint64 bytes)
+{
+    return QString("%1 MB").arg(double(bytes) / (1024 * 1024), 0, 'f', 1);
+}
+
+QString formatDuration(qint64 ms)
+{
+    return QString("%1:%2").arg(ms / 60000).arg(double(ms % 60000) / 1000.0, 4, 'f', 1, QLatin1Char('0'));
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_tabWidget(nullptr)
     , m_projectTree(nullptr)
+    , m_projectModel(nullptr)
     , m_outputPanel(nullptr)
+    , m_watchLabel(nullptr)
+    , m_viewMenu(nullptr)
     , m_bagelClient(nullptr)
     , m_bagelWidget(nullptr)
     , m_projectManager(nullptr)
     , m_bagelDock(nullptr)
+    , m_saveService(nullptr)
+    , m_searchEngine(nullptr)
+    , m_searchPanel(nullptr)
+    , m_searchDock(nullptr)
+    , m_fileGrep(nullptr)
+    , m_quickOpen(nullptr)
+    , m_symbolIndex(nullptr)
+    , m_symbolSearch(nullptr)
+    , m_lspStatsPanel(nullptr)
+    , m_lspStatsDock(nullptr)
+    , m_buildManager(nullptr)
+    , m_problemsPanel(nullptr)
+    , m_problemsDock(nullptr)
+    , m_runner(nullptr)
+    , m_runLabel(nullptr)
+    , m_runAction(nullptr)
+    , m_runToolbarAction(nullptr)
+    , m_benchmarkRunner(nullptr)
+    , m_benchmarkPanel(nullptr)
+    , m_benchmarkDock(nullptr)
+    , m_benchmarkAfterBuild(false)
 {
     setupUI();
     setupMenus();
@@ -41,6 +105,13 @@ MainWindow::MainWindow(QWidget *parent)
     setupStatusBar();
     setupBagel();
     setupProjectManager();
+    setupSaveService();
+    setupSearch();
+    setupSymbols();
+    setupLanguageServers();
+    setupBuild();
+    setupRun();
+    setupBenchmarks();
     
     // Apply dark theme
     applyDarkTheme();
@@ -53,6 +124,7 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    shutdownLanguageServers();
 }
 
 void MainWindow::setupUI()
@@ -82,6 +154,10 @@ void MainWindow::setupMenus()
     openAction->setShortcut(QKeySequence::Open);
     connect(openAction, &QAction::triggered, this, &MainWindow::openFile);
     
+    QAction *goToFileAction = fileMenu->addAction("Go to &File...");
+    goToFileAction->setShortcut(QKeySequence("Ctrl+P"));
+    connect(goToFileAction, &QAction::triggered, this, &MainWindow::goToFile);
+    
     QAction *saveAction = fileMenu->addAction("&Save");
     saveAction->setShortcut(QKeySequence::Save);
     connect(saveAction, &QAction::triggered, this, &MainWindow::saveFile);
@@ -90,6 +166,10 @@ void MainWindow::setupMenus()
     saveAsAction->setShortcut(QKeySequence::SaveAs);
     connect(saveAsAction, &QAction::triggered, this, &MainWindow::saveAsFile);
     
+    QAction *saveAllAction = fileMenu->addAction("Save A&ll");
+    saveAllAction->setShortcut(QKeySequence("Ctrl+Alt+S"));
+    connect(saveAllAction, &QAction::triggered, this, &MainWindow::saveAllFiles);
+    
     fileMenu->addSeparator();
     
     QAction *exitAction = fileMenu->addAction("E&xit");
@@ -105,9 +185,31 @@ void MainWindow::setupMenus()
     editMenu->addAction("&Copy")->setShortcut(QKeySequence::Copy);
     editMenu->addAction("&Paste")->setShortcut(QKeySequence::Paste);
     editMenu->addSeparator();
-    editMenu->addAction("&Find")->setShortcut(QKeySequence::Find);
+    QAction *findAction = editMenu->addAction("&Find");
+    findAction->setShortcut(QKeySequence::Find);
+    connect(findAction, &QAction::triggered, this, &MainWindow::find);
     editMenu->addAction("Find && &Replace")->setShortcut(QKeySequence::Replace);
     
+    QAction *findInProjectAction = editMenu->addAction("Find in Pro&ject...");
+    findInProjectAction->setShortcut(QKeySequence("Ctrl+Shift+F"));
+    connect(findInProjectAction, &QAction::triggered, this, &MainWindow::findInProject);
+    
+    QAction *searchInFilesAction = editMenu->addAction("Search in &Files...");
+    searchInFilesAction->setShortcut(QKeySequence("Ctrl+Alt+F"));
+    connect(searchInFilesAction, &QAction::triggered, this, &MainWindow::searchInFiles);
+    
+    QAction *goToLineAction = editMenu->addAction("&Go to Line...");
+    goToLineAction->setShortcut(QKeySequence("Ctrl+G"));
+    connect(goToLineAction, &QAction::triggered, this, &MainWindow::goToLine);
+    
+    QAction *goToDefinitionAction = editMenu->addAction("Go to &Definition");
+    goToDefinitionAction->setShortcut(QKeySequence("F12"));
+    connect(goToDefinitionAction, &QAction::triggered, this, &MainWindow::goToDefinition);
+    
+    QAction *goToSymbolAction = editMenu->addAction("Go to &Symbol in Workspace...");
+    goToSymbolAction->setShortcut(QKeySequence("Ctrl+T"));
+    connect(goToSymbolAction, &QAction::triggered, this, &MainWindow::goToSymbol);
+    
     // Project menu
     QMenu *projectMenu = menuBar()->addMenu("&Project");
     
@@ -123,9 +225,24 @@ void MainWindow::setupMenus()
     buildAction->setShortcut(QKeySequence("Ctrl+B"));
     connect(buildAction, &QAction::triggered, this, &MainWindow::buildProject);
     
-    QAction *runAction = projectMenu->addAction("&Run Project");
-    runAction->setShortcut(QKeySequence("Ctrl+R"));
-    connect(runAction, &QAction::triggered, this, &MainWindow::runProject);
+    QAction *buildFileAction = projectMenu->addAction("Build C&urrent File");
+    buildFileAction->setShortcut(QKeySequence("Ctrl+Shift+B"));
+    connect(buildFileAction, &QAction::triggered, this, &MainWindow::buildCurrentFile);
+    
+    QAction *cancelBuildAction = projectMenu->addAction("Cance&l Build");
+    cancelBuildAction->setShortcut(QKeySequence("Ctrl+Break"));
+    connect(cancelBuildAction, &QAction::triggered, this, &MainWindow::cancelBuild);
+    
+    m_runAction = projectMenu->addAction("&Run Project");
+    m_runAction->setShortcut(QKeySequence("Ctrl+R"));
+    connect(m_runAction, &QAction::triggered, this, &MainWindow::runProject);
+    
+    QAction *runConfigurationsAction = projectMenu->addAction("Run &Configurations...");
+    connect(runConfigurationsAction, &QAction::triggered, this, &MainWindow::editRunConfigurations);
+    
+    QAction *benchmarkAction = projectMenu->addAction("Run Bench&marks");
+    benchmarkAction->setShortcut(QKeySequence("Ctrl+Alt+B"));
+    connect(benchmarkAction, &QAction::triggered, this, &MainWindow::runBenchmarks);
     
     // AI menu
     QMenu *aiMenu = menuBar()->addMenu("&AI");
@@ -141,10 +258,10 @@ void MainWindow::setupMenus()
     aiMenu->addAction("Generate &Image")->setShortcut(QKeySequence("Ctrl+Shift+I"));
     
     // View menu
-    QMenu *viewMenu = menuBar()->addMenu("&View");
-    viewMenu->addAction("&Project Explorer");
-    viewMenu->addAction("&Output Panel");
-    viewMenu->addAction("&BAGEL Assistant");
+    m_viewMenu = menuBar()->addMenu("&View");
+    m_viewMenu->addAction("&Project Explorer");
+    m_viewMenu->addAction("&Output Panel");
+    m_viewMenu->addAction("&BAGEL Assistant");
     
     // Help menu
     QMenu *helpMenu = menuBar()->addMenu("&Help");
@@ -171,8 +288,8 @@ void MainWindow::setupToolbars()
     QAction *buildAction = mainToolbar->addAction("Build");
     connect(buildAction, &QAction::triggered, this, &MainWindow::buildProject);
     
-    QAction *runAction = mainToolbar->addAction("Run");
-    connect(runAction, &QAction::triggered, this, &MainWindow::runProject);
+    m_runToolbarAction = mainToolbar->addAction("Run");
+    connect(m_runToolbarAction, &QAction::triggered, this, &MainWindow::runProject);
     
     mainToolbar->addSeparator();
     
@@ -186,21 +303,26 @@ void MainWindow::setupDockWidgets()
     // Project Explorer
     QDockWidget *projectDock = new QDockWidget("Project Explorer", this);
     projectDock->setObjectName("ProjectDock");
-    m_projectTree = new QTreeWidget();
-    m_projectTree->setHeaderLabel("Project Files");
+    m_projectModel = new ProjectTreeModel(this);
+    m_projectTree = new QTreeView();
+    m_projectTree->setModel(m_projectModel);
     m_projectTree->setRootIsDecorated(true);
-    connect(m_projectTree, &QTreeWidget::itemDoubleClicked, this, &MainWindow::onProjectFileDoubleClicked);
+    m_projectTree->setUniformRowHeights(true);
+    connect(m_projectTree, &QTreeView::doubleClicked, this, &MainWindow::onProjectFileDoubleClicked);
     projectDock->setWidget(m_projectTree);
     addDockWidget(Qt::LeftDockWidgetArea, projectDock);
     
     // Output Panel
     QDockWidget *outputDock = new QDockWidget("Output", this);
     outputDock->setObjectName("OutputDock");
-    m_outputPanel = new QTextEdit();
-    m_outputPanel->setReadOnly(true);
+    m_outputPanel = new OutputConsole();
     m_outputPanel->setMaximumHeight(200);
-    m_outputPanel->append("Krius IDE Output Panel");
-    m_outputPanel->append("Ready for development...");
+    m_outputPanel->setMaximumLineCount(QSettings().value("output/scrollbackLines", m_outputPanel->maximumLineCount()).toInt());
+    connect(m_outputPanel, &OutputConsole::maximumLineCountChanged, this, [](int count) {
+        QSettings().setValue("output/scrollbackLines", count);
+    });
+    m_outputPanel->appendLine("Krius IDE Output Panel");
+    m_outputPanel->appendLine("Ready for development...");
     outputDock->setWidget(m_outputPanel);
     addDockWidget(Qt::BottomDockWidgetArea, outputDock);
 }
@@ -208,6 +330,10 @@ void MainWindow::setupDockWidgets()
 void MainWindow::setupStatusBar()
 {
     statusBar()->showMessage("Ready - Krius IDE with BAGEL AI Integration");
+    
+    m_watchLabel = new QLabel();
+    m_watchLabel->setToolTip("Directories watched for changes");
+    statusBar()->addPermanentWidget(m_watchLabel);
 }
 
 void MainWindow::setupBagel()
@@ -235,7 +361,379 @@ void MainWindow::setupProjectManager()
     
     connect(m_projectManager, &ProjectManager::projectOpened, this, &MainWindow::onProjectOpened);
     connect(m_projectManager, &ProjectManager::projectClosed, this, &MainWindow::onProjectClosed);
-    connect(m_projectManager, &ProjectManager::fileAdded, this, &MainWindow::onProjectFileAdded);
+    connect(m_projectManager, &ProjectManager::filesChanged, this,
+            [this](const QStringList &added, const QStringList &removed, const QStringList &) {
+        m_projectModel->applyChanges(added, removed);
+    });
+    connect(m_projectManager, &ProjectManager::watchCountChanged, this, [this](int count) {
+        m_watchLabel->setText(count > 0 ? QString("Watches: %1").arg(count) : QString());
+    });
+    connect(m_projectManager, &ProjectManager::watchLimitReached, this, [this](int count) {
+        statusBar()->showMessage(QString("Watch limit reached after %1 directories; "
+                                         "raise fs.inotify.max_user_watches to track the whole project").arg(count), 10000);
+    });
+    connect(m_projectManager, &ProjectManager::scanFinished, this, [this](int fileCount) {
+        statusBar()->showMessage(QString("Project scan finished: %1 files").arg(fileCount), 3000);
+    });
+}
+
+void MainWindow::setupSaveService()
+{
+    m_saveService = new SaveService(this);
+    
+    connect(m_saveService, &SaveService::fileSaved, this, [this](const QString &fileName) {
+        statusBar()->showMessage(QString("Saved: %1").arg(fileName), 2000);
+        for (LspClient *client : qAsConst(m_languageClients)) {
+            client->documentSaved(fileName);
+        }
+    });
+    connect(m_saveService, &SaveService::saveFailed, this, [this](const QString &fileName, const QString &error) {
+        // The document was marked clean when the save was queued
+        for (int i = 0; i < m_tabWidget->count(); ++i) {
+            CodeEditor *editor = qobject_cast<CodeEditor*>(m_tabWidget->widget(i));
+            if (editor && editor->property("fileName").toString() == fileName) {
+                editor->document()->setModified(true);
+            }
+        }
+        statusBar()->showMessage(QString("Could not save %1: %2").arg(fileName, error), 5000);
+    });
+    connect(m_saveService, &SaveService::batchFinished, this, [this](int savedCount, int failedCount) {
+        if (savedCount + failedCount > 1) {
+            statusBar()->showMessage(QString("Saved %1 files, %2 failed").arg(savedCount).arg(failedCount), 3000);
+        }
+        if (m_afterSave && !m_saveService->isBusy()) {
+            const std::function<void()> action = m_afterSave;
+            m_afterSave = nullptr;
+            action();
+        }
+    });
+}
+
+void MainWindow::setupSearch()
+{
+    m_searchEngine = new SearchEngine(this);
+    m_searchPanel = new SearchPanel(m_searchEngine);
+    
+    m_searchDock = new QDockWidget("Search", this);
+    m_searchDock->setObjectName("SearchDock");
+    m_searchDock->setWidget(m_searchPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_searchDock);
+    m_searchDock->hide();
+    
+    // The index follows the project's file list
+    connect(m_projectManager, &ProjectManager::filesChanged, m_searchEngine, &SearchEngine::updateFiles);
+    connect(m_projectManager, &ProjectManager::projectClosed, m_searchEngine, &SearchEngine::clear);
+    connect(m_searchEngine, &SearchEngine::indexingFinished, this, [this](int fileCount) {
+        statusBar()->showMessage(QString("Search index ready: %1 files").arg(fileCount), 3000);
+    });
+    connect(m_searchPanel, &SearchPanel::matchActivated, this, &MainWindow::openFileAt);
+    
+    // Brute-force search prints to the output panel in grep format
+    m_fileGrep = new FileGrep(this);
+    connect(m_fileGrep, &FileGrep::matchesFound, this, [this](const QVector<SearchMatch> &matches) {
+        QStringList lines;
+        for (const SearchMatch &match : matches) {
+            lines.append(QString("%1:%2:%3: %4").arg(match.filePath, QString::number(match.line + 1),
+                                                     QString::number(match.column + 1), match.lineText.left(500)));
+        }
+        m_outputPanel->appendLine(lines.join('\n'));
+    });
+    connect(m_fileGrep, &FileGrep::finished, this,
+            [this](int matchCount, int fileCount, qint64 bytesSearched, bool truncated) {
+        m_outputPanel->appendLine(QString("=== %1 matches in %2 files, %3 MB searched%4 ===")
+                                  .arg(matchCount).arg(fileCount)
+                                  .arg(double(bytesSearched) / (1024 * 1024), 0, 'f', 1)
+                                  .arg(truncated ? ", stopped at the match limit" : ""));
+        statusBar()->showMessage(QString("Search in files finished: %1 matches").arg(matchCount), 3000);
+    });
+    connect(m_fileGrep, &FileGrep::failed, this, [this](const QString &error) {
+        statusBar()->showMessage(QString("Invalid search: %1").arg(error), 5000);
+    });
+    
+    // Quick open keeps its own path index in step with the project
+    m_quickOpen = new QuickOpenDialog(this);
+    connect(m_projectManager, &ProjectManager::projectOpened, m_quickOpen, &QuickOpenDialog::setRootPath);
+    connect(m_projectManager, &ProjectManager::projectClosed, m_quickOpen, &QuickOpenDialog::clear);
+    connect(m_projectManager, &ProjectManager::filesChanged, m_quickOpen,
+            [this](const QStringList &added, const QStringList &removed, const QStringList &) {
+        m_quickOpen->updateFiles(added, removed);
+    });
+    connect(m_quickOpen, &QuickOpenDialog::fileSelected, this, &MainWindow::openFileInEditor);
+}
+
+void MainWindow::setupSymbols()
+{
+    // C and C++ symbols are indexed in the background as the project
+    // reports files, and cached on disk between sessions
+    m_symbolIndex = new SymbolIndex(this);
+    connect(m_projectManager, &ProjectManager::projectOpened, m_symbolIndex, &SymbolIndex::setRootPath);
+    connect(m_projectManager, &ProjectManager::projectClosed, m_symbolIndex, &SymbolIndex::clear);
+    connect(m_projectManager, &ProjectManager::filesChanged, m_symbolIndex, &SymbolIndex::updateFiles);
+    connect(m_symbolIndex, &SymbolIndex::indexingFinished, this, [this](int fileCount, int symbolCount) {
+        statusBar()->showMessage(QString("Symbol index ready: %1 symbols in %2 files").arg(symbolCount).arg(fileCount),
+                                 3000);
+    });
+    
+    m_symbolSearch = new SymbolSearchDialog(m_symbolIndex, this);
+    connect(m_symbolSearch, &SymbolSearchDialog::symbolSelected, this, &MainWindow::openFileAt);
+}
+
+void MainWindow::setupLanguageServers()
+{
+    m_lspStatsPanel = new LspStatsPanel();
+    
+    m_lspStatsDock = new QDockWidget("Language Server", this);
+    m_lspStatsDock->setObjectName("LanguageServerDock");
+    m_lspStatsDock->setWidget(m_lspStatsPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_lspStatsDock);
+    m_lspStatsDock->hide();
+    m_viewMenu->addAction(m_lspStatsDock->toggleViewAction());
+    
+    // Servers are rooted at the project, so they restart with it
+    connect(m_projectManager, &ProjectManager::projectOpened, this, [this]() {
+        shutdownLanguageServers();
+        for (int i = 0; i < m_tabWidget->count(); ++i) {
+            CodeEditor *editor = qobject_cast<CodeEditor*>(m_tabWidget->widget(i));
+            if (editor && !editor->isLoading()) {
+                attachLanguageServer(editor, editor->property("fileName").toString());
+            }
+        }
+    });
+    connect(m_projectManager, &ProjectManager::projectClosed, this, &MainWindow::shutdownLanguageServers);
+}
+
+void MainWindow::setupBuild()
+{
+    m_buildManager = new BuildManager(this);
+    
+    m_problemsPanel = new ProblemsPanel();
+    
+    m_problemsDock = new QDockWidget("Problems", this);
+    m_problemsDock->setObjectName("ProblemsDock");
+    m_problemsDock->setWidget(m_problemsPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_problemsDock);
+    m_problemsDock->hide();
+    m_viewMenu->addAction(m_problemsDock->toggleViewAction());
+    
+    connect(m_buildManager, &BuildManager::buildStarted, this, [this](const QString &description) {
+        m_problemsPanel->clear();
+        m_outputPanel->appendLine(QString("=== %1 ===").arg(description));
+        statusBar()->showMessage(description + "...");
+    });
+    connect(m_buildManager, &BuildManager::stepStarted, this,
+            [this](const QString &commandLine, const QString &workingDirectory) {
+        m_problemsPanel->setBaseDirectory(workingDirectory);
+        m_outputPanel->appendLine("$ " + commandLine);
+    });
+    connect(m_buildManager, &BuildManager::outputReady, m_outputPanel, &OutputConsole::appendText);
+    connect(m_buildManager, &BuildManager::outputReady, m_problemsPanel, &ProblemsPanel::addOutput);
+    connect(m_buildManager, &BuildManager::buildFinished, this, [this](bool success, bool cancelled, qint64 elapsedMs) {
+        const QString result = cancelled ? "cancelled" : (success ? "succeeded" : "failed");
+        const QString seconds = QString::number(double(elapsedMs) / 1000.0, 'f', 1);
+        QString problems;
+        if (m_problemsPanel->errorCount() + m_problemsPanel->warningCount() > 0) {
+            problems = QString(", %1 errors, %2 warnings").arg(m_problemsPanel->errorCount())
+                                                          .arg(m_problemsPanel->warningCount());
+        }
+        m_outputPanel->appendLine(QString("=== Build %1 (%2 s%3) ===").arg(result, seconds, problems));
+        statusBar()->showMessage(QString("Build %1 in %2 s%3").arg(result, seconds, problems), 5000);
+        if (m_problemsPanel->errorCount() > 0) {
+            m_problemsDock->show();
+            m_problemsDock->raise();
+        }
+        if (m_benchmarkAfterBuild) {
+            m_benchmarkAfterBuild = false;
+            if (success) {
+                findBenchmarkTargets();
+            } else {
+                m_benchmarkPanel->showError(QString("Build %1; benchmarks not run").arg(result));
+            }
+        }
+    });
+    
+    // Squiggles follow the problem list, for the files that changed in it
+    connect(m_problemsPanel, &ProblemsPanel::diagnosticsChanged, this, [this](const QStringList &filePaths) {
+        for (int i = 0; i < m_tabWidget->count(); ++i) {
+            CodeEditor *editor = qobject_cast<CodeEditor*>(m_tabWidget->widget(i));
+            const QString fileName = editor ? editor->property("fileName").toString() : QString();
+            if (editor && !editor->isLoading() && filePaths.contains(fileName)) {
+                applyBuildDiagnostics(editor, fileName);
+            }
+        }
+    });
+    connect(m_problemsPanel, &ProblemsPanel::problemActivated, this, &MainWindow::openFileAt);
+    connect(m_outputPanel, &OutputConsole::lineActivated, m_problemsPanel, &ProblemsPanel::activateOutputLine);
+}
+
+void MainWindow::setupRun()
+{
+    m_runner = new ProcessRunner(this);
+    
+    m_runLabel = new QLabel();
+    m_runLabel->setToolTip("CPU, resident memory and wall time of the running program");
+    m_runLabel->hide();
+    statusBar()->addPermanentWidget(m_runLabel);
+    
+    connect(m_runner, &ProcessRunner::started, this, [this](const QString &commandLine) {
+        m_outputPanel->appendLine("$ " + commandLine);
+    });
+    connect(m_runner, &ProcessRunner::outputReady, m_outputPanel, &OutputConsole::appendText);
+    connect(m_runner, &ProcessRunner::statsUpdated, this, [this](const RunStats &stats) {
+        m_runLabel->setText(QString("%1: CPU %2%  RSS %3  %4")
+                                .arg(m_runner->configuration().name)
+                                .arg(stats.cpuPercent, 0, 'f', 0)
+                                .arg(formatBytes(stats.rssBytes))
+                                .arg(formatDuration(stats.wallMs)));
+    });
+    connect(m_runner, &ProcessRunner::finished, this,
+            [this](int exitCode, bool crashed, bool stopped, const RunStats &stats) {
+        QString result = QString("exited with code %1").arg(exitCode);
+        if (stopped) {
+            result = "stopped";
+        } else if (crashed) {
+            result = "crashed";
+        }
+        m_outputPanel->appendLine(QString("=== %1 %2 (wall %3, CPU %4, peak RSS %5) ===")
+                                      .arg(m_runner->configuration().name, result, formatDuration(stats.wallMs),
+                                           formatDuration(stats.cpuMs), formatBytes(stats.peakRssBytes)));
+        statusBar()->showMessage(QString("%1 %2").arg(m_runner->configuration().name, result), 5000);
+        updateRunActions();
+    });
+    connect(m_runner, &ProcessRunner::failed, this, [this](const QString &message) {
+        m_outputPanel->appendLine(message);
+        statusBar()->showMessage(message, 5000);
+        updateRunActions();
+    });
+}
+
+void MainWindow::setupBenchmarks()
+{
+    m_benchmarkRunner = new BenchmarkRunner(this);
+    m_benchmarkPanel = new BenchmarkPanel();
+    
+    m_benchmarkDock = new QDockWidget("Benchmarks", this);
+    m_benchmarkDock->setObjectName("BenchmarkDock");
+    m_benchmarkDock->setWidget(m_benchmarkPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_benchmarkDock);
+    m_benchmarkDock->hide();
+    m_viewMenu->addAction(m_benchmarkDock->toggleViewAction());
+    
+    connect(m_benchmarkPanel, &BenchmarkPanel::runRequested, this, &MainWindow::runBenchmarks);
+    connect(m_benchmarkRunner, &BenchmarkRunner::targetsFound, this, [this](const QVector<BenchmarkTarget> &targets) {
+        if (!m_projectManager->isProjectOpen()) {
+            m_benchmarkPanel->showError("No project open");
+            return;
+        }
+        if (targets.isEmpty()) {
+            m_benchmarkPanel->showError("No Google Benchmark or Catch2 executables in the build directories");
+            return;
+        }
+        
+        // With several, ask which one; the last choice is offered first
+        BenchmarkTarget target = targets.first();
+        if (targets.size() > 1) {
+            const QDir projectDir(m_projectManager->currentProject());
+            const QString lastExecutable = QSettings().value("benchmark/lastExecutable").toString();
+            QStringList items;
+            int current = 0;
+            for (int i = 0; i < targets.size(); ++i) {
+                items.append(QString("%1 (%2)").arg(projectDir.relativeFilePath(targets.at(i).executable),
+                                                    BenchmarkRunner::frameworkName(BenchmarkRunner::Framework(targets.at(i).framework))));
+                if (targets.at(i).executable == lastExecutable) {
+                    current = i;
+                }
+            }
+            bool ok = false;
+            const QString item = QInputDialog::getItem(this, "Run Benchmarks", "Benchmark executable:", items, current,
+                                                       false, &ok);
+            if (!ok) {
+                m_benchmarkPanel->showError("Benchmarks not run");
+                return;
+            }
+            target = targets.at(items.indexOf(item));
+        }
+        QSettings().setValue("benchmark/lastExecutable", target.executable);
+        m_benchmarkRunner->start(m_projectManager->currentProject(), target, m_benchmarkPanel->repetitions());
+    });
+    connect(m_benchmarkRunner, &BenchmarkRunner::started, this, [this](const QString &commandLine, int cpu) {
+        m_outputPanel->appendLine("=== Benchmark ===");
+        m_outputPanel->appendLine("$ " + commandLine);
+        m_benchmarkPanel->setRunning(true, cpu >= 0 ? QString("Running, pinned to CPU %1...").arg(cpu) : "Running...");
+    });
+    connect(m_benchmarkRunner, &BenchmarkRunner::outputReady, m_outputPanel, &OutputConsole::appendText);
+    connect(m_benchmarkRunner, &BenchmarkRunner::finished, this,
+            [this](const BenchmarkRun &run, const BenchmarkBaseline &baseline) {
+        m_benchmarkPanel->showRun(run, baseline);
+        m_outputPanel->appendLine(QString("=== Benchmark finished: %1 results ===").arg(run.results.size()));
+        statusBar()->showMessage("Benchmark finished", 3000);
+    });
+    connect(m_benchmarkRunner, &BenchmarkRunner::failed, this, [this](const QString &message) {
+        m_benchmarkPanel->showError(message);
+        m_outputPanel->appendLine(QString("=== Benchmark failed: %1 ===").arg(message));
+    });
+}
+
+void MainWindow::applyBuildDiagnostics(CodeEditor *editor, const QString &fileName)
+{
+    QVector<EditorDiagnostic> diagnostics;
+    for (const BuildDiagnostic &problem : m_problemsPanel->diagnosticsFor(fileName)) {
+        EditorDiagnostic diagnostic;
+        diagnostic.line = problem.line;
+        diagnostic.column = problem.column;
+        diagnostic.endLine = problem.line;
+        diagnostic.endColumn = problem.column;
+        diagnostic.severity = problem.severity == BuildDiagnostic::Error ? EditorDiagnostic::Error
+                                                                         : EditorDiagnostic::Warning;
+        diagnostic.message = problem.message;
+        diagnostics.append(diagnostic);
+    }
+    editor->setDiagnostics("build", diagnostics);
+}
+
+void MainWindow::runWhenSaved(const std::function<void()> &action)
+{
+    if (m_saveService->isBusy()) {
+        m_afterSave = action;
+    } else {
+        action();
+    }
+}
+
+void MainWindow::attachLanguageServer(CodeEditor *editor, const QString &fileName)
+{
+    QString program;
+    QStringList arguments;
+    QString languageId;
+    if (fileName.isEmpty() || !LspClient::serverForFile(fileName, &program, &arguments, &languageId)) {
+        return;
+    }
+    
+    LspClient *client = m_languageClients.value(program);
+    if (!client) {
+        const QString rootPath = m_projectManager->isProjectOpen() ? m_projectManager->currentProject()
+                                                                   : QFileInfo(fileName).absolutePath();
+        client = new LspClient(program, arguments, rootPath, this);
+        connect(client, &LspClient::statusMessage, this, [this](const QString &message) {
+            statusBar()->showMessage(message, 3000);
+        });
+        m_languageClients.insert(program, client);
+        m_lspStatsPanel->addClient(client);
+    }
+    client->openDocument(editor, fileName, languageId);
+}
+
+void MainWindow::shutdownLanguageServers()
+{
+    // Diagnostics belong to the server that published them
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        if (CodeEditor *editor = qobject_cast<CodeEditor*>(m_tabWidget->widget(i))) {
+            for (LspClient *client : qAsConst(m_languageClients)) {
+                editor->setDiagnostics(client->serverName(), QVector<EditorDiagnostic>());
+            }
+        }
+    }
+    qDeleteAll(m_languageClients);
+    m_languageClients.clear();
 }
 
 void MainWindow::applyDarkTheme()
@@ -321,16 +819,16 @@ void MainWindow::applyDarkTheme()
         "    padding: 6px;"
         "    border-bottom: 1px solid #555555;"
         "}"
-        "QTreeWidget {"
+        "QTreeView {"
         "    background-color: #2b2b2b;"
         "    color: #ffffff;"
         "    border: 1px solid #555555;"
         "    selection-background-color: #0078d4;"
         "}"
-        "QTreeWidget::item {"
+        "QTreeView::item {"
         "    padding: 4px;"
         "}"
-        "QTreeWidget::item:hover {"
+        "QTreeView::item:hover {"
         "    background-color: #3c3c3c;"
         "}"
         "QTextEdit {"
@@ -386,6 +884,7 @@ void MainWindow::createWelcomeTab()
 void MainWindow::newFile()
 {
     CodeEditor *editor = new CodeEditor();
+    editor->setSymbolIndex(m_symbolIndex);
     editor->setPlainText("// New C++ file\n#include <iostream>\n\nint main() {\n    std::cout << \"Hello, World!\" << std::endl;\n    return 0;\n}\n");
     
     static int fileCounter = 1;
@@ -408,6 +907,15 @@ void MainWindow::openFile()
     }
 }
 
+void MainWindow::goToFile()
+{
+    if (!m_projectManager->isProjectOpen()) {
+        openFile();
+        return;
+    }
+    m_quickOpen->popup();
+}
+
 void MainWindow::saveFile()
 {
     CodeEditor *editor = getCurrentEditor();
@@ -416,13 +924,47 @@ void MainWindow::saveFile()
         return;
     }
     
+    if (editor->isLoading()) {
+        statusBar()->showMessage("File is still loading", 2000);
+        return;
+    }
+    
     QString fileName = editor->property("fileName").toString();
     if (fileName.isEmpty()) {
         saveAsFile();
         return;
     }
     
-    saveFileContent(fileName, editor->toPlainText());
+    saveFileContent(fileName, editor->textSnapshot());
+    editor->document()->setModified(false);
+}
+
+void MainWindow::saveAllFiles()
+{
+    // Untitled editors need a name first and are left to Save As
+    QVector<SaveRequest> requests;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        CodeEditor *editor = qobject_cast<CodeEditor*>(m_tabWidget->widget(i));
+        if (!editor || editor->isLoading() || !editor->document()->isModified()) {
+            continue;
+        }
+        
+        const QString fileName = editor->property("fileName").toString();
+        if (fileName.isEmpty()) {
+            continue;
+        }
+        
+        requests.append(SaveRequest{fileName, editor->textSnapshot()});
+        editor->document()->setModified(false);
+    }
+    
+    if (requests.isEmpty()) {
+        statusBar()->showMessage("Nothing to save", 2000);
+        return;
+    }
+    
+    m_saveService->saveAll(requests);
+    statusBar()->showMessage(QString("Saving %1 files...").arg(requests.size()));
 }
 
 void MainWindow::saveAsFile()
@@ -432,12 +974,18 @@ void MainWindow::saveAsFile()
         return;
     }
     
+    if (editor->isLoading()) {
+        statusBar()->showMessage("File is still loading", 2000);
+        return;
+    }
+    
     QString fileName = QFileDialog::getSaveFileName(this,
         "Save File", "",
         "C++ Files (*.cpp *.h *.hpp);;Python Files (*.py);;JavaScript Files (*.js);;All Files (*)");
     
     if (!fileName.isEmpty()) {
-        saveFileContent(fileName, editor->toPlainText());
+        saveFileContent(fileName, editor->textSnapshot());
+        editor->document()->setModified(false);
         editor->setProperty("fileName", fileName);
         
         QFileInfo fileInfo(fileName);
@@ -445,6 +993,162 @@ void MainWindow::saveAsFile()
     }
 }
 
+void MainWindow::find()
+{
+    if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(m_tabWidget->currentWidget())) {
+        viewer->promptFind();
+        return;
+    }
+    
+    CodeEditor *editor = getCurrentEditor();
+    if (!editor) {
+        return;
+    }
+    
+    bool ok = false;
+    QString text = QInputDialog::getText(this, "Find", "Find:", QLineEdit::Normal,
+                                         editor->textCursor().selectedText(), &ok);
+    if (ok && !text.isEmpty() && !editor->find(text)) {
+        // Wrap around once before giving up
+        QTextCursor cursor = editor->textCursor();
+        cursor.movePosition(QTextCursor::Start);
+        editor->setTextCursor(cursor);
+        if (!editor->find(text)) {
+            statusBar()->showMessage(QString("Not found: %1").arg(text), 2000);
+        }
+    }
+}
+
+void MainWindow::findInProject()
+{
+    if (!m_projectManager->isProjectOpen()) {
+        statusBar()->showMessage("Open a project folder to search in it", 2000);
+        return;
+    }
+    
+    if (CodeEditor *editor = getCurrentEditor()) {
+        const QString selection = editor->textCursor().selectedText();
+        if (!selection.isEmpty() && !selection.contains(QChar::ParagraphSeparator)) {
+            m_searchPanel->setQuery(selection);
+        }
+    }
+    
+    m_searchDock->show();
+    m_searchDock->raise();
+    m_searchPanel->focusQuery();
+}
+
+void MainWindow::searchInFiles()
+{
+    SearchInFilesDialog dialog(this);
+    dialog.setDirectory(m_projectManager->isProjectOpen() ? m_projectManager->currentProject() : QDir::currentPath());
+    if (CodeEditor *editor = getCurrentEditor()) {
+        const QString selection = editor->textCursor().selectedText();
+        if (!selection.contains(QChar::ParagraphSeparator)) {
+            dialog.setPattern(selection);
+        }
+    }
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    m_outputPanel->appendLine(QString("=== Searching for \"%1\" in %2 ===").arg(dialog.pattern(), dialog.directory()));
+    if (m_fileGrep->start(QStringList() << dialog.directory(), dialog.pattern(), dialog.options())) {
+        statusBar()->showMessage(QString("Searching in %1...").arg(dialog.directory()));
+    }
+}
+
+void MainWindow::goToLine()
+{
+    if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(m_tabWidget->currentWidget())) {
+        viewer->promptGoToLine();
+        return;
+    }
+    
+    CodeEditor *editor = getCurrentEditor();
+    if (!editor) {
+        return;
+    }
+    
+    bool ok = false;
+    int line = QInputDialog::getInt(this, "Go to Line", "Line:",
+                                    editor->textCursor().blockNumber() + 1, 1,
+                                    editor->document()->blockCount(), 1, &ok);
+    if (ok) {
+        QTextCursor cursor(editor->document()->findBlockByNumber(line - 1));
+        editor->setTextCursor(cursor);
+        editor->centerCursor();
+    }
+}
+
+void MainWindow::goToDefinition()
+{
+    CodeEditor *editor = getCurrentEditor();
+    if (!editor) {
+        return;
+    }
+    
+    QTextCursor cursor = editor->textCursor();
+    cursor.select(QTextCursor::WordUnderCursor);
+    const QString word = cursor.selectedText();
+    if (word.isEmpty() || !(word.at(0).isLetter() || word.at(0) == '_')) {
+        statusBar()->showMessage("No symbol under the cursor", 2000);
+        return;
+    }
+    
+    // Answered from the index; the open buffer is not parsed
+    const QVector<SymbolLocation> locations = m_symbolIndex->lookup(word);
+    if (locations.isEmpty()) {
+        statusBar()->showMessage(QString("No definition of %1 found%2")
+                                     .arg(word, m_symbolIndex->isIndexing() ? " (still indexing)" : ""), 3000);
+        return;
+    }
+    
+    // From a definition, go to its declarations instead
+    const QString fileName = editor->property("fileName").toString();
+    const int line = cursor.blockNumber();
+    bool onDefinition = false;
+    for (const SymbolLocation &location : locations) {
+        if (location.symbol.definition && location.symbol.line == line && location.filePath == fileName) {
+            onDefinition = true;
+            break;
+        }
+    }
+    
+    QVector<SymbolLocation> targets;
+    for (const SymbolLocation &location : locations) {
+        const bool here = location.symbol.line == line && location.filePath == fileName;
+        if (!here && location.symbol.definition != onDefinition) {
+            targets.append(location);
+        }
+    }
+    if (targets.isEmpty()) {
+        for (const SymbolLocation &location : locations) {
+            if (location.symbol.line != line || location.filePath != fileName) {
+                targets.append(location);
+            }
+        }
+    }
+    
+    if (targets.isEmpty()) {
+        statusBar()->showMessage(QString("%1 is defined here").arg(word), 2000);
+    } else if (targets.size() == 1) {
+        const Symbol &symbol = targets.first().symbol;
+        openFileAt(targets.first().filePath, symbol.line, symbol.column, symbol.name.size());
+    } else {
+        m_symbolSearch->showLocations(QString("%1: %2 locations").arg(word).arg(targets.size()), targets);
+    }
+}
+
+void MainWindow::goToSymbol()
+{
+    if (!m_projectManager->isProjectOpen()) {
+        statusBar()->showMessage("Open a project folder to search its symbols", 3000);
+        return;
+    }
+    m_symbolSearch->popup();
+}
+
 void MainWindow::openProject()
 {
     QString projectDir = QFileDialog::getExistingDirectory(this, "Open Project Folder");
@@ -460,17 +1164,167 @@ void MainWindow::closeProject()
 
 void MainWindow::buildProject()
 {
-    m_outputPanel->append("=== Build Started ===");
-    m_outputPanel->append("Build functionality not yet implemented");
-    m_outputPanel->append("=== Build Finished ===");
-    statusBar()->showMessage("Build completed", 2000);
+    if (!m_projectManager->isProjectOpen()) {
+        statusBar()->showMessage("Open a project folder to build it", 3000);
+        return;
+    }
+    if (m_buildManager->isRunning()) {
+        statusBar()->showMessage("A build is already running", 2000);
+        return;
+    }
+    
+    // The build reads the files from disk
+    saveAllFiles();
+    runWhenSaved([this]() {
+        if (m_projectManager->isProjectOpen() && !m_buildManager->isRunning()) {
+            m_buildManager->buildProject(m_projectManager->currentProject());
+        }
+    });
+}
+
+void MainWindow::buildCurrentFile()
+{
+    CodeEditor *editor = getCurrentEditor();
+    const QString fileName = editor ? editor->property("fileName").toString() : QString();
+    if (fileName.isEmpty()) {
+        statusBar()->showMessage("No saved file to build", 2000);
+        return;
+    }
+    if (!m_projectManager->isProjectOpen()) {
+        statusBar()->showMessage("Open a project folder to build its files", 3000);
+        return;
+    }
+    if (m_buildManager->isRunning()) {
+        statusBar()->showMessage("A build is already running", 2000);
+        return;
+    }
+    
+    saveAllFiles();
+    runWhenSaved([this, fileName]() {
+        if (m_projectManager->isProjectOpen() && !m_buildManager->isRunning()) {
+            m_buildManager->buildFile(m_projectManager->currentProject(), fileName);
+        }
+    });
+}
+
+void MainWindow::cancelBuild()
+{
+    if (m_benchmarkAfterBuild) {
+        m_benchmarkAfterBuild = false;
+        m_benchmarkPanel->showError("Build cancelled; benchmarks not run");
+    }
+    if (m_afterSave) {
+        m_afterSave = nullptr;
+        statusBar()->showMessage("Build cancelled", 2000);
+        return;
+    }
+    if (!m_buildManager->isRunning()) {
+        statusBar()->showMessage("No build is running", 2000);
+        return;
+    }
+    m_buildManager->cancel();
+    statusBar()->showMessage("Cancelling build...");
 }
 
 void MainWindow::runProject()
 {
-    m_outputPanel->append("=== Run Started ===");
-    m_outputPanel->append("Run functionality not yet implemented");
-    statusBar()->showMessage("Run completed", 2000);
+    // Ctrl+R stops what it started
+    if (m_runner->isRunning()) {
+        m_runner->stop();
+        statusBar()->showMessage(QString("Stopping %1...").arg(m_runner->configuration().name));
+        return;
+    }
+    
+    const QString projectPath = m_projectManager->isProjectOpen() ? m_projectManager->currentProject() : QString();
+    int currentIndex = -1;
+    const QVector<RunConfiguration> configurations = RunConfiguration::load(projectPath, &currentIndex);
+    if (currentIndex < 0 || !configurations.at(currentIndex).isValid()) {
+        editRunConfigurations();
+        return;
+    }
+    startRun(configurations.at(currentIndex));
+}
+
+void MainWindow::editRunConfigurations()
+{
+    const QString projectPath = m_projectManager->isProjectOpen() ? m_projectManager->currentProject() : QString();
+    int currentIndex = -1;
+    const QVector<RunConfiguration> configurations = RunConfiguration::load(projectPath, &currentIndex);
+    
+    RunConfigurationDialog dialog(projectPath, this);
+    dialog.setConfigurations(configurations, currentIndex);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    const QVector<RunConfiguration> edited = dialog.configurations();
+    RunConfiguration::save(projectPath, edited, dialog.currentIndex());
+    if (dialog.currentIndex() >= 0 && !m_runner->isRunning()) {
+        startRun(edited.at(dialog.currentIndex()));
+    }
+}
+
+void MainWindow::runBenchmarks()
+{
+    if (m_benchmarkRunner->isRunning()) {
+        m_benchmarkRunner->cancel();
+        statusBar()->showMessage("Stopping benchmark...");
+        return;
+    }
+    if (m_benchmarkAfterBuild || m_benchmarkRunner->isSearching()) {
+        statusBar()->showMessage("Benchmarks are being prepared", 2000);
+        return;
+    }
+    if (!m_projectManager->isProjectOpen()) {
+        statusBar()->showMessage("Open a project folder to benchmark it", 3000);
+        return;
+    }
+    
+    m_benchmarkDock->show();
+    m_benchmarkDock->raise();
+    
+    // Results are only worth comparing for the code as it is now
+    if (BuildManager::detectSystem(m_projectManager->currentProject()) != BuildManager::NoSystem) {
+        if (m_buildManager->isRunning()) {
+            statusBar()->showMessage("A build is already running", 2000);
+            return;
+        }
+        m_benchmarkAfterBuild = true;
+        m_benchmarkPanel->setRunning(true, "Building...");
+        buildProject();
+        return;
+    }
+    findBenchmarkTargets();
+}
+
+void MainWindow::findBenchmarkTargets()
+{
+    // Run configurations may point at a benchmark outside the build tree
+    int currentIndex = -1;
+    QStringList executables;
+    for (const RunConfiguration &configuration : RunConfiguration::load(m_projectManager->currentProject(), &currentIndex)) {
+        if (configuration.isValid()) {
+            executables.append(configuration.executable);
+        }
+    }
+    
+    m_benchmarkPanel->setRunning(true, "Looking for benchmarks...");
+    m_benchmarkRunner->findTargets(m_projectManager->currentProject(), executables);
+}
+
+void MainWindow::startRun(const RunConfiguration &configuration)
+{
+    m_outputPanel->appendLine(QString("=== Running %1 ===").arg(configuration.name));
+    m_runner->start(configuration);
+    updateRunActions();
+}
+
+void MainWindow::updateRunActions()
+{
+    const bool running = m_runner->isRunning();
+    m_runAction->setText(running ? "Stop &Running" : "&Run Project");
+    m_runToolbarAction->setText(running ? "Stop" : "Run");
+    m_runLabel->setVisible(running);
 }
 
 void MainWindow::toggleBagel()
@@ -512,43 +1366,104 @@ void MainWindow::openFileInEditor(const QString &fileName)
         }
     }
     
-    // Load file content
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "Error", QString("Could not open file: %1").arg(fileName));
-        return;
-    }
+    QFileInfo fileInfo(fileName);
     
-    QTextStream in(&file);
-    QString content = in.readAll();
-    file.close();
+    // Huge files are memory-mapped and shown read-only instead of being
+    // copied into a QTextDocument
+    if (fileInfo.size() >= kLargeFileThreshold) {
+        LargeFileViewer *viewer = new LargeFileViewer();
+        if (viewer->openFile(fileName)) {
+            viewer->setProperty("fileName", fileName);
+            connect(viewer, &LargeFileViewer::indexingFinished, this, [this](qint64 lineCount) {
+                statusBar()->showMessage(QString("Indexed %1 lines").arg(lineCount), 2000);
+            });
+            
+            int index = m_tabWidget->addTab(viewer, fileInfo.fileName() + " [read-only]");
+            m_tabWidget->setCurrentIndex(index);
+            statusBar()->showMessage(QString("Opened large file read-only: %1").arg(fileName), 2000);
+            return;
+        }
+        delete viewer;
+    }
     
-    // Create new editor
+    // Create the tab right away and stream the content in; closing the tab
+    // deletes the editor, which cancels the load
     CodeEditor *editor = new CodeEditor();
-    editor->setPlainText(content);
+    editor->setSymbolIndex(m_symbolIndex);
     editor->setProperty("fileName", fileName);
     editor->setCurrentFile(fileName);
     
-    QFileInfo fileInfo(fileName);
-    int index = m_tabWidget->addTab(editor, fileInfo.fileName());
+    const QString tabName = fileInfo.fileName();
+    int index = m_tabWidget->addTab(editor, tabName + " (0%)");
     m_tabWidget->setCurrentIndex(index);
     
-    statusBar()->showMessage(QString("Opened: %1").arg(fileName), 2000);
+    connect(editor, &CodeEditor::loadProgress, this, [this, editor, tabName](int percent) {
+        m_tabWidget->setTabText(m_tabWidget->indexOf(editor), QString("%1 (%2%)").arg(tabName).arg(percent));
+    });
+    connect(editor, &CodeEditor::loadFinished, this, [this, editor, tabName, fileName]() {
+        m_tabWidget->setTabText(m_tabWidget->indexOf(editor), tabName);
+        statusBar()->showMessage(QString("Opened: %1").arg(fileName), 2000);
+        attachLanguageServer(editor, fileName);
+        applyBuildDiagnostics(editor, fileName);
+    });
+    connect(editor, &CodeEditor::loadFailed, this, [this, editor, fileName](const QString &error) {
+        m_tabWidget->removeTab(m_tabWidget->indexOf(editor));
+        editor->deleteLater();
+        QMessageBox::warning(this, "Error", QString("Could not open file: %1\n%2").arg(fileName, error));
+    });
+    
+    editor->loadFile(fileName);
+    statusBar()->showMessage(QString("Loading: %1").arg(fileName));
 }
 
-void MainWindow::saveFileContent(const QString &fileName, const QString &content)
+void MainWindow::openFileAt(const QString &fileName, int line, int column, int length)
 {
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "Error", QString("Could not save file: %1").arg(fileName));
+    openFileInEditor(fileName);
+    
+    QWidget *widget = m_tabWidget->currentWidget();
+    if (!widget || widget->property("fileName").toString() != fileName) {
         return;
     }
     
-    QTextStream out(&file);
-    out << content;
-    file.close();
+    if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(widget)) {
+        viewer->goToLine(line);
+        return;
+    }
     
-    statusBar()->showMessage(QString("Saved: %1").arg(fileName), 2000);
+    CodeEditor *editor = qobject_cast<CodeEditor*>(widget);
+    if (!editor) {
+        return;
+    }
+    
+    auto select = [editor, line, column, length]() {
+        const QTextBlock block = editor->document()->findBlockByNumber(line);
+        if (!block.isValid()) {
+            return;
+        }
+        QTextCursor cursor(block);
+        cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, qMin(column, block.length() - 1));
+        cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, length);
+        editor->setTextCursor(cursor);
+        editor->centerCursor();
+    };
+    
+    // The content is still streaming in; jump once it is all there
+    if (editor->isLoading()) {
+        QSharedPointer<QMetaObject::Connection> connection(new QMetaObject::Connection);
+        *connection = connect(editor, &CodeEditor::loadFinished, this, [select, connection]() {
+            QObject::disconnect(*connection);
+            select();
+        });
+    } else {
+        select();
+    }
+}
+
+void MainWindow::saveFileContent(const QString &fileName, const TextSnapshot &content)
+{
+    // Written off-thread; the outcome is reported through the status bar
+    m_saveService->save(fileName, content);
+    statusBar()->showMessage(QString("Saving: %1").arg(fileName));
 }
 
 CodeEditor* MainWindow::getCurrentEditor()
@@ -558,42 +1473,23 @@ CodeEditor* MainWindow::getCurrentEditor()
 
 void MainWindow::onProjectOpened(const QString &projectPath)
 {
-    m_projectTree->clear();
-    
-    QTreeWidgetItem *rootItem = new QTreeWidgetItem(m_projectTree);
-    QFileInfo projectInfo(projectPath);
-    rootItem->setText(0, projectInfo.fileName());
-    rootItem->setData(0, Qt::UserRole, projectPath);
-    
-    populateProjectTree(rootItem, projectPath);
-    rootItem->setExpanded(true);
+    // The model fills in as the scanner reports files
+    m_projectModel->setRootPath(projectPath);
+    m_projectTree->expand(m_projectModel->rootIndex());
     
-    statusBar()->showMessage(QString("Project opened: %1").arg(projectPath), 3000);
+    statusBar()->showMessage(QString("Scanning project: %1").arg(projectPath));
 }
 
 void MainWindow::onProjectClosed()
 {
-    m_projectTree->clear();
+    m_projectModel->setRootPath(QString());
     statusBar()->showMessage("Project closed", 2000);
 }
 
-void MainWindow::onProjectFileAdded(const QString &filePath)
-{
-    // Refresh project tree
-    if (m_projectManager->isProjectOpen()) {
-        onProjectOpened(m_projectManager->currentProject());
-    }
-}
-
-void MainWindow::onProjectFileDoubleClicked(QTreeWidgetItem *item, int column)
+void MainWindow::onProjectFileDoubleClicked(const QModelIndex &index)
 {
-    Q_UNUSED(column)
-    
-    QString filePath = item->data(0, Qt::UserRole).toString();
-    QFileInfo fileInfo(filePath);
-    
-    if (fileInfo.isFile()) {
-        openFileInEditor(filePath);
+    if (index.isValid() && !m_projectModel->isDirectory(index)) {
+        openFileInEditor(m_projectModel->filePath(index));
     }
 }
 
@@ -605,22 +1501,3 @@ void MainWindow::onBagelHealthCheck(bool isHealthy)
         statusBar()->showMessage("BAGEL AI server is not responding", 3000);
     }
 }
-
-void MainWindow::populateProjectTree(QTreeWidgetItem *parentItem, const QString &dirPath)
-{
-    QDir dir(dirPath);
-    QStringList entries = dir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    
-    foreach (const QString &entry, entries) {
-        QString fullPath = dir.absoluteFilePath(entry);
-        QFileInfo fileInfo(fullPath);
-        
-        QTreeWidgetItem *item = new QTreeWidgetItem(parentItem);
-        item->setText(0, entry);
-        item->setData(0, Qt::UserRole, fullPath);
-        
-        if (fileInfo.isDir()) {
-            populateProjectTree(item, fullPath);
-        }
-    }
-}
\ No newline at end of file
@@ -2,16 +2,39 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QHash>
+
+#include <functional>
 
 class QTabWidget;
-class QTreeWidget;
-class QTextEdit;
+class QTreeView;
+class QModelIndex;
+class QLabel;
 class QDockWidget;
-class QTreeWidgetItem;
+class QMenu;
+class QAction;
 class CodeEditor;
 class BagelClient;
 class BagelChatWidget;
 class ProjectManager;
+class ProjectTreeModel;
+class TextSnapshot;
+class SaveService;
+class SearchEngine;
+class SearchPanel;
+class FileGrep;
+class QuickOpenDialog;
+class SymbolIndex;
+class SymbolSearchDialog;
+class LspClient;
+class LspStatsPanel;
+class BuildManager;
+class ProblemsPanel;
+class ProcessRunner;
+class BenchmarkRunner;
+class BenchmarkPanel;
+struct RunConfiguration;
+class OutputConsole;
 
 class MainWindow : public QMainWindow
 {
@@ -24,12 +47,24 @@ public:
 private slots:
     void newFile();
     void openFile();
+    void goToFile();
     void saveFile();
     void saveAsFile();
+    void saveAllFiles();
+    void find();
+    void findInProject();
+    void searchInFiles();
+    void goToLine();
+    void goToDefinition();
+    void goToSymbol();
     void openProject();
     void closeProject();
     void buildProject();
+    void buildCurrentFile();
+    void cancelBuild();
     void runProject();
+    void editRunConfigurations();
+    void runBenchmarks();
     void toggleBagel();
     void showAbout();
     void closeTab(int index);
@@ -37,8 +72,7 @@ private slots:
     // Project management slots
     void onProjectOpened(const QString &projectPath);
     void onProjectClosed();
-    void onProjectFileAdded(const QString &filePath);
-    void onProjectFileDoubleClicked(QTreeWidgetItem *item, int column);
+    void onProjectFileDoubleClicked(const QModelIndex &index);
     
     // BAGEL slots
     void onBagelHealthCheck(bool isHealthy);
@@ -51,18 +85,35 @@ private:
     void setupStatusBar();
     void setupBagel();
     void setupProjectManager();
+    void setupSaveService();
+    void setupSearch();
+    void setupSymbols();
+    void setupLanguageServers();
+    void setupBuild();
     void applyDarkTheme();
     void createWelcomeTab();
     void openFileInEditor(const QString &fileName);
-    void saveFileContent(const QString &fileName, const QString &content);
-    void populateProjectTree(QTreeWidgetItem *parentItem, const QString &dirPath);
+    void openFileAt(const QString &fileName, int line, int column, int length);
+    void saveFileContent(const QString &fileName, const TextSnapshot &content);
+    void attachLanguageServer(CodeEditor *editor, const QString &fileName);
+    void shutdownLanguageServers();
+    void runWhenSaved(const std::function<void()> &action);
+    void applyBuildDiagnostics(CodeEditor *editor, const QString &fileName);
+    void setupRun();
+    void startRun(const RunConfiguration &configuration);
+    void updateRunActions();
+    void setupBenchmarks();
+    void findBenchmarkTargets();
     
     CodeEditor* getCurrentEditor();
     
     // UI Components
     QTabWidget *m_tabWidget;
-    QTreeWidget *m_projectTree;
-    QTextEdit *m_outputPanel;
+    QTreeView *m_projectTree;
+    ProjectTreeModel *m_projectModel;
+    OutputConsole *m_outputPanel;
+    QLabel *m_watchLabel;
+    QMenu *m_viewMenu;
     
     // BAGEL Integration
     BagelClient *m_bagelClient;
@@ -71,6 +122,43 @@ private:
     
     // Project Management
     ProjectManager *m_projectManager;
+    
+    // Saving, and what to run once the pending saves are on disk
+    SaveService *m_saveService;
+    std::function<void()> m_afterSave;
+    
+    // Project-wide search
+    SearchEngine *m_searchEngine;
+    SearchPanel *m_searchPanel;
+    QDockWidget *m_searchDock;
+    FileGrep *m_fileGrep;
+    QuickOpenDialog *m_quickOpen;
+    
+    // Code navigation
+    SymbolIndex *m_symbolIndex;
+    SymbolSearchDialog *m_symbolSearch;
+    
+    // Language servers, one per server program
+    QHash<QString, LspClient*> m_languageClients;
+    LspStatsPanel *m_lspStatsPanel;
+    QDockWidget *m_lspStatsDock;
+    
+    // Building, and the problems the last build reported
+    BuildManager *m_buildManager;
+    ProblemsPanel *m_problemsPanel;
+    QDockWidget *m_problemsDock;
+    
+    // Running the project's programs
+    ProcessRunner *m_runner;
+    QLabel *m_runLabel;
+    QAction *m_runAction;
+    QAction *m_runToolbarAction;
+    
+    // Benchmarks, run after a build when there is one
+    BenchmarkRunner *m_benchmarkRunner;
+    BenchmarkPanel *m_benchmarkPanel;
+    QDockWidget *m_benchmarkDock;
+    bool m_benchmarkAfterBuild;
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
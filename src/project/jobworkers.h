@@ -0,0 +1,37 @@
+#ifndef JOBWORKERS_H
+#define JOBWORKERS_H
+
+#include <QObject>
+#include <QAtomicInt>
+
+#include <utility>
+
+// Counts the pool workers of one job, so the last one out can report
+// completion. The report is queued to the receiver's thread like the
+// batches the workers posted earlier, so it is delivered after all of them.
+class JobWorkers
+{
+public:
+    explicit JobWorkers(int count = 0) : m_active(count) {}
+
+    void start(int count) { m_active.storeRelease(count); }
+
+    // Leaves without reporting, e.g. once the job was cancelled. Returns
+    // true for the last worker out.
+    bool leave() { return !m_active.deref(); }
+
+    // Leaves; the last worker out queues report. Results the report needs
+    // are read when it runs, once every worker is done with them.
+    template <typename Report>
+    void finish(QObject *receiver, Report report)
+    {
+        if (leave()) {
+            QMetaObject::invokeMethod(receiver, std::move(report), Qt::QueuedConnection);
+        }
+    }
+
+private:
+    QAtomicInt m_active;
+};
+
+#endif // JOBWORKERS_H
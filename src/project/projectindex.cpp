@@ -0,0 +1,410 @@
+#include "projectindex.h"
+#include "util/projectpaths.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QAtomicInt>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char kIndexMagic[4] = { 'K', 'P', 'I', 'X' };
+const quint32 kIndexVersion = 2;
+
+// On-disk layout, in native byte order: the header, the directory records
+// and the file records (both sorted by path), then the UTF-8 paths
+// relative to the root. Records are fixed size so the mapped file is used
+// as is.
+struct IndexHeader
+{
+    char magic[4];
+    quint32 version;
+    quint32 directoryCount;
+    quint32 fileCount;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+    quint32 rootOffset;
+    quint32 rootLength;
+};
+
+struct IndexDirectory
+{
+    quint32 pathOffset;
+    quint32 pathLength;
+    qint64 mtime;
+};
+
+struct IndexFile
+{
+    quint32 pathOffset;
+    quint32 pathLength;
+    qint64 mtime;
+    qint64 size;
+};
+
+} // namespace
+
+struct MappedIndex
+{
+    ~MappedIndex()
+    {
+        if (data) {
+            file.unmap(data);
+        }
+    }
+
+    const IndexHeader *header() const
+    {
+        return reinterpret_cast<const IndexHeader *>(data);
+    }
+
+    const IndexDirectory *directories() const
+    {
+        return reinterpret_cast<const IndexDirectory *>(data + sizeof(IndexHeader));
+    }
+
+    const IndexFile *files() const
+    {
+        return reinterpret_cast<const IndexFile *>(directories() + header()->directoryCount);
+    }
+
+    const char *string(quint32 offset) const
+    {
+        return reinterpret_cast<const char *>(data + header()->stringsOffset + offset);
+    }
+
+    QString absolutePath(quint32 offset, quint32 length) const
+    {
+        if (length == 0) {
+            return rootPath;
+        }
+        return rootPath + '/' + QString::fromUtf8(string(offset), int(length));
+    }
+
+    QFile file;
+    uchar *data = nullptr;
+    QString rootPath;
+};
+
+namespace {
+
+// Modification time in nanoseconds
+bool statPath(const QString &path, qint64 *mtime, qint64 *size)
+{
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return false;
+    }
+    *mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    *size = st.st_size;
+#else
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return false;
+    }
+    *mtime = info.lastModified().toMSecsSinceEpoch() * 1000000;
+    *size = info.size();
+#endif
+    return true;
+}
+
+bool pathLessThan(const QByteArray &a, const QByteArray &b)
+{
+    const int result = std::memcmp(a.constData(), b.constData(), size_t(qMin(a.size(), b.size())));
+    return result != 0 ? result < 0 : a.size() < b.size();
+}
+
+QVector<QByteArray> relativePaths(const QString &rootPath, const QStringList &paths)
+{
+    const QString prefix = rootPath + '/';
+    QVector<QByteArray> result;
+    result.reserve(paths.size());
+    for (const QString &path : paths) {
+        if (path == rootPath) {
+            result.append(QByteArray(""));
+        } else if (path.startsWith(prefix)) {
+            result.append(path.mid(prefix.size()).toUtf8());
+        }
+    }
+    std::sort(result.begin(), result.end(), pathLessThan);
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+QString absolutePath(const QString &rootPath, const QByteArray &relativePath)
+{
+    return relativePath.isEmpty() ? rootPath : rootPath + '/' + QString::fromUtf8(relativePath);
+}
+
+QStringList validateIndex(const QSharedPointer<const MappedIndex> &index)
+{
+    QStringList changed;
+    const IndexDirectory *directories = index->directories();
+    for (quint32 i = 0; i < index->header()->directoryCount; ++i) {
+        const QString path = index->absolutePath(directories[i].pathOffset, directories[i].pathLength);
+        qint64 mtime = 0;
+        qint64 size = 0;
+        if (!statPath(path, &mtime, &size) || mtime != directories[i].mtime) {
+            changed.append(path);
+        }
+    }
+    return changed;
+}
+
+// Returns false without touching the old index when cancelled
+bool writeIndex(const QString &rootPath, const QStringList &files, const QStringList &directories,
+                const QSharedPointer<QAtomicInt> &cancelled)
+{
+    const QVector<QByteArray> directoryPaths = relativePaths(rootPath, directories);
+    const QVector<QByteArray> filePaths = relativePaths(rootPath, files);
+
+    QByteArray strings;
+    const QByteArray root = rootPath.toUtf8();
+    IndexHeader header;
+    std::memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+    header.version = kIndexVersion;
+    header.rootOffset = 0;
+    header.rootLength = quint32(root.size());
+    strings.append(root);
+
+    QVector<IndexDirectory> directoryRecords;
+    directoryRecords.reserve(directoryPaths.size());
+    for (const QByteArray &path : directoryPaths) {
+        if (cancelled->loadAcquire()) {
+            return false;
+        }
+        IndexDirectory record;
+        qint64 size = 0;
+        if (!statPath(absolutePath(rootPath, path), &record.mtime, &size)) {
+            continue;
+        }
+        record.pathOffset = quint32(strings.size());
+        record.pathLength = quint32(path.size());
+        strings.append(path);
+        directoryRecords.append(record);
+    }
+
+    QVector<IndexFile> fileRecords;
+    fileRecords.reserve(filePaths.size());
+    for (const QByteArray &path : filePaths) {
+        if (cancelled->loadAcquire()) {
+            return false;
+        }
+        IndexFile record;
+        if (!statPath(absolutePath(rootPath, path), &record.mtime, &record.size)) {
+            continue;
+        }
+        record.pathOffset = quint32(strings.size());
+        record.pathLength = quint32(path.size());
+        strings.append(path);
+        fileRecords.append(record);
+    }
+
+    header.directoryCount = quint32(directoryRecords.size());
+    header.fileCount = quint32(fileRecords.size());
+    header.stringsOffset = sizeof(IndexHeader) + directoryRecords.size() * sizeof(IndexDirectory)
+                         + fileRecords.size() * sizeof(IndexFile);
+    header.stringsSize = quint64(strings.size());
+
+    const QString fileName = ProjectIndex::indexPath(rootPath);
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    // Written to a temp file and renamed, so a mapped old index stays intact
+    QSaveFile out(fileName);
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(directoryRecords.constData()),
+              directoryRecords.size() * sizeof(IndexDirectory));
+    out.write(reinterpret_cast<const char *>(fileRecords.constData()),
+              fileRecords.size() * sizeof(IndexFile));
+    out.write(strings);
+    return out.commit();
+}
+
+} // namespace
+
+ProjectIndex::ProjectIndex(QObject *parent)
+    : QObject(parent)
+    , m_validateWatcher(new QFutureWatcher<QStringList>(this))
+    , m_saveWatcher(new QFutureWatcher<bool>(this))
+    , m_validatePending(false)
+    , m_savePending(false)
+    , m_saveCancelled(new QAtomicInt(0))
+{
+    connect(m_validateWatcher, &QFutureWatcher<QStringList>::finished, this, [this]() {
+        // A newer request makes this result stale
+        if (m_validatePending) {
+            startValidate();
+            return;
+        }
+        emit validated(m_validateWatcher->result());
+    });
+    connect(m_saveWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        emit saved(m_saveWatcher->result());
+        if (m_savePending) {
+            startSave();
+        }
+    });
+}
+
+ProjectIndex::~ProjectIndex()
+{
+    // Jobs hold their own references to what they use, so they are left to
+    // finish on their own. An unwritten index only costs the next open a
+    // rescan of the directories that changed.
+    m_saveCancelled->storeRelease(1);
+}
+
+QString ProjectIndex::indexPath(const QString &rootPath)
+{
+    return projectCachePath(rootPath, "projects", ".index");
+}
+
+bool ProjectIndex::load(const QString &rootPath)
+{
+    close();
+
+    QSharedPointer<MappedIndex> index(new MappedIndex);
+    index->rootPath = rootPath;
+    index->file.setFileName(indexPath(rootPath));
+    if (!index->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const quint64 size = quint64(index->file.size());
+    if (size < sizeof(IndexHeader)) {
+        return false;
+    }
+    index->data = index->file.map(0, qint64(size));
+    if (!index->data) {
+        return false;
+    }
+
+    // Everything is bounds-checked once here, so readers can trust offsets
+    const IndexHeader *header = index->header();
+    if (std::memcmp(header->magic, kIndexMagic, sizeof(header->magic)) != 0 || header->version != kIndexVersion) {
+        return false;
+    }
+    const quint64 recordsEnd = sizeof(IndexHeader) + quint64(header->directoryCount) * sizeof(IndexDirectory)
+                             + quint64(header->fileCount) * sizeof(IndexFile);
+    if (recordsEnd > header->stringsOffset || header->stringsOffset > size
+        || header->stringsSize > size - header->stringsOffset) {
+        return false;
+    }
+
+    auto inStrings = [header](quint32 offset, quint32 length) {
+        return quint64(offset) + length <= header->stringsSize;
+    };
+    if (!inStrings(header->rootOffset, header->rootLength)
+        || QByteArray::fromRawData(index->string(header->rootOffset), int(header->rootLength)) != rootPath.toUtf8()) {
+        return false;
+    }
+    for (quint32 i = 0; i < header->directoryCount; ++i) {
+        if (!inStrings(index->directories()[i].pathOffset, index->directories()[i].pathLength)) {
+            return false;
+        }
+    }
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        if (!inStrings(index->files()[i].pathOffset, index->files()[i].pathLength)) {
+            return false;
+        }
+    }
+
+    m_index = index;
+    return true;
+}
+
+void ProjectIndex::close()
+{
+    // Running jobs keep their own reference to the mapping
+    m_index.reset();
+}
+
+int ProjectIndex::fileCount() const
+{
+    return m_index ? int(m_index->header()->fileCount) : 0;
+}
+
+QStringList ProjectIndex::files() const
+{
+    QStringList result;
+    if (!m_index) {
+        return result;
+    }
+
+    const IndexFile *files = m_index->files();
+    result.reserve(int(m_index->header()->fileCount));
+    for (quint32 i = 0; i < m_index->header()->fileCount; ++i) {
+        result.append(m_index->absolutePath(files[i].pathOffset, files[i].pathLength));
+    }
+    return result;
+}
+
+QStringList ProjectIndex::directories() const
+{
+    QStringList result;
+    if (!m_index) {
+        return result;
+    }
+
+    const IndexDirectory *directories = m_index->directories();
+    result.reserve(int(m_index->header()->directoryCount));
+    for (quint32 i = 0; i < m_index->header()->directoryCount; ++i) {
+        result.append(m_index->absolutePath(directories[i].pathOffset, directories[i].pathLength));
+    }
+    return result;
+}
+
+void ProjectIndex::validate()
+{
+    m_validatePending = true;
+    if (!m_validateWatcher->isRunning()) {
+        startValidate();
+    }
+}
+
+void ProjectIndex::startValidate()
+{
+    m_validatePending = false;
+    if (!m_index) {
+        emit validated(QStringList());
+        return;
+    }
+    m_validateWatcher->setFuture(QtConcurrent::run(validateIndex, QSharedPointer<const MappedIndex>(m_index)));
+}
+
+void ProjectIndex::save(const QString &rootPath, const QStringList &files, const QStringList &directories)
+{
+    // Only the latest index matters; an older request still waiting is
+    // replaced
+    m_pendingRoot = rootPath;
+    m_pendingFiles = files;
+    m_pendingDirectories = directories;
+    m_savePending = true;
+    if (!m_saveWatcher->isRunning()) {
+        startSave();
+    }
+}
+
+void ProjectIndex::startSave()
+{
+    m_savePending = false;
+    m_saveWatcher->setFuture(QtConcurrent::run(writeIndex, m_pendingRoot, m_pendingFiles, m_pendingDirectories,
+                                               m_saveCancelled));
+    m_pendingFiles.clear();
+    m_pendingDirectories.clear();
+}
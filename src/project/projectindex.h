@@ -0,0 +1,67 @@
+#ifndef PROJECTINDEX_H
+#define PROJECTINDEX_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+
+struct MappedIndex;
+
+// Memory-mapped snapshot of a project's files and directories, kept in the
+// cache directory so a reopened project is listed without walking the
+// disk. Each file carries its mtime and size; directories carry their
+// mtime, which is all validate() needs to find what changed.
+class ProjectIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProjectIndex(QObject *parent = nullptr);
+    ~ProjectIndex();
+
+    // Maps the index of rootPath. Returns false when there is none or it
+    // does not belong to this root or format version.
+    bool load(const QString &rootPath);
+    void close();
+    bool isLoaded() const { return !m_index.isNull(); }
+
+    int fileCount() const;
+    QStringList files() const;
+    QStringList directories() const;
+
+    // Stats every indexed directory on a worker and reports those whose
+    // mtime changed or which are gone. A request made while one runs
+    // replaces its result.
+    void validate();
+
+    // Writes a new index on a worker. Requests made while a write runs
+    // collapse into the latest one, which starts when the write finishes.
+    // Destroying the index cancels the write.
+    void save(const QString &rootPath, const QStringList &files, const QStringList &directories);
+
+    static QString indexPath(const QString &rootPath);
+
+signals:
+    void validated(const QStringList &changedDirectories);
+    void saved(bool ok);
+
+private:
+    void startValidate();
+    void startSave();
+
+    QSharedPointer<const MappedIndex> m_index;
+    QFutureWatcher<QStringList> *m_validateWatcher;
+    QFutureWatcher<bool> *m_saveWatcher;
+
+    bool m_validatePending;
+    bool m_savePending;
+    QString m_pendingRoot;
+    QStringList m_pendingFiles;
+    QStringList m_pendingDirectories;
+    QSharedPointer<QAtomicInt> m_saveCancelled;
+};
+
+#endif // PROJECTINDEX_H
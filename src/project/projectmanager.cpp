@@ -1,16 +1,52 @@
 #include "projectmanager.h"
+#include "projectscanner.h"
+#include "projectwatcher.h"
+#include "projectindex.h"
 #include <QDir>
 #include <QFileInfo>
+#include <QTimer>
 #include <QDebug>
 
+#include <algorithm>
+
+namespace {
+
+const int kDefaultChangeDebounceMsec = 250;
+
+// A steady stream of events (a long checkout) cannot hold a delta back for
+// longer than this.
+const int kMaxChangeDelayMsec = 2000;
+
+} // namespace
+
 ProjectManager::ProjectManager(QObject *parent)
     : QObject(parent)
-    , m_fileWatcher(new QFileSystemWatcher(this))
+    , m_watcher(new ProjectWatcher(this))
+    , m_scanner(new ProjectScanner(this))
+    , m_initialScan(false)
+    , m_index(new ProjectIndex(this))
+    , m_validating(false)
+    , m_revalidating(false)
+    , m_indexDirty(false)
+    , m_changeTimer(new QTimer(this))
+    , m_changeDebounceInterval(kDefaultChangeDebounceMsec)
+    , m_overflowPending(false)
+    , m_scanOverflowed(false)
 {
-    connect(m_fileWatcher, &QFileSystemWatcher::directoryChanged,
-            this, &ProjectManager::onDirectoryChanged);
-    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged,
-            this, &ProjectManager::onFileChanged);
+    connect(m_watcher, &ProjectWatcher::changed, this, &ProjectManager::onWatcherChanged);
+    connect(m_watcher, &ProjectWatcher::overflowed, this, &ProjectManager::onWatcherOverflowed);
+    connect(m_watcher, &ProjectWatcher::watchCountChanged, this, &ProjectManager::watchCountChanged);
+    connect(m_watcher, &ProjectWatcher::watchLimitReached, this, &ProjectManager::watchLimitReached);
+
+    connect(m_scanner, &ProjectScanner::filesFound, this, &ProjectManager::onFilesFound);
+    connect(m_scanner, &ProjectScanner::directoriesFound, this, &ProjectManager::onDirectoriesFound);
+    connect(m_scanner, &ProjectScanner::finished, this, &ProjectManager::onScanFinished);
+
+    connect(m_index, &ProjectIndex::validated, this, &ProjectManager::onIndexValidated);
+    connect(m_index, &ProjectIndex::saved, this, &ProjectManager::onIndexSaved);
+
+    m_changeTimer->setSingleShot(true);
+    connect(m_changeTimer, &QTimer::timeout, this, &ProjectManager::flushChanges);
 }
 
 bool ProjectManager::openProject(const QString &projectPath)
@@ -19,108 +55,366 @@ bool ProjectManager::openProject(const QString &projectPath)
     if (!dir.exists()) {
         return false;
     }
-    
+
     closeProject();
-    
-    m_currentProjectPath = projectPath;
-    m_fileWatcher->addPath(projectPath);
-    
-    scanProjectFiles();
-    
-    emit projectOpened(projectPath);
+
+    // The index stores paths relative to the root, so the root must be
+    // spelled the same way on every open
+    const QString rootPath = QDir::cleanPath(dir.absolutePath());
+    m_currentProjectPath = rootPath;
+    emit projectOpened(rootPath);
+
+    if (m_index->load(rootPath)) {
+        const QStringList directories = m_index->directories();
+        foreach (const QString &directory, directories) {
+            m_projectDirectories.insert(directory);
+        }
+        m_watcher->addDirectories(directories);
+        applyDelta(m_index->files(), QStringList(), QStringList());
+        m_indexDirty = false;
+
+        m_validating = true;
+        m_index->validate();
+        return true;
+    }
+
+    // Files arrive as filesChanged batches while the scan runs
+    m_initialScan = true;
+    m_scanner->start(rootPath);
+
     return true;
 }
 
 void ProjectManager::closeProject()
 {
     if (!m_currentProjectPath.isEmpty()) {
-        m_fileWatcher->removePaths(m_fileWatcher->directories());
-        m_fileWatcher->removePaths(m_fileWatcher->files());
-        
+        if (canSaveIndex()) {
+            saveIndex();
+        }
+        m_index->close();
+
+        m_scanner->cancel();
+        m_changeTimer->stop();
+        m_initialScan = false;
+        m_validating = false;
+        m_revalidating = false;
+        m_indexDirty = false;
+
+        m_watcher->clear();
+
         m_currentProjectPath.clear();
         m_projectFiles.clear();
-        
+        m_projectDirectories.clear();
+        m_dirtyDirectories.clear();
+        m_modifiedFiles.clear();
+        m_scanDirectories.clear();
+        m_scanFound.clear();
+        m_scanModified.clear();
+        m_overflowPending = false;
+        m_scanOverflowed = false;
+
         emit projectClosed();
     }
 }
 
-void ProjectManager::scanProjectFiles()
+QStringList ProjectManager::projectFiles() const
+{
+    return m_projectFiles.values();
+}
+
+bool ProjectManager::isScanning() const
+{
+    return m_scanner->isRunning();
+}
+
+int ProjectManager::watchCount() const
+{
+    return m_watcher->watchCount();
+}
+
+void ProjectManager::setChangeDebounceInterval(int msec)
+{
+    m_changeDebounceInterval = qMax(0, msec);
+}
+
+void ProjectManager::onWatcherChanged(const QStringList &directories, const QStringList &files)
+{
+    if (m_currentProjectPath.isEmpty()) {
+        return;
+    }
+
+    foreach (const QString &directory, directories) {
+        m_dirtyDirectories.insert(directory);
+    }
+    foreach (const QString &filePath, files) {
+        m_modifiedFiles.insert(filePath);
+    }
+    scheduleFlush();
+}
+
+void ProjectManager::onWatcherOverflowed()
 {
     if (m_currentProjectPath.isEmpty()) {
         return;
     }
-    
-    m_projectFiles.clear();
-    
-    QDir dir(m_currentProjectPath);
-    QStringList filters;
-    filters << "*.cpp" << "*.h" << "*.hpp" << "*.c" << "*.cc" << "*.cxx"
-            << "*.py" << "*.js" << "*.ts" << "*.html" << "*.css" << "*.json"
-            << "*.txt" << "*.md" << "*.cmake" << "CMakeLists.txt" << "*.pro"
-            << "*.qrc" << "*.ui";
-    
-    QStringList files = dir.entryList(filters, QDir::Files | QDir::Readable, QDir::Name);
-    
-    foreach (const QString &file, files) {
-        QString fullPath = dir.absoluteFilePath(file);
-        addFileToProject(fullPath);
+
+    // Lost events could have touched any directory. Listing every known
+    // directory once (each is a start path and skipped as a subdirectory)
+    // is enough to diff; nothing is walked twice. Writes were lost too, so
+    // every file the rescan finds again counts as modified.
+    m_dirtyDirectories.unite(m_projectDirectories);
+    m_overflowPending = true;
+    scheduleFlush();
+}
+
+void ProjectManager::scheduleFlush()
+{
+    if (!m_changeTimer->isActive()) {
+        m_pendingSince.start();
+        m_changeTimer->start(m_changeDebounceInterval);
+        return;
     }
-    
-    // Recursively scan subdirectories
-    QStringList subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    foreach (const QString &subdir, subdirs) {
-        QString subdirPath = dir.absoluteFilePath(subdir);
-        m_fileWatcher->addPath(subdirPath);
-        
-        // Recursively scan subdirectory
-        QDir subDir(subdirPath);
-        QStringList subFiles = subDir.entryList(filters, QDir::Files | QDir::Readable, QDir::Name);
-        foreach (const QString &file, subFiles) {
-            QString fullPath = subDir.absoluteFilePath(file);
-            addFileToProject(fullPath);
+
+    // Each event restarts the window, up to the maximum delay
+    if (m_pendingSince.elapsed() < qMax(kMaxChangeDelayMsec, m_changeDebounceInterval)) {
+        m_changeTimer->start(m_changeDebounceInterval);
+    }
+}
+
+void ProjectManager::flushChanges()
+{
+    // A running scan picks the pending changes up when it finishes
+    if (m_scanner->isRunning()) {
+        return;
+    }
+
+    // Writes are reported for every file in a watched directory; only
+    // project files matter. One that is gone is a directory change.
+    QSet<QString> modified;
+    foreach (const QString &filePath, m_modifiedFiles) {
+        if (!m_projectFiles.contains(filePath)) {
+            continue;
+        }
+        if (QFileInfo::exists(filePath)) {
+            modified.insert(filePath);
+        } else {
+            m_dirtyDirectories.insert(QFileInfo(filePath).path());
         }
     }
+    m_modifiedFiles.clear();
+
+    if (m_dirtyDirectories.isEmpty()) {
+        if (!modified.isEmpty()) {
+            applyDelta(QStringList(), QStringList(), modified.values());
+        }
+        return;
+    }
+
+    // Rescan only the dirty directories and whatever new directories they
+    // contain; known subdirectories have watches of their own
+    m_scanDirectories = m_dirtyDirectories.values();
+    m_dirtyDirectories.clear();
+    m_scanFound.clear();
+    m_scanModified = modified;
+    m_scanOverflowed = m_overflowPending;
+    m_overflowPending = false;
+    m_scanner->start(m_currentProjectPath, m_scanDirectories, m_projectDirectories);
 }
 
-void ProjectManager::addFileToProject(const QString &filePath)
+void ProjectManager::onFilesFound(const QStringList &files)
 {
-    if (!m_projectFiles.contains(filePath) && isSourceFile(filePath)) {
-        m_projectFiles.append(filePath);
-        m_fileWatcher->addPath(filePath);
-        emit fileAdded(filePath);
+    if (!m_initialScan) {
+        foreach (const QString &filePath, files) {
+            m_scanFound.insert(filePath);
+        }
+        return;
+    }
+
+    QStringList added;
+    foreach (const QString &filePath, files) {
+        if (!m_projectFiles.contains(filePath)) {
+            added.append(filePath);
+        }
+    }
+
+    if (!added.isEmpty()) {
+        applyDelta(added, QStringList(), QStringList());
+    }
+}
+
+void ProjectManager::onDirectoriesFound(const QStringList &directories)
+{
+    QStringList newDirectories;
+    foreach (const QString &directory, directories) {
+        if (!m_projectDirectories.contains(directory)) {
+            m_projectDirectories.insert(directory);
+            newDirectories.append(directory);
+        }
+    }
+
+    m_watcher->addDirectories(newDirectories);
+}
+
+void ProjectManager::onScanFinished()
+{
+    if (m_initialScan) {
+        m_initialScan = false;
+        emit scanFinished(m_projectFiles.size());
+        if (m_dirtyDirectories.isEmpty()) {
+            saveIndex();
+        } else {
+            m_indexDirty = true;
+        }
+    } else {
+        finishChangeScan();
+        if (m_revalidating && m_dirtyDirectories.isEmpty()) {
+            m_revalidating = false;
+            emit scanFinished(m_projectFiles.size());
+            saveIndex();
+        }
+    }
+
+    if (!m_dirtyDirectories.isEmpty() || !m_modifiedFiles.isEmpty()) {
+        scheduleFlush();
+    }
+}
+
+void ProjectManager::onIndexValidated(const QStringList &changedDirectories)
+{
+    if (!m_validating) {
+        return;
+    }
+    m_validating = false;
+
+    if (changedDirectories.isEmpty()) {
+        emit scanFinished(m_projectFiles.size());
+        return;
+    }
+
+    // Changed directories go through the same rescan as watcher events
+    m_revalidating = true;
+    foreach (const QString &directory, changedDirectories) {
+        m_dirtyDirectories.insert(directory);
+    }
+    flushChanges();
+}
+
+void ProjectManager::onIndexSaved(bool ok)
+{
+    if (!ok) {
+        qWarning() << "ProjectManager: could not write the project index for" << m_currentProjectPath;
     }
 }
 
-void ProjectManager::removeFileFromProject(const QString &filePath)
+void ProjectManager::finishChangeScan()
 {
-    if (m_projectFiles.contains(filePath)) {
-        m_projectFiles.removeAll(filePath);
-        m_fileWatcher->removePath(filePath);
-        emit fileRemoved(filePath);
+    QStringList added;
+    foreach (const QString &filePath, m_scanFound) {
+        if (!m_projectFiles.contains(filePath)) {
+            added.append(filePath);
+        }
+    }
+
+    // The rescan covered the direct children of directories that still
+    // exist, and everything below directories that are gone
+    QSet<QString> existing;
+    QStringList gone;
+    foreach (const QString &directory, m_scanDirectories) {
+        if (QFileInfo::exists(directory)) {
+            existing.insert(directory);
+        } else {
+            gone.append(directory + '/');
+        }
+    }
+
+    // Keep only the outermost gone directories, so the closest preceding
+    // entry is the only candidate prefix of a path
+    std::sort(gone.begin(), gone.end());
+    QStringList outermost;
+    foreach (const QString &directory, gone) {
+        if (outermost.isEmpty() || !directory.startsWith(outermost.last())) {
+            outermost.append(directory);
+        }
+    }
+
+    auto isUnderGoneDirectory = [&outermost](const QString &path) {
+        const auto it = std::upper_bound(outermost.constBegin(), outermost.constEnd(), path);
+        return it != outermost.constBegin() && path.startsWith(*(it - 1));
+    };
+
+    QSet<QString> removed;
+    foreach (const QString &filePath, m_projectFiles) {
+        if (m_scanFound.contains(filePath)) {
+            continue;
+        }
+        if (existing.contains(filePath.left(filePath.lastIndexOf('/')))
+            || (!outermost.isEmpty() && isUnderGoneDirectory(filePath))) {
+            removed.insert(filePath);
+        }
+    }
+
+    if (!outermost.isEmpty()) {
+        QSet<QString>::iterator it = m_projectDirectories.begin();
+        while (it != m_projectDirectories.end()) {
+            if (isUnderGoneDirectory(*it + '/')) {
+                it = m_projectDirectories.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (m_scanOverflowed) {
+        foreach (const QString &filePath, m_scanFound) {
+            if (m_projectFiles.contains(filePath)) {
+                m_scanModified.insert(filePath);
+            }
+        }
+    }
+
+    QStringList modified;
+    foreach (const QString &filePath, m_scanModified) {
+        if (m_projectFiles.contains(filePath) && !removed.contains(filePath)) {
+            modified.append(filePath);
+        }
+    }
+
+    m_scanDirectories.clear();
+    m_scanFound.clear();
+    m_scanModified.clear();
+    m_scanOverflowed = false;
+
+    if (!added.isEmpty() || !removed.isEmpty() || !modified.isEmpty()) {
+        applyDelta(added, removed.values(), modified);
     }
 }
 
-bool ProjectManager::isSourceFile(const QString &filePath) const
+void ProjectManager::applyDelta(const QStringList &added, const QStringList &removed, const QStringList &modified)
 {
-    QFileInfo fileInfo(filePath);
-    QString suffix = fileInfo.suffix().toLower();
-    
-    QStringList sourceExtensions;
-    sourceExtensions << "cpp" << "h" << "hpp" << "c" << "cc" << "cxx"
-                     << "py" << "js" << "ts" << "html" << "css" << "json"
-                     << "txt" << "md" << "cmake" << "pro" << "qrc" << "ui";
-    
-    return sourceExtensions.contains(suffix) || fileInfo.fileName() == "CMakeLists.txt";
+    foreach (const QString &filePath, added) {
+        m_projectFiles.insert(filePath);
+    }
+    foreach (const QString &filePath, removed) {
+        m_projectFiles.remove(filePath);
+    }
+    // Modified files change their stat data in the index as well
+    if (!added.isEmpty() || !removed.isEmpty() || !modified.isEmpty()) {
+        m_indexDirty = true;
+    }
+
+    emit filesChanged(added, removed, modified);
 }
 
-void ProjectManager::onDirectoryChanged(const QString &path)
+bool ProjectManager::canSaveIndex() const
 {
-    Q_UNUSED(path)
-    // Rescan project files when directory changes
-    scanProjectFiles();
+    // Only a settled listing is written; directory mtimes in the index
+    // must not claim changes that were never picked up
+    return m_indexDirty && !m_initialScan && !m_validating
+        && !m_scanner->isRunning() && m_dirtyDirectories.isEmpty();
 }
 
-void ProjectManager::onFileChanged(const QString &path)
+void ProjectManager::saveIndex()
 {
-    emit fileChanged(path);
-}
\ No newline at end of file
+    m_index->save(m_currentProjectPath, m_projectFiles.values(), m_projectDirectories.values());
+    m_indexDirty = false;
+}
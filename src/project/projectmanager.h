@@ -4,7 +4,13 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
-#include <QFileSystemWatcher>
+#include <QSet>
+#include <QElapsedTimer>
+
+class QTimer;
+class ProjectScanner;
+class ProjectWatcher;
+class ProjectIndex;
 
 class ProjectManager : public QObject
 {
@@ -17,30 +23,69 @@ public:
     void closeProject();
     
     QString currentProject() const { return m_currentProjectPath; }
-    QStringList projectFiles() const { return m_projectFiles; }
+    QStringList projectFiles() const;
     
     bool isProjectOpen() const { return !m_currentProjectPath.isEmpty(); }
+    bool isScanning() const;
+    int watchCount() const;
+    
+    // Watcher events are collected until none has arrived for this long,
+    // then turned into a single filesChanged delta
+    void setChangeDebounceInterval(int msec);
+    int changeDebounceInterval() const { return m_changeDebounceInterval; }
 
 signals:
     void projectOpened(const QString &projectPath);
     void projectClosed();
-    void fileAdded(const QString &filePath);
-    void fileRemoved(const QString &filePath);
-    void fileChanged(const QString &filePath);
+    void filesChanged(const QStringList &added, const QStringList &removed, const QStringList &modified);
+    void scanFinished(int fileCount);
+    void watchCountChanged(int count);
+    void watchLimitReached(int count);
 
 private slots:
-    void onDirectoryChanged(const QString &path);
-    void onFileChanged(const QString &path);
+    void onWatcherChanged(const QStringList &directories, const QStringList &files);
+    void onWatcherOverflowed();
+    void onFilesFound(const QStringList &files);
+    void onDirectoriesFound(const QStringList &directories);
+    void onScanFinished();
+    void onIndexValidated(const QStringList &changedDirectories);
+    void onIndexSaved(bool ok);
+    void flushChanges();
 
 private:
-    void scanProjectFiles();
-    void addFileToProject(const QString &filePath);
-    void removeFileFromProject(const QString &filePath);
-    bool isSourceFile(const QString &filePath) const;
+    void scheduleFlush();
+    void finishChangeScan();
+    void applyDelta(const QStringList &added, const QStringList &removed, const QStringList &modified);
+    bool canSaveIndex() const;
+    void saveIndex();
     
     QString m_currentProjectPath;
-    QStringList m_projectFiles;
-    QFileSystemWatcher *m_fileWatcher;
+    QSet<QString> m_projectFiles;
+    QSet<QString> m_projectDirectories;
+    ProjectWatcher *m_watcher;
+    ProjectScanner *m_scanner;
+    bool m_initialScan;
+    
+    // On-disk index: a warm open lists the project from it, then rescans
+    // only the directories that changed since it was written
+    ProjectIndex *m_index;
+    bool m_validating;
+    bool m_revalidating;
+    bool m_indexDirty;
+    
+    // Change aggregation
+    QTimer *m_changeTimer;
+    int m_changeDebounceInterval;
+    QElapsedTimer m_pendingSince;
+    QSet<QString> m_dirtyDirectories;
+    QSet<QString> m_modifiedFiles;
+    bool m_overflowPending;
+    
+    // State of the rescan that turns dirty directories into a delta
+    QStringList m_scanDirectories;
+    QSet<QString> m_scanFound;
+    QSet<QString> m_scanModified;
+    bool m_scanOverflowed;
 };
 
-#endif // PROJECTMANAGER_H
\ No newline at end of file
+#endif // PROJECTMANAGER_H
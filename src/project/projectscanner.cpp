@@ -0,0 +1,481 @@
+#include "projectscanner.h"
+#include "workstealingqueue.h"
+#include "jobworkers.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Results are handed to the GUI thread in batches of this size, or earlier
+// when a worker runs out of directories.
+const int kFileBatchSize = 1024;
+const int kDirectoryBatchSize = 256;
+const int kMaxWorkers = 16;
+
+const char *const kSourceSuffixes[] = {
+    "cpp", "h", "hpp", "c", "cc", "cxx", "py", "js", "ts", "html", "css", "json",
+    "txt", "md", "cmake", "pro", "qrc", "ui"
+};
+
+bool isSourceFileName(const char *name, size_t length)
+{
+    if (length == 14 && std::memcmp(name, "CMakeLists.txt", 14) == 0) {
+        return true;
+    }
+
+    const char *dot = static_cast<const char *>(std::memchr(name, '.', length));
+    if (!dot) {
+        return false;
+    }
+    // The suffix is everything after the last dot
+    for (const char *p = dot; p < name + length; ++p) {
+        if (*p == '.') {
+            dot = p;
+        }
+    }
+
+    const char *suffix = dot + 1;
+    const size_t suffixLength = name + length - suffix;
+    for (const char *candidate : kSourceSuffixes) {
+        if (std::strlen(candidate) == suffixLength && qstrnicmp(candidate, suffix, uint(suffixLength)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString toQString(const fs::path &path)
+{
+#ifdef Q_OS_WIN
+    return QString::fromStdWString(path.native());
+#else
+    return QFile::decodeName(path.c_str());
+#endif
+}
+
+fs::path toPath(const QString &path)
+{
+#ifdef Q_OS_WIN
+    return fs::path(path.toStdWString());
+#else
+    return fs::path(QFile::encodeName(path).toStdString());
+#endif
+}
+
+// Glob matching with .gitignore semantics: '*', '?' and '[...]' stop at
+// '/', '**' crosses directories and "**/" may also match no directory.
+bool globMatch(const char *p, const char *pe, const char *s, const char *se)
+{
+    while (p < pe) {
+        switch (*p) {
+        case '*':
+            if (p + 1 < pe && p[1] == '*') {
+                p += 2;
+                const bool slash = p < pe && *p == '/';
+                if (slash) {
+                    ++p;
+                }
+                for (const char *t = s;; ++t) {
+                    if ((!slash || t == s || t[-1] == '/') && globMatch(p, pe, t, se)) {
+                        return true;
+                    }
+                    if (t == se) {
+                        return false;
+                    }
+                }
+            }
+            ++p;
+            for (const char *t = s;; ++t) {
+                if (globMatch(p, pe, t, se)) {
+                    return true;
+                }
+                if (t == se || *t == '/') {
+                    return false;
+                }
+            }
+        case '?':
+            if (s == se || *s == '/') {
+                return false;
+            }
+            ++p;
+            ++s;
+            break;
+        case '[': {
+            if (s == se || *s == '/') {
+                return false;
+            }
+            const char *q = p + 1;
+            const bool negated = q < pe && (*q == '!' || *q == '^');
+            if (negated) {
+                ++q;
+            }
+            const uchar c = uchar(*s);
+            bool matched = false;
+            for (bool first = true; q < pe && (first || *q != ']'); first = false, ++q) {
+                if (*q == '\\' && q + 1 < pe) {
+                    ++q;
+                }
+                uchar low = uchar(*q);
+                uchar high = low;
+                if (q + 2 < pe && q[1] == '-' && q[2] != ']') {
+                    high = uchar(q[2]);
+                    q += 2;
+                }
+                if (low <= c && c <= high) {
+                    matched = true;
+                }
+            }
+            if (q >= pe) {
+                // Unterminated class; '[' is literal
+                if (*s != '[') {
+                    return false;
+                }
+                ++p;
+                ++s;
+                break;
+            }
+            if (matched == negated) {
+                return false;
+            }
+            p = q + 1;
+            ++s;
+            break;
+        }
+        case '\\':
+            if (p + 1 < pe) {
+                ++p;
+            }
+            Q_FALLTHROUGH();
+        default:
+            if (s == se || *s != *p) {
+                return false;
+            }
+            ++p;
+            ++s;
+        }
+    }
+    return s == se;
+}
+
+struct IgnoreRule
+{
+    std::string pattern;
+    bool negate;
+    bool directoryOnly;
+    bool anchored;   // matched against the path, not just the name
+};
+
+// Rules of one .gitignore, chained to the rules of the directories above.
+struct IgnoreList
+{
+    QSharedPointer<const IgnoreList> parent;
+    std::string base;   // directory of the .gitignore, relative to the root
+    std::vector<IgnoreRule> rules;
+};
+
+typedef QSharedPointer<const IgnoreList> IgnorePtr;
+
+IgnorePtr loadIgnoreFile(const fs::path &directory, const std::string &base, const IgnorePtr &parent)
+{
+    QFile file(toQString(directory / ".gitignore"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return parent;
+    }
+
+    QSharedPointer<IgnoreList> list(new IgnoreList);
+    list->parent = parent;
+    list->base = base;
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r') || (line.endsWith(' ') && !line.endsWith("\\ "))) {
+            line.chop(1);
+        }
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        IgnoreRule rule;
+        rule.negate = line.startsWith('!');
+        if (rule.negate) {
+            line.remove(0, 1);
+        }
+        rule.directoryOnly = line.endsWith('/');
+        if (rule.directoryOnly) {
+            line.chop(1);
+        }
+        rule.anchored = line.contains('/');
+        if (line.startsWith('/')) {
+            line.remove(0, 1);
+        }
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        rule.pattern = line.toStdString();
+        list->rules.push_back(rule);
+    }
+
+    if (list->rules.empty()) {
+        return parent;
+    }
+    return list;
+}
+
+// The last matching rule wins, and rules of deeper .gitignore files take
+// precedence over those above them.
+bool isIgnored(const IgnorePtr &ignore, const std::string &relativePath, size_t nameOffset, bool isDirectory)
+{
+    const char *end = relativePath.data() + relativePath.size();
+    const char *name = relativePath.data() + nameOffset;
+
+    for (const IgnoreList *list = ignore.data(); list; list = list->parent.data()) {
+        const char *path = relativePath.data() + (list->base.empty() ? 0 : list->base.size() + 1);
+        for (auto rule = list->rules.rbegin(); rule != list->rules.rend(); ++rule) {
+            if (rule->directoryOnly && !isDirectory) {
+                continue;
+            }
+            const char *pattern = rule->pattern.data();
+            if (globMatch(pattern, pattern + rule->pattern.size(), rule->anchored ? path : name, end)) {
+                return !rule->negate;
+            }
+        }
+    }
+    return false;
+}
+
+struct DirectoryTask
+{
+    fs::path path;
+    std::string relativePath;
+    IgnorePtr ignore;
+};
+
+} // namespace
+
+struct ScanState
+{
+    explicit ScanState(int workerCount)
+        : queue(workerCount)
+        , workers(workerCount)
+    {
+    }
+
+    fs::path root;
+    std::vector<fs::path> starts;
+    QSet<QString> skipDirectories;
+    WorkStealingQueue<DirectoryTask> queue;
+    JobWorkers workers;
+};
+
+namespace {
+
+// Loads the .gitignore files between the root and a start directory and
+// queues the start directory unless it is ignored itself.
+void seedDirectory(ScanState *state, int index, const fs::path &start)
+{
+    IgnorePtr ignore;
+    std::string relativePath;
+    fs::path directory = state->root;
+
+    const fs::path relative = start.lexically_relative(state->root);
+    if (!relative.empty() && relative != ".") {
+        for (const fs::path &component : relative) {
+            ignore = loadIgnoreFile(directory, relativePath, ignore);
+            const std::string name = component.u8string();
+            relativePath = relativePath.empty() ? name : relativePath + '/' + name;
+            if (name == ".git" || isIgnored(ignore, relativePath, relativePath.size() - name.size(), true)) {
+                return;
+            }
+            directory /= component;
+        }
+    }
+
+    state->queue.push(index, DirectoryTask{start, relativePath, ignore});
+}
+
+void scanDirectory(ScanState *state, int index, const DirectoryTask &task,
+                   QStringList *files, QStringList *directories)
+{
+    std::error_code error;
+    fs::directory_iterator it(task.path, fs::directory_options::skip_permission_denied, error);
+    if (error) {
+        // Gone or unreadable; the caller diffs it away
+        return;
+    }
+
+    directories->append(toQString(task.path));
+    const IgnorePtr ignore = loadIgnoreFile(task.path, task.relativePath, task.ignore);
+
+    for (; !error && it != fs::directory_iterator(); it.increment(error)) {
+        if (state->queue.isCancelled()) {
+            return;
+        }
+
+        const fs::directory_entry &entry = *it;
+        const std::string name = entry.path().filename().u8string();
+
+        // The entry type comes from the directory listing itself, so this
+        // does not stat every file.
+        std::error_code statusError;
+        const fs::file_status status = entry.symlink_status(statusError);
+        if (statusError) {
+            continue;
+        }
+
+        if (fs::is_directory(status)) {
+            // Directory symlinks are not followed, which also rules out cycles
+            if (name == ".git"
+                || (!state->skipDirectories.isEmpty() && state->skipDirectories.contains(toQString(entry.path())))) {
+                continue;
+            }
+            std::string relativePath = task.relativePath.empty() ? name : task.relativePath + '/' + name;
+            if (!isIgnored(ignore, relativePath, relativePath.size() - name.size(), true)) {
+                state->queue.push(index, DirectoryTask{entry.path(), std::move(relativePath), ignore});
+            }
+        } else if (fs::is_regular_file(status) || (fs::is_symlink(status) && entry.is_regular_file(statusError))) {
+            if (!isSourceFileName(name.data(), name.size())) {
+                continue;
+            }
+            const std::string relativePath = task.relativePath.empty() ? name : task.relativePath + '/' + name;
+            if (!isIgnored(ignore, relativePath, relativePath.size() - name.size(), false)) {
+                files->append(toQString(entry.path()));
+            }
+        }
+    }
+}
+
+} // namespace
+
+ProjectScanner::ProjectScanner(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+    , m_running(false)
+{
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), kMaxWorkers));
+}
+
+ProjectScanner::~ProjectScanner()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void ProjectScanner::start(const QString &rootPath, const QStringList &startPaths,
+                           const QSet<QString> &skipDirectories)
+{
+    // Workers of the old scan may be stuck in a slow listing; they notice the
+    // cancellation afterwards and drain in the background, and nothing they
+    // post gets through under the new generation
+    cancel();
+
+    const int workerCount = m_pool.maxThreadCount();
+    m_state.reset(new ScanState(workerCount));
+    m_state->root = toPath(rootPath);
+    m_state->skipDirectories = skipDirectories;
+    if (startPaths.isEmpty()) {
+        m_state->starts.push_back(m_state->root);
+    }
+    for (const QString &startPath : startPaths) {
+        m_state->starts.push_back(toPath(startPath));
+    }
+    m_running = true;
+
+    const QSharedPointer<ScanState> state = m_state;
+    const int generation = m_generation;
+    for (int i = 0; i < workerCount; ++i) {
+        QtConcurrent::run(&m_pool, [this, state, i, generation] { runWorker(state, i, generation); });
+    }
+}
+
+void ProjectScanner::cancel()
+{
+    if (m_state) {
+        m_state->queue.cancel();
+    }
+    // Batches that are already queued for delivery are dropped as well
+    ++m_generation;
+    m_running = false;
+}
+
+bool ProjectScanner::isSourceFile(const QString &filePath)
+{
+    const QByteArray name = QFileInfo(filePath).fileName().toUtf8();
+    return isSourceFileName(name.constData(), size_t(name.size()));
+}
+
+void ProjectScanner::runWorker(const QSharedPointer<ScanState> &state, int index, int generation)
+{
+    // Runs on a pool thread. Everything reaches the GUI thread through
+    // post(), which is ignored once the scan has been cancelled.
+    if (index == 0) {
+        for (const fs::path &start : state->starts) {
+            seedDirectory(state.data(), index, start);
+        }
+        state->queue.taskDone();
+    }
+
+    QStringList files;
+    QStringList directories;
+    DirectoryTask task;
+    // Before sleeping until another worker queues more directories, hand
+    // over what we have
+    const auto flush = [&] {
+        if (!files.isEmpty() || !directories.isEmpty()) {
+            post(generation, files, directories);
+            files.clear();
+            directories.clear();
+        }
+    };
+    while (state->queue.take(index, &task, flush)) {
+        scanDirectory(state.data(), index, task, &files, &directories);
+        state->queue.taskDone();
+
+        if (files.size() >= kFileBatchSize || directories.size() >= kDirectoryBatchSize) {
+            post(generation, files, directories);
+            files.clear();
+            directories.clear();
+        }
+    }
+
+    if (state->queue.isCancelled()) {
+        state->workers.leave();
+        return;
+    }
+
+    if (!files.isEmpty() || !directories.isEmpty()) {
+        post(generation, files, directories);
+    }
+
+    state->workers.finish(this, [this, generation] {
+        if (generation == m_generation) {
+            m_running = false;
+            emit finished();
+        }
+    });
+}
+
+void ProjectScanner::post(int generation, const QStringList &files, const QStringList &directories)
+{
+    QMetaObject::invokeMethod(this, [this, generation, files, directories] {
+        if (generation != m_generation) {
+            return;
+        }
+        if (!directories.isEmpty()) {
+            emit directoriesFound(directories);
+        }
+        if (!files.isEmpty()) {
+            emit filesFound(files);
+        }
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,51 @@
+#ifndef PROJECTSCANNER_H
+#define PROJECTSCANNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QThreadPool>
+#include <QSharedPointer>
+
+struct ScanState;
+
+// Recursively collects the source files of a project on a dedicated thread
+// pool. Every worker owns a deque of directories and steals from the others
+// when it runs dry, so one huge subtree does not serialize the scan.
+// .gitignore files are honored, and results are streamed back in batches.
+class ProjectScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProjectScanner(QObject *parent = nullptr);
+    ~ProjectScanner();
+
+    // Scans startPaths (the whole project if empty) below rootPath. The
+    // .gitignore files of the directories in between apply as well, and
+    // skipDirectories, typically those scanned before, are not descended
+    // into. A scan that is still running is cancelled first.
+    void start(const QString &rootPath, const QStringList &startPaths = QStringList(),
+               const QSet<QString> &skipDirectories = QSet<QString>());
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+    static bool isSourceFile(const QString &filePath);
+
+signals:
+    void filesFound(const QStringList &files);
+    void directoriesFound(const QStringList &directories);
+    void finished();
+
+private:
+    void runWorker(const QSharedPointer<ScanState> &state, int index, int generation);
+    void post(int generation, const QStringList &files, const QStringList &directories);
+
+    QThreadPool m_pool;
+    QSharedPointer<ScanState> m_state;
+    int m_generation;
+    bool m_running;
+};
+
+#endif // PROJECTSCANNER_H
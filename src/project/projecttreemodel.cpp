@@ -0,0 +1,331 @@
+#include "projecttreemodel.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
+struct ProjectTreeNode
+{
+    ProjectTreeNode(const QString &name, const QString &path, bool isDirectory, ProjectTreeNode *parent)
+        : name(name)
+        , path(path)
+        , isDirectory(isDirectory)
+        , fetched(false)
+        , parent(parent)
+    {
+    }
+
+    ~ProjectTreeNode()
+    {
+        qDeleteAll(children);
+    }
+
+    QString name;
+    QString path;
+    bool isDirectory;
+    // Children are exposed to views, and kept sorted, only once fetched
+    bool fetched;
+    ProjectTreeNode *parent;
+    QVector<ProjectTreeNode*> children;
+};
+
+namespace {
+
+// Directories first, then by name, case-insensitively
+bool nodeLessThan(const ProjectTreeNode *a, const ProjectTreeNode *b)
+{
+    if (a->isDirectory != b->isDirectory) {
+        return a->isDirectory;
+    }
+    const int result = QString::compare(a->name, b->name, Qt::CaseInsensitive);
+    if (result != 0) {
+        return result < 0;
+    }
+    return a->name < b->name;
+}
+
+} // namespace
+
+ProjectTreeModel::ProjectTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_invisibleRoot(new ProjectTreeNode(QString(), QString(), true, nullptr))
+    , m_projectNode(nullptr)
+{
+    m_invisibleRoot->fetched = true;
+}
+
+ProjectTreeModel::~ProjectTreeModel()
+{
+    delete m_invisibleRoot;
+}
+
+void ProjectTreeModel::setRootPath(const QString &projectPath)
+{
+    beginResetModel();
+
+    qDeleteAll(m_invisibleRoot->children);
+    m_invisibleRoot->children.clear();
+    m_nodes.clear();
+    m_projectNode = nullptr;
+
+    if (!projectPath.isEmpty()) {
+        const QString path = QDir::cleanPath(projectPath);
+        m_projectNode = new ProjectTreeNode(QFileInfo(path).fileName(), path, true, m_invisibleRoot);
+        // The top level is shown expanded, so it never waits for a fetch
+        m_projectNode->fetched = true;
+        m_invisibleRoot->children.append(m_projectNode);
+        m_nodes.insert(path, m_projectNode);
+    }
+
+    endResetModel();
+}
+
+QModelIndex ProjectTreeModel::rootIndex() const
+{
+    return m_projectNode ? indexOfNode(m_projectNode) : QModelIndex();
+}
+
+void ProjectTreeModel::applyChanges(const QStringList &added, const QStringList &removed)
+{
+    for (const QString &filePath : removed) {
+        removeFile(filePath);
+    }
+    addFiles(added);
+}
+
+void ProjectTreeModel::addFiles(const QStringList &filePaths)
+{
+    if (!m_projectNode) {
+        return;
+    }
+
+    for (const QString &filePath : filePaths) {
+        const int slash = filePath.lastIndexOf('/');
+        if (slash < 0 || m_nodes.contains(filePath)) {
+            continue;
+        }
+
+        // Missing directories are built detached and attached once they
+        // hold the file, so views never see an empty directory appear
+        ProjectTreeNode *detached = nullptr;
+        ProjectTreeNode *parent = directoryNode(filePath.left(slash), &detached);
+        ProjectTreeNode *node = new ProjectTreeNode(filePath.mid(slash + 1), filePath, false, parent);
+        m_nodes.insert(filePath, node);
+
+        if (detached) {
+            parent->children.append(node);
+            insertNode(detached->parent, detached);
+        } else {
+            insertNode(parent, node);
+        }
+    }
+}
+
+void ProjectTreeModel::removeFile(const QString &filePath)
+{
+    ProjectTreeNode *node = m_nodes.value(filePath);
+    if (!node || node->isDirectory) {
+        return;
+    }
+
+    ProjectTreeNode *parent = node->parent;
+    removeNode(node);
+
+    // Directories only exist to hold files
+    while (parent != m_projectNode && parent->children.isEmpty()) {
+        ProjectTreeNode *grandParent = parent->parent;
+        removeNode(parent);
+        parent = grandParent;
+    }
+}
+
+QString ProjectTreeModel::filePath(const QModelIndex &index) const
+{
+    return index.isValid() ? nodeFromIndex(index)->path : QString();
+}
+
+bool ProjectTreeModel::isDirectory(const QModelIndex &index) const
+{
+    return nodeFromIndex(index)->isDirectory;
+}
+
+QModelIndex ProjectTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, nodeFromIndex(parent)->children.at(row));
+}
+
+QModelIndex ProjectTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid()) {
+        return QModelIndex();
+    }
+    return indexOfNode(nodeFromIndex(child)->parent);
+}
+
+int ProjectTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    const ProjectTreeNode *node = nodeFromIndex(parent);
+    return node->fetched ? node->children.size() : 0;
+}
+
+int ProjectTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 1;
+}
+
+QVariant ProjectTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const ProjectTreeNode *node = nodeFromIndex(index);
+    switch (role) {
+    case Qt::DisplayRole:
+        return node->name;
+    case Qt::ToolTipRole:
+    case FilePathRole:
+        return node->path;
+    case IsDirectoryRole:
+        return node->isDirectory;
+    default:
+        return QVariant();
+    }
+}
+
+QVariant ProjectTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (section == 0 && orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        return QString("Project Files");
+    }
+    return QVariant();
+}
+
+bool ProjectTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return false;
+    }
+    const ProjectTreeNode *node = nodeFromIndex(parent);
+    return node->isDirectory && !node->children.isEmpty();
+}
+
+bool ProjectTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    const ProjectTreeNode *node = nodeFromIndex(parent);
+    return !node->fetched && !node->children.isEmpty();
+}
+
+void ProjectTreeModel::fetchMore(const QModelIndex &parent)
+{
+    ProjectTreeNode *node = nodeFromIndex(parent);
+    if (node->fetched || node->children.isEmpty()) {
+        return;
+    }
+
+    // Unfetched children were appended in arrival order
+    std::sort(node->children.begin(), node->children.end(), nodeLessThan);
+
+    beginInsertRows(parent, 0, node->children.size() - 1);
+    node->fetched = true;
+    endInsertRows();
+}
+
+ProjectTreeNode *ProjectTreeModel::nodeFromIndex(const QModelIndex &index) const
+{
+    return index.isValid() ? static_cast<ProjectTreeNode*>(index.internalPointer()) : m_invisibleRoot;
+}
+
+QModelIndex ProjectTreeModel::indexOfNode(ProjectTreeNode *node) const
+{
+    if (node == m_invisibleRoot) {
+        return QModelIndex();
+    }
+    return createIndex(rowOfNode(node), 0, node);
+}
+
+int ProjectTreeModel::rowOfNode(const ProjectTreeNode *node) const
+{
+    const QVector<ProjectTreeNode*> &siblings = node->parent->children;
+    if (!node->parent->fetched) {
+        return siblings.indexOf(const_cast<ProjectTreeNode*>(node));
+    }
+    // Fetched children are sorted, so large directories stay O(log n)
+    return insertionRow(node->parent, node);
+}
+
+int ProjectTreeModel::insertionRow(const ProjectTreeNode *parent, const ProjectTreeNode *node) const
+{
+    const auto it = std::lower_bound(parent->children.constBegin(), parent->children.constEnd(), node, nodeLessThan);
+    return int(it - parent->children.constBegin());
+}
+
+ProjectTreeNode *ProjectTreeModel::directoryNode(const QString &dirPath, ProjectTreeNode **detached)
+{
+    if (ProjectTreeNode *node = m_nodes.value(dirPath)) {
+        return node;
+    }
+
+    // Anything outside the project hangs off the project node
+    const int slash = dirPath.lastIndexOf('/');
+    if (slash <= 0 || dirPath.length() <= m_projectNode->path.length()) {
+        return m_projectNode;
+    }
+
+    ProjectTreeNode *parent = directoryNode(dirPath.left(slash), detached);
+    ProjectTreeNode *node = new ProjectTreeNode(dirPath.mid(slash + 1), dirPath, true, parent);
+    m_nodes.insert(dirPath, node);
+
+    if (*detached) {
+        // The parent was created for this file as well
+        parent->children.append(node);
+    } else {
+        *detached = node;
+    }
+    return node;
+}
+
+void ProjectTreeModel::insertNode(ProjectTreeNode *parent, ProjectTreeNode *node)
+{
+    if (!parent->fetched) {
+        parent->children.append(node);
+        return;
+    }
+
+    const int row = insertionRow(parent, node);
+    beginInsertRows(indexOfNode(parent), row, row);
+    parent->children.insert(row, node);
+    endInsertRows();
+}
+
+void ProjectTreeModel::removeNode(ProjectTreeNode *node)
+{
+    ProjectTreeNode *parent = node->parent;
+    if (parent->fetched) {
+        const int row = rowOfNode(node);
+        beginRemoveRows(indexOfNode(parent), row, row);
+        parent->children.removeAt(row);
+        endRemoveRows();
+    } else {
+        parent->children.removeOne(node);
+    }
+
+    forgetNode(node);
+    delete node;
+}
+
+void ProjectTreeModel::forgetNode(ProjectTreeNode *node)
+{
+    m_nodes.remove(node->path);
+    for (ProjectTreeNode *child : node->children) {
+        forgetNode(child);
+    }
+}
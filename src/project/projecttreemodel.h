@@ -0,0 +1,67 @@
+#ifndef PROJECTTREEMODEL_H
+#define PROJECTTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+struct ProjectTreeNode;
+
+// Project explorer model built from the scanner's file batches. Additions
+// and removals are applied as row deltas, and a directory exposes its
+// children to views only once it is expanded (canFetchMore/fetchMore), so
+// huge projects cost nothing until they are browsed.
+class ProjectTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole,
+        IsDirectoryRole
+    };
+
+    explicit ProjectTreeModel(QObject *parent = nullptr);
+    ~ProjectTreeModel();
+
+    // Replaces the model with an empty tree for projectPath; an empty path
+    // clears it.
+    void setRootPath(const QString &projectPath);
+    QModelIndex rootIndex() const;
+
+    // Applies a ProjectManager::filesChanged delta
+    void applyChanges(const QStringList &added, const QStringList &removed);
+    void addFiles(const QStringList &filePaths);
+    void removeFile(const QString &filePath);
+
+    QString filePath(const QModelIndex &index) const;
+    bool isDirectory(const QModelIndex &index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    ProjectTreeNode *nodeFromIndex(const QModelIndex &index) const;
+    QModelIndex indexOfNode(ProjectTreeNode *node) const;
+    int rowOfNode(const ProjectTreeNode *node) const;
+    int insertionRow(const ProjectTreeNode *parent, const ProjectTreeNode *node) const;
+
+    ProjectTreeNode *directoryNode(const QString &dirPath, ProjectTreeNode **detached);
+    void insertNode(ProjectTreeNode *parent, ProjectTreeNode *node);
+    void removeNode(ProjectTreeNode *node);
+    void forgetNode(ProjectTreeNode *node);
+
+    ProjectTreeNode *m_invisibleRoot;
+    ProjectTreeNode *m_projectNode;
+    QHash<QString, ProjectTreeNode*> m_nodes;
+};
+
+#endif // PROJECTTREEMODEL_H
@@ -0,0 +1,335 @@
+#include "projectwatcher.h"
+
+#include <QFile>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <QFileSystemWatcher>
+#endif
+
+#ifdef Q_OS_LINUX
+
+namespace {
+
+// Entry changes and finished writes inside the directory, and the
+// directory itself going away. IN_CLOSE_WRITE instead of IN_MODIFY reports
+// a save once rather than once per write() call.
+const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+                          | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+const size_t kEventBufferSize = 64 * 1024;
+
+} // namespace
+
+class InotifyThread : public QThread
+{
+public:
+    InotifyThread(ProjectWatcher *watcher, int generation);
+    ~InotifyThread();
+
+    bool isValid() const { return m_inotifyFd >= 0 && m_wakeFd >= 0; }
+
+    // Watches are added on the thread; this only queues the paths
+    void addDirectories(const QStringList &directories);
+
+protected:
+    void run() override;
+
+private:
+    void wake();
+    void addPendingWatches();
+    void readEvents();
+    void post(const QStringList &directories, const QStringList &files, bool overflowed, bool countChanged);
+
+    ProjectWatcher *m_watcher;
+    const int m_generation;
+    int m_inotifyFd;
+    int m_wakeFd;
+    QAtomicInt m_stopped;
+
+    QMutex m_mutex;
+    QStringList m_pending;
+
+    // Only touched by the thread
+    QHash<int, QString> m_paths;
+    QSet<QString> m_watched;
+    bool m_limitReached;
+    bool m_limitReported;
+};
+
+InotifyThread::InotifyThread(ProjectWatcher *watcher, int generation)
+    : m_watcher(watcher)
+    , m_generation(generation)
+    , m_inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_stopped(0)
+    , m_limitReached(false)
+    , m_limitReported(false)
+{
+}
+
+InotifyThread::~InotifyThread()
+{
+    m_stopped.storeRelease(1);
+    wake();
+    wait();
+
+    // Closing the descriptor drops every watch at once
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+}
+
+void InotifyThread::addDirectories(const QStringList &directories)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pending.append(directories);
+    }
+    wake();
+}
+
+void InotifyThread::wake()
+{
+    if (m_wakeFd >= 0) {
+        const quint64 one = 1;
+        const ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        Q_UNUSED(written)
+    }
+}
+
+void InotifyThread::run()
+{
+    pollfd fds[2];
+    fds[0].fd = m_inotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd;
+    fds[1].events = POLLIN;
+
+    while (!m_stopped.loadAcquire()) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qWarning() << "ProjectWatcher: poll failed:" << qt_error_string(errno);
+            return;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            quint64 value;
+            const ssize_t length = ::read(m_wakeFd, &value, sizeof(value));
+            Q_UNUSED(length)
+            if (m_stopped.loadAcquire()) {
+                return;
+            }
+            addPendingWatches();
+        }
+        if (fds[0].revents & POLLIN) {
+            readEvents();
+        }
+    }
+}
+
+void InotifyThread::addPendingWatches()
+{
+    QStringList paths;
+    {
+        QMutexLocker locker(&m_mutex);
+        paths.swap(m_pending);
+    }
+
+    const int countBefore = m_paths.size();
+    for (const QString &path : paths) {
+        if (m_watched.contains(path)) {
+            continue;
+        }
+
+        const int wd = inotify_add_watch(m_inotifyFd, QFile::encodeName(path).constData(), kWatchMask);
+        if (wd < 0) {
+            // ENOSPC: fs.inotify.max_user_watches is exhausted
+            if (errno == ENOSPC) {
+                m_limitReached = true;
+            }
+            continue;
+        }
+        m_paths.insert(wd, path);
+        m_watched.insert(path);
+    }
+
+    post(QStringList(), QStringList(), false, m_paths.size() != countBefore);
+}
+
+void InotifyThread::readEvents()
+{
+    alignas(inotify_event) char buffer[kEventBufferSize];
+
+    QSet<QString> directories;
+    QSet<QString> files;
+    bool overflowed = false;
+    const int countBefore = m_paths.size();
+
+    for (;;) {
+        const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (const char *p = buffer; p < buffer + length;) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_watched.remove(m_paths.take(event->wd));
+                continue;
+            }
+
+            const QString directory = m_paths.value(event->wd);
+            if (directory.isEmpty()) {
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // A moved directory keeps its watch under a stale path
+                if (event->mask & IN_MOVE_SELF) {
+                    inotify_rm_watch(m_inotifyFd, event->wd);
+                }
+                directories.insert(directory);
+            } else if ((event->mask & IN_CLOSE_WRITE) && event->len > 0) {
+                files.insert(directory + '/' + QFile::decodeName(event->name));
+            } else {
+                directories.insert(directory);
+            }
+        }
+    }
+
+    post(directories.values(), files.values(), overflowed, m_paths.size() != countBefore);
+}
+
+void InotifyThread::post(const QStringList &directories, const QStringList &files, bool overflowed, bool countChanged)
+{
+    const bool limitReached = m_limitReached && !m_limitReported;
+    m_limitReported = m_limitReached;
+    if (directories.isEmpty() && files.isEmpty() && !overflowed && !countChanged && !limitReached) {
+        return;
+    }
+
+    ProjectWatcher *watcher = m_watcher;
+    const int generation = m_generation;
+    const int watchCount = countChanged || limitReached ? m_paths.size() : -1;
+    QMetaObject::invokeMethod(watcher, [=] {
+        watcher->deliver(generation, directories, files, overflowed, watchCount, limitReached);
+    }, Qt::QueuedConnection);
+}
+
+#endif // Q_OS_LINUX
+
+ProjectWatcher::ProjectWatcher(QObject *parent)
+    : QObject(parent)
+#ifdef Q_OS_LINUX
+    , m_thread(nullptr)
+#else
+    , m_watcher(new QFileSystemWatcher(this))
+#endif
+    , m_watchCount(0)
+    , m_generation(0)
+{
+#ifndef Q_OS_LINUX
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &path) {
+        emit changed(QStringList() << path, QStringList());
+    });
+#endif
+}
+
+ProjectWatcher::~ProjectWatcher()
+{
+#ifdef Q_OS_LINUX
+    delete m_thread;
+#endif
+}
+
+void ProjectWatcher::addDirectories(const QStringList &directories)
+{
+    if (directories.isEmpty()) {
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    if (!m_thread) {
+        m_thread = new InotifyThread(this, m_generation);
+        if (!m_thread->isValid()) {
+            qWarning() << "ProjectWatcher: could not initialize inotify:" << qt_error_string(errno);
+        }
+        m_thread->start();
+    }
+    m_thread->addDirectories(directories);
+#else
+    m_watcher->addPaths(directories);
+    setWatchCount(m_watcher->directories().size());
+#endif
+}
+
+void ProjectWatcher::clear()
+{
+    // Events already on their way belong to the old generation
+    ++m_generation;
+
+#ifdef Q_OS_LINUX
+    delete m_thread;
+    m_thread = nullptr;
+#else
+    if (!m_watcher->directories().isEmpty()) {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+#endif
+
+    setWatchCount(0);
+}
+
+void ProjectWatcher::deliver(int generation, const QStringList &directories, const QStringList &files,
+                             bool queueOverflowed, int watchCount, bool limitReached)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (watchCount >= 0) {
+        setWatchCount(watchCount);
+    }
+    if (limitReached) {
+        emit watchLimitReached(watchCount);
+    }
+    if (queueOverflowed) {
+        emit overflowed();
+    }
+    if (!directories.isEmpty() || !files.isEmpty()) {
+        emit changed(directories, files);
+    }
+}
+
+void ProjectWatcher::setWatchCount(int count)
+{
+    if (count != m_watchCount) {
+        m_watchCount = count;
+        emit watchCountChanged(count);
+    }
+}
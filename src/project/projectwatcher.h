@@ -0,0 +1,53 @@
+#ifndef PROJECTWATCHER_H
+#define PROJECTWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class InotifyThread;
+
+// Watches project directories, never individual files. On Linux it reads
+// raw inotify events on its own thread: one watch per directory, writes to
+// files are reported through their directory's watch, and adding watches
+// never blocks the GUI thread. Other platforms fall back to
+// QFileSystemWatcher on the same directories.
+class ProjectWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProjectWatcher(QObject *parent = nullptr);
+    ~ProjectWatcher();
+
+    void addDirectories(const QStringList &directories);
+    void clear();
+
+    int watchCount() const { return m_watchCount; }
+
+signals:
+    // Directories whose entries changed or which are gone, and files that
+    // were written and closed
+    void changed(const QStringList &directories, const QStringList &files);
+    // The kernel queue overflowed and events were lost
+    void overflowed();
+    void watchCountChanged(int count);
+    void watchLimitReached(int count);
+
+private:
+    friend class InotifyThread;
+    void deliver(int generation, const QStringList &directories, const QStringList &files,
+                 bool queueOverflowed, int watchCount, bool limitReached);
+    void setWatchCount(int count);
+
+#ifdef Q_OS_LINUX
+    InotifyThread *m_thread;
+#else
+    QFileSystemWatcher *m_watcher;
+#endif
+    int m_watchCount;
+    int m_generation;
+};
+
+#endif // PROJECTWATCHER_H
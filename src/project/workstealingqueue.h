@@ -0,0 +1,147 @@
+#ifndef WORKSTEALINGQUEUE_H
+#define WORKSTEALINGQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+#include <deque>
+#include <vector>
+
+// Per-worker task deques for a fixed set of pool workers. A worker takes
+// from the back of its own deque, depth-first, and steals the oldest entry
+// of another deque when it runs dry; for directory walks that tends to be
+// the largest subtree. Workers with nothing to do sleep until a task is
+// queued, and all of them return once every task is done or the queue is
+// cancelled.
+//
+// The queue starts with one pending seed, so workers do not finish before
+// the first tasks are queued; whoever queues them calls taskDone() once
+// after that.
+template <typename Task>
+class WorkStealingQueue
+{
+public:
+    explicit WorkStealingQueue(int workerCount)
+        : m_deques(workerCount)
+        , m_pending(1)
+        , m_queued(0)
+        , m_sleepers(0)
+        , m_cancelled(0)
+    {
+    }
+
+    int workerCount() const { return int(m_deques.size()); }
+
+    void push(int worker, Task task)
+    {
+        m_pending.ref();
+        {
+            Deque &deque = m_deques[worker];
+            QMutexLocker locker(&deque.mutex);
+            deque.tasks.push_back(std::move(task));
+        }
+
+        // Both counters use full barriers, so either this sees the sleeper
+        // or the sleeper sees the task
+        m_queued.fetchAndAddOrdered(1);
+        if (m_sleepers.fetchAndAddOrdered(0) > 0) {
+            QMutexLocker locker(&m_idleMutex);
+            m_workAvailable.wakeOne();
+        }
+    }
+
+    // Returns false once all work is done or the queue is cancelled.
+    // onIdle runs before the worker goes to sleep, e.g. to hand over a
+    // partial batch of results.
+    template <typename IdleFunction>
+    bool take(int worker, Task *task, IdleFunction onIdle)
+    {
+        while (!isCancelled()) {
+            if (pop(worker, task) || steal(worker, task)) {
+                m_queued.deref();
+                return true;
+            }
+            if (m_pending.loadAcquire() == 0) {
+                return false;
+            }
+
+            onIdle();
+
+            QMutexLocker locker(&m_idleMutex);
+            m_sleepers.fetchAndAddOrdered(1);
+            while (m_queued.fetchAndAddOrdered(0) == 0 && m_pending.loadAcquire() != 0 && !isCancelled()) {
+                m_workAvailable.wait(&m_idleMutex);
+            }
+            m_sleepers.fetchAndAddOrdered(-1);
+        }
+        return false;
+    }
+
+    // Called once per task after it has been worked on, and once for the seed
+    void taskDone()
+    {
+        if (!m_pending.deref()) {
+            wakeAll();
+        }
+    }
+
+    void cancel()
+    {
+        m_cancelled.storeRelease(1);
+        wakeAll();
+    }
+
+    bool isCancelled() const { return m_cancelled.loadAcquire(); }
+
+private:
+    struct Deque
+    {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(int worker, Task *task)
+    {
+        Deque &deque = m_deques[worker];
+        QMutexLocker locker(&deque.mutex);
+        if (deque.tasks.empty()) {
+            return false;
+        }
+        *task = std::move(deque.tasks.back());
+        deque.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int worker, Task *task)
+    {
+        const int count = workerCount();
+        for (int i = 1; i < count; ++i) {
+            Deque &deque = m_deques[(worker + i) % count];
+            QMutexLocker locker(&deque.mutex);
+            if (!deque.tasks.empty()) {
+                *task = std::move(deque.tasks.front());
+                deque.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void wakeAll()
+    {
+        QMutexLocker locker(&m_idleMutex);
+        m_workAvailable.wakeAll();
+    }
+
+    std::vector<Deque> m_deques;
+    QAtomicInt m_pending;   // tasks queued or being worked on, plus the seed
+    QAtomicInt m_queued;    // tasks sitting in a deque
+    QAtomicInt m_sleepers;
+    QAtomicInt m_cancelled;
+    QMutex m_idleMutex;
+    QWaitCondition m_workAvailable;
+};
+
+#endif // WORKSTEALINGQUEUE_H
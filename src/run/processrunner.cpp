@@ -0,0 +1,240 @@
+#include "processrunner.h"
+#include "util/processgroup.h"
+
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTimer>
+#include <QFile>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int kOutputFlushInterval = 50;
+
+// Output that reaches the console per flush, about 1.3 MB/s; a program
+// printing faster than that loses the excess
+const int kMaxOutputPerFlush = 64 * 1024;
+
+const int kSampleInterval = 500;
+
+// Time a stopped program gets to exit before it is killed
+const int kStopGracePeriod = 3000;
+
+#ifdef Q_OS_LINUX
+// CPU time (user + system) and resident set size of one process
+bool readProcessStat(qint64 pid, qint64 *cpuMs, qint64 *rssBytes)
+{
+    QFile file(QString("/proc/%1/stat").arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray stat = file.readAll();
+
+    // The command name is in parentheses and may contain anything, so the
+    // fields are counted from its end: utime, stime and rss are fields 14,
+    // 15 and 24, and field 3 follows the parenthesis
+    const int nameEnd = stat.lastIndexOf(')');
+    if (nameEnd < 0) {
+        return false;
+    }
+    const QList<QByteArray> fields = stat.mid(nameEnd + 2).split(' ');
+    if (fields.size() < 22) {
+        return false;
+    }
+
+    static const long ticksPerSecond = ::sysconf(_SC_CLK_TCK);
+    static const long pageSize = ::sysconf(_SC_PAGESIZE);
+    *cpuMs = (fields.at(11).toLongLong() + fields.at(12).toLongLong()) * 1000 / qMax(1L, ticksPerSecond);
+    *rssBytes = fields.at(21).toLongLong() * pageSize;
+    return true;
+}
+#endif
+
+} // namespace
+
+ProcessRunner::ProcessRunner(QObject *parent)
+    : QObject(parent)
+    , m_process(nullptr)
+    , m_flushTimer(new QTimer(this))
+    , m_sampleTimer(new QTimer(this))
+    , m_killTimer(new QTimer(this))
+    , m_droppedBytes(0)
+    , m_stopped(false)
+    , m_lastSampleWallMs(0)
+    , m_lastSampleCpuMs(0)
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kOutputFlushInterval);
+    connect(m_flushTimer, &QTimer::timeout, this, &ProcessRunner::flushOutput);
+
+    m_sampleTimer->setInterval(kSampleInterval);
+    connect(m_sampleTimer, &QTimer::timeout, this, &ProcessRunner::sample);
+
+    m_killTimer->setSingleShot(true);
+    m_killTimer->setInterval(kStopGracePeriod);
+    connect(m_killTimer, &QTimer::timeout, this, [this]() {
+        if (m_process) {
+            signalProcessGroup(m_process, true);
+        }
+    });
+}
+
+ProcessRunner::~ProcessRunner()
+{
+    if (m_process) {
+        m_process->disconnect(this);
+        signalProcessGroup(m_process, true);
+        m_process->waitForFinished(1000);
+    }
+}
+
+void ProcessRunner::start(const RunConfiguration &configuration)
+{
+    if (m_process) {
+        return;
+    }
+
+    m_configuration = configuration;
+    m_stopped = false;
+    m_pendingOutput.clear();
+    m_droppedBytes = 0;
+    m_decoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+    m_stats = RunStats();
+    m_lastSampleWallMs = 0;
+    m_lastSampleCpuMs = 0;
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    for (const QString &entry : configuration.environment) {
+        const int separator = entry.indexOf('=');
+        if (separator > 0) {
+            environment.insert(entry.left(separator), entry.mid(separator + 1));
+        }
+    }
+
+    // Programs that fork get stopped together with their children
+    m_process = new ProcessGroupProcess(this);
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    m_process->setWorkingDirectory(configuration.effectiveWorkingDirectory());
+    m_process->setProcessEnvironment(environment);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &ProcessRunner::readOutput);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus exitStatus) {
+        onFinished(exitCode, exitStatus == QProcess::CrashExit);
+    });
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        // Nothing else is reported for a program that never ran
+        if (error == QProcess::FailedToStart) {
+            const QString reason = m_process->errorString();
+            m_sampleTimer->stop();
+            m_process->deleteLater();
+            m_process = nullptr;
+            emit failed(QString("Could not start %1: %2").arg(m_configuration.executable, reason));
+        }
+    });
+
+    QString commandLine = m_configuration.executable;
+    if (!configuration.arguments.isEmpty()) {
+        commandLine += ' ' + RunConfiguration::joinArguments(configuration.arguments);
+    }
+    emit started(commandLine);
+
+    m_wallTimer.start();
+    m_sampleTimer->start();
+    m_process->start(configuration.executable, configuration.arguments);
+}
+
+void ProcessRunner::stop()
+{
+    if (!m_process || m_stopped) {
+        return;
+    }
+    m_stopped = true;
+    signalProcessGroup(m_process, false);
+    m_killTimer->start();
+}
+
+void ProcessRunner::readOutput()
+{
+    // The pipe is always drained, or the program would block on it; what
+    // does not fit in this period's budget is only counted
+    const QByteArray data = m_process->readAllStandardOutput();
+    const int room = qMax(0, kMaxOutputPerFlush - m_pendingOutput.size());
+    if (data.size() <= room) {
+        m_pendingOutput += data;
+    } else {
+        m_pendingOutput += data.left(room);
+        m_droppedBytes += data.size() - room;
+    }
+
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void ProcessRunner::flushOutput()
+{
+    QString text;
+    if (!m_pendingOutput.isEmpty()) {
+        // Partial lines go out too, for prompts; the decoder keeps a UTF-8
+        // sequence split between reads
+        text = m_decoder->toUnicode(m_pendingOutput);
+        m_pendingOutput.clear();
+    }
+    if (m_droppedBytes > 0) {
+        if (!text.isEmpty() && !text.endsWith('\n')) {
+            text += '\n';
+        }
+        text += QString("[... %1 KB of output dropped ...]\n").arg((m_droppedBytes + 1023) / 1024);
+        m_droppedBytes = 0;
+    }
+    if (!text.isEmpty()) {
+        emit outputReady(text);
+    }
+}
+
+void ProcessRunner::sample()
+{
+    m_stats.wallMs = m_wallTimer.elapsed();
+
+#ifdef Q_OS_LINUX
+    qint64 cpuMs = 0;
+    qint64 rssBytes = 0;
+    if (m_process && readProcessStat(m_process->processId(), &cpuMs, &rssBytes)) {
+        const qint64 wallDelta = m_stats.wallMs - m_lastSampleWallMs;
+        if (wallDelta > 0) {
+            m_stats.cpuPercent = 100.0 * double(cpuMs - m_lastSampleCpuMs) / double(wallDelta);
+        }
+        m_stats.cpuMs = cpuMs;
+        m_stats.rssBytes = rssBytes;
+        m_stats.peakRssBytes = qMax(m_stats.peakRssBytes, rssBytes);
+        m_lastSampleWallMs = m_stats.wallMs;
+        m_lastSampleCpuMs = cpuMs;
+    }
+#endif
+
+    emit statsUpdated(m_stats);
+}
+
+void ProcessRunner::onFinished(int exitCode, bool crashed)
+{
+    readOutput();
+    m_flushTimer->stop();
+    flushOutput();
+
+    // The process is gone from /proc by now; CPU and memory are as of the
+    // last sample
+    m_sampleTimer->stop();
+    m_killTimer->stop();
+    m_stats.wallMs = m_wallTimer.elapsed();
+    m_stats.cpuPercent = 0.0;
+    m_stats.rssBytes = 0;
+
+    m_process->deleteLater();
+    m_process = nullptr;
+    emit finished(exitCode, crashed, m_stopped, m_stats);
+}
@@ -0,0 +1,77 @@
+#ifndef PROCESSRUNNER_H
+#define PROCESSRUNNER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+
+#include "runconfiguration.h"
+
+class QProcess;
+class QTimer;
+class QTextDecoder;
+
+// A sample of the running program, from /proc on Linux
+struct RunStats
+{
+    qint64 wallMs = 0;
+    qint64 cpuMs = 0;          // user + system time so far
+    double cpuPercent = 0.0;   // over the last sample period; 100 is one core
+    qint64 rssBytes = 0;
+    qint64 peakRssBytes = 0;
+};
+
+// Runs one program at a time for the IDE and watches it. Its CPU time and
+// resident memory are sampled while it runs, and its output is passed on
+// at a bounded rate: past the budget for a flush period the rest of what
+// was read is dropped and reported as such, so a program printing in a
+// tight loop cannot flood the UI. The program runs in its own process
+// group and stop() ends the whole group.
+class ProcessRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProcessRunner(QObject *parent = nullptr);
+    ~ProcessRunner();
+
+    bool isRunning() const { return m_process != nullptr; }
+    const RunConfiguration &configuration() const { return m_configuration; }
+    RunStats stats() const { return m_stats; }
+
+    void start(const RunConfiguration &configuration);
+    void stop();
+
+signals:
+    void started(const QString &commandLine);
+    void outputReady(const QString &text);
+    void statsUpdated(const RunStats &stats);
+    void finished(int exitCode, bool crashed, bool stopped, const RunStats &stats);
+    void failed(const QString &message);
+
+private slots:
+    void readOutput();
+    void flushOutput();
+    void sample();
+
+private:
+    void onFinished(int exitCode, bool crashed);
+
+    RunConfiguration m_configuration;
+    QProcess *m_process;
+    QTimer *m_flushTimer;
+    QTimer *m_sampleTimer;
+    QTimer *m_killTimer;
+    QScopedPointer<QTextDecoder> m_decoder;
+    QByteArray m_pendingOutput;
+    qint64 m_droppedBytes;
+    bool m_stopped;
+
+    QElapsedTimer m_wallTimer;
+    RunStats m_stats;
+    qint64 m_lastSampleWallMs;
+    qint64 m_lastSampleCpuMs;
+};
+
+#endif // PROCESSRUNNER_H
@@ -0,0 +1,131 @@
+#include "runconfiguration.h"
+#include "util/projectpaths.h"
+
+#include <QSettings>
+#include <QFileInfo>
+
+namespace {
+
+QString settingsGroup(const QString &projectPath)
+{
+    return "runConfigurations/" + projectKey(projectPath);
+}
+
+} // namespace
+
+QString RunConfiguration::effectiveWorkingDirectory() const
+{
+    if (!workingDirectory.isEmpty()) {
+        return workingDirectory;
+    }
+    return QFileInfo(executable).absolutePath();
+}
+
+QStringList RunConfiguration::splitArguments(const QString &line)
+{
+    QStringList arguments;
+    QString current;
+    bool inArgument = false;
+    QChar quote;
+
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line.at(i);
+        if (!quote.isNull()) {
+            if (c == quote) {
+                quote = QChar();
+            } else if (c == '\\' && quote == '"' && i + 1 < line.size()
+                       && (line.at(i + 1) == '"' || line.at(i + 1) == '\\')) {
+                current += line.at(++i);
+            } else {
+                current += c;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            inArgument = true;
+        } else if (c == '\\' && i + 1 < line.size()) {
+            current += line.at(++i);
+            inArgument = true;
+        } else if (c.isSpace()) {
+            if (inArgument) {
+                arguments.append(current);
+                current.clear();
+                inArgument = false;
+            }
+        } else {
+            current += c;
+            inArgument = true;
+        }
+    }
+    if (inArgument) {
+        arguments.append(current);
+    }
+    return arguments;
+}
+
+QString RunConfiguration::joinArguments(const QStringList &arguments)
+{
+    QStringList quoted;
+    for (QString argument : arguments) {
+        bool plain = !argument.isEmpty();
+        for (const QChar c : argument) {
+            if (c.isSpace() || c == '"' || c == '\'' || c == '\\') {
+                plain = false;
+                break;
+            }
+        }
+        if (!plain) {
+            argument.replace('\\', "\\\\").replace('"', "\\\"");
+            argument = '"' + argument + '"';
+        }
+        quoted.append(argument);
+    }
+    return quoted.join(' ');
+}
+
+QVector<RunConfiguration> RunConfiguration::load(const QString &projectPath, int *currentIndex)
+{
+    QSettings settings;
+    settings.beginGroup(settingsGroup(projectPath));
+
+    QVector<RunConfiguration> configurations;
+    const int count = settings.beginReadArray("configurations");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        RunConfiguration configuration;
+        configuration.name = settings.value("name").toString();
+        configuration.executable = settings.value("executable").toString();
+        configuration.arguments = settings.value("arguments").toStringList();
+        configuration.environment = settings.value("environment").toStringList();
+        configuration.workingDirectory = settings.value("workingDirectory").toString();
+        configurations.append(configuration);
+    }
+    settings.endArray();
+
+    if (currentIndex) {
+        *currentIndex = qBound(-1, settings.value("current", 0).toInt(), configurations.size() - 1);
+    }
+    settings.endGroup();
+    return configurations;
+}
+
+void RunConfiguration::save(const QString &projectPath, const QVector<RunConfiguration> &configurations, int currentIndex)
+{
+    QSettings settings;
+    settings.remove(settingsGroup(projectPath));
+    settings.beginGroup(settingsGroup(projectPath));
+
+    settings.beginWriteArray("configurations", configurations.size());
+    for (int i = 0; i < configurations.size(); ++i) {
+        const RunConfiguration &configuration = configurations.at(i);
+        settings.setArrayIndex(i);
+        settings.setValue("name", configuration.name);
+        settings.setValue("executable", configuration.executable);
+        settings.setValue("arguments", configuration.arguments);
+        settings.setValue("environment", configuration.environment);
+        settings.setValue("workingDirectory", configuration.workingDirectory);
+    }
+    settings.endArray();
+
+    settings.setValue("current", currentIndex);
+    settings.endGroup();
+}
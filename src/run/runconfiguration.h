@@ -0,0 +1,30 @@
+#ifndef RUNCONFIGURATION_H
+#define RUNCONFIGURATION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// How to launch a program from the IDE
+struct RunConfiguration
+{
+    QString name;
+    QString executable;
+    QStringList arguments;
+    QStringList environment;   // NAME=value, on top of the IDE's own
+    QString workingDirectory;  // empty: the executable's directory
+
+    bool isValid() const { return !executable.isEmpty(); }
+    QString effectiveWorkingDirectory() const;
+
+    // Shell-like splitting and quoting of an argument line
+    static QStringList splitArguments(const QString &line);
+    static QString joinArguments(const QStringList &arguments);
+
+    // Configurations are stored per project in the user settings, with the
+    // index of the one Run starts
+    static QVector<RunConfiguration> load(const QString &projectPath, int *currentIndex);
+    static void save(const QString &projectPath, const QVector<RunConfiguration> &configurations, int currentIndex);
+};
+
+#endif // RUNCONFIGURATION_H
@@ -0,0 +1,208 @@
+#include "runconfigurationdialog.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QListWidget>
+#include <QLineEdit>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFileInfo>
+
+RunConfigurationDialog::RunConfigurationDialog(const QString &projectPath, QWidget *parent)
+    : QDialog(parent)
+    , m_projectPath(projectPath)
+    , m_editedRow(-1)
+{
+    setWindowTitle("Run Configurations");
+
+    m_list = new QListWidget();
+    QPushButton *addButton = new QPushButton("Add");
+    m_removeButton = new QPushButton("Remove");
+
+    QHBoxLayout *listButtons = new QHBoxLayout();
+    listButtons->addWidget(addButton);
+    listButtons->addWidget(m_removeButton);
+
+    QVBoxLayout *listLayout = new QVBoxLayout();
+    listLayout->addWidget(m_list, 1);
+    listLayout->addLayout(listButtons);
+
+    m_nameEdit = new QLineEdit();
+    m_executableEdit = new QLineEdit();
+    QPushButton *browseExecutableButton = new QPushButton("Browse...");
+    QHBoxLayout *executableLayout = new QHBoxLayout();
+    executableLayout->addWidget(m_executableEdit, 1);
+    executableLayout->addWidget(browseExecutableButton);
+
+    m_argumentsEdit = new QLineEdit();
+    m_argumentsEdit->setPlaceholderText("Quoted like a shell: --name \"two words\"");
+
+    m_workingDirectoryEdit = new QLineEdit();
+    m_workingDirectoryEdit->setPlaceholderText("The executable's directory");
+    QPushButton *browseDirectoryButton = new QPushButton("Browse...");
+    QHBoxLayout *directoryLayout = new QHBoxLayout();
+    directoryLayout->addWidget(m_workingDirectoryEdit, 1);
+    directoryLayout->addWidget(browseDirectoryButton);
+
+    m_environmentEdit = new QPlainTextEdit();
+    m_environmentEdit->setPlaceholderText("NAME=value, one per line");
+    m_environmentEdit->setTabChangesFocus(true);
+
+    QFormLayout *form = new QFormLayout();
+    form->addRow("Name:", m_nameEdit);
+    form->addRow("Executable:", executableLayout);
+    form->addRow("Arguments:", m_argumentsEdit);
+    form->addRow("Working directory:", directoryLayout);
+    form->addRow("Environment:", m_environmentEdit);
+
+    QHBoxLayout *editLayout = new QHBoxLayout();
+    editLayout->addLayout(listLayout);
+    editLayout->addLayout(form, 1);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    m_okButton = buttons->button(QDialogButtonBox::Ok);
+    m_okButton->setText("Run");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(editLayout, 1);
+    layout->addWidget(buttons);
+
+    connect(addButton, &QPushButton::clicked, this, &RunConfigurationDialog::addConfiguration);
+    connect(m_removeButton, &QPushButton::clicked, this, &RunConfigurationDialog::removeConfiguration);
+    connect(m_list, &QListWidget::currentRowChanged, this, &RunConfigurationDialog::onCurrentRowChanged);
+    connect(browseExecutableButton, &QPushButton::clicked, this, &RunConfigurationDialog::browseExecutable);
+    connect(browseDirectoryButton, &QPushButton::clicked, this, &RunConfigurationDialog::browseWorkingDirectory);
+    connect(m_executableEdit, &QLineEdit::textChanged, this, &RunConfigurationDialog::updateAcceptable);
+    connect(m_nameEdit, &QLineEdit::textChanged, this, [this](const QString &name) {
+        if (QListWidgetItem *item = m_list->currentItem()) {
+            item->setText(name.isEmpty() ? "(unnamed)" : name);
+        }
+    });
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    onCurrentRowChanged(-1);
+    resize(720, 420);
+}
+
+void RunConfigurationDialog::setConfigurations(const QVector<RunConfiguration> &configurations, int currentIndex)
+{
+    m_editedRow = -1;
+    m_configurations = configurations;
+    m_list->clear();
+    for (const RunConfiguration &configuration : configurations) {
+        m_list->addItem(configuration.name.isEmpty() ? "(unnamed)" : configuration.name);
+    }
+    if (configurations.isEmpty()) {
+        addConfiguration();
+    } else {
+        m_list->setCurrentRow(qBound(0, currentIndex, configurations.size() - 1));
+    }
+}
+
+QVector<RunConfiguration> RunConfigurationDialog::configurations()
+{
+    storeEdits();
+    return m_configurations;
+}
+
+int RunConfigurationDialog::currentIndex() const
+{
+    return m_list->currentRow();
+}
+
+void RunConfigurationDialog::storeEdits()
+{
+    if (m_editedRow < 0 || m_editedRow >= m_configurations.size()) {
+        return;
+    }
+
+    RunConfiguration &configuration = m_configurations[m_editedRow];
+    configuration.name = m_nameEdit->text().trimmed();
+    configuration.executable = m_executableEdit->text().trimmed();
+    configuration.arguments = RunConfiguration::splitArguments(m_argumentsEdit->text());
+    configuration.workingDirectory = m_workingDirectoryEdit->text().trimmed();
+    configuration.environment.clear();
+    for (const QString &line : m_environmentEdit->toPlainText().split('\n')) {
+        const QString entry = line.trimmed();
+        if (entry.indexOf('=') > 0) {
+            configuration.environment.append(entry);
+        }
+    }
+}
+
+void RunConfigurationDialog::onCurrentRowChanged(int row)
+{
+    storeEdits();
+    m_editedRow = -1;
+
+    const bool valid = row >= 0 && row < m_configurations.size();
+    const RunConfiguration configuration = valid ? m_configurations.at(row) : RunConfiguration();
+    m_nameEdit->setText(configuration.name);
+    m_executableEdit->setText(configuration.executable);
+    m_argumentsEdit->setText(RunConfiguration::joinArguments(configuration.arguments));
+    m_workingDirectoryEdit->setText(configuration.workingDirectory);
+    m_environmentEdit->setPlainText(configuration.environment.join('\n'));
+
+    for (QWidget *widget : {static_cast<QWidget*>(m_nameEdit), static_cast<QWidget*>(m_executableEdit),
+                            static_cast<QWidget*>(m_argumentsEdit), static_cast<QWidget*>(m_workingDirectoryEdit),
+                            static_cast<QWidget*>(m_environmentEdit)}) {
+        widget->setEnabled(valid);
+    }
+    m_removeButton->setEnabled(valid);
+
+    m_editedRow = valid ? row : -1;
+    updateAcceptable();
+}
+
+void RunConfigurationDialog::addConfiguration()
+{
+    RunConfiguration configuration;
+    configuration.name = QString("Configuration %1").arg(m_configurations.size() + 1);
+    m_configurations.append(configuration);
+    m_list->addItem(configuration.name);
+    m_list->setCurrentRow(m_configurations.size() - 1);
+    m_executableEdit->setFocus();
+}
+
+void RunConfigurationDialog::removeConfiguration()
+{
+    const int row = m_list->currentRow();
+    if (row < 0 || row >= m_configurations.size()) {
+        return;
+    }
+    // Nothing is stored back into the row being removed
+    m_editedRow = -1;
+    m_configurations.remove(row);
+    delete m_list->takeItem(row);
+    onCurrentRowChanged(m_list->currentRow());
+}
+
+void RunConfigurationDialog::browseExecutable()
+{
+    const QString start = m_executableEdit->text().isEmpty() ? m_projectPath : m_executableEdit->text();
+    const QString executable = QFileDialog::getOpenFileName(this, "Executable", start);
+    if (!executable.isEmpty()) {
+        m_executableEdit->setText(executable);
+        if (m_nameEdit->text().startsWith("Configuration ")) {
+            m_nameEdit->setText(QFileInfo(executable).fileName());
+        }
+    }
+}
+
+void RunConfigurationDialog::browseWorkingDirectory()
+{
+    const QString start = m_workingDirectoryEdit->text().isEmpty() ? m_projectPath : m_workingDirectoryEdit->text();
+    const QString directory = QFileDialog::getExistingDirectory(this, "Working Directory", start);
+    if (!directory.isEmpty()) {
+        m_workingDirectoryEdit->setText(directory);
+    }
+}
+
+void RunConfigurationDialog::updateAcceptable()
+{
+    m_okButton->setEnabled(m_editedRow >= 0 && !m_executableEdit->text().trimmed().isEmpty());
+}
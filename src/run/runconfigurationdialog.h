@@ -0,0 +1,52 @@
+#ifndef RUNCONFIGURATIONDIALOG_H
+#define RUNCONFIGURATIONDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+#include "runconfiguration.h"
+
+class QListWidget;
+class QLineEdit;
+class QPlainTextEdit;
+class QPushButton;
+
+// Edits a project's run configurations; the one selected on OK is the one
+// Run starts
+class RunConfigurationDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RunConfigurationDialog(const QString &projectPath, QWidget *parent = nullptr);
+
+    void setConfigurations(const QVector<RunConfiguration> &configurations, int currentIndex);
+    QVector<RunConfiguration> configurations();
+    int currentIndex() const;
+
+private slots:
+    void addConfiguration();
+    void removeConfiguration();
+    void onCurrentRowChanged(int row);
+    void browseExecutable();
+    void browseWorkingDirectory();
+    void updateAcceptable();
+
+private:
+    void storeEdits();
+
+    QString m_projectPath;
+    QVector<RunConfiguration> m_configurations;
+    int m_editedRow;
+
+    QListWidget *m_list;
+    QPushButton *m_removeButton;
+    QLineEdit *m_nameEdit;
+    QLineEdit *m_executableEdit;
+    QLineEdit *m_argumentsEdit;
+    QLineEdit *m_workingDirectoryEdit;
+    QPlainTextEdit *m_environmentEdit;
+    QPushButton *m_okButton;
+};
+
+#endif // RUNCONFIGURATIONDIALOG_H
@@ -0,0 +1,303 @@
+#include "filegrep.h"
+#include "project/workstealingqueue.h"
+#include "project/jobworkers.h"
+
+#include <QFile>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <climits>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Below this size a plain read is cheaper than setting up a mapping
+const qint64 kMapThreshold = 256 * 1024;
+
+// Matches are handed to the GUI thread in batches of this size, or when a
+// worker runs out of work
+const int kMatchBatchSize = 256;
+
+const int kDefaultMaxMatches = 10000;
+const int kMaxWorkers = 16;
+
+QString toQString(const fs::path &path)
+{
+#ifdef Q_OS_WIN
+    return QString::fromStdWString(path.native());
+#else
+    return QFile::decodeName(path.c_str());
+#endif
+}
+
+fs::path toPath(const QString &path)
+{
+#ifdef Q_OS_WIN
+    return fs::path(path.toStdWString());
+#else
+    return fs::path(QFile::encodeName(path).toStdString());
+#endif
+}
+
+bool isVersionControlDirectory(const std::string &name)
+{
+    return name == ".git" || name == ".hg" || name == ".svn";
+}
+
+struct GrepTask
+{
+    fs::path path;
+    bool isDirectory;
+};
+
+} // namespace
+
+struct GrepState
+{
+    GrepState(int workerCount, const QString &pattern, const SearchOptions &options)
+        : matcher(pattern, options)
+        , queue(workerCount)
+        , workers(workerCount)
+        , fileCount(0)
+        , bytesSearched(0)
+    {
+    }
+
+    const TextMatcher matcher;
+    std::vector<GrepTask> starts;
+    WorkStealingQueue<GrepTask> queue;
+    JobWorkers workers;
+    MatchBudget budget;
+    QAtomicInt fileCount;
+    QAtomicInteger<qint64> bytesSearched;
+};
+
+namespace {
+
+void listDirectory(GrepState *state, int index, const fs::path &directory)
+{
+    std::error_code error;
+    fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, error);
+    for (; !error && it != fs::directory_iterator(); it.increment(error)) {
+        if (state->queue.isCancelled()) {
+            return;
+        }
+
+        const fs::directory_entry &entry = *it;
+        std::error_code statusError;
+        const fs::file_status status = entry.symlink_status(statusError);
+        if (statusError) {
+            continue;
+        }
+
+        if (fs::is_directory(status)) {
+            // Directory symlinks are not followed, which also rules out cycles
+            if (!isVersionControlDirectory(entry.path().filename().u8string())) {
+                state->queue.push(index, GrepTask{entry.path(), true});
+            }
+        } else if (fs::is_regular_file(status) || (fs::is_symlink(status) && entry.is_regular_file(statusError))) {
+            state->queue.push(index, GrepTask{entry.path(), false});
+        }
+    }
+}
+
+// Appends the matches of one file to batch; binary files are skipped
+void searchFile(GrepState *state, const fs::path &path, QByteArray *buffer,
+                QVector<LineMatch> *lines, QVector<SearchMatch> *batch)
+{
+    const int budget = state->budget.remaining();
+    if (budget == 0) {
+        state->queue.cancel();
+        return;
+    }
+
+    const QString filePath = toQString(path);
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    qint64 size = file.size();
+    if (size == 0) {
+        return;
+    }
+
+    const char *data = nullptr;
+    uchar *mapped = nullptr;
+    if (size >= kMapThreshold) {
+        mapped = file.map(0, size);
+        if (mapped) {
+#ifdef Q_OS_UNIX
+            // A mapping at offset 0 is page-aligned
+            ::madvise(mapped, size_t(size), MADV_SEQUENTIAL);
+#endif
+            data = reinterpret_cast<const char *>(mapped);
+        }
+    }
+    if (!data) {
+        if (buffer->size() < size) {
+            buffer->resize(int(qMin<qint64>(size, INT_MAX)));
+        }
+        const qint64 length = file.read(buffer->data(), qMin<qint64>(size, buffer->size()));
+        if (length <= 0) {
+            return;
+        }
+        data = buffer->constData();
+        // The file may have shrunk since it was sized
+        size = length;
+    }
+
+    state->fileCount.ref();
+    state->bytesSearched.fetchAndAddRelaxed(size);
+
+    lines->clear();
+    int found = 0;
+    if (!TextMatcher::isBinary(data, size)) {
+        found = state->matcher.findMatches(data, size, lines, budget);
+    }
+    if (mapped) {
+        file.unmap(mapped);
+    }
+    if (found > 0) {
+        state->budget.claim(filePath, *lines, found, batch);
+    }
+}
+
+} // namespace
+
+FileGrep::FileGrep(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+    , m_maxMatches(kDefaultMaxMatches)
+    , m_running(false)
+{
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), kMaxWorkers));
+}
+
+FileGrep::~FileGrep()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool FileGrep::start(const QStringList &paths, const QString &pattern, const SearchOptions &options)
+{
+    // Workers of the old search drain in the background, like the project
+    // scanner's; their posts are dropped by the generation check
+    cancel();
+
+    const int workerCount = m_pool.maxThreadCount();
+    QSharedPointer<GrepState> state(new GrepState(workerCount, pattern, options));
+    if (!state->matcher.isValid()) {
+        emit failed(state->matcher.errorString());
+        return false;
+    }
+    state->budget.setMaxMatches(m_maxMatches);
+
+    for (const QString &path : paths) {
+        std::error_code error;
+        const fs::path start = toPath(path);
+        const fs::file_status status = fs::status(start, error);
+        if (!error && (fs::is_directory(status) || fs::is_regular_file(status))) {
+            state->starts.push_back(GrepTask{start, fs::is_directory(status)});
+        }
+    }
+
+    m_state = state;
+    m_running = true;
+
+    const int generation = m_generation;
+    for (int i = 0; i < workerCount; ++i) {
+        QtConcurrent::run(&m_pool, [this, state, i, generation] { runWorker(state, i, generation); });
+    }
+    return true;
+}
+
+void FileGrep::cancel()
+{
+    if (m_state) {
+        m_state->queue.cancel();
+    }
+    // Batches that are already queued for delivery are dropped as well
+    ++m_generation;
+    m_running = false;
+}
+
+void FileGrep::setMaxMatches(int maxMatches)
+{
+    m_maxMatches = qMax(1, maxMatches);
+}
+
+void FileGrep::runWorker(const QSharedPointer<GrepState> &state, int index, int generation)
+{
+    // Runs on a pool thread. Everything reaches the GUI thread through
+    // post(), which is ignored once the search has been cancelled.
+    if (index == 0) {
+        for (const GrepTask &start : state->starts) {
+            state->queue.push(index, start);
+        }
+        state->queue.taskDone();
+    }
+
+    QByteArray buffer;
+    QVector<LineMatch> lines;
+    QVector<SearchMatch> batch;
+    GrepTask task;
+    // Before sleeping until another worker queues more work, hand over
+    // what we have
+    const auto flush = [&] {
+        if (!batch.isEmpty()) {
+            post(generation, batch);
+            batch.clear();
+        }
+    };
+    while (state->queue.take(index, &task, flush)) {
+        if (task.isDirectory) {
+            listDirectory(state.data(), index, task.path);
+        } else {
+            searchFile(state.data(), task.path, &buffer, &lines, &batch);
+        }
+        state->queue.taskDone();
+
+        if (batch.size() >= kMatchBatchSize) {
+            post(generation, batch);
+            batch.clear();
+        }
+    }
+
+    // Running into the match limit stops the search but still reports it
+    if (state->queue.isCancelled() && !state->budget.isTruncated()) {
+        state->workers.leave();
+        return;
+    }
+
+    if (!batch.isEmpty()) {
+        post(generation, batch);
+    }
+
+    state->workers.finish(this, [this, state, generation] {
+        if (generation == m_generation) {
+            m_running = false;
+            emit finished(state->budget.matchCount(), state->fileCount.loadAcquire(),
+                          state->bytesSearched.loadAcquire(), state->budget.isTruncated());
+        }
+    });
+}
+
+void FileGrep::post(int generation, const QVector<SearchMatch> &matches)
+{
+    QMetaObject::invokeMethod(this, [this, generation, matches] {
+        if (generation == m_generation) {
+            emit matchesFound(matches);
+        }
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,54 @@
+#ifndef FILEGREP_H
+#define FILEGREP_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QThreadPool>
+#include <QSharedPointer>
+
+#include "textmatcher.h"
+
+struct GrepState;
+
+// Brute-force "search in files" over arbitrary directories, for anything
+// the project index does not cover. Directories and files are queued on
+// per-worker deques and stolen by idle workers, so listing and searching
+// overlap and one deep subtree keeps every core busy. Large files are
+// memory-mapped, binary files are skipped, and matches are streamed back
+// in batches.
+class FileGrep : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileGrep(QObject *parent = nullptr);
+    ~FileGrep();
+
+    // Searches every regular file below paths (files are searched as
+    // given). A search that is still running is cancelled first.
+    bool start(const QStringList &paths, const QString &pattern, const SearchOptions &options);
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+    int maxMatches() const { return m_maxMatches; }
+    void setMaxMatches(int maxMatches);
+
+signals:
+    void matchesFound(const QVector<SearchMatch> &matches);
+    void finished(int matchCount, int fileCount, qint64 bytesSearched, bool truncated);
+    void failed(const QString &error);
+
+private:
+    void runWorker(const QSharedPointer<GrepState> &state, int index, int generation);
+    void post(int generation, const QVector<SearchMatch> &matches);
+
+    QThreadPool m_pool;
+    QSharedPointer<GrepState> m_state;
+    int m_generation;
+    int m_maxMatches;
+    bool m_running;
+};
+
+#endif // FILEGREP_H
@@ -0,0 +1,325 @@
+#include "pathindex.h"
+
+#include <QDir>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <climits>
+#include <cstring>
+
+namespace {
+
+// Bit 63 marks a live entry; characters hash into the other 63 bits
+const quint64 kAliveBit = Q_UINT64_C(1) << 63;
+
+// Longer queries are cut; nobody types that much into a file picker
+const int kMaxQueryLength = 64;
+
+// Below this many candidates, splitting the work costs more than it saves
+const int kParallelThreshold = 32768;
+
+// Removed entries stay until they outnumber live ones
+const int kMinCompactDeadCount = 1024;
+
+inline char foldByte(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+inline quint64 charBit(char c)
+{
+    return Q_UINT64_C(1) << (uchar(c) % 63);
+}
+
+inline bool isLowerAscii(char c)
+{
+    return c >= 'a' && c <= 'z';
+}
+
+inline bool isUpperAscii(char c)
+{
+    return c >= 'A' && c <= 'Z';
+}
+
+QByteArray foldQuery(const QString &query)
+{
+    QByteArray result;
+    const QByteArray bytes = query.toUtf8();
+    for (const char c : bytes) {
+        if (c != ' ') {
+            result.append(foldByte(c));
+        }
+    }
+    return result.left(kMaxQueryLength);
+}
+
+// End of the leftmost greedy subsequence match of query in text[from, length),
+// or -1
+int subsequenceEnd(const char *text, int from, int length, const QByteArray &query)
+{
+    int position = from;
+    for (const char c : query) {
+        const void *hit = std::memchr(text + position, c, size_t(length - position));
+        if (!hit) {
+            return -1;
+        }
+        position = int(static_cast<const char *>(hit) - text) + 1;
+    }
+    return position;
+}
+
+struct MatchChunk
+{
+    int begin;
+    int end;
+    QVector<PathIndex::Match> matches;
+};
+
+} // namespace
+
+PathIndex::PathIndex()
+    : m_deadCount(0)
+    , m_revision(0)
+{
+}
+
+void PathIndex::setRootPath(const QString &rootPath)
+{
+    clear();
+    m_rootPath = QDir::cleanPath(rootPath);
+}
+
+void PathIndex::addPaths(const QStringList &paths)
+{
+    const QString prefix = m_rootPath + '/';
+    const int countBefore = m_ids.size();
+    for (const QString &path : paths) {
+        const QString relative = (!m_rootPath.isEmpty() && path.startsWith(prefix)) ? path.mid(prefix.size()) : path;
+        if (relative.isEmpty() || m_ids.contains(relative)) {
+            continue;
+        }
+
+        const QByteArray bytes = relative.toUtf8();
+        Entry entry;
+        entry.offset = quint32(m_text.size());
+        entry.length = quint32(bytes.size());
+        entry.nameOffset = quint32(bytes.lastIndexOf('/') + 1);
+
+        quint64 mask = kAliveBit;
+        for (const char c : bytes) {
+            const char folded = foldByte(c);
+            m_folded.append(folded);
+            mask |= charBit(folded);
+        }
+        m_text.append(bytes);
+
+        m_ids.insert(relative, int(m_entries.size()));
+        m_entries.push_back(entry);
+        m_masks.push_back(mask);
+    }
+
+    // A refined query only looks at earlier matches, which miss new paths
+    if (m_ids.size() != countBefore) {
+        ++m_revision;
+    }
+}
+
+void PathIndex::removePaths(const QStringList &paths)
+{
+    const QString prefix = m_rootPath + '/';
+    for (const QString &path : paths) {
+        const QString relative = (!m_rootPath.isEmpty() && path.startsWith(prefix)) ? path.mid(prefix.size()) : path;
+        const auto it = m_ids.find(relative);
+        if (it == m_ids.end()) {
+            continue;
+        }
+        m_masks[size_t(it.value())] = 0;
+        m_ids.erase(it);
+        ++m_deadCount;
+    }
+
+    if (m_deadCount >= kMinCompactDeadCount && m_deadCount > m_ids.size()) {
+        compact();
+    }
+}
+
+void PathIndex::clear()
+{
+    m_text.clear();
+    m_folded.clear();
+    m_entries.clear();
+    m_masks.clear();
+    m_ids.clear();
+    m_deadCount = 0;
+    ++m_revision;
+}
+
+QString PathIndex::relativePath(int index) const
+{
+    const Entry &entry = m_entries[size_t(index)];
+    return QString::fromUtf8(m_text.constData() + entry.offset, int(entry.length));
+}
+
+QString PathIndex::filePath(int index) const
+{
+    const QString relative = relativePath(index);
+    if (m_rootPath.isEmpty() || QDir::isAbsolutePath(relative)) {
+        return relative;
+    }
+    return m_rootPath + '/' + relative;
+}
+
+QVector<PathIndex::Match> PathIndex::match(const QString &query, const QVector<int> *within) const
+{
+    QVector<Match> matches;
+    const QByteArray folded = foldQuery(query);
+    if (folded.isEmpty()) {
+        return matches;
+    }
+
+    quint64 queryMask = kAliveBit;
+    for (const char c : folded) {
+        queryMask |= charBit(c);
+    }
+
+    const int *indices = within ? within->constData() : nullptr;
+    const int count = within ? within->size() : int(m_entries.size());
+    if (count < kParallelThreshold) {
+        matchRange(folded, queryMask, indices, 0, count, &matches);
+        return matches;
+    }
+
+    // Large candidate sets are split into one range per core
+    const int chunkCount = qMax(1, QThread::idealThreadCount());
+    QVector<MatchChunk> chunks(chunkCount);
+    for (int i = 0; i < chunkCount; ++i) {
+        chunks[i].begin = int(qint64(count) * i / chunkCount);
+        chunks[i].end = int(qint64(count) * (i + 1) / chunkCount);
+    }
+    QtConcurrent::blockingMap(chunks, [this, &folded, queryMask, indices](MatchChunk &chunk) {
+        matchRange(folded, queryMask, indices, chunk.begin, chunk.end, &chunk.matches);
+    });
+
+    for (const MatchChunk &chunk : chunks) {
+        matches += chunk.matches;
+    }
+    return matches;
+}
+
+void PathIndex::matchRange(const QByteArray &query, quint64 queryMask, const int *indices, int begin, int end,
+                           QVector<Match> *matches) const
+{
+    const quint64 *masks = m_masks.data();
+    for (int i = begin; i < end; ++i) {
+        const int index = indices ? indices[i] : i;
+        if ((masks[index] & queryMask) != queryMask) {
+            continue;
+        }
+        const int score = scoreEntry(index, query);
+        if (score != INT_MIN) {
+            matches->append(Match{index, score});
+        }
+    }
+}
+
+// Characters score more at the start of a path component, after a
+// separator and at camelCase humps, and more again when consecutive. A
+// match inside the file name beats one spread over directories, and
+// shorter paths win ties. Returns INT_MIN when the query does not match.
+int PathIndex::scoreEntry(int index, const QByteArray &query) const
+{
+    const Entry &entry = m_entries[size_t(index)];
+    const char *folded = m_folded.constData() + entry.offset;
+    const char *text = m_text.constData() + entry.offset;
+    const int length = int(entry.length);
+    const int nameOffset = int(entry.nameOffset);
+    const int queryLength = query.size();
+
+    int from = nameOffset;
+    int end = subsequenceEnd(folded, from, length, query);
+    const bool inName = end >= 0;
+    if (!inName) {
+        from = 0;
+        end = subsequenceEnd(folded, from, length, query);
+        if (end < 0) {
+            return INT_MIN;
+        }
+    }
+
+    // Walk back from the end of the greedy match for the shortest window
+    int matched[kMaxQueryLength];
+    int q = queryLength - 1;
+    for (int p = end - 1; p >= from && q >= 0; --p) {
+        if (folded[p] == query.at(q)) {
+            matched[q--] = p;
+        }
+    }
+
+    int score = 0;
+    int previous = -2;
+    for (int i = 0; i < queryLength; ++i) {
+        const int p = matched[i];
+        score += 16;
+        if (p == 0 || text[p - 1] == '/') {
+            score += 32;
+        } else if (text[p - 1] == '_' || text[p - 1] == '-' || text[p - 1] == '.' || text[p - 1] == ' ') {
+            score += 24;
+        } else if (isUpperAscii(text[p]) && isLowerAscii(text[p - 1])) {
+            score += 20;
+        }
+
+        if (p == previous + 1) {
+            score += 16;
+        } else if (i > 0) {
+            score -= qMin(p - previous - 1, 12);
+        }
+        previous = p;
+    }
+
+    if (inName) {
+        score += 48;
+        if (matched[0] == nameOffset) {
+            score += 24;
+        }
+    }
+    score -= length / 8;
+    return score;
+}
+
+void PathIndex::compact()
+{
+    QByteArray text;
+    QByteArray folded;
+    std::vector<Entry> entries;
+    std::vector<quint64> masks;
+    text.reserve(m_text.size());
+    folded.reserve(m_folded.size());
+    entries.reserve(size_t(m_ids.size()));
+    masks.reserve(size_t(m_ids.size()));
+
+    QVector<int> newIds(int(m_entries.size()), -1);
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (!m_masks[i]) {
+            continue;
+        }
+        Entry entry = m_entries[i];
+        const int offset = int(entry.offset);
+        entry.offset = quint32(text.size());
+        text.append(m_text.constData() + offset, int(entry.length));
+        folded.append(m_folded.constData() + offset, int(entry.length));
+        newIds[int(i)] = int(entries.size());
+        entries.push_back(entry);
+        masks.push_back(m_masks[i]);
+    }
+
+    for (auto it = m_ids.begin(); it != m_ids.end(); ++it) {
+        it.value() = newIds.at(it.value());
+    }
+
+    m_text = text;
+    m_folded = folded;
+    m_entries.swap(entries);
+    m_masks.swap(masks);
+    m_deadCount = 0;
+    ++m_revision;
+}
@@ -0,0 +1,69 @@
+#ifndef PATHINDEX_H
+#define PATHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+
+#include <vector>
+
+// Flat, cache-friendly store of project paths for fuzzy matching. Paths
+// live relative to the root in one UTF-8 buffer, next to an ASCII-folded
+// copy and a 64-bit mask of the characters each path contains. A query is
+// first tested against the masks, a tight loop over a contiguous array
+// that the compiler vectorizes; survivors are checked for the query as a
+// subsequence with memchr and scored.
+class PathIndex
+{
+public:
+    struct Match
+    {
+        int index;
+        int score;
+    };
+
+    PathIndex();
+
+    void setRootPath(const QString &rootPath);
+    void addPaths(const QStringList &paths);
+    void removePaths(const QStringList &paths);
+    void clear();
+
+    int size() const { return m_ids.size(); }
+    // Changes when paths are added or indices renumbered; earlier matches
+    // can no longer be refined
+    int revision() const { return m_revision; }
+
+    // Scores every path, or only the given indices when refining a query
+    // that extends an earlier one. Unsorted.
+    QVector<Match> match(const QString &query, const QVector<int> *within = nullptr) const;
+
+    QString filePath(int index) const;
+    QString relativePath(int index) const;
+
+private:
+    struct Entry
+    {
+        quint32 offset;
+        quint32 length;
+        quint32 nameOffset;   // start of the file name within the path
+    };
+
+    int scoreEntry(int index, const QByteArray &query) const;
+    void matchRange(const QByteArray &query, quint64 queryMask, const int *indices, int begin, int end,
+                    QVector<Match> *matches) const;
+    void compact();
+
+    QString m_rootPath;
+    QByteArray m_text;
+    QByteArray m_folded;
+    std::vector<Entry> m_entries;
+    std::vector<quint64> m_masks;   // 0 for removed entries
+    QHash<QString, int> m_ids;      // by relative path
+    int m_deadCount;
+    int m_revision;
+};
+
+#endif // PATHINDEX_H
@@ -0,0 +1,164 @@
+#include "quickopendialog.h"
+
+#include <QVBoxLayout>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QLabel>
+#include <QKeyEvent>
+#include <QElapsedTimer>
+#include <QApplication>
+
+#include <algorithm>
+
+namespace {
+
+const int kMaxResults = 100;
+
+} // namespace
+
+QuickOpenDialog::QuickOpenDialog(QWidget *parent)
+    : QDialog(parent, Qt::Popup | Qt::FramelessWindowHint)
+    , m_lastRevision(-1)
+{
+    m_queryEdit = new QLineEdit();
+    m_queryEdit->setPlaceholderText("Go to file");
+    m_queryEdit->installEventFilter(this);
+
+    m_resultList = new QListWidget();
+    m_resultList->setUniformItemSizes(true);
+    m_resultList->setFocusPolicy(Qt::NoFocus);
+
+    m_statusLabel = new QLabel();
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 6, 6, 6);
+    layout->setSpacing(4);
+    layout->addWidget(m_queryEdit);
+    layout->addWidget(m_resultList, 1);
+    layout->addWidget(m_statusLabel);
+
+    connect(m_queryEdit, &QLineEdit::textChanged, this, &QuickOpenDialog::updateResults);
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &QuickOpenDialog::activateCurrent);
+    connect(m_resultList, &QListWidget::itemActivated, this, &QuickOpenDialog::activateCurrent);
+
+    resize(640, 420);
+}
+
+void QuickOpenDialog::setRootPath(const QString &rootPath)
+{
+    m_index.setRootPath(rootPath);
+    m_lastQuery.clear();
+}
+
+void QuickOpenDialog::updateFiles(const QStringList &added, const QStringList &removed)
+{
+    m_index.removePaths(removed);
+    m_index.addPaths(added);
+}
+
+void QuickOpenDialog::clear()
+{
+    m_index.clear();
+    m_lastQuery.clear();
+    m_lastMatches.clear();
+    m_resultList->clear();
+}
+
+void QuickOpenDialog::popup()
+{
+    if (QWidget *owner = parentWidget()) {
+        const QRect frame = owner->geometry();
+        move(frame.x() + (frame.width() - width()) / 2, frame.y() + frame.height() / 8);
+    }
+
+    m_queryEdit->clear();
+    m_resultList->clear();
+    m_statusLabel->setText(QString("%1 files").arg(m_index.size()));
+    show();
+    m_queryEdit->setFocus();
+}
+
+bool QuickOpenDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    // Navigation keys go to the list while the query keeps the focus
+    if (watched == m_queryEdit && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QApplication::sendEvent(m_resultList, event);
+            return true;
+        default:
+            break;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
+
+void QuickOpenDialog::updateResults(const QString &query)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QString compact = query;
+    compact.remove(' ');
+    if (compact.isEmpty()) {
+        m_lastQuery.clear();
+        m_lastMatches.clear();
+        m_resultList->clear();
+        m_statusLabel->setText(QString("%1 files").arg(m_index.size()));
+        return;
+    }
+
+    // A query that extends the previous one can only match a subset of it
+    const bool refine = !m_lastQuery.isEmpty() && compact.startsWith(m_lastQuery)
+                        && m_lastRevision == m_index.revision();
+    QVector<PathIndex::Match> matches = m_index.match(compact, refine ? &m_lastMatches : nullptr);
+
+    m_lastQuery = compact;
+    m_lastRevision = m_index.revision();
+    m_lastMatches.resize(matches.size());
+    for (int i = 0; i < matches.size(); ++i) {
+        m_lastMatches[i] = matches.at(i).index;
+    }
+
+    const int shown = qMin(kMaxResults, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + shown, matches.end(),
+                      [](const PathIndex::Match &a, const PathIndex::Match &b) {
+        return a.score != b.score ? a.score > b.score : a.index < b.index;
+    });
+
+    m_resultList->setUpdatesEnabled(false);
+    m_resultList->clear();
+    for (int i = 0; i < shown; ++i) {
+        const int index = matches.at(i).index;
+        const QString relativePath = m_index.relativePath(index);
+        const int slash = relativePath.lastIndexOf('/');
+        const QString label = slash < 0
+            ? relativePath
+            : QString("%1    %2").arg(relativePath.mid(slash + 1), relativePath.left(slash));
+
+        QListWidgetItem *item = new QListWidgetItem(label, m_resultList);
+        item->setData(Qt::UserRole, m_index.filePath(index));
+        item->setToolTip(relativePath);
+    }
+    m_resultList->setCurrentRow(0);
+    m_resultList->setUpdatesEnabled(true);
+
+    m_statusLabel->setText(QString("%1 of %2 files (%3 ms)")
+                               .arg(matches.size()).arg(m_index.size()).arg(timer.elapsed()));
+}
+
+void QuickOpenDialog::activateCurrent()
+{
+    QListWidgetItem *item = m_resultList->currentItem();
+    if (!item) {
+        return;
+    }
+    const QString filePath = item->data(Qt::UserRole).toString();
+    hide();
+    emit fileSelected(filePath);
+}
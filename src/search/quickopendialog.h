@@ -0,0 +1,53 @@
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+#include "pathindex.h"
+
+class QLineEdit;
+class QListWidget;
+class QLabel;
+
+// Ctrl+P palette over the project's files. Each keystroke that extends the
+// previous query only rescores the paths that matched before.
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QuickOpenDialog(QWidget *parent = nullptr);
+
+    void setRootPath(const QString &rootPath);
+    // Takes ProjectManager::filesChanged deltas
+    void updateFiles(const QStringList &added, const QStringList &removed);
+    void clear();
+
+    // Shows the palette with an empty query, centered at the top of the parent
+    void popup();
+
+signals:
+    void fileSelected(const QString &filePath);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void updateResults(const QString &query);
+    void activateCurrent();
+
+private:
+    PathIndex m_index;
+
+    QLineEdit *m_queryEdit;
+    QListWidget *m_resultList;
+    QLabel *m_statusLabel;
+
+    // Matches of the last query, for refinement
+    QString m_lastQuery;
+    QVector<int> m_lastMatches;
+    int m_lastRevision;
+};
+
+#endif // QUICKOPENDIALOG_H
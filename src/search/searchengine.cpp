@@ -0,0 +1,353 @@
+#include "searchengine.h"
+#include "project/jobworkers.h"
+
+#include <QFile>
+#include <QAtomicInt>
+#include <QThread>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QtConcurrent>
+
+#include <vector>
+
+namespace {
+
+// Files larger than this are not indexed; they are verified on every search
+const qint64 kMaxIndexedFileSize = 16 * 1024 * 1024;
+
+// Indexed files are added to the index under the write lock in batches of
+// this size, so searches are not held up for long
+const int kIndexBatchSize = 64;
+
+// Matches are handed to the GUI thread in batches of this size, or when a
+// worker runs out of files
+const int kMatchBatchSize = 256;
+
+const int kDefaultMaxMatches = 20000;
+const int kMaxWorkers = 16;
+
+} // namespace
+
+struct IndexJob
+{
+    QStringList files;
+    // Removed while the job ran; guarded by SearchEngine::m_lock
+    QSet<QString> removed;
+    QAtomicInt next;
+    JobWorkers workers;
+    QAtomicInt cancelled;
+    int generation = 0;
+};
+
+struct SearchJob
+{
+    SearchJob(const QString &pattern, const SearchOptions &options)
+        : matcher(pattern, options)
+    {
+    }
+
+    const TextMatcher matcher;
+    QStringList files;
+    QAtomicInt next;
+    JobWorkers workers;
+    QAtomicInt cancelled;
+    MatchBudget budget;
+    int generation = 0;
+};
+
+SearchEngine::SearchEngine(QObject *parent)
+    : QObject(parent)
+    , m_indexGeneration(0)
+    , m_searchGeneration(0)
+    , m_maxMatches(kDefaultMaxMatches)
+{
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), kMaxWorkers));
+}
+
+SearchEngine::~SearchEngine()
+{
+    cancelSearch();
+    if (m_indexJob) {
+        m_indexJob->cancelled.storeRelease(1);
+    }
+    m_pool.waitForDone();
+}
+
+void SearchEngine::updateFiles(const QStringList &added, const QStringList &removed, const QStringList &modified)
+{
+    if (!removed.isEmpty()) {
+        QWriteLocker locker(&m_lock);
+        for (const QString &filePath : removed) {
+            m_pendingFiles.remove(filePath);
+            m_index.removeFile(filePath);
+            if (m_indexJob) {
+                m_indexJob->removed.insert(filePath);
+            }
+        }
+    }
+
+    for (const QString &filePath : added) {
+        m_pendingFiles.insert(filePath);
+    }
+    for (const QString &filePath : modified) {
+        m_pendingFiles.insert(filePath);
+    }
+    startIndexing();
+}
+
+void SearchEngine::clear()
+{
+    cancelSearch();
+    if (m_indexJob) {
+        m_indexJob->cancelled.storeRelease(1);
+        m_indexJob.reset();
+    }
+    ++m_indexGeneration;
+    m_pendingFiles.clear();
+
+    // Workers check for cancellation under the lock before adding anything
+    QWriteLocker locker(&m_lock);
+    m_index.clear();
+}
+
+int SearchEngine::fileCount() const
+{
+    QReadLocker locker(&m_lock);
+    return m_index.fileCount();
+}
+
+void SearchEngine::setMaxMatches(int maxMatches)
+{
+    m_maxMatches = qMax(1, maxMatches);
+}
+
+void SearchEngine::startIndexing()
+{
+    if (m_indexJob || m_pendingFiles.isEmpty()) {
+        return;
+    }
+
+    // One job at a time; files reported meanwhile wait for the next one
+    QSharedPointer<IndexJob> job(new IndexJob);
+    job->files = m_pendingFiles.values();
+    job->generation = m_indexGeneration;
+    m_pendingFiles.clear();
+    m_indexJob = job;
+
+    const int workerCount = qMin(m_pool.maxThreadCount(), (job->files.size() + kIndexBatchSize - 1) / kIndexBatchSize);
+    job->workers.start(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        QtConcurrent::run(&m_pool, [this, job] { runIndexWorker(job); });
+    }
+}
+
+void SearchEngine::runIndexWorker(const QSharedPointer<IndexJob> &job)
+{
+    // Runs on a pool thread
+    struct IndexedFile
+    {
+        QString path;
+        std::vector<quint32> trigrams;
+        bool indexed;
+    };
+    std::vector<IndexedFile> batch;
+
+    auto apply = [this, &job, &batch]() {
+        QWriteLocker locker(&m_lock);
+        if (job->cancelled.loadAcquire()) {
+            return;
+        }
+        for (const IndexedFile &file : batch) {
+            if (job->removed.contains(file.path)) {
+                continue;
+            }
+            if (file.indexed) {
+                m_index.addFile(file.path, file.trigrams);
+            } else {
+                m_index.addUnindexedFile(file.path);
+            }
+        }
+        batch.clear();
+    };
+
+    while (!job->cancelled.loadAcquire()) {
+        const int i = job->next.fetchAndAddRelaxed(1);
+        if (i >= job->files.size()) {
+            break;
+        }
+
+        IndexedFile file;
+        file.path = job->files.at(i);
+        file.indexed = false;
+
+        QFile input(file.path);
+        if (input.open(QIODevice::ReadOnly) && input.size() <= kMaxIndexedFileSize) {
+            const qint64 size = input.size();
+            if (size == 0) {
+                file.indexed = true;
+            } else if (uchar *data = input.map(0, size)) {
+                const char *text = reinterpret_cast<const char *>(data);
+                // Binary files are indexed without trigrams; only a search
+                // with no trigrams lists them, and verification skips them
+                if (!TextMatcher::isBinary(text, size)) {
+                    TrigramIndex::extractTrigrams(text, size, &file.trigrams);
+                }
+                file.indexed = true;
+                input.unmap(data);
+            }
+        }
+
+        batch.push_back(std::move(file));
+        if (int(batch.size()) >= kIndexBatchSize) {
+            apply();
+        }
+    }
+
+    if (!batch.empty()) {
+        apply();
+    }
+
+    const int generation = job->generation;
+    job->workers.finish(this, [this, generation] {
+        if (generation != m_indexGeneration) {
+            return;
+        }
+        m_indexJob.reset();
+        if (!m_pendingFiles.isEmpty()) {
+            startIndexing();
+        } else {
+            emit indexingFinished(fileCount());
+        }
+    });
+}
+
+bool SearchEngine::search(const QString &pattern, const SearchOptions &options)
+{
+    cancelSearch();
+
+    QSharedPointer<SearchJob> job(new SearchJob(pattern, options));
+    if (!job->matcher.isValid()) {
+        emit searchFailed(job->matcher.errorString());
+        return false;
+    }
+    job->generation = m_searchGeneration;
+    job->budget.setMaxMatches(m_maxMatches);
+
+    {
+        QReadLocker locker(&m_lock);
+        job->files = m_index.candidates(TrigramIndex::queryTrigrams(job->matcher.requiredLiterals()));
+    }
+
+    // Files still waiting for the indexer are checked directly
+    if (m_indexJob || !m_pendingFiles.isEmpty()) {
+        QSet<QString> files(m_pendingFiles);
+        if (m_indexJob) {
+            for (const QString &filePath : m_indexJob->files) {
+                files.insert(filePath);
+            }
+        }
+        for (const QString &filePath : job->files) {
+            files.remove(filePath);
+        }
+        job->files.append(files.values());
+    }
+
+    const int workerCount = qMin(m_pool.maxThreadCount(), job->files.size());
+    if (workerCount == 0) {
+        emit searchFinished(0, false);
+        return true;
+    }
+
+    m_searchJob = job;
+    job->workers.start(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        QtConcurrent::run(&m_pool, [this, job] { runSearchWorker(job); });
+    }
+    return true;
+}
+
+void SearchEngine::cancelSearch()
+{
+    if (m_searchJob) {
+        m_searchJob->cancelled.storeRelease(1);
+        m_searchJob.reset();
+    }
+    // Batches that are already queued for delivery are dropped as well
+    ++m_searchGeneration;
+}
+
+void SearchEngine::runSearchWorker(const QSharedPointer<SearchJob> &job)
+{
+    // Runs on a pool thread
+    QVector<SearchMatch> batch;
+    QVector<LineMatch> lines;
+
+    while (!job->cancelled.loadAcquire()) {
+        const int i = job->next.fetchAndAddRelaxed(1);
+        if (i >= job->files.size()) {
+            break;
+        }
+
+        const int budget = job->budget.remaining();
+        if (budget == 0) {
+            break;
+        }
+
+        const QString &filePath = job->files.at(i);
+        QFile input(filePath);
+        if (!input.open(QIODevice::ReadOnly) || input.size() == 0) {
+            continue;
+        }
+
+        const qint64 size = input.size();
+        QByteArray contents;
+        const char *text = nullptr;
+        uchar *data = input.map(0, size);
+        if (data) {
+            text = reinterpret_cast<const char *>(data);
+        } else {
+            contents = input.readAll();
+            text = contents.constData();
+        }
+
+        lines.clear();
+        int found = 0;
+        if (!TextMatcher::isBinary(text, size)) {
+            found = job->matcher.findMatches(text, size, &lines, budget);
+        }
+        if (data) {
+            input.unmap(data);
+        }
+        if (found == 0) {
+            continue;
+        }
+
+        job->budget.claim(filePath, lines, found, &batch);
+
+        if (batch.size() >= kMatchBatchSize) {
+            postMatches(job->generation, batch);
+            batch.clear();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        postMatches(job->generation, batch);
+    }
+
+    job->workers.finish(this, [this, job] {
+        if (job->generation != m_searchGeneration) {
+            return;
+        }
+        m_searchJob.reset();
+        emit searchFinished(job->budget.matchCount(), job->budget.isTruncated());
+    });
+}
+
+void SearchEngine::postMatches(int generation, const QVector<SearchMatch> &matches)
+{
+    QMetaObject::invokeMethod(this, [this, generation, matches] {
+        if (generation == m_searchGeneration) {
+            emit matchesFound(matches);
+        }
+    }, Qt::QueuedConnection);
+}
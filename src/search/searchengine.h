@@ -0,0 +1,72 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSet>
+#include <QThreadPool>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+
+#include "trigramindex.h"
+#include "textmatcher.h"
+
+struct IndexJob;
+struct SearchJob;
+
+// Project-wide full-text search. Files are indexed by trigram on a thread
+// pool as the project reports them; a search intersects the posting lists
+// of its required literals and verifies only the candidate files, spread
+// over the same pool. Matches are streamed back in batches.
+class SearchEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SearchEngine(QObject *parent = nullptr);
+    ~SearchEngine();
+
+    // Takes ProjectManager::filesChanged deltas; added and modified files
+    // are (re)indexed in the background
+    void updateFiles(const QStringList &added, const QStringList &removed, const QStringList &modified);
+    void clear();
+    bool isIndexing() const { return !m_indexJob.isNull(); }
+    int fileCount() const;
+
+    // Cancels any running search. Files not indexed yet are verified
+    // directly, so results are complete while indexing runs.
+    bool search(const QString &pattern, const SearchOptions &options);
+    void cancelSearch();
+    bool isSearching() const { return !m_searchJob.isNull(); }
+
+    int maxMatches() const { return m_maxMatches; }
+    void setMaxMatches(int maxMatches);
+
+signals:
+    void indexingFinished(int fileCount);
+    void matchesFound(const QVector<SearchMatch> &matches);
+    void searchFinished(int matchCount, bool truncated);
+    void searchFailed(const QString &error);
+
+private:
+    void startIndexing();
+    void runIndexWorker(const QSharedPointer<IndexJob> &job);
+    void runSearchWorker(const QSharedPointer<SearchJob> &job);
+    void postMatches(int generation, const QVector<SearchMatch> &matches);
+
+    QThreadPool m_pool;
+    mutable QReadWriteLock m_lock;
+    TrigramIndex m_index;
+
+    QSet<QString> m_pendingFiles;
+    QSharedPointer<IndexJob> m_indexJob;
+    int m_indexGeneration;
+
+    QSharedPointer<SearchJob> m_searchJob;
+    int m_searchGeneration;
+    int m_maxMatches;
+};
+
+#endif // SEARCHENGINE_H
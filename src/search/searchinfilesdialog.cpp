@@ -0,0 +1,100 @@
+#include "searchinfilesdialog.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFileInfo>
+
+SearchInFilesDialog::SearchInFilesDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Search in Files");
+
+    m_patternEdit = new QLineEdit();
+    m_directoryEdit = new QLineEdit();
+    QPushButton *browseButton = new QPushButton("Browse...");
+
+    QHBoxLayout *directoryLayout = new QHBoxLayout();
+    directoryLayout->addWidget(m_directoryEdit, 1);
+    directoryLayout->addWidget(browseButton);
+
+    m_caseCheck = new QCheckBox("Match case");
+    m_wordCheck = new QCheckBox("Whole words");
+    m_regexCheck = new QCheckBox("Regular expression");
+
+    QHBoxLayout *optionsLayout = new QHBoxLayout();
+    optionsLayout->addWidget(m_caseCheck);
+    optionsLayout->addWidget(m_wordCheck);
+    optionsLayout->addWidget(m_regexCheck);
+    optionsLayout->addStretch();
+
+    QFormLayout *form = new QFormLayout();
+    form->addRow("Find:", m_patternEdit);
+    form->addRow("In:", directoryLayout);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    m_okButton = buttons->button(QDialogButtonBox::Ok);
+    m_okButton->setText("Search");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addLayout(optionsLayout);
+    layout->addWidget(buttons);
+
+    connect(browseButton, &QPushButton::clicked, this, &SearchInFilesDialog::browse);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(m_patternEdit, &QLineEdit::textChanged, this, &SearchInFilesDialog::updateAcceptable);
+    connect(m_directoryEdit, &QLineEdit::textChanged, this, &SearchInFilesDialog::updateAcceptable);
+
+    updateAcceptable();
+    resize(520, sizeHint().height());
+}
+
+QString SearchInFilesDialog::pattern() const
+{
+    return m_patternEdit->text();
+}
+
+void SearchInFilesDialog::setPattern(const QString &pattern)
+{
+    m_patternEdit->setText(pattern);
+    m_patternEdit->selectAll();
+}
+
+QString SearchInFilesDialog::directory() const
+{
+    return m_directoryEdit->text();
+}
+
+void SearchInFilesDialog::setDirectory(const QString &directory)
+{
+    m_directoryEdit->setText(directory);
+}
+
+SearchOptions SearchInFilesDialog::options() const
+{
+    SearchOptions options;
+    options.caseSensitive = m_caseCheck->isChecked();
+    options.wholeWord = m_wordCheck->isChecked();
+    options.regularExpression = m_regexCheck->isChecked();
+    return options;
+}
+
+void SearchInFilesDialog::browse()
+{
+    const QString directory = QFileDialog::getExistingDirectory(this, "Search in Directory", m_directoryEdit->text());
+    if (!directory.isEmpty()) {
+        m_directoryEdit->setText(directory);
+    }
+}
+
+void SearchInFilesDialog::updateAcceptable()
+{
+    m_okButton->setEnabled(!m_patternEdit->text().isEmpty() && QFileInfo::exists(m_directoryEdit->text()));
+}
@@ -0,0 +1,39 @@
+#ifndef SEARCHINFILESDIALOG_H
+#define SEARCHINFILESDIALOG_H
+
+#include <QDialog>
+
+#include "textmatcher.h"
+
+class QLineEdit;
+class QCheckBox;
+class QPushButton;
+
+// Asks for a pattern and a directory for FileGrep
+class SearchInFilesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SearchInFilesDialog(QWidget *parent = nullptr);
+
+    QString pattern() const;
+    void setPattern(const QString &pattern);
+    QString directory() const;
+    void setDirectory(const QString &directory);
+    SearchOptions options() const;
+
+private slots:
+    void browse();
+    void updateAcceptable();
+
+private:
+    QLineEdit *m_patternEdit;
+    QLineEdit *m_directoryEdit;
+    QCheckBox *m_caseCheck;
+    QCheckBox *m_wordCheck;
+    QCheckBox *m_regexCheck;
+    QPushButton *m_okButton;
+};
+
+#endif // SEARCHINFILESDIALOG_H
@@ -0,0 +1,179 @@
+#include "searchpanel.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QFileInfo>
+
+namespace {
+
+enum ResultRole {
+    FilePathRole = Qt::UserRole,
+    LineRole,
+    ColumnRole,
+    LengthRole
+};
+
+// Long lines are cut down to a window around the match
+const int kMaxPreviewLength = 200;
+const int kPreviewContext = 40;
+
+QString previewText(const SearchMatch &match)
+{
+    QString text = match.lineText;
+    int start = 0;
+    if (text.size() > kMaxPreviewLength) {
+        start = qMax(0, match.column - kPreviewContext);
+        text = text.mid(start, kMaxPreviewLength);
+    }
+
+    // Leading indentation is dropped
+    int indent = 0;
+    while (indent < text.size() && text.at(indent).isSpace()) {
+        ++indent;
+    }
+    return text.mid(indent);
+}
+
+} // namespace
+
+SearchPanel::SearchPanel(SearchEngine *engine, QWidget *parent)
+    : QWidget(parent)
+    , m_engine(engine)
+{
+    setupUI();
+
+    connect(m_engine, &SearchEngine::matchesFound, this, &SearchPanel::onMatchesFound);
+    connect(m_engine, &SearchEngine::searchFinished, this, &SearchPanel::onSearchFinished);
+    connect(m_engine, &SearchEngine::searchFailed, this, &SearchPanel::onSearchFailed);
+}
+
+void SearchPanel::setupUI()
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->setSpacing(4);
+
+    QHBoxLayout *queryLayout = new QHBoxLayout();
+    m_queryEdit = new QLineEdit();
+    m_queryEdit->setPlaceholderText("Search in project");
+    m_queryEdit->setClearButtonEnabled(true);
+    queryLayout->addWidget(m_queryEdit, 1);
+
+    m_caseCheck = new QCheckBox("Aa");
+    m_caseCheck->setToolTip("Match case");
+    m_wordCheck = new QCheckBox("Word");
+    m_wordCheck->setToolTip("Match whole words");
+    m_regexCheck = new QCheckBox(".*");
+    m_regexCheck->setToolTip("Regular expression");
+    queryLayout->addWidget(m_caseCheck);
+    queryLayout->addWidget(m_wordCheck);
+    queryLayout->addWidget(m_regexCheck);
+    layout->addLayout(queryLayout);
+
+    m_statusLabel = new QLabel();
+    layout->addWidget(m_statusLabel);
+
+    m_resultsTree = new QTreeWidget();
+    m_resultsTree->setHeaderHidden(true);
+    m_resultsTree->setUniformRowHeights(true);
+    m_resultsTree->setColumnCount(1);
+    layout->addWidget(m_resultsTree, 1);
+
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &SearchPanel::startSearch);
+    connect(m_caseCheck, &QCheckBox::toggled, this, &SearchPanel::startSearch);
+    connect(m_wordCheck, &QCheckBox::toggled, this, &SearchPanel::startSearch);
+    connect(m_regexCheck, &QCheckBox::toggled, this, &SearchPanel::startSearch);
+    connect(m_resultsTree, &QTreeWidget::itemActivated, this, &SearchPanel::onItemActivated);
+}
+
+void SearchPanel::setQuery(const QString &text)
+{
+    m_queryEdit->setText(text);
+}
+
+void SearchPanel::focusQuery()
+{
+    m_queryEdit->setFocus();
+    m_queryEdit->selectAll();
+}
+
+void SearchPanel::startSearch()
+{
+    m_resultsTree->clear();
+    m_fileItems.clear();
+
+    const QString pattern = m_queryEdit->text();
+    if (pattern.isEmpty()) {
+        m_engine->cancelSearch();
+        m_statusLabel->clear();
+        return;
+    }
+
+    SearchOptions options;
+    options.caseSensitive = m_caseCheck->isChecked();
+    options.wholeWord = m_wordCheck->isChecked();
+    options.regularExpression = m_regexCheck->isChecked();
+
+    m_searchTimer.start();
+    m_statusLabel->setText(m_engine->isIndexing() ? "Searching (indexing in progress)..." : "Searching...");
+    m_engine->search(pattern, options);
+}
+
+void SearchPanel::onMatchesFound(const QVector<SearchMatch> &matches)
+{
+    m_resultsTree->setUpdatesEnabled(false);
+
+    for (const SearchMatch &match : matches) {
+        QTreeWidgetItem *fileItem = m_fileItems.value(match.filePath);
+        if (!fileItem) {
+            fileItem = new QTreeWidgetItem(m_resultsTree);
+            fileItem->setText(0, QFileInfo(match.filePath).fileName());
+            fileItem->setToolTip(0, match.filePath);
+            fileItem->setData(0, FilePathRole, match.filePath);
+            fileItem->setData(0, LineRole, -1);
+            fileItem->setExpanded(true);
+            m_fileItems.insert(match.filePath, fileItem);
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(fileItem);
+        item->setText(0, QString("%1: %2").arg(match.line + 1).arg(previewText(match)));
+        item->setToolTip(0, match.lineText.left(1000));
+        item->setData(0, FilePathRole, match.filePath);
+        item->setData(0, LineRole, match.line);
+        item->setData(0, ColumnRole, match.column);
+        item->setData(0, LengthRole, match.length);
+    }
+
+    m_resultsTree->setUpdatesEnabled(true);
+    m_statusLabel->setText(QString("Searching... %1 files").arg(m_fileItems.size()));
+}
+
+void SearchPanel::onSearchFinished(int matchCount, bool truncated)
+{
+    QString status = QString("%1 matches in %2 files (%3 ms)")
+                         .arg(matchCount).arg(m_fileItems.size()).arg(m_searchTimer.elapsed());
+    if (truncated) {
+        status += QString(", stopped after %1").arg(m_engine->maxMatches());
+    }
+    m_statusLabel->setText(status);
+}
+
+void SearchPanel::onSearchFailed(const QString &error)
+{
+    m_statusLabel->setText(QString("Invalid search: %1").arg(error));
+}
+
+void SearchPanel::onItemActivated(QTreeWidgetItem *item)
+{
+    const int line = item->data(0, LineRole).toInt();
+    if (line < 0) {
+        return;
+    }
+    emit matchActivated(item->data(0, FilePathRole).toString(), line,
+                        item->data(0, ColumnRole).toInt(), item->data(0, LengthRole).toInt());
+}
@@ -0,0 +1,55 @@
+#ifndef SEARCHPANEL_H
+#define SEARCHPANEL_H
+
+#include <QWidget>
+#include <QHash>
+#include <QElapsedTimer>
+
+#include "searchengine.h"
+
+class QLineEdit;
+class QCheckBox;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Query field and streaming result tree for SearchEngine. Matches are
+// grouped under their file as the batches arrive.
+class SearchPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SearchPanel(SearchEngine *engine, QWidget *parent = nullptr);
+
+    void setQuery(const QString &text);
+    void focusQuery();
+
+signals:
+    // line is zero-based; column and length are in UTF-16 units
+    void matchActivated(const QString &filePath, int line, int column, int length);
+
+private slots:
+    void startSearch();
+    void onMatchesFound(const QVector<SearchMatch> &matches);
+    void onSearchFinished(int matchCount, bool truncated);
+    void onSearchFailed(const QString &error);
+    void onItemActivated(QTreeWidgetItem *item);
+
+private:
+    void setupUI();
+
+    SearchEngine *m_engine;
+
+    QLineEdit *m_queryEdit;
+    QCheckBox *m_caseCheck;
+    QCheckBox *m_wordCheck;
+    QCheckBox *m_regexCheck;
+    QLabel *m_statusLabel;
+    QTreeWidget *m_resultsTree;
+
+    QHash<QString, QTreeWidgetItem*> m_fileItems;
+    QElapsedTimer m_searchTimer;
+};
+
+#endif // SEARCHPANEL_H
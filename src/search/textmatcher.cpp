@@ -0,0 +1,401 @@
+#include "textmatcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <string.h>
+#endif
+
+namespace {
+
+// Only this much of a file is looked at to tell binary from text
+const qint64 kBinaryProbeBytes = 8192;
+
+inline char asciiLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+inline char asciiUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? char(c - ('a' - 'A')) : c;
+}
+
+// UTF-8 continuation and lead bytes count as word characters
+inline bool isWordByte(char c)
+{
+    const uchar u = uchar(c);
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_' || u >= 0x80;
+}
+
+QByteArray foldAscii(const QByteArray &bytes)
+{
+    QByteArray result = bytes;
+    for (int i = 0; i < result.size(); ++i) {
+        result[i] = asciiLower(result.at(i));
+    }
+    return result;
+}
+
+bool caselessEqual(const char *a, const char *b, int length)
+{
+    for (int i = 0; i < length; ++i) {
+        if (asciiLower(a[i]) != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isAscii(const QString &text)
+{
+    for (const QChar c : text) {
+        if (c.unicode() >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs of characters that every match of a regular expression contains.
+// Conservative: only top-level literals count, an optional character ends
+// a run, and any alternative or inline option gives up entirely. Without
+// case sensitivity, non-ASCII characters end a run, since their folding
+// is not ASCII.
+QVector<QByteArray> regexLiterals(const QString &pattern, bool caseSensitive)
+{
+    QVector<QByteArray> runs;
+    if (pattern.contains(QLatin1String("(?"))) {
+        return runs;
+    }
+
+    QString current;
+    auto flush = [&runs, &current]() {
+        if (!current.isEmpty()) {
+            runs.append(current.toUtf8());
+            current.clear();
+        }
+    };
+
+    int depth = 0;
+    bool lastWasLiteral = false;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        QChar literal;
+
+        if (c == '\\') {
+            if (i + 1 >= pattern.size()) {
+                break;
+            }
+            const QChar next = pattern.at(++i);
+            // \d, \w, \b, \n and friends are classes or assertions
+            if (next.isLetterOrNumber()) {
+                flush();
+                lastWasLiteral = false;
+                continue;
+            }
+            literal = next;
+        } else if (c == '|') {
+            return QVector<QByteArray>();
+        } else if (c == '(') {
+            flush();
+            ++depth;
+            lastWasLiteral = false;
+            continue;
+        } else if (c == ')') {
+            flush();
+            depth = qMax(0, depth - 1);
+            lastWasLiteral = false;
+            continue;
+        } else if (c == '[') {
+            flush();
+            // Skip the class; a leading ']' (after an optional '^') is literal
+            int j = i + 1;
+            if (j < pattern.size() && pattern.at(j) == '^') {
+                ++j;
+            }
+            if (j < pattern.size() && pattern.at(j) == ']') {
+                ++j;
+            }
+            while (j < pattern.size() && pattern.at(j) != ']') {
+                if (pattern.at(j) == '\\') {
+                    ++j;
+                }
+                ++j;
+            }
+            i = j;
+            lastWasLiteral = false;
+            continue;
+        } else if (c == '*' || c == '?' || c == '{' || c == '+') {
+            // The quantified character may be absent, except with '+'
+            if (lastWasLiteral && c != '+' && !current.isEmpty()) {
+                current.chop(1);
+            }
+            flush();
+            if (c == '{') {
+                while (i < pattern.size() && pattern.at(i) != '}') {
+                    ++i;
+                }
+            }
+            if (i + 1 < pattern.size() && (pattern.at(i + 1) == '?' || pattern.at(i + 1) == '+')) {
+                ++i;
+            }
+            lastWasLiteral = false;
+            continue;
+        } else if (c == '.' || c == '^' || c == '$') {
+            flush();
+            lastWasLiteral = false;
+            continue;
+        } else {
+            literal = c;
+        }
+
+        if (depth > 0 || (!caseSensitive && literal.unicode() >= 0x80)) {
+            flush();
+            lastWasLiteral = false;
+            continue;
+        }
+        current.append(literal);
+        lastWasLiteral = true;
+    }
+    flush();
+    return runs;
+}
+
+// Maximal ASCII runs of a plain text pattern
+QVector<QByteArray> asciiRuns(const QString &pattern)
+{
+    QVector<QByteArray> runs;
+    QString current;
+    for (const QChar c : pattern) {
+        if (c.unicode() < 0x80) {
+            current.append(c);
+        } else if (!current.isEmpty()) {
+            runs.append(current.toLatin1());
+            current.clear();
+        }
+    }
+    if (!current.isEmpty()) {
+        runs.append(current.toLatin1());
+    }
+    return runs;
+}
+
+} // namespace
+
+TextMatcher::TextMatcher(const QString &pattern, const SearchOptions &options)
+    : m_options(options)
+    , m_valid(false)
+    , m_useRegex(options.regularExpression)
+    , m_literalsCaseSensitive(options.caseSensitive)
+{
+    if (pattern.isEmpty()) {
+        m_errorString = "Empty search pattern";
+        return;
+    }
+
+    // Caseless matching beyond ASCII needs Unicode case folding, which only
+    // the regex engine does
+    const bool foldedLiteral = !options.regularExpression && !options.caseSensitive && !isAscii(pattern);
+    if (foldedLiteral) {
+        m_useRegex = true;
+    }
+
+    if (m_useRegex) {
+        QString source = options.regularExpression ? pattern : QRegularExpression::escape(pattern);
+        if (options.wholeWord) {
+            source = QString("\\b(?:%1)\\b").arg(source);
+        }
+        QRegularExpression::PatternOptions patternOptions = QRegularExpression::UseUnicodePropertiesOption;
+        if (!options.caseSensitive) {
+            patternOptions |= QRegularExpression::CaseInsensitiveOption;
+        }
+        m_regex = QRegularExpression(source, patternOptions);
+        if (!m_regex.isValid()) {
+            m_errorString = m_regex.errorString();
+            return;
+        }
+        m_regex.optimize();
+        m_literals = foldedLiteral ? asciiRuns(pattern) : regexLiterals(pattern, options.caseSensitive);
+    } else {
+        m_needle = pattern.toUtf8();
+        m_literals.append(m_needle);
+    }
+
+    if (!options.caseSensitive) {
+        m_needle = foldAscii(m_needle);
+        for (QByteArray &literal : m_literals) {
+            literal = foldAscii(literal);
+        }
+    }
+
+    for (const QByteArray &literal : m_literals) {
+        if (literal.size() > m_prefilter.size()) {
+            m_prefilter = literal;
+        }
+    }
+    m_valid = true;
+}
+
+bool TextMatcher::isBinary(const char *data, qint64 size)
+{
+    return std::memchr(data, 0, size_t(qMin(size, kBinaryProbeBytes))) != nullptr;
+}
+
+int TextMatcher::findMatches(const char *data, qint64 size, QVector<LineMatch> *matches, int maxMatches) const
+{
+    if (!m_valid) {
+        return 0;
+    }
+
+    const char *end = data + size;
+    const char *p = data;
+    const char *lineCounted = data;
+    int line = 0;
+    int count = 0;
+
+    while (p < end && count < maxMatches) {
+        const char *lineBegin = p;
+        if (!m_prefilter.isEmpty()) {
+            const char *hit = findPrefilter(p, end);
+            if (!hit) {
+                break;
+            }
+            // p is always at the start of a line
+            lineBegin = hit;
+            while (lineBegin > p && lineBegin[-1] != '\n') {
+                --lineBegin;
+            }
+        }
+
+        const char *newline = static_cast<const char *>(std::memchr(lineBegin, '\n', size_t(end - lineBegin)));
+        const char *lineEnd = newline ? newline : end;
+
+        line += int(std::count(lineCounted, lineBegin, '\n'));
+        lineCounted = lineBegin;
+
+        const char *textEnd = (lineEnd > lineBegin && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+        LineMatch match;
+        if (matchLine(lineBegin, textEnd, &match)) {
+            match.line = line;
+            matches->append(match);
+            ++count;
+        }
+
+        if (!newline) {
+            break;
+        }
+        p = newline + 1;
+    }
+    return count;
+}
+
+const char *TextMatcher::findPrefilter(const char *from, const char *end) const
+{
+    const int length = m_prefilter.size();
+    if (end - from < length) {
+        return nullptr;
+    }
+
+    if (m_literalsCaseSensitive) {
+#ifdef Q_OS_UNIX
+        return static_cast<const char *>(::memmem(from, size_t(end - from), m_prefilter.constData(), size_t(length)));
+#else
+        const char *hit = std::search(from, end, m_prefilter.constData(), m_prefilter.constData() + length);
+        return hit != end ? hit : nullptr;
+#endif
+    }
+
+    // Both cases of the first byte are found with memchr, the rest is
+    // compared folded
+    const char lower = m_prefilter.at(0);
+    const char upper = asciiUpper(lower);
+    const char *last = end - length;
+    for (const char *p = from; p <= last;) {
+        const char *hit = static_cast<const char *>(std::memchr(p, lower, size_t(last - p + 1)));
+        if (upper != lower) {
+            const char *limit = hit ? hit : last + 1;
+            if (const char *upperHit = static_cast<const char *>(std::memchr(p, upper, size_t(limit - p)))) {
+                hit = upperHit;
+            }
+        }
+        if (!hit) {
+            return nullptr;
+        }
+        if (caselessEqual(hit + 1, m_prefilter.constData() + 1, length - 1)) {
+            return hit;
+        }
+        p = hit + 1;
+    }
+    return nullptr;
+}
+
+bool TextMatcher::matchLine(const char *begin, const char *end, LineMatch *match) const
+{
+    if (m_useRegex) {
+        const QString text = QString::fromUtf8(begin, int(end - begin));
+        const QRegularExpressionMatch result = m_regex.match(text);
+        if (!result.hasMatch()) {
+            return false;
+        }
+        match->text = text;
+        match->column = result.capturedStart();
+        match->length = result.capturedLength();
+        return true;
+    }
+
+    int offset = 0;
+    if (!matchLiteral(begin, end, &offset)) {
+        return false;
+    }
+    match->text = QString::fromUtf8(begin, int(end - begin));
+    match->column = QString::fromUtf8(begin, offset).size();
+    match->length = QString::fromUtf8(begin + offset, m_needle.size()).size();
+    return true;
+}
+
+bool TextMatcher::matchLiteral(const char *begin, const char *end, int *offset) const
+{
+    const int length = m_needle.size();
+    for (const char *p = begin;;) {
+        const char *hit = findPrefilter(p, end);
+        if (!hit) {
+            return false;
+        }
+        if (!m_options.wholeWord
+            || ((hit == begin || !isWordByte(hit[-1])) && (hit + length == end || !isWordByte(hit[length])))) {
+            *offset = int(hit - begin);
+            return true;
+        }
+        p = hit + 1;
+    }
+}
+
+int MatchBudget::remaining()
+{
+    const int budget = m_maxMatches - m_claimed.loadAcquire();
+    if (budget <= 0) {
+        m_truncated.storeRelease(1);
+        return 0;
+    }
+    return budget;
+}
+
+void MatchBudget::claim(const QString &filePath, const QVector<LineMatch> &lines, int found, QVector<SearchMatch> *batch)
+{
+    const int claimed = m_claimed.fetchAndAddOrdered(found);
+    const int allowed = qBound(0, m_maxMatches - claimed, found);
+    if (allowed < found) {
+        m_truncated.storeRelease(1);
+    }
+    for (int i = 0; i < allowed; ++i) {
+        SearchMatch match;
+        match.filePath = filePath;
+        match.line = lines.at(i).line;
+        match.column = lines.at(i).column;
+        match.length = lines.at(i).length;
+        match.lineText = lines.at(i).text;
+        batch->append(match);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef TEXTMATCHER_H
+#define TEXTMATCHER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QRegularExpression>
+#include <QAtomicInt>
+
+struct SearchOptions
+{
+    bool caseSensitive = false;
+    bool wholeWord = false;
+    bool regularExpression = false;
+};
+
+// One matching line; column and length are in UTF-16 units of text, which
+// is the whole line, so they can go straight to a QTextCursor.
+struct LineMatch
+{
+    int line = 0;
+    int column = 0;
+    int length = 0;
+    QString text;
+};
+
+// A LineMatch together with the file it was found in
+struct SearchMatch
+{
+    QString filePath;
+    int line = 0;       // zero-based
+    int column = 0;     // UTF-16 units into lineText
+    int length = 0;
+    QString lineText;
+};
+
+// Finds matching lines in a UTF-8 buffer. Literal patterns are located
+// with memchr/memmem, which glibc vectorizes; regular expressions only run
+// on lines that contain the longest literal every match must contain.
+class TextMatcher
+{
+public:
+    TextMatcher(const QString &pattern, const SearchOptions &options);
+
+    bool isValid() const { return m_valid; }
+    QString errorString() const { return m_errorString; }
+
+    // UTF-8 fragments that occur in every match, case-folded to ASCII
+    // lowercase unless the search is case-sensitive. Empty when nothing is
+    // known, e.g. for a regular expression with alternatives.
+    QVector<QByteArray> requiredLiterals() const { return m_literals; }
+    bool literalsCaseSensitive() const { return m_literalsCaseSensitive; }
+
+    // Appends up to maxMatches matching lines, one entry per line.
+    // Returns the number of entries appended.
+    int findMatches(const char *data, qint64 size, QVector<LineMatch> *matches, int maxMatches) const;
+
+    // NUL bytes near the start mark a file as binary
+    static bool isBinary(const char *data, qint64 size);
+
+private:
+    const char *findPrefilter(const char *from, const char *end) const;
+    bool matchLine(const char *begin, const char *end, LineMatch *match) const;
+    bool matchLiteral(const char *begin, const char *end, int *offset) const;
+
+    SearchOptions m_options;
+    bool m_valid;
+    QString m_errorString;
+
+    // Literal mode when m_useRegex is false: m_needle is the pattern
+    bool m_useRegex;
+    QByteArray m_needle;
+    QRegularExpression m_regex;
+
+    // The longest required literal, searched for before anything else
+    QByteArray m_prefilter;
+    QVector<QByteArray> m_literals;
+    bool m_literalsCaseSensitive;
+};
+
+// Match limit shared by the workers of one search. Workers race for what
+// is left, and the search counts as truncated once a match was dropped or
+// a file was skipped for lack of budget.
+class MatchBudget
+{
+public:
+    explicit MatchBudget(int maxMatches = 0) : m_maxMatches(maxMatches), m_claimed(0), m_truncated(0) {}
+
+    void setMaxMatches(int maxMatches) { m_maxMatches = maxMatches; }
+
+    // What a file may still look for; 0 marks the search truncated
+    int remaining();
+
+    // Claims found matches of filePath from lines and appends those that
+    // fit the budget to batch
+    void claim(const QString &filePath, const QVector<LineMatch> &lines, int found, QVector<SearchMatch> *batch);
+
+    int matchCount() const { return qMin(m_claimed.loadAcquire(), m_maxMatches); }
+    bool isTruncated() const { return m_truncated.loadAcquire(); }
+
+private:
+    int m_maxMatches;
+    QAtomicInt m_claimed;
+    QAtomicInt m_truncated;
+};
+
+#endif // TEXTMATCHER_H
@@ -0,0 +1,201 @@
+#include "trigramindex.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Removed ids stay in the posting lists until they outnumber live ones
+const int kMinCompactDeadCount = 1024;
+
+inline quint32 foldByte(char c)
+{
+    const uchar u = uchar(c);
+    return (u >= 'A' && u <= 'Z') ? quint32(u + ('a' - 'A')) : quint32(u);
+}
+
+} // namespace
+
+TrigramIndex::TrigramIndex()
+    : m_deadCount(0)
+{
+}
+
+void TrigramIndex::extractTrigrams(const char *data, qint64 size, std::vector<quint32> *trigrams)
+{
+    trigrams->clear();
+    if (size < 3) {
+        return;
+    }
+
+    trigrams->reserve(size_t(size - 2));
+    quint32 trigram = (foldByte(data[0]) << 8) | foldByte(data[1]);
+    for (qint64 i = 2; i < size; ++i) {
+        trigram = ((trigram << 8) | foldByte(data[i])) & 0xffffff;
+        trigrams->push_back(trigram);
+    }
+
+    std::sort(trigrams->begin(), trigrams->end());
+    trigrams->erase(std::unique(trigrams->begin(), trigrams->end()), trigrams->end());
+}
+
+std::vector<quint32> TrigramIndex::queryTrigrams(const QVector<QByteArray> &literals)
+{
+    std::vector<quint32> result;
+    std::vector<quint32> trigrams;
+    for (const QByteArray &literal : literals) {
+        extractTrigrams(literal.constData(), literal.size(), &trigrams);
+        result.insert(result.end(), trigrams.begin(), trigrams.end());
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void TrigramIndex::addFile(const QString &filePath, const std::vector<quint32> &trigrams)
+{
+    const quint32 id = allocateId(filePath);
+    for (const quint32 trigram : trigrams) {
+        m_postings[trigram].push_back(id);
+    }
+}
+
+void TrigramIndex::addUnindexedFile(const QString &filePath)
+{
+    m_unindexed.insert(allocateId(filePath));
+}
+
+void TrigramIndex::removeFile(const QString &filePath)
+{
+    const auto it = m_ids.find(filePath);
+    if (it == m_ids.end()) {
+        return;
+    }
+
+    m_paths[int(it.value())].clear();
+    m_unindexed.remove(it.value());
+    m_ids.erase(it);
+    ++m_deadCount;
+
+    if (m_deadCount >= kMinCompactDeadCount && m_deadCount > m_ids.size()) {
+        compact();
+    }
+}
+
+void TrigramIndex::clear()
+{
+    m_ids.clear();
+    m_paths.clear();
+    m_unindexed.clear();
+    m_postings.clear();
+    m_deadCount = 0;
+}
+
+QStringList TrigramIndex::candidates(const std::vector<quint32> &trigrams) const
+{
+    QStringList result;
+
+    if (trigrams.empty()) {
+        result.reserve(m_ids.size());
+        for (const QString &path : m_paths) {
+            if (!path.isEmpty()) {
+                result.append(path);
+            }
+        }
+        return result;
+    }
+
+    // Intersect starting from the shortest list; a missing trigram leaves
+    // only the unindexed files
+    std::vector<const std::vector<quint32> *> lists;
+    lists.reserve(trigrams.size());
+    bool missing = false;
+    for (const quint32 trigram : trigrams) {
+        const auto it = m_postings.find(trigram);
+        if (it == m_postings.end()) {
+            missing = true;
+            break;
+        }
+        lists.push_back(&it->second);
+    }
+
+    std::vector<quint32> ids;
+    if (!missing) {
+        std::sort(lists.begin(), lists.end(), [](const std::vector<quint32> *a, const std::vector<quint32> *b) {
+            return a->size() < b->size();
+        });
+        ids = *lists.front();
+        std::vector<quint32> intersection;
+        for (size_t i = 1; i < lists.size() && !ids.empty(); ++i) {
+            intersection.clear();
+            std::set_intersection(ids.begin(), ids.end(), lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(intersection));
+            ids.swap(intersection);
+        }
+    }
+
+    result.reserve(int(ids.size()) + m_unindexed.size());
+    for (const quint32 id : ids) {
+        const QString &path = m_paths.at(int(id));
+        if (!path.isEmpty()) {
+            result.append(path);
+        }
+    }
+    for (const quint32 id : m_unindexed) {
+        result.append(m_paths.at(int(id)));
+    }
+    return result;
+}
+
+quint32 TrigramIndex::allocateId(const QString &filePath)
+{
+    removeFile(filePath);
+
+    const quint32 id = quint32(m_paths.size());
+    m_paths.append(filePath);
+    m_ids.insert(filePath, id);
+    return id;
+}
+
+void TrigramIndex::compact()
+{
+    // Renumbering in id order keeps every posting list sorted
+    QVector<quint32> newIds(m_paths.size(), quint32(-1));
+    QVector<QString> paths;
+    paths.reserve(m_ids.size());
+    for (int id = 0; id < m_paths.size(); ++id) {
+        if (!m_paths.at(id).isEmpty()) {
+            newIds[id] = quint32(paths.size());
+            paths.append(m_paths.at(id));
+        }
+    }
+
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        std::vector<quint32> &ids = it->second;
+        size_t kept = 0;
+        for (const quint32 id : ids) {
+            if (newIds.at(int(id)) != quint32(-1)) {
+                ids[kept++] = newIds.at(int(id));
+            }
+        }
+        if (kept == 0) {
+            it = m_postings.erase(it);
+            continue;
+        }
+        ids.resize(kept);
+        ids.shrink_to_fit();
+        ++it;
+    }
+
+    QSet<quint32> unindexed;
+    for (const quint32 id : m_unindexed) {
+        unindexed.insert(newIds.at(int(id)));
+    }
+    for (auto it = m_ids.begin(); it != m_ids.end(); ++it) {
+        it.value() = newIds.at(int(it.value()));
+    }
+
+    m_unindexed = unindexed;
+    m_paths = paths;
+    m_deadCount = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+
+#include <unordered_map>
+#include <vector>
+
+// Inverted index from byte trigrams to the files containing them. ASCII is
+// folded to lowercase, so one index serves case-sensitive and caseless
+// searches; candidates are always verified against the file content.
+//
+// Not thread-safe; SearchEngine guards it with a read/write lock.
+class TrigramIndex
+{
+public:
+    TrigramIndex();
+
+    // Sorted, unique trigrams of data
+    static void extractTrigrams(const char *data, qint64 size, std::vector<quint32> *trigrams);
+    // Trigrams every file containing all of the literals must have
+    static std::vector<quint32> queryTrigrams(const QVector<QByteArray> &literals);
+
+    // Adds or replaces a file. Unindexed files, too large or unreadable
+    // when they were indexed, are candidates for every search.
+    void addFile(const QString &filePath, const std::vector<quint32> &trigrams);
+    void addUnindexedFile(const QString &filePath);
+    void removeFile(const QString &filePath);
+    void clear();
+
+    int fileCount() const { return m_ids.size(); }
+
+    // Files that may contain a match for a query with these trigrams; all
+    // files when there are none
+    QStringList candidates(const std::vector<quint32> &trigrams) const;
+
+private:
+    quint32 allocateId(const QString &filePath);
+    void compact();
+
+    QHash<QString, quint32> m_ids;
+    // By id; empty once the file was removed or replaced. Ids only grow,
+    // which keeps posting lists sorted by appending.
+    QVector<QString> m_paths;
+    QSet<quint32> m_unindexed;
+    std::unordered_map<quint32, std::vector<quint32>> m_postings;
+    int m_deadCount;
+};
+
+#endif // TRIGRAMINDEX_H
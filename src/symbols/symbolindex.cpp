@@ -0,0 +1,619 @@
+#include "symbolindex.h"
+#include "util/projectpaths.h"
+#include "project/jobworkers.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QAtomicInt>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const quint32 kIndexMagic = 0x4b53594d;   // "KSYM"
+const quint32 kIndexVersion = 1;
+
+// Larger files are generated or vendored; they are listed without symbols
+const qint64 kMaxParsedFileSize = 8 * 1024 * 1024;
+
+// Parsed files are handed to the GUI thread in batches of this size
+const int kBatchSize = 64;
+
+const int kMaxWorkers = 16;
+
+struct ParsedFile
+{
+    QString path;
+    FileSymbols entry;
+    bool fresh;   // parsed now rather than taken from the cache
+};
+
+// Modification time in nanoseconds
+bool statFile(const QString &path, qint64 *mtime, qint64 *size)
+{
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return false;
+    }
+    *mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    *size = st.st_size;
+#else
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return false;
+    }
+    *mtime = info.lastModified().toMSecsSinceEpoch() * 1000000;
+    *size = info.size();
+#endif
+    return true;
+}
+
+// On-disk layout: a header, one table of the distinct UTF-8 strings (file
+// paths relative to the root, names and containers), then per file its stat
+// data and symbols, which refer to strings by index. Names repeat a lot
+// across a project; after loading, equal strings share one QString.
+SymbolTable readSymbolIndex(const QString &rootPath)
+{
+    SymbolTable table;
+    QFile file(SymbolIndex::indexPath(rootPath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return table;
+    }
+    const qint64 fileSize = file.size();
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_9);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString root;
+    in >> magic >> version >> root;
+    if (in.status() != QDataStream::Ok || magic != kIndexMagic || version != kIndexVersion || root != rootPath) {
+        return table;
+    }
+
+    // Counts are checked against the file size before anything is allocated
+    quint32 stringCount = 0;
+    in >> stringCount;
+    if (in.status() != QDataStream::Ok || qint64(stringCount) > fileSize) {
+        return table;
+    }
+    QVector<QString> strings;
+    strings.reserve(int(stringCount));
+    for (quint32 i = 0; i < stringCount; ++i) {
+        QByteArray bytes;
+        in >> bytes;
+        strings.append(QString::fromUtf8(bytes));
+    }
+
+    quint32 fileCount = 0;
+    in >> fileCount;
+    if (in.status() != QDataStream::Ok || qint64(fileCount) > fileSize) {
+        return table;
+    }
+    const quint32 stringLimit = quint32(strings.size());
+    for (quint32 i = 0; i < fileCount; ++i) {
+        quint32 path = 0;
+        quint32 symbolCount = 0;
+        FileSymbols entry;
+        in >> path >> entry.mtime >> entry.size >> symbolCount;
+        if (in.status() != QDataStream::Ok || path >= stringLimit || qint64(symbolCount) > fileSize) {
+            return SymbolTable();
+        }
+
+        entry.symbols.resize(int(symbolCount));
+        for (Symbol &symbol : entry.symbols) {
+            quint32 name = 0;
+            quint32 container = 0;
+            quint8 kind = 0;
+            quint8 definition = 0;
+            quint32 line = 0;
+            quint32 column = 0;
+            in >> name >> container >> kind >> definition >> line >> column;
+            if (name >= stringLimit || container >= stringLimit || kind > Symbol::Macro) {
+                return SymbolTable();
+            }
+            symbol.name = strings.at(int(name));
+            symbol.container = strings.at(int(container));
+            symbol.kind = Symbol::Kind(kind);
+            symbol.definition = definition != 0;
+            symbol.line = int(qMin(line, quint32(INT_MAX)));
+            symbol.column = int(qMin(column, quint32(INT_MAX)));
+        }
+        if (in.status() != QDataStream::Ok) {
+            return SymbolTable();
+        }
+        table.insert(rootPath + '/' + strings.at(int(path)), entry);
+    }
+    return table;
+}
+
+bool writeSymbolIndex(const QString &rootPath, const SymbolTable &table)
+{
+    QVector<QString> strings;
+    QHash<QString, quint32> stringIds;
+    auto intern = [&strings, &stringIds](const QString &string) {
+        const auto it = stringIds.constFind(string);
+        if (it != stringIds.constEnd()) {
+            return it.value();
+        }
+        const quint32 id = quint32(strings.size());
+        stringIds.insert(string, id);
+        strings.append(string);
+        return id;
+    };
+
+    // Strings go first in the file, so they are all collected up front
+    const QString prefix = rootPath + '/';
+    QVector<quint32> pathIds;
+    pathIds.reserve(table.size());
+    intern(QString());
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it) {
+        pathIds.append(intern(it.key().startsWith(prefix) ? it.key().mid(prefix.size()) : it.key()));
+        for (const Symbol &symbol : it.value().symbols) {
+            intern(symbol.name);
+            intern(symbol.container);
+        }
+    }
+
+    const QString fileName = SymbolIndex::indexPath(rootPath);
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile out(fileName);
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << kIndexMagic << kIndexVersion << rootPath;
+
+    stream << quint32(strings.size());
+    for (const QString &string : strings) {
+        stream << string.toUtf8();
+    }
+
+    stream << quint32(table.size());
+    int fileIndex = 0;
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it, ++fileIndex) {
+        const FileSymbols &entry = it.value();
+        stream << pathIds.at(fileIndex) << entry.mtime << entry.size << quint32(entry.symbols.size());
+        for (const Symbol &symbol : entry.symbols) {
+            stream << stringIds.value(symbol.name) << stringIds.value(symbol.container)
+                   << quint8(symbol.kind) << quint8(symbol.definition ? 1 : 0)
+                   << quint32(symbol.line) << quint32(symbol.column);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        out.cancelWriting();
+        return false;
+    }
+    return out.commit();
+}
+
+inline bool isWordStart(const QString &text, int position)
+{
+    if (position == 0) {
+        return true;
+    }
+    const QChar previous = text.at(position - 1);
+    return previous == '_' || (previous.isLower() && text.at(position).isUpper());
+}
+
+// Exact beats prefix beats a substring at a word start beats any substring
+// beats a scattered subsequence. Returns INT_MIN when nothing matches.
+int scoreName(const QString &name, const QString &query)
+{
+    if (name == query) {
+        return 1000;
+    }
+    if (name.compare(query, Qt::CaseInsensitive) == 0) {
+        return 950;
+    }
+    if (name.startsWith(query, Qt::CaseInsensitive)) {
+        return 800 - qMin(name.size() - query.size(), 100);
+    }
+    const int position = name.indexOf(query, 0, Qt::CaseInsensitive);
+    if (position > 0) {
+        return (isWordStart(name, position) ? 650 : 500) - qMin(position, 50) - qMin(name.size() - query.size(), 50);
+    }
+
+    int score = 300;
+    int from = 0;
+    for (const QChar c : query) {
+        const QChar folded = c.toLower();
+        int found = -1;
+        for (int i = from; i < name.size(); ++i) {
+            if (name.at(i).toLower() == folded) {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0) {
+            return INT_MIN;
+        }
+        score += isWordStart(name, found) ? 10 : 0;
+        score -= qMin(found - from, 10);
+        from = found + 1;
+    }
+    return score - qMin(name.size() - query.size(), 50);
+}
+
+} // namespace
+
+struct SymbolJob
+{
+    QStringList files;
+    SymbolTable cached;
+    // Removed while the job ran; only touched on the GUI thread
+    QSet<QString> removed;
+    QAtomicInt next;
+    JobWorkers workers;
+    QAtomicInt cancelled;
+    int generation = 0;
+};
+
+SymbolIndex::SymbolIndex(QObject *parent)
+    : QObject(parent)
+    , m_symbolCount(0)
+    , m_loadWatcher(new QFutureWatcher<SymbolTable>(this))
+    , m_saveWatcher(new QFutureWatcher<bool>(this))
+    , m_loading(false)
+    , m_dirty(false)
+    , m_savePending(false)
+    , m_generation(0)
+{
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), kMaxWorkers));
+
+    connect(m_loadWatcher, &QFutureWatcher<SymbolTable>::finished, this, [this]() {
+        // A clear() while loading drops the result
+        if (!m_loading) {
+            return;
+        }
+        m_loading = false;
+        m_cache = m_loadWatcher->result();
+        startIndexing();
+    });
+    connect(m_saveWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        if (m_savePending) {
+            startSave();
+        }
+    });
+}
+
+SymbolIndex::~SymbolIndex()
+{
+    if (m_job) {
+        m_job->cancelled.storeRelease(1);
+    }
+    m_pool.waitForDone();
+    m_loadWatcher->waitForFinished();
+    // A save still waiting is dropped; the next open reparses what it
+    // would have covered, by stat data
+    m_saveWatcher->waitForFinished();
+}
+
+QString SymbolIndex::indexPath(const QString &rootPath)
+{
+    return projectCachePath(rootPath, "symbols", ".index");
+}
+
+void SymbolIndex::setRootPath(const QString &rootPath)
+{
+    clear();
+    m_rootPath = QDir::cleanPath(rootPath);
+
+    // Files reported meanwhile wait until the cached table is in
+    m_loading = true;
+    m_loadWatcher->setFuture(QtConcurrent::run(readSymbolIndex, m_rootPath));
+}
+
+void SymbolIndex::updateFiles(const QStringList &added, const QStringList &removed, const QStringList &modified)
+{
+    for (const QString &filePath : removed) {
+        m_pendingFiles.remove(filePath);
+        m_cache.remove(filePath);
+        removeFile(filePath);
+        if (m_job) {
+            m_job->removed.insert(filePath);
+        }
+    }
+    for (const QString &filePath : added) {
+        if (CppSymbolParser::isCppFile(filePath)) {
+            m_pendingFiles.insert(filePath);
+        }
+    }
+    for (const QString &filePath : modified) {
+        if (CppSymbolParser::isCppFile(filePath)) {
+            m_pendingFiles.insert(filePath);
+            m_cache.remove(filePath);
+        }
+    }
+
+    startIndexing();
+    saveIfIdle();
+}
+
+void SymbolIndex::clear()
+{
+    // Whatever was indexed completely is kept for the next open
+    saveIfIdle();
+
+    if (m_job) {
+        m_job->cancelled.storeRelease(1);
+        m_job.reset();
+    }
+    ++m_generation;
+    m_pendingFiles.clear();
+    m_files.clear();
+    m_filesByName.clear();
+    m_names.clear();
+    m_cache.clear();
+    m_symbolCount = 0;
+    m_loading = false;
+    m_dirty = false;
+    m_rootPath.clear();
+}
+
+QVector<SymbolLocation> SymbolIndex::lookup(const QString &name) const
+{
+    QVector<SymbolLocation> result;
+    const QList<QString> files = m_filesByName.values(name);
+    for (const QString &filePath : files) {
+        for (const Symbol &symbol : m_files.value(filePath).symbols) {
+            if (symbol.name == name) {
+                result.append(SymbolLocation{filePath, symbol});
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const SymbolLocation &a, const SymbolLocation &b) {
+        if (a.symbol.definition != b.symbol.definition) {
+            return a.symbol.definition;
+        }
+        if (a.filePath != b.filePath) {
+            return a.filePath < b.filePath;
+        }
+        return a.symbol.line < b.symbol.line;
+    });
+    return result;
+}
+
+QVector<SymbolLocation> SymbolIndex::search(const QString &query, int maxResults) const
+{
+    QVector<SymbolLocation> result;
+    QString name = query.trimmed();
+    QString container;
+    const int separator = name.lastIndexOf(QStringLiteral("::"));
+    if (separator >= 0) {
+        container = name.left(separator);
+        name = name.mid(separator + 2);
+    }
+    if (name.isEmpty() && container.isEmpty()) {
+        return result;
+    }
+
+    struct Candidate
+    {
+        int score;
+        const QString *filePath;
+        const Symbol *symbol;
+    };
+    std::vector<Candidate> candidates;
+
+    for (auto it = m_files.constBegin(); it != m_files.constEnd(); ++it) {
+        for (const Symbol &symbol : it.value().symbols) {
+            int score = name.isEmpty() ? 0 : scoreName(symbol.name, name);
+            if (score == INT_MIN) {
+                continue;
+            }
+            if (!container.isEmpty() && !symbol.container.contains(container, Qt::CaseInsensitive)) {
+                continue;
+            }
+            if (symbol.definition) {
+                score += 20;
+            }
+            candidates.push_back(Candidate{score, &it.key(), &symbol});
+        }
+    }
+
+    const size_t shown = qMin(candidates.size(), size_t(qMax(0, maxResults)));
+    std::partial_sort(candidates.begin(), candidates.begin() + shown, candidates.end(),
+                      [](const Candidate &a, const Candidate &b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (a.symbol->name.size() != b.symbol->name.size()) {
+            return a.symbol->name.size() < b.symbol->name.size();
+        }
+        return *a.filePath < *b.filePath;
+    });
+
+    result.reserve(int(shown));
+    for (size_t i = 0; i < shown; ++i) {
+        result.append(SymbolLocation{*candidates[i].filePath, *candidates[i].symbol});
+    }
+    return result;
+}
+
+void SymbolIndex::startIndexing()
+{
+    if (m_loading || m_job || m_pendingFiles.isEmpty()) {
+        return;
+    }
+
+    // One job at a time; files reported meanwhile wait for the next one
+    QSharedPointer<SymbolJob> job(new SymbolJob);
+    job->files = m_pendingFiles.values();
+    job->generation = m_generation;
+    for (const QString &filePath : job->files) {
+        const auto it = m_cache.constFind(filePath);
+        if (it != m_cache.constEnd()) {
+            job->cached.insert(filePath, it.value());
+        }
+    }
+    m_pendingFiles.clear();
+    m_job = job;
+
+    const int workerCount = qMin(m_pool.maxThreadCount(), (job->files.size() + kBatchSize - 1) / kBatchSize);
+    job->workers.start(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        QtConcurrent::run(&m_pool, [this, job] { runWorker(job); });
+    }
+}
+
+void SymbolIndex::runWorker(const QSharedPointer<SymbolJob> &job)
+{
+    // Runs on a pool thread
+    QVector<ParsedFile> batch;
+
+    auto post = [this, &job, &batch]() {
+        const int generation = job->generation;
+        const QSharedPointer<SymbolJob> owner = job;
+        const QVector<ParsedFile> files = batch;
+        QMetaObject::invokeMethod(this, [this, generation, owner, files] {
+            if (generation != m_generation) {
+                return;
+            }
+            for (const ParsedFile &file : files) {
+                if (owner->removed.contains(file.path)) {
+                    continue;
+                }
+                setFileSymbols(file.path, file.entry);
+                if (file.fresh) {
+                    m_dirty = true;
+                }
+            }
+        }, Qt::QueuedConnection);
+        batch.clear();
+    };
+
+    while (!job->cancelled.loadAcquire()) {
+        const int i = job->next.fetchAndAddRelaxed(1);
+        if (i >= job->files.size()) {
+            break;
+        }
+
+        ParsedFile file;
+        file.path = job->files.at(i);
+        file.fresh = true;
+        if (!statFile(file.path, &file.entry.mtime, &file.entry.size)) {
+            continue;
+        }
+
+        // Unchanged since the cached table was written
+        const auto cached = job->cached.constFind(file.path);
+        if (cached != job->cached.constEnd() && cached->mtime == file.entry.mtime && cached->size == file.entry.size) {
+            file.entry.symbols = cached->symbols;
+            file.fresh = false;
+        } else if (file.entry.size > 0 && file.entry.size <= kMaxParsedFileSize) {
+            QFile input(file.path);
+            if (input.open(QIODevice::ReadOnly)) {
+                if (uchar *data = input.map(0, input.size())) {
+                    file.entry.symbols = CppSymbolParser::parse(reinterpret_cast<const char *>(data), input.size());
+                    input.unmap(data);
+                } else {
+                    const QByteArray contents = input.readAll();
+                    file.entry.symbols = CppSymbolParser::parse(contents.constData(), contents.size());
+                }
+            }
+        }
+
+        batch.append(file);
+        if (batch.size() >= kBatchSize) {
+            post();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        post();
+    }
+
+    const int generation = job->generation;
+    job->workers.finish(this, [this, generation] {
+        if (generation != m_generation) {
+            return;
+        }
+        m_job.reset();
+        if (!m_pendingFiles.isEmpty()) {
+            startIndexing();
+            return;
+        }
+        // Every file the project listed so far has been through the cache
+        m_cache.clear();
+        saveIfIdle();
+        emit indexingFinished(m_files.size(), m_symbolCount);
+    });
+}
+
+void SymbolIndex::setFileSymbols(const QString &filePath, const FileSymbols &entry)
+{
+    removeFile(filePath);
+    m_files.insert(filePath, entry);
+    m_symbolCount += entry.symbols.size();
+
+    QSet<QString> names;
+    for (const Symbol &symbol : entry.symbols) {
+        if (!names.contains(symbol.name)) {
+            names.insert(symbol.name);
+            m_filesByName.insert(symbol.name, filePath);
+            m_names.insert(symbol.name);
+        }
+    }
+}
+
+void SymbolIndex::removeFile(const QString &filePath)
+{
+    const auto it = m_files.find(filePath);
+    if (it == m_files.end()) {
+        return;
+    }
+
+    QSet<QString> names;
+    for (const Symbol &symbol : it.value().symbols) {
+        names.insert(symbol.name);
+    }
+    for (const QString &name : names) {
+        m_filesByName.remove(name, filePath);
+        m_names.remove(name);
+    }
+    m_symbolCount -= it.value().symbols.size();
+    m_files.erase(it);
+    m_dirty = true;
+}
+
+void SymbolIndex::saveIfIdle()
+{
+    if (!m_dirty || m_loading || m_job || !m_pendingFiles.isEmpty() || m_rootPath.isEmpty()) {
+        return;
+    }
+
+    // The table is shared, not copied, until the GUI thread changes it
+    m_pendingSaveRoot = m_rootPath;
+    m_pendingSaveTable = m_files;
+    m_savePending = true;
+    m_dirty = false;
+    if (!m_saveWatcher->isRunning()) {
+        startSave();
+    }
+}
+
+void SymbolIndex::startSave()
+{
+    m_savePending = false;
+    m_saveWatcher->setFuture(QtConcurrent::run(writeSymbolIndex, m_pendingSaveRoot, m_pendingSaveTable));
+    m_pendingSaveRoot.clear();
+    m_pendingSaveTable.clear();
+}
@@ -0,0 +1,107 @@
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+
+#include "symbolparser.h"
+#include "editor/identifiertrie.h"
+
+struct SymbolJob;
+
+struct SymbolLocation
+{
+    QString filePath;
+    Symbol symbol;
+};
+
+// Symbols of one file, with the stat data they were parsed from
+struct FileSymbols
+{
+    qint64 mtime = 0;
+    qint64 size = 0;
+    QVector<Symbol> symbols;
+};
+
+typedef QHash<QString, FileSymbols> SymbolTable;
+
+// Declarations and definitions of the project's C and C++ files. Files are
+// parsed on a thread pool as the project reports them and only again when
+// they change; the table is cached on disk, so a reopened project only
+// parses what changed since. Lookups are answered from memory on the GUI
+// thread.
+class SymbolIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SymbolIndex(QObject *parent = nullptr);
+    ~SymbolIndex();
+
+    // Starts over for a project and loads its cached table in the background
+    void setRootPath(const QString &rootPath);
+    // Takes ProjectManager::filesChanged deltas; other files are ignored
+    void updateFiles(const QStringList &added, const QStringList &removed, const QStringList &modified);
+    void clear();
+
+    QString rootPath() const { return m_rootPath; }
+    bool isIndexing() const { return m_loading || !m_job.isNull(); }
+    int fileCount() const { return m_files.size(); }
+    int symbolCount() const { return m_symbolCount; }
+
+    // Everything named exactly name, definitions first
+    QVector<SymbolLocation> lookup(const QString &name) const;
+    // Fuzzy match on names, best first. "Class::name" also matches the
+    // container.
+    QVector<SymbolLocation> search(const QString &query, int maxResults) const;
+    // Distinct symbol names starting with prefix, case-insensitively
+    QStringList completions(const QString &prefix, int maxResults) const { return m_names.complete(prefix, maxResults); }
+
+    static QString indexPath(const QString &rootPath);
+
+signals:
+    void indexingFinished(int fileCount, int symbolCount);
+
+private:
+    void startIndexing();
+    void runWorker(const QSharedPointer<SymbolJob> &job);
+    void applyResults(int generation, const SymbolTable &results);
+    void setFileSymbols(const QString &filePath, const FileSymbols &entry);
+    void removeFile(const QString &filePath);
+    void saveIfIdle();
+    void startSave();
+
+    QString m_rootPath;
+    QThreadPool m_pool;
+
+    SymbolTable m_files;
+    QMultiHash<QString, QString> m_filesByName;
+    IdentifierTrie m_names;   // counted once per file
+    int m_symbolCount;
+
+    // The table read from disk; entries are used when stat data still match
+    SymbolTable m_cache;
+    QFutureWatcher<SymbolTable> *m_loadWatcher;
+    QFutureWatcher<bool> *m_saveWatcher;
+    bool m_loading;
+    bool m_dirty;
+
+    // A save requested while one is written; only the latest is kept
+    bool m_savePending;
+    QString m_pendingSaveRoot;
+    SymbolTable m_pendingSaveTable;
+
+    QSet<QString> m_pendingFiles;
+    QSharedPointer<SymbolJob> m_job;
+    int m_generation;
+};
+
+#endif // SYMBOLINDEX_H
@@ -0,0 +1,1117 @@
+#include "symbolparser.h"
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QSet>
+
+#include <climits>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct Token
+{
+    enum Type : quint8 {
+        Identifier,
+        Punctuation,
+        Literal
+    };
+
+    Type type;
+    int offset;
+    int length;
+    int line;
+    int lineStart;
+};
+
+struct Scope
+{
+    enum Kind {
+        Namespace,
+        Class,
+        Enum,
+        Body,           // function body or plain block; skipped
+        Initializer     // braces inside a declaration; skipped, the statement goes on
+    };
+
+    Kind kind;
+    QString container;
+    bool typedefName;   // "typedef struct { } Name;"
+};
+
+// Words that can precede "(" without naming a function
+const QSet<QByteArray> &nonFunctionWords()
+{
+    static const QSet<QByteArray> words = {
+        "if", "for", "while", "switch", "catch", "return", "sizeof", "alignof", "decltype",
+        "typeid", "static_assert", "_Static_assert", "noexcept", "throw", "requires", "new",
+        "delete", "defined", "asm", "__asm", "__asm__", "typeof", "__typeof__", "do", "else",
+        "case", "goto", "co_await", "co_return", "co_yield",
+        "void", "bool", "char", "short", "int", "long", "float", "double", "signed", "unsigned",
+        "auto", "const", "volatile", "static", "extern", "inline", "virtual", "explicit",
+        "constexpr", "struct", "class", "union", "enum", "typename", "template", "mutable",
+        "register", "thread_local", "wchar_t", "char16_t", "char32_t", "char8_t", "this",
+        "public", "private", "protected", "friend", "using", "namespace", "typedef",
+        "override", "final"
+    };
+    return words;
+}
+
+// Groups that carry no declaration and are dropped from statements
+const QSet<QByteArray> &attributeWords()
+{
+    static const QSet<QByteArray> words = {
+        "__attribute__", "__attribute", "__declspec", "alignas", "_Alignas"
+    };
+    return words;
+}
+
+const QSet<QByteArray> &accessWords()
+{
+    static const QSet<QByteArray> words = {
+        "public", "private", "protected", "signals", "slots", "Q_SIGNALS", "Q_SLOTS"
+    };
+    return words;
+}
+
+inline bool isIdentifierStart(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || uchar(c) >= 0x80;
+}
+
+inline bool isIdentifierChar(char c)
+{
+    return isIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+class Parser
+{
+public:
+    Parser(const char *data, int size)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    QVector<Symbol> run()
+    {
+        tokenize();
+        m_scopes.push_back(Scope{Scope::Namespace, QString(), false});
+        parse();
+        return m_symbols;
+    }
+
+private:
+    // Tokens --------------------------------------------------------------
+
+    void tokenize()
+    {
+        const char *begin = m_data;
+        const char *end = m_data + m_size;
+        const char *p = begin;
+        int line = 0;
+        int lineStart = 0;
+        bool lineBlank = true;
+        int disabledDepth = 0;    // inside "#if 0"
+
+        m_tokens.reserve(size_t(m_size / 5));
+
+        while (p < end) {
+            const char c = *p;
+            if (c == '\n') {
+                ++p;
+                ++line;
+                lineStart = int(p - begin);
+                lineBlank = true;
+                continue;
+            }
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+                ++p;
+                continue;
+            }
+            if (c == '/' && p + 1 < end && p[1] == '/') {
+                while (p < end && *p != '\n') {
+                    ++p;
+                }
+                continue;
+            }
+            if (c == '/' && p + 1 < end && p[1] == '*') {
+                p += 2;
+                while (p < end && !(*p == '*' && p + 1 < end && p[1] == '/')) {
+                    if (*p == '\n') {
+                        ++line;
+                        lineStart = int(p - begin) + 1;
+                    }
+                    ++p;
+                }
+                p = p < end ? p + 2 : end;
+                continue;
+            }
+            if (c == '#' && lineBlank) {
+                p = preprocessor(p + 1, &line, &lineStart, &disabledDepth);
+                continue;
+            }
+            lineBlank = false;
+
+            if (disabledDepth > 0) {
+                ++p;
+                continue;
+            }
+
+            Token token;
+            token.offset = int(p - begin);
+            token.line = line;
+            token.lineStart = lineStart;
+
+            if (c == '"' || c == '\'') {
+                p = skipQuoted(p, end);
+                token.type = Token::Literal;
+            } else if (isIdentifierStart(c)) {
+                while (p < end && isIdentifierChar(*p)) {
+                    ++p;
+                }
+                token.type = Token::Identifier;
+                const int length = int(p - begin) - token.offset;
+                // R"delim( ... )delim", also with an encoding prefix
+                if (p < end && *p == '"' && begin[token.offset + length - 1] == 'R' && length <= 3) {
+                    p = skipRawString(p, end, &line, &lineStart);
+                    token.type = Token::Literal;
+                } else if (p < end && (*p == '"' || *p == '\'') && length <= 2) {
+                    // u8"", L'', u"" and friends
+                    p = skipQuoted(p, end);
+                    token.type = Token::Literal;
+                }
+            } else if (isDigit(c) || (c == '.' && p + 1 < end && isDigit(p[1]))) {
+                ++p;
+                while (p < end) {
+                    const char d = *p;
+                    if (isIdentifierChar(d) || d == '.' || d == '\'') {
+                        ++p;
+                    } else if ((d == '+' || d == '-')
+                               && (p[-1] == 'e' || p[-1] == 'E' || p[-1] == 'p' || p[-1] == 'P')) {
+                        ++p;
+                    } else {
+                        break;
+                    }
+                }
+                token.type = Token::Literal;
+            } else {
+                token.type = Token::Punctuation;
+                // "::" and "->" are kept whole; ">>" is not, it may close two
+                // template argument lists
+                if (p + 1 < end && ((c == ':' && p[1] == ':') || (c == '-' && p[1] == '>'))) {
+                    p += 2;
+                } else {
+                    ++p;
+                }
+            }
+
+            token.length = int(p - begin) - token.offset;
+            m_tokens.push_back(token);
+        }
+    }
+
+    const char *skipQuoted(const char *p, const char *end) const
+    {
+        const char quote = *p++;
+        while (p < end && *p != quote && *p != '\n') {
+            if (*p == '\\' && p + 1 < end && p[1] != '\n') {
+                p += 2;
+            } else {
+                ++p;
+            }
+        }
+        return p < end && *p == quote ? p + 1 : p;
+    }
+
+    const char *skipRawString(const char *p, const char *end, int *line, int *lineStart) const
+    {
+        ++p;
+        const char *delimiter = p;
+        while (p < end && *p != '(' && *p != '\n' && p - delimiter < 16) {
+            ++p;
+        }
+        if (p >= end || *p != '(') {
+            return p;
+        }
+        QByteArray terminator = ")" + QByteArray(delimiter, int(p - delimiter)) + "\"";
+        ++p;
+        while (p < end) {
+            if (*p == '\n') {
+                ++*line;
+                *lineStart = int(p - m_data) + 1;
+            } else if (*p == ')' && end - p >= terminator.size()
+                       && std::memcmp(p, terminator.constData(), size_t(terminator.size())) == 0) {
+                return p + terminator.size();
+            }
+            ++p;
+        }
+        return end;
+    }
+
+    // Handles one directive starting after '#' and returns the end of its
+    // logical line. Records macro definitions and tracks "#if 0" blocks.
+    const char *preprocessor(const char *p, int *line, int *lineStart, int *disabledDepth)
+    {
+        const char *end = m_data + m_size;
+        auto skipSpaces = [&p, end]() {
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                ++p;
+            }
+        };
+        auto readWord = [&p, end]() {
+            const char *start = p;
+            while (p < end && isIdentifierChar(*p)) {
+                ++p;
+            }
+            return QByteArray::fromRawData(start, int(p - start));
+        };
+
+        skipSpaces();
+        const QByteArray directive = readWord();
+        if (*disabledDepth > 0) {
+            if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+                ++*disabledDepth;
+            } else if (directive == "endif") {
+                --*disabledDepth;
+            } else if ((directive == "else" || directive == "elif") && *disabledDepth == 1) {
+                *disabledDepth = 0;
+            }
+        } else if (directive == "if") {
+            skipSpaces();
+            if (p < end && *p == '0' && (p + 1 >= end || !isIdentifierChar(p[1]))) {
+                *disabledDepth = 1;
+            }
+        } else if (directive == "define") {
+            skipSpaces();
+            Token token;
+            token.offset = int(p - m_data);
+            token.line = *line;
+            token.lineStart = *lineStart;
+            token.length = readWord().size();
+            token.type = Token::Identifier;
+            if (token.length > 0) {
+                addSymbol(token, QString::fromUtf8(m_data + token.offset, token.length), Symbol::Macro, true, QString(),
+                          false);
+            }
+        }
+
+        while (p < end && *p != '\n') {
+            if (*p == '\\' && p + 1 < end && (p[1] == '\n' || (p[1] == '\r' && p + 2 < end && p[2] == '\n'))) {
+                p += p[1] == '\n' ? 2 : 3;
+                ++*line;
+                *lineStart = int(p - m_data);
+            } else {
+                ++p;
+            }
+        }
+        return p;
+    }
+
+    // Token helpers -------------------------------------------------------
+
+    const Token &token(int index) const
+    {
+        return m_tokens[size_t(index)];
+    }
+
+    QByteArray text(int index) const
+    {
+        return QByteArray::fromRawData(m_data + token(index).offset, token(index).length);
+    }
+
+    QString string(int index) const
+    {
+        return QString::fromUtf8(m_data + token(index).offset, token(index).length);
+    }
+
+    bool isPunct(int index, char c) const
+    {
+        const Token &t = token(index);
+        return t.type == Token::Punctuation && t.length == 1 && m_data[t.offset] == c;
+    }
+
+    bool isScope(int index) const
+    {
+        const Token &t = token(index);
+        return t.type == Token::Punctuation && t.length == 2 && m_data[t.offset] == ':';
+    }
+
+    bool isIdentifier(int index) const
+    {
+        return token(index).type == Token::Identifier;
+    }
+
+    bool isWord(int index, const char *word) const
+    {
+        const Token &t = token(index);
+        return t.type == Token::Identifier && t.length == int(std::strlen(word))
+               && std::memcmp(m_data + t.offset, word, size_t(t.length)) == 0;
+    }
+
+    // Upper-case names are taken for macros: Q_OBJECT, Q_PROPERTY(...)
+    bool isMacroName(int index) const
+    {
+        const Token &t = token(index);
+        if (t.type != Token::Identifier || t.length < 2) {
+            return false;
+        }
+        bool hasLetter = false;
+        for (int i = t.offset; i < t.offset + t.length; ++i) {
+            const char c = m_data[i];
+            if (c >= 'A' && c <= 'Z') {
+                hasLetter = true;
+            } else if (c != '_' && !isDigit(c)) {
+                return false;
+            }
+        }
+        return hasLetter;
+    }
+
+    // Index of the token closing the group opened at index. Stops short at
+    // a statement boundary, so unbalanced macro soup cannot eat the file.
+    int skipGroup(int index) const
+    {
+        const char open = m_data[token(index).offset];
+        const char close = open == '(' ? ')' : ']';
+        int depth = 0;
+        const int count = int(m_tokens.size());
+        for (int i = index; i < count; ++i) {
+            if (isPunct(i, open)) {
+                ++depth;
+            } else if (isPunct(i, close)) {
+                if (--depth == 0) {
+                    return i;
+                }
+            } else if (isPunct(i, ';') || isPunct(i, '{') || isPunct(i, '}')) {
+                return i - 1;
+            }
+        }
+        return count - 1;
+    }
+
+    // Statement helpers ---------------------------------------------------
+    // Positions below index m_statement, which holds token indices.
+
+    int at(int position) const
+    {
+        return m_statement.at(position);
+    }
+
+    // True when the punctuation at position belongs to an operator name,
+    // like the "=" in "operator==" or the "[" in "operator[]"
+    bool isOperatorPunct(int position) const
+    {
+        for (int k = position - 1; k >= 0 && position - k <= 3; --k) {
+            if (isWord(at(k), "operator")) {
+                return true;
+            }
+            if (token(at(k)).type != Token::Punctuation) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // Walks the statement at nesting depth zero; visit(position) returns
+    // false to stop. Template argument lists count as nesting when "<"
+    // follows a name.
+    template <typename Visit>
+    void walkTopLevel(int from, int to, Visit visit) const
+    {
+        int depth = 0;
+        int angle = 0;
+        for (int k = from; k < to; ++k) {
+            const int i = at(k);
+            if (token(i).type == Token::Punctuation && !isPunct(i, '(') && isOperatorPunct(k)) {
+                continue;
+            }
+            if (isPunct(i, '(') || isPunct(i, '[') || isPunct(i, '{')) {
+                // Groups are visited by their opening token only
+                if (depth == 0 && angle == 0 && !visit(k)) {
+                    return;
+                }
+                ++depth;
+                continue;
+            }
+            if (isPunct(i, ')') || isPunct(i, ']') || isPunct(i, '}')) {
+                depth = qMax(0, depth - 1);
+                continue;
+            }
+            if (depth == 0 && isPunct(i, '<') && k > from && isIdentifier(at(k - 1))
+                && !isWord(at(k - 1), "operator")) {
+                ++angle;
+                continue;
+            }
+            if (depth == 0 && angle > 0 && isPunct(i, '>')) {
+                --angle;
+                continue;
+            }
+            if (depth == 0 && angle == 0 && !visit(k)) {
+                return;
+            }
+        }
+    }
+
+    // Position of the first top-level punctuation c, or -1
+    int findTopLevel(int from, char c) const
+    {
+        int found = -1;
+        walkTopLevel(from, m_statement.size(), [this, c, &found](int k) {
+            if (isPunct(at(k), c)) {
+                found = k;
+                return false;
+            }
+            return true;
+        });
+        return found;
+    }
+
+    int matchingParen(int position) const
+    {
+        int depth = 0;
+        for (int k = position; k < m_statement.size(); ++k) {
+            if (isPunct(at(k), '(')) {
+                ++depth;
+            } else if (isPunct(at(k), ')') && --depth == 0) {
+                return k;
+            }
+        }
+        return m_statement.size() - 1;
+    }
+
+    // Skips "template <...>", "inline", "export" and the like in front of
+    // the statement's first meaningful word
+    int statementStart() const
+    {
+        int k = 0;
+        const int size = m_statement.size();
+        while (k < size) {
+            if (isWord(at(k), "template") && k + 1 < size && isPunct(at(k + 1), '<')) {
+                int angle = 0;
+                ++k;
+                for (; k < size; ++k) {
+                    if (isPunct(at(k), '<')) {
+                        ++angle;
+                    } else if (isPunct(at(k), '>') && --angle == 0) {
+                        ++k;
+                        break;
+                    }
+                }
+            } else if (isWord(at(k), "inline") || isWord(at(k), "export")) {
+                ++k;
+            } else {
+                break;
+            }
+        }
+        return k;
+    }
+
+    struct FunctionHead
+    {
+        int name = -1;        // position of the name token
+        int paren = -1;       // position of "(" opening the parameters
+        QString text;
+        QString qualifier;
+    };
+
+    // Finds the declarator of a function: the first top-level "(" that
+    // follows a name which is not a keyword or macro
+    FunctionHead functionHead(int from) const
+    {
+        FunctionHead head;
+        const int size = m_statement.size();
+        int k = from;
+        int angle = 0;
+        while (k < size) {
+            const int i = at(k);
+            if (token(i).type == Token::Punctuation && !isPunct(i, '(') && isOperatorPunct(k)) {
+                ++k;
+                continue;
+            }
+            if (isPunct(i, '<') && k > from && isIdentifier(at(k - 1)) && !isWord(at(k - 1), "operator")) {
+                ++angle;
+            } else if (isPunct(i, '>') && angle > 0) {
+                --angle;
+            } else if (isPunct(i, '[') || isPunct(i, '{')) {
+                return head;
+            } else if (isPunct(i, '(') && angle == 0) {
+                if (k > from && nameBeforeParen(k, &head)) {
+                    head.paren = isWord(at(k - 1), "operator") ? k + 2 : k;
+                    if (head.paren >= size || !isPunct(at(head.paren), '(')) {
+                        return FunctionHead();
+                    }
+                    return head;
+                }
+                k = matchingParen(k);
+            } else if (isPunct(i, '=') && angle == 0) {
+                return head;
+            }
+            ++k;
+        }
+        return head;
+    }
+
+    bool nameBeforeParen(int paren, FunctionHead *head) const
+    {
+        int k = paren - 1;
+        const int previous = at(k);
+
+        if (isWord(previous, "operator")) {
+            // operator()(...)
+            if (paren + 1 < m_statement.size() && isPunct(at(paren + 1), ')')) {
+                head->text = QStringLiteral("operator()");
+                head->name = k;
+            } else {
+                return false;
+            }
+        } else if (token(previous).type == Token::Punctuation) {
+            // operator==, operator[], operator<<, ...
+            int j = k;
+            QString symbols;
+            while (j > 0 && token(at(j)).type == Token::Punctuation && k - j < 3) {
+                symbols.prepend(string(at(j)));
+                --j;
+            }
+            if (!isWord(at(j), "operator") || symbols.isEmpty()) {
+                return false;
+            }
+            head->text = QStringLiteral("operator") + symbols;
+            head->name = j;
+            k = j;
+        } else if (isIdentifier(previous)) {
+            if (k > 0 && isWord(at(k - 1), "operator")) {
+                // operator new, operator bool
+                head->text = QStringLiteral("operator ") + string(previous);
+                head->name = k - 1;
+                k = k - 1;
+            } else if (nonFunctionWords().contains(text(previous)) || isMacroName(previous)) {
+                return false;
+            } else {
+                head->text = string(previous);
+                head->name = k;
+            }
+        } else {
+            return false;
+        }
+
+        // Destructor and qualification: A::B::~C
+        if (k > 0 && isPunct(at(k - 1), '~')) {
+            head->text.prepend('~');
+            --k;
+            head->name = k;
+        }
+        QStringList scopes;
+        while (k >= 2 && isScope(at(k - 1))) {
+            int j = k - 2;
+            if (isPunct(at(j), '>')) {
+                // Foo<T>::bar
+                int angle = 0;
+                for (; j >= 0; --j) {
+                    if (isPunct(at(j), '>')) {
+                        ++angle;
+                    } else if (isPunct(at(j), '<') && --angle == 0) {
+                        --j;
+                        break;
+                    }
+                }
+            }
+            if (j < 0 || !isIdentifier(at(j))) {
+                break;
+            }
+            scopes.prepend(string(at(j)));
+            k = j;
+        }
+        head->qualifier = scopes.join(QStringLiteral("::"));
+        return true;
+    }
+
+    // The name a declarator introduces: "x" in "int x = 1", "fp" in
+    // "void (*fp)(int)". Returns a position, or -1.
+    int declaratorName(int from) const
+    {
+        int found = -1;
+        int last = -1;
+        walkTopLevel(from, m_statement.size(), [this, from, &found, &last](int k) {
+            const int i = at(k);
+            if (isPunct(i, '=') || isPunct(i, ',') || isPunct(i, ':')) {
+                found = last;
+                return false;
+            }
+            if (isIdentifier(i)) {
+                last = k;
+            }
+            return true;
+        });
+        if (found < 0) {
+            found = last;
+        }
+
+        // Pointers to functions and arrays: the name sits in the first group
+        for (int k = from; k + 1 < m_statement.size(); ++k) {
+            if (isPunct(at(k), '(') && (isPunct(at(k + 1), '*') || isPunct(at(k + 1), '&') || isPunct(at(k + 1), '^'))) {
+                for (int j = k + 1; j < m_statement.size() && !isPunct(at(j), ')'); ++j) {
+                    if (isIdentifier(at(j)) && !isWord(at(j), "const")) {
+                        found = j;
+                    }
+                }
+                break;
+            }
+            if (isPunct(at(k), '=')) {
+                break;
+            }
+        }
+
+        // "[N]" or "{...}" after the name is not part of it
+        if (found > from && isIdentifier(at(found)) && !nonFunctionWords().contains(text(at(found)))) {
+            return found;
+        }
+        return -1;
+    }
+
+    // Scopes and symbols --------------------------------------------------
+
+    static QString joinScope(const QString &outer, const QString &inner)
+    {
+        if (outer.isEmpty()) {
+            return inner;
+        }
+        if (inner.isEmpty()) {
+            return outer;
+        }
+        return outer + QStringLiteral("::") + inner;
+    }
+
+    void addSymbol(const Token &t, const QString &name, Symbol::Kind kind, bool definition, const QString &qualifier,
+                   bool scoped = true)
+    {
+        Symbol symbol;
+        symbol.name = name;
+        symbol.container = scoped ? joinScope(m_scopes.back().container, qualifier) : qualifier;
+        symbol.kind = kind;
+        symbol.definition = definition;
+        symbol.line = t.line;
+
+        // Columns are counted in UTF-16 units, like the editor does
+        const char *lineBegin = m_data + t.lineStart;
+        const int bytes = t.offset - t.lineStart;
+        bool ascii = true;
+        for (int i = 0; i < bytes; ++i) {
+            if (uchar(lineBegin[i]) >= 0x80) {
+                ascii = false;
+                break;
+            }
+        }
+        symbol.column = ascii ? bytes : QString::fromUtf8(lineBegin, bytes).size();
+        m_symbols.append(symbol);
+    }
+
+    void pushScope(Scope::Kind kind, const QString &container, bool typedefName = false)
+    {
+        m_scopes.push_back(Scope{kind, container, typedefName});
+    }
+
+    void popScope(int braceToken)
+    {
+        if (m_scopes.size() <= 1) {
+            m_statement.clear();
+            return;
+        }
+        const Scope scope = m_scopes.back();
+        m_scopes.pop_back();
+
+        // Statements only matter in namespaces and classes
+        const Scope::Kind outer = m_scopes.back().kind;
+        if (outer != Scope::Namespace && outer != Scope::Class) {
+            return;
+        }
+        if (scope.kind == Scope::Initializer) {
+            // "int x{1}" or a constructor's "m_x{1}": the declaration goes on
+            m_statement.append(braceToken);
+            return;
+        }
+        m_statement.clear();
+        m_pendingTypedef = scope.typedefName;
+    }
+
+    // Parsing -------------------------------------------------------------
+
+    void parse()
+    {
+        const int count = int(m_tokens.size());
+        for (int i = 0; i < count; ++i) {
+            const Scope::Kind kind = m_scopes.back().kind;
+
+            if (kind == Scope::Body || kind == Scope::Initializer) {
+                if (isPunct(i, '{')) {
+                    pushScope(Scope::Body, QString());
+                } else if (isPunct(i, '}')) {
+                    popScope(i);
+                }
+                continue;
+            }
+
+            if (kind == Scope::Enum) {
+                enumToken(i);
+                continue;
+            }
+
+            if (isPunct(i, '{')) {
+                openBrace(i);
+            } else if (isPunct(i, '}')) {
+                popScope(i);
+            } else if (isPunct(i, ';')) {
+                endStatement();
+                m_statement.clear();
+            } else if (isPunct(i, ':') && isAccessLabel()) {
+                m_statement.clear();
+            } else if (isIdentifier(i) && attributeWords().contains(text(i)) && i + 1 < count && isPunct(i + 1, '(')) {
+                i = skipGroup(i + 1);
+            } else if (isPunct(i, '[') && i + 1 < count && isPunct(i + 1, '[')) {
+                // [[attribute]]
+                i = skipGroup(i);
+            } else if (m_statement.isEmpty() && isMacroName(i)) {
+                if (i + 1 < count && isPunct(i + 1, '(')) {
+                    i = skipGroup(i + 1);
+                } else if (i + 1 < count && token(i + 1).line == token(i).line) {
+                    m_statement.append(i);
+                }
+                // A bare macro alone on its line, like Q_OBJECT, is dropped
+            } else {
+                m_statement.append(i);
+            }
+        }
+    }
+
+    bool isAccessLabel() const
+    {
+        if (m_statement.isEmpty()) {
+            return false;
+        }
+        for (const int i : m_statement) {
+            if (!accessWords().contains(text(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void enumToken(int i)
+    {
+        if (isPunct(i, '{')) {
+            pushScope(Scope::Body, QString());
+        } else if (isPunct(i, '}')) {
+            popScope(i);
+        } else if (isPunct(i, '(') || isPunct(i, '[')) {
+            ++m_enumDepth;
+        } else if (isPunct(i, ')') || isPunct(i, ']')) {
+            m_enumDepth = qMax(0, m_enumDepth - 1);
+        } else if (isPunct(i, ',') && m_enumDepth == 0) {
+            m_expectEnumerator = true;
+        } else if (isIdentifier(i) && m_expectEnumerator && m_enumDepth == 0) {
+            addSymbol(token(i), string(i), Symbol::Enumerator, true, QString());
+            m_expectEnumerator = false;
+        }
+    }
+
+    // Position of class, struct, union or enum introducing a type, or -1
+    int classKey(int from) const
+    {
+        int found = -1;
+        walkTopLevel(from, m_statement.size(), [this, &found](int k) {
+            const int i = at(k);
+            if (isPunct(i, '(') || isPunct(i, '=')) {
+                return false;
+            }
+            if (isWord(i, "class") || isWord(i, "struct") || isWord(i, "union") || isWord(i, "enum")) {
+                found = k;
+                return false;
+            }
+            return true;
+        });
+        return found;
+    }
+
+    void openBrace(int braceToken)
+    {
+        const QString container = m_scopes.back().container;
+        m_pendingTypedef = false;
+
+        const int from = statementStart();
+        const int size = m_statement.size();
+        if (from >= size) {
+            pushScope(Scope::Body, container);
+            m_statement.clear();
+            return;
+        }
+
+        // namespace A::B {
+        if (isWord(at(from), "namespace")) {
+            QStringList parts;
+            int name = -1;
+            for (int k = from + 1; k < size; ++k) {
+                if (isIdentifier(at(k))) {
+                    parts.append(string(at(k)));
+                    name = k;
+                }
+            }
+            if (name >= 0) {
+                const QString inner = parts.takeLast();
+                addSymbol(token(at(name)), inner, Symbol::Namespace, true, parts.join(QStringLiteral("::")));
+                parts.append(inner);
+            }
+            pushScope(Scope::Namespace, joinScope(container, parts.join(QStringLiteral("::"))));
+            m_statement.clear();
+            return;
+        }
+
+        // extern "C" {
+        if (isWord(at(from), "extern") && from + 1 < size && token(at(from + 1)).type == Token::Literal) {
+            pushScope(Scope::Namespace, container);
+            m_statement.clear();
+            return;
+        }
+
+        // Braces after "=" belong to an initializer or a lambda
+        if (findTopLevel(from, '=') >= 0) {
+            pushScope(Scope::Initializer, container);
+            m_statement.append(braceToken);
+            return;
+        }
+
+        const int key = classKey(from);
+        if (key >= 0 && findTopLevel(from, '(') < 0) {
+            openType(key, isWord(at(from), "typedef"));
+            m_statement.clear();
+            return;
+        }
+
+        const FunctionHead head = functionHead(from);
+        if (head.paren >= 0) {
+            // Inside a constructor's initializer list, "m_x{1}" is not the body
+            const int close = matchingParen(head.paren);
+            const int last = at(size - 1);
+            bool initializerList = false;
+            for (int k = close + 1; k < size; ++k) {
+                if (isPunct(at(k), ':')) {
+                    initializerList = true;
+                    break;
+                }
+            }
+            if (initializerList && (isIdentifier(last) || isPunct(last, '>')) && !isWord(last, "const")
+                && !isWord(last, "override") && !isWord(last, "final") && !isWord(last, "noexcept")) {
+                pushScope(Scope::Initializer, container);
+                m_statement.append(braceToken);
+                return;
+            }
+
+            addSymbol(token(at(head.name)), head.text, Symbol::Function, true, head.qualifier);
+            pushScope(Scope::Body, joinScope(container, joinScope(head.qualifier, head.text)));
+            m_statement.clear();
+            return;
+        }
+
+        // int x{1};
+        if (findTopLevel(from, '(') < 0 && declaratorName(from) >= 0) {
+            pushScope(Scope::Initializer, container);
+            m_statement.append(braceToken);
+            return;
+        }
+
+        pushScope(Scope::Body, container);
+        m_statement.clear();
+    }
+
+    void openType(int key, bool typedefName)
+    {
+        const QString container = m_scopes.back().container;
+        Symbol::Kind kind = Symbol::Class;
+        if (isWord(at(key), "struct")) {
+            kind = Symbol::Struct;
+        } else if (isWord(at(key), "union")) {
+            kind = Symbol::Union;
+        } else if (isWord(at(key), "enum")) {
+            kind = Symbol::Enum;
+            if (key + 1 < m_statement.size() && (isWord(at(key + 1), "class") || isWord(at(key + 1), "struct"))) {
+                ++key;
+            }
+        }
+
+        // The name is the last top-level word before the base clause:
+        // "class EXPORT Foo final : public Bar"
+        int name = -1;
+        walkTopLevel(key + 1, m_statement.size(), [this, &name](int k) {
+            const int i = at(k);
+            if (isPunct(i, ':')) {
+                return false;
+            }
+            if (isIdentifier(i) && !isWord(i, "final") && !isWord(i, "sealed")) {
+                name = k;
+            }
+            return true;
+        });
+
+        QString qualified;
+        if (name >= 0) {
+            QStringList scopes;
+            for (int k = name; k >= 2 && isScope(at(k - 1)) && isIdentifier(at(k - 2)); k -= 2) {
+                scopes.prepend(string(at(k - 2)));
+            }
+            const QString qualifier = scopes.join(QStringLiteral("::"));
+            addSymbol(token(at(name)), string(at(name)), kind, true, qualifier);
+            qualified = joinScope(qualifier, string(at(name)));
+        }
+
+        if (kind == Symbol::Enum) {
+            // Unscoped enumerators are listed under the enum all the same
+            pushScope(Scope::Enum, joinScope(container, qualified), typedefName);
+            m_expectEnumerator = true;
+            m_enumDepth = 0;
+        } else {
+            pushScope(Scope::Class, joinScope(container, qualified), typedefName);
+        }
+    }
+
+    void endStatement()
+    {
+        const bool pendingTypedef = m_pendingTypedef;
+        m_pendingTypedef = false;
+
+        int from = statementStart();
+        const int size = m_statement.size();
+        if (from >= size) {
+            return;
+        }
+
+        // typedef struct { ... } Name;
+        if (pendingTypedef) {
+            for (int k = from; k < size; ++k) {
+                const int i = at(k);
+                if (isIdentifier(i) && !nonFunctionWords().contains(text(i))) {
+                    addSymbol(token(i), string(i), Symbol::Typedef, true, QString());
+                    break;
+                }
+            }
+            return;
+        }
+
+        const int first = at(from);
+        if (isWord(first, "using")) {
+            if (from + 1 < size && isIdentifier(at(from + 1)) && findTopLevel(from, '=') >= 0) {
+                addSymbol(token(at(from + 1)), string(at(from + 1)), Symbol::Typedef, true, QString());
+            }
+            return;
+        }
+        if (isWord(first, "typedef")) {
+            const int name = declaratorName(from + 1);
+            if (name >= 0) {
+                addSymbol(token(at(name)), string(at(name)), Symbol::Typedef, true, QString());
+            }
+            return;
+        }
+        if (isWord(first, "friend") || isWord(first, "namespace") || isWord(first, "template")
+            || isWord(first, "static_assert") || isWord(first, "_Static_assert")) {
+            return;
+        }
+        if (isWord(first, "extern") && from + 1 < size && token(at(from + 1)).type == Token::Literal) {
+            from += 2;
+            if (from >= size) {
+                return;
+            }
+        }
+
+        // Forward declarations: class Foo;
+        const int key = classKey(from);
+        if (key >= 0 && findTopLevel(from, '(') < 0) {
+            return;
+        }
+
+        const bool inClass = m_scopes.back().kind == Scope::Class;
+        const FunctionHead head = functionHead(from);
+        if (head.paren >= 0) {
+            // "= default" defines; "= 0" and "= delete" do not
+            const int close = matchingParen(head.paren);
+            const bool defaulted = close + 2 < size && isPunct(at(close + 1), '=') && isWord(at(close + 2), "default");
+            addSymbol(token(at(head.name)), head.text, Symbol::Function, defaulted, head.qualifier);
+            return;
+        }
+
+        const int name = declaratorName(from);
+        if (name < 0) {
+            return;
+        }
+        bool isExtern = false;
+        for (int k = from; k < name; ++k) {
+            if (isWord(at(k), "extern")) {
+                isExtern = true;
+                break;
+            }
+        }
+        addSymbol(token(at(name)), string(at(name)), inClass ? Symbol::Field : Symbol::Variable, !isExtern,
+                  QString());
+    }
+
+    const char *m_data;
+    int m_size;
+    std::vector<Token> m_tokens;
+    QVector<Scope> m_scopes;
+    QVector<int> m_statement;
+    QVector<Symbol> m_symbols;
+
+    bool m_pendingTypedef = false;
+    bool m_expectEnumerator = false;
+    int m_enumDepth = 0;
+};
+
+} // namespace
+
+QString symbolKindName(Symbol::Kind kind)
+{
+    switch (kind) {
+    case Symbol::Namespace:
+        return QStringLiteral("namespace");
+    case Symbol::Class:
+        return QStringLiteral("class");
+    case Symbol::Struct:
+        return QStringLiteral("struct");
+    case Symbol::Union:
+        return QStringLiteral("union");
+    case Symbol::Enum:
+        return QStringLiteral("enum");
+    case Symbol::Enumerator:
+        return QStringLiteral("enumerator");
+    case Symbol::Function:
+        return QStringLiteral("function");
+    case Symbol::Variable:
+        return QStringLiteral("variable");
+    case Symbol::Field:
+        return QStringLiteral("field");
+    case Symbol::Typedef:
+        return QStringLiteral("type");
+    case Symbol::Macro:
+        return QStringLiteral("macro");
+    }
+    return QString();
+}
+
+QVector<Symbol> CppSymbolParser::parse(const char *data, qint64 size)
+{
+    if (!data || size <= 0 || size > INT_MAX) {
+        return QVector<Symbol>();
+    }
+    return Parser(data, int(size)).run();
+}
+
+bool CppSymbolParser::isCppFile(const QString &filePath)
+{
+    static const QSet<QString> suffixes = {
+        "c", "cc", "cpp", "cxx", "c++", "h", "hh", "hpp", "hxx", "h++", "inl", "ipp", "tpp", "ixx", "cppm"
+    };
+    return suffixes.contains(QFileInfo(filePath).suffix().toLower());
+}
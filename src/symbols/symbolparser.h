@@ -0,0 +1,44 @@
+#ifndef SYMBOLPARSER_H
+#define SYMBOLPARSER_H
+
+#include <QString>
+#include <QVector>
+
+struct Symbol
+{
+    enum Kind : quint8 {
+        Namespace,
+        Class,
+        Struct,
+        Union,
+        Enum,
+        Enumerator,
+        Function,
+        Variable,
+        Field,
+        Typedef,
+        Macro
+    };
+
+    QString name;
+    QString container;      // enclosing scopes, "ns::Class"
+    Kind kind = Function;
+    bool definition = false;
+    int line = 0;           // zero-based
+    int column = 0;         // UTF-16 units
+};
+
+QString symbolKindName(Symbol::Kind kind);
+
+// Extracts declarations and definitions from C and C++ source without
+// preprocessing or type information. It tokenizes, tracks scopes by braces
+// and classifies each top-level or member statement; function bodies are
+// skipped. Good enough for navigation, not for compilation.
+class CppSymbolParser
+{
+public:
+    static QVector<Symbol> parse(const char *data, qint64 size);
+    static bool isCppFile(const QString &filePath);
+};
+
+#endif // SYMBOLPARSER_H
@@ -0,0 +1,159 @@
+#include "symbolsearchdialog.h"
+
+#include <QVBoxLayout>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QLabel>
+#include <QKeyEvent>
+#include <QElapsedTimer>
+#include <QApplication>
+
+namespace {
+
+const int kMaxResults = 200;
+
+enum ItemRole {
+    FilePathRole = Qt::UserRole,
+    LineRole,
+    ColumnRole,
+    LengthRole
+};
+
+} // namespace
+
+SymbolSearchDialog::SymbolSearchDialog(SymbolIndex *index, QWidget *parent)
+    : QDialog(parent, Qt::Popup | Qt::FramelessWindowHint)
+    , m_index(index)
+{
+    m_queryEdit = new QLineEdit();
+    m_queryEdit->setPlaceholderText("Go to symbol in workspace");
+    m_queryEdit->installEventFilter(this);
+
+    m_resultList = new QListWidget();
+    m_resultList->setUniformItemSizes(true);
+    m_resultList->setFocusPolicy(Qt::NoFocus);
+
+    m_statusLabel = new QLabel();
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 6, 6, 6);
+    layout->setSpacing(4);
+    layout->addWidget(m_queryEdit);
+    layout->addWidget(m_resultList, 1);
+    layout->addWidget(m_statusLabel);
+
+    connect(m_queryEdit, &QLineEdit::textChanged, this, &SymbolSearchDialog::updateResults);
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &SymbolSearchDialog::activateCurrent);
+    connect(m_resultList, &QListWidget::itemActivated, this, &SymbolSearchDialog::activateCurrent);
+
+    resize(720, 420);
+}
+
+void SymbolSearchDialog::popup()
+{
+    m_queryEdit->clear();
+    m_resultList->clear();
+    m_statusLabel->setText(QString("%1 symbols in %2 files%3")
+                               .arg(m_index->symbolCount()).arg(m_index->fileCount())
+                               .arg(m_index->isIndexing() ? ", indexing..." : ""));
+    placeAndShow();
+}
+
+void SymbolSearchDialog::showLocations(const QString &title, const QVector<SymbolLocation> &locations)
+{
+    // The title is not a query
+    m_queryEdit->blockSignals(true);
+    m_queryEdit->clear();
+    m_queryEdit->blockSignals(false);
+    m_queryEdit->setPlaceholderText(title);
+
+    showResults(locations);
+    m_statusLabel->setText(QString("%1 locations").arg(locations.size()));
+    placeAndShow();
+}
+
+void SymbolSearchDialog::placeAndShow()
+{
+    if (QWidget *owner = parentWidget()) {
+        const QRect frame = owner->geometry();
+        move(frame.x() + (frame.width() - width()) / 2, frame.y() + frame.height() / 8);
+    }
+    show();
+    m_queryEdit->setFocus();
+}
+
+bool SymbolSearchDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    // Navigation keys go to the list while the query keeps the focus
+    if (watched == m_queryEdit && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QApplication::sendEvent(m_resultList, event);
+            return true;
+        default:
+            break;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
+
+void SymbolSearchDialog::updateResults(const QString &query)
+{
+    m_queryEdit->setPlaceholderText("Go to symbol in workspace");
+    if (query.trimmed().isEmpty()) {
+        m_resultList->clear();
+        m_statusLabel->clear();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<SymbolLocation> locations = m_index->search(query, kMaxResults);
+    showResults(locations);
+    m_statusLabel->setText(QString("%1 shown of %2 symbols (%3 ms)")
+                               .arg(locations.size()).arg(m_index->symbolCount()).arg(timer.elapsed()));
+}
+
+void SymbolSearchDialog::showResults(const QVector<SymbolLocation> &locations)
+{
+    const QString prefix = m_index->rootPath() + '/';
+
+    m_resultList->setUpdatesEnabled(false);
+    m_resultList->clear();
+    for (const SymbolLocation &location : locations) {
+        const Symbol &symbol = location.symbol;
+        const QString relativePath = location.filePath.startsWith(prefix)
+            ? location.filePath.mid(prefix.size())
+            : location.filePath;
+        const QString name = symbol.container.isEmpty() ? symbol.name : symbol.container + "::" + symbol.name;
+        const QString label = QString("%1    %2%3    %4:%5")
+                                  .arg(name, symbolKindName(symbol.kind),
+                                       symbol.definition ? QString() : QString(" declaration"),
+                                       relativePath, QString::number(symbol.line + 1));
+
+        QListWidgetItem *item = new QListWidgetItem(label, m_resultList);
+        item->setData(FilePathRole, location.filePath);
+        item->setData(LineRole, symbol.line);
+        item->setData(ColumnRole, symbol.column);
+        item->setData(LengthRole, symbol.name.size());
+        item->setToolTip(location.filePath);
+    }
+    m_resultList->setCurrentRow(0);
+    m_resultList->setUpdatesEnabled(true);
+}
+
+void SymbolSearchDialog::activateCurrent()
+{
+    QListWidgetItem *item = m_resultList->currentItem();
+    if (!item) {
+        return;
+    }
+    hide();
+    emit symbolSelected(item->data(FilePathRole).toString(), item->data(LineRole).toInt(),
+                        item->data(ColumnRole).toInt(), item->data(LengthRole).toInt());
+}
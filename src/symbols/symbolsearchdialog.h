@@ -0,0 +1,48 @@
+#ifndef SYMBOLSEARCHDIALOG_H
+#define SYMBOLSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+#include "symbolindex.h"
+
+class QLineEdit;
+class QListWidget;
+class QLabel;
+
+// Ctrl+T palette over the project's symbols. Also lists the candidates
+// when Go to Definition finds more than one.
+class SymbolSearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SymbolSearchDialog(SymbolIndex *index, QWidget *parent = nullptr);
+
+    // Shows the palette with an empty query
+    void popup();
+    // Shows a fixed list; typing a query searches the whole project again
+    void showLocations(const QString &title, const QVector<SymbolLocation> &locations);
+
+signals:
+    void symbolSelected(const QString &filePath, int line, int column, int length);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void updateResults(const QString &query);
+    void activateCurrent();
+
+private:
+    void showResults(const QVector<SymbolLocation> &locations);
+    void placeAndShow();
+
+    SymbolIndex *m_index;
+
+    QLineEdit *m_queryEdit;
+    QListWidget *m_resultList;
+    QLabel *m_statusLabel;
+};
+
+#endif // SYMBOLSEARCHDIALOG_H
@@ -0,0 +1,516 @@
+#include "outputconsole.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QContextMenuEvent>
+#include <QScrollBar>
+#include <QTimer>
+#include <QMenu>
+#include <QInputDialog>
+#include <QApplication>
+#include <QClipboard>
+#include <QStringList>
+
+namespace {
+
+const int kDefaultMaxLines = 100000;
+
+// Longer lines are cut; the rest up to the newline is dropped
+const int kMaxLineLength = 8192;
+const int kTabWidth = 4;
+
+// Escape sequences longer than this are garbage, not something to wait for
+const int kMaxEscapeLength = 64;
+
+// Pending output is parsed and painted once per frame
+const int kIngestInterval = 16;
+
+const QRgb kAnsiColors[16] = {
+    qRgb(0, 0, 0), qRgb(205, 49, 49), qRgb(13, 188, 121), qRgb(229, 229, 16),
+    qRgb(36, 114, 200), qRgb(188, 63, 188), qRgb(17, 168, 205), qRgb(229, 229, 229),
+    qRgb(102, 102, 102), qRgb(241, 76, 76), qRgb(35, 209, 139), qRgb(245, 245, 67),
+    qRgb(59, 142, 234), qRgb(214, 112, 214), qRgb(41, 184, 219), qRgb(255, 255, 255)
+};
+
+QRgb ansi256Color(int index)
+{
+    if (index < 16) {
+        return kAnsiColors[qBound(0, index, 15)];
+    }
+    if (index < 232) {
+        // 6x6x6 cube
+        static const int levels[6] = {0, 95, 135, 175, 215, 255};
+        index -= 16;
+        return qRgb(levels[index / 36], levels[index / 6 % 6], levels[index % 6]);
+    }
+    const int gray = 8 + (qMin(index, 255) - 232) * 10;
+    return qRgb(gray, gray, gray);
+}
+
+} // namespace
+
+ConsoleBuffer::ConsoleBuffer(int maximumLineCount)
+    : m_capacity(qMax(1, maximumLineCount))
+    , m_head(0)
+    , m_count(0)
+    , m_totalLines(0)
+    , m_lastLineOpen(false)
+    , m_longestLine(0)
+    , m_color(0)
+    , m_bold(false)
+    , m_carriageReturn(false)
+{
+}
+
+void ConsoleBuffer::setMaximumLineCount(int count)
+{
+    count = qMax(1, count);
+    if (count == m_capacity) {
+        return;
+    }
+
+    // Keep the newest lines, in order from slot 0
+    const int kept = qMin(count, m_count);
+    QVector<ConsoleLine> lines;
+    lines.reserve(kept);
+    for (int i = m_count - kept; i < m_count; ++i) {
+        lines.append(line(i));
+    }
+    m_lines = lines;
+    m_head = 0;
+    m_count = kept;
+    m_capacity = count;
+    if (kept == 0) {
+        m_lastLineOpen = false;
+    }
+}
+
+void ConsoleBuffer::clear()
+{
+    m_lines.clear();
+    m_head = 0;
+    m_count = 0;
+    m_totalLines = 0;
+    m_lastLineOpen = false;
+    m_longestLine = 0;
+    m_color = 0;
+    m_bold = false;
+    m_escape.clear();
+    m_carriageReturn = false;
+}
+
+ConsoleLine &ConsoleBuffer::openLine()
+{
+    if (m_lastLineOpen) {
+        return m_lines[(m_head + m_count - 1) % m_lines.size()];
+    }
+
+    // The ring grows up to its capacity, then reuses the oldest slot
+    int slot;
+    if (m_lines.size() < m_capacity) {
+        slot = m_lines.size();
+        m_lines.append(ConsoleLine());
+        ++m_count;
+    } else if (m_count < m_lines.size()) {
+        slot = (m_head + m_count) % m_lines.size();
+        m_lines[slot] = ConsoleLine();
+        ++m_count;
+    } else {
+        slot = m_head;
+        m_head = (m_head + 1) % m_lines.size();
+        m_lines[slot] = ConsoleLine();
+    }
+
+    ++m_totalLines;
+    m_lastLineOpen = true;
+    return m_lines[slot];
+}
+
+void ConsoleBuffer::appendRun(ConsoleLine &line, const QChar *data, int length)
+{
+    length = qMin(length, kMaxLineLength - line.text.size());
+    if (length <= 0) {
+        return;
+    }
+
+    if (m_color != 0 || m_bold) {
+        if (!line.spans.isEmpty()) {
+            ConsoleSpan &last = line.spans.last();
+            if (last.start + last.length == line.text.size() && last.color == m_color && last.bold == m_bold) {
+                last.length += length;
+                line.text.append(data, length);
+                m_longestLine = qMax(m_longestLine, line.text.size());
+                return;
+            }
+        }
+        line.spans.append(ConsoleSpan{line.text.size(), length, m_color, m_bold});
+    }
+    line.text.append(data, length);
+    m_longestLine = qMax(m_longestLine, line.text.size());
+}
+
+void ConsoleBuffer::append(const QString &text)
+{
+    const QChar *data = text.constData();
+    const int length = text.length();
+    int pos = 0;
+
+    while (pos < length) {
+        // Escape sequences may be split between two appends
+        if (!m_escape.isEmpty()) {
+            const QChar c = data[pos++];
+            m_escape += c;
+            if (m_escape.size() == 2 && c != QLatin1Char('[')) {
+                // Two-character escape; nothing to show for it
+                m_escape.clear();
+            } else if (m_escape.size() > 2 && c.unicode() >= 0x40 && c.unicode() <= 0x7e) {
+                applyEscape(m_escape);
+                m_escape.clear();
+            } else if (m_escape.size() > kMaxEscapeLength) {
+                m_escape.clear();
+            }
+            continue;
+        }
+
+        // A lone carriage return redraws its line, as progress output expects
+        if (m_carriageReturn) {
+            m_carriageReturn = false;
+            if (data[pos] != QLatin1Char('\n') && m_lastLineOpen) {
+                ConsoleLine &line = openLine();
+                line.text.clear();
+                line.spans.clear();
+            }
+        }
+
+        int end = pos;
+        while (end < length && data[end].unicode() >= 0x20 && data[end].unicode() != 0x7f) {
+            ++end;
+        }
+        if (end > pos) {
+            appendRun(openLine(), data + pos, end - pos);
+            pos = end;
+            continue;
+        }
+
+        switch (data[pos++].unicode()) {
+        case '\n':
+            openLine();
+            m_lastLineOpen = false;
+            break;
+        case '\r':
+            m_carriageReturn = true;
+            break;
+        case '\t': {
+            ConsoleLine &line = openLine();
+            const QString spaces(kTabWidth - line.text.size() % kTabWidth, QLatin1Char(' '));
+            appendRun(line, spaces.constData(), spaces.size());
+            break;
+        }
+        case 0x1b:
+            m_escape = QChar(0x1b);
+            break;
+        default:
+            // Other control characters
+            break;
+        }
+    }
+}
+
+void ConsoleBuffer::applyEscape(const QString &sequence)
+{
+    // Only SGR (ESC [ ... m) changes what is shown
+    if (!sequence.endsWith(QLatin1Char('m'))) {
+        return;
+    }
+
+    const QStringList parameters = sequence.mid(2, sequence.size() - 3).split(QLatin1Char(';'));
+    for (int i = 0; i < parameters.size(); ++i) {
+        const int code = parameters.at(i).toInt();
+        if (code == 0) {
+            m_color = 0;
+            m_bold = false;
+        } else if (code == 1) {
+            m_bold = true;
+        } else if (code == 22) {
+            m_bold = false;
+        } else if (code >= 30 && code <= 37) {
+            m_color = kAnsiColors[code - 30];
+        } else if (code >= 90 && code <= 97) {
+            m_color = kAnsiColors[code - 90 + 8];
+        } else if (code == 39) {
+            m_color = 0;
+        } else if (code == 38 || code == 48) {
+            // Extended colours; backgrounds are parsed only to be skipped
+            QRgb color = 0;
+            const int mode = i + 1 < parameters.size() ? parameters.at(i + 1).toInt() : 0;
+            if (mode == 5 && i + 2 < parameters.size()) {
+                color = ansi256Color(parameters.at(i + 2).toInt());
+                i += 2;
+            } else if (mode == 2 && i + 4 < parameters.size()) {
+                color = qRgb(parameters.at(i + 2).toInt(), parameters.at(i + 3).toInt(), parameters.at(i + 4).toInt());
+                i += 4;
+            }
+            if (code == 38 && color != 0) {
+                m_color = color;
+            }
+        }
+    }
+}
+
+OutputConsole::OutputConsole(QWidget *parent)
+    : QAbstractScrollArea(parent)
+    , m_buffer(kDefaultMaxLines)
+    , m_ingestTimer(new QTimer(this))
+    , m_lineHeight(1)
+    , m_charWidth(1)
+    , m_selectionAnchor(-1)
+    , m_selectionEnd(-1)
+{
+    QFont font("Consolas", 10);
+    font.setFixedPitch(true);
+    setFont(font);
+
+    m_lineHeight = qMax(1, fontMetrics().lineSpacing());
+    m_charWidth = qMax(1, fontMetrics().width(QLatin1Char('9')));
+
+    m_ingestTimer->setSingleShot(true);
+    m_ingestTimer->setInterval(kIngestInterval);
+    connect(m_ingestTimer, &QTimer::timeout, this, &OutputConsole::ingest);
+
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+void OutputConsole::appendText(const QString &text)
+{
+    m_pending += text;
+    if (!m_ingestTimer->isActive()) {
+        m_ingestTimer->start();
+    }
+}
+
+void OutputConsole::ingest()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    QScrollBar *bar = verticalScrollBar();
+    const bool following = bar->value() >= bar->maximum();
+    const int value = bar->value();
+    const qint64 firstLine = m_buffer.firstLineNumber();
+
+    m_buffer.append(m_pending);
+    m_pending.resize(0);
+
+    // Lines that fell off the top move the view up with them
+    const int dropped = int(m_buffer.firstLineNumber() - firstLine);
+    updateScrollBars();
+    bar->setValue(following ? bar->maximum() : value - dropped);
+    viewport()->update();
+}
+
+void OutputConsole::setMaximumLineCount(int count)
+{
+    ingest();
+    m_buffer.setMaximumLineCount(count);
+    updateScrollBars();
+    viewport()->update();
+}
+
+void OutputConsole::clear()
+{
+    m_ingestTimer->stop();
+    m_pending.clear();
+    m_buffer.clear();
+    m_selectionAnchor = -1;
+    m_selectionEnd = -1;
+    updateScrollBars();
+    viewport()->update();
+}
+
+void OutputConsole::updateScrollBars()
+{
+    const int visibleLines = qMax(1, viewport()->height() / m_lineHeight);
+    verticalScrollBar()->setRange(0, qMax(0, m_buffer.lineCount() - visibleLines));
+    verticalScrollBar()->setPageStep(visibleLines);
+    verticalScrollBar()->setSingleStep(1);
+
+    const int textWidth = viewport()->width() - 8;
+    horizontalScrollBar()->setRange(0, qMax(0, m_buffer.longestLine() * m_charWidth - textWidth));
+    horizontalScrollBar()->setPageStep(qMax(1, textWidth));
+    horizontalScrollBar()->setSingleStep(m_charWidth);
+}
+
+void OutputConsole::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), QColor(30, 30, 30));
+
+    const QColor defaultColor(220, 220, 220);
+    const QFont normalFont = font();
+    QFont boldFont = font();
+    boldFont.setBold(true);
+
+    const int firstIndex = verticalScrollBar()->value();
+    const int visibleLines = viewport()->height() / m_lineHeight + 1;
+    const int x = 4 - horizontalScrollBar()->value();
+    const int ascent = fontMetrics().ascent();
+    const qint64 selectionFirst = qMin(m_selectionAnchor, m_selectionEnd);
+    const qint64 selectionLast = qMax(m_selectionAnchor, m_selectionEnd);
+
+    for (int i = 0; i < visibleLines && firstIndex + i < m_buffer.lineCount(); ++i) {
+        const ConsoleLine &line = m_buffer.line(firstIndex + i);
+        const qint64 lineNumber = m_buffer.firstLineNumber() + firstIndex + i;
+        const int y = i * m_lineHeight;
+        if (selectionFirst >= 0 && lineNumber >= selectionFirst && lineNumber <= selectionLast) {
+            painter.fillRect(0, y, viewport()->width(), m_lineHeight, QColor(38, 79, 120));
+        }
+
+        if (line.spans.isEmpty()) {
+            painter.setPen(defaultColor);
+            painter.setFont(normalFont);
+            painter.drawText(x, y + ascent, line.text);
+            continue;
+        }
+
+        // Fixed pitch: every run starts at its column
+        auto drawRun = [&](int start, int length, QRgb color, bool bold) {
+            painter.setPen(color != 0 ? QColor::fromRgb(color) : defaultColor);
+            painter.setFont(bold ? boldFont : normalFont);
+            painter.drawText(x + start * m_charWidth, y + ascent, line.text.mid(start, length));
+        };
+        int pos = 0;
+        for (const ConsoleSpan &span : line.spans) {
+            if (span.start > pos) {
+                drawRun(pos, span.start - pos, 0, false);
+            }
+            drawRun(span.start, span.length, span.color, span.bold);
+            pos = span.start + span.length;
+        }
+        if (pos < line.text.size()) {
+            drawRun(pos, line.text.size() - pos, 0, false);
+        }
+    }
+}
+
+void OutputConsole::resizeEvent(QResizeEvent *event)
+{
+    QScrollBar *bar = verticalScrollBar();
+    const bool following = bar->value() >= bar->maximum();
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+    if (following) {
+        bar->setValue(bar->maximum());
+    }
+}
+
+qint64 OutputConsole::lineNumberAt(const QPoint &pos) const
+{
+    if (m_buffer.lineCount() == 0) {
+        return -1;
+    }
+    const int index = qBound(0, verticalScrollBar()->value() + pos.y() / m_lineHeight, m_buffer.lineCount() - 1);
+    return m_buffer.firstLineNumber() + index;
+}
+
+void OutputConsole::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_selectionAnchor = lineNumberAt(event->pos());
+        m_selectionEnd = m_selectionAnchor;
+        viewport()->update();
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+void OutputConsole::mouseMoveEvent(QMouseEvent *event)
+{
+    if ((event->buttons() & Qt::LeftButton) && m_selectionAnchor >= 0) {
+        m_selectionEnd = lineNumberAt(event->pos());
+        viewport()->update();
+    }
+    QAbstractScrollArea::mouseMoveEvent(event);
+}
+
+void OutputConsole::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    const qint64 lineNumber = lineNumberAt(event->pos());
+    if (lineNumber >= 0) {
+        emit lineActivated(m_buffer.line(int(lineNumber - m_buffer.firstLineNumber())).text);
+    }
+}
+
+void OutputConsole::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy)) {
+        copySelection();
+        return;
+    }
+    if (event->matches(QKeySequence::SelectAll)) {
+        selectAll();
+        return;
+    }
+    if (event->matches(QKeySequence::MoveToStartOfDocument)) {
+        verticalScrollBar()->setValue(0);
+        return;
+    }
+    if (event->matches(QKeySequence::MoveToEndOfDocument)) {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void OutputConsole::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu menu(this);
+    QAction *copyAction = menu.addAction("&Copy", this, &OutputConsole::copySelection);
+    copyAction->setEnabled(m_selectionAnchor >= 0);
+    menu.addAction("Select &All", this, &OutputConsole::selectAll);
+    menu.addAction("C&lear", this, &OutputConsole::clear);
+    menu.addSeparator();
+    menu.addAction(QString("&Scrollback Limit (%1 lines)...").arg(maximumLineCount()),
+                   this, &OutputConsole::promptMaximumLineCount);
+    menu.exec(event->globalPos());
+}
+
+void OutputConsole::promptMaximumLineCount()
+{
+    bool ok = false;
+    const int count = QInputDialog::getInt(this, "Output Scrollback", "Lines to keep:", maximumLineCount(),
+                                           1000, 10000000, 10000, &ok);
+    if (ok && count != maximumLineCount()) {
+        setMaximumLineCount(count);
+        emit maximumLineCountChanged(count);
+    }
+}
+
+void OutputConsole::selectAll()
+{
+    if (m_buffer.lineCount() == 0) {
+        return;
+    }
+    m_selectionAnchor = m_buffer.firstLineNumber();
+    m_selectionEnd = m_buffer.totalLineCount() - 1;
+    viewport()->update();
+}
+
+void OutputConsole::copySelection()
+{
+    if (m_selectionAnchor < 0) {
+        return;
+    }
+
+    // Lines that scrolled out of the buffer are gone
+    const qint64 first = qMax(qMin(m_selectionAnchor, m_selectionEnd), m_buffer.firstLineNumber());
+    const qint64 last = qMin(qMax(m_selectionAnchor, m_selectionEnd), m_buffer.totalLineCount() - 1);
+    QStringList lines;
+    for (qint64 lineNumber = first; lineNumber <= last; ++lineNumber) {
+        lines.append(m_buffer.line(int(lineNumber - m_buffer.firstLineNumber())).text);
+    }
+    if (!lines.isEmpty()) {
+        QApplication::clipboard()->setText(lines.join('\n'));
+    }
+}
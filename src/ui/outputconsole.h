@@ -0,0 +1,127 @@
+#ifndef OUTPUTCONSOLE_H
+#define OUTPUTCONSOLE_H
+
+#include <QAbstractScrollArea>
+#include <QString>
+#include <QVector>
+#include <QColor>
+
+class QTimer;
+
+// A run of coloured or bold text within a console line
+struct ConsoleSpan
+{
+    int start;
+    int length;
+    QRgb color;   // 0 for the default colour
+    bool bold;
+};
+
+struct ConsoleLine
+{
+    QString text;
+    QVector<ConsoleSpan> spans;   // empty for plain lines
+};
+
+// Fixed-capacity ring of output lines. ANSI SGR colours are parsed once
+// here, as text comes in; other escape sequences are dropped, tabs are
+// expanded and a carriage return starts its line over. Once the ring is
+// full, every new line replaces the oldest one.
+class ConsoleBuffer
+{
+public:
+    explicit ConsoleBuffer(int maximumLineCount);
+
+    void setMaximumLineCount(int count);
+    int maximumLineCount() const { return m_capacity; }
+
+    // A trailing partial line stays open and is continued by the next call
+    void append(const QString &text);
+    void clear();
+
+    int lineCount() const { return m_count; }
+    const ConsoleLine &line(int index) const { return m_lines.at((m_head + index) % m_lines.size()); }
+
+    // Lines ever appended; line(0) is number totalLineCount() - lineCount()
+    qint64 totalLineCount() const { return m_totalLines; }
+    qint64 firstLineNumber() const { return m_totalLines - m_count; }
+    int longestLine() const { return m_longestLine; }
+
+private:
+    ConsoleLine &openLine();
+    void appendRun(ConsoleLine &line, const QChar *data, int length);
+    void applyEscape(const QString &sequence);
+
+    QVector<ConsoleLine> m_lines;
+    int m_capacity;
+    int m_head;
+    int m_count;
+    qint64 m_totalLines;
+    bool m_lastLineOpen;
+    int m_longestLine;
+
+    // Carried from one line, and one append, to the next
+    QRgb m_color;
+    bool m_bold;
+    QString m_escape;         // unfinished escape sequence
+    bool m_carriageReturn;    // a '\r' not yet known to start "\r\n"
+};
+
+// Output dock console. Producers append text at any rate; it is parsed
+// into the ring buffer once per frame and only the visible lines are
+// painted, so cost per frame does not depend on the scrollback size.
+// The view follows new output while scrolled to the bottom.
+class OutputConsole : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit OutputConsole(QWidget *parent = nullptr);
+
+    void appendText(const QString &text);
+    void appendLine(const QString &line) { appendText(line + '\n'); }
+
+    void setMaximumLineCount(int count);
+    int maximumLineCount() const { return m_buffer.maximumLineCount(); }
+    int lineCount() const { return m_buffer.lineCount(); }
+
+public slots:
+    void clear();
+    void copySelection();
+    void selectAll();
+
+signals:
+    // Double-clicked line, e.g. a compiler diagnostic to jump to
+    void lineActivated(const QString &text);
+    void maximumLineCountChanged(int count);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private slots:
+    void ingest();
+
+private:
+    void updateScrollBars();
+    qint64 lineNumberAt(const QPoint &pos) const;
+    void promptMaximumLineCount();
+
+    ConsoleBuffer m_buffer;
+    QString m_pending;
+    QTimer *m_ingestTimer;
+
+    int m_lineHeight;
+    int m_charWidth;
+
+    // Selected whole lines, as absolute line numbers, or -1
+    qint64 m_selectionAnchor;
+    qint64 m_selectionEnd;
+};
+
+#endif // OUTPUTCONSOLE_H
@@ -0,0 +1,29 @@
+#include "processgroup.h"
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+void ProcessGroupProcess::setupChildProcess()
+{
+#ifdef Q_OS_UNIX
+    ::setpgid(0, 0);
+#endif
+}
+
+void signalProcessGroup(QProcess *process, bool kill)
+{
+#ifdef Q_OS_UNIX
+    const qint64 pid = process->processId();
+    if (pid > 0) {
+        ::kill(-pid_t(pid), kill ? SIGKILL : SIGTERM);
+        return;
+    }
+#endif
+    if (kill) {
+        process->kill();
+    } else {
+        process->terminate();
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef PROCESSGROUP_H
+#define PROCESSGROUP_H
+
+#include <QProcess>
+
+// Starts its program in a process group of its own, so a build tool or a
+// program that forks can be stopped together with its children.
+// Subclasses that set up more in the child call the base implementation.
+class ProcessGroupProcess : public QProcess
+{
+public:
+    explicit ProcessGroupProcess(QObject *parent = nullptr) : QProcess(parent) {}
+
+protected:
+    void setupChildProcess() override;
+};
+
+// Sends SIGTERM, or SIGKILL when kill is set, to the whole group of a
+// ProcessGroupProcess; elsewhere it falls back to terminate() and kill()
+void signalProcessGroup(QProcess *process, bool kill);
+
+#endif // PROCESSGROUP_H
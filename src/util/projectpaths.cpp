@@ -0,0 +1,16 @@
+#include "projectpaths.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+
+QString projectKey(const QString &rootPath)
+{
+    const QByteArray key = QCryptographicHash::hash(QDir::cleanPath(rootPath).toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QString::fromLatin1(key.left(16));
+}
+
+QString projectCachePath(const QString &rootPath, const QString &name, const QString &suffix,
+                         QStandardPaths::StandardLocation location)
+{
+    return QStandardPaths::writableLocation(location) + '/' + name + '/' + projectKey(rootPath) + suffix;
+}
@@ -0,0 +1,15 @@
+#ifndef PROJECTPATHS_H
+#define PROJECTPATHS_H
+
+#include <QString>
+#include <QStandardPaths>
+
+// Short stable key for a project root: the first 16 hex digits of the SHA-1
+// of its cleaned path. Used to name per-project files and settings groups.
+QString projectKey(const QString &rootPath);
+
+// <location>/<name>/<key><suffix>, e.g. the cached file index of a project
+QString projectCachePath(const QString &rootPath, const QString &name, const QString &suffix,
+                         QStandardPaths::StandardLocation location = QStandardPaths::CacheLocation);
+
+#endif // PROJECTPATHS_H